@@ -4,6 +4,10 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "gtopogroup.h"
+#include "gtopogeo.h"
+#include "gtopomosaic.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 // Stores the data from the input tuples about the image and its placement.
 typedef struct gtopoSubDEM
@@ -11,26 +15,37 @@ typedef struct gtopoSubDEM
     gtopoDEM *subDEM;
     int startRow;
     int startColumn;
+    int width;
+    int height;
 } gtopoSubDEM;
 
 
 /*
- * Frees memory allocated to the sub-DEMs.
+ * Frees memory allocated to the sub-DEMs, which were all read into one arena,
+ * the origin they were placed relative to, and any mosaic kept of them.
  */
-void freeSubDEMs(gtopoSubDEM *subDEMs, int amount)
+void freeSubDEMs(gtopoSubDEM *subDEMs, gtopoArena *subDEMArena, gtopoGeoReference *origin, gtopoMosaic *mosaic)
 {
-    int x;
-    for (x = 0; x < amount; x++)
-    {
-        if (subDEMs[x].subDEM != NULL)
-            freeDEM(subDEMs[x].subDEM);
-    }
     free(subDEMs);
+    freeArena(subDEMArena);
+    freeGeoReference(origin);
+    freeMosaic(mosaic);
 }
 
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    // Remove any --incremental flag, which patches the output from the last run.
+    int incremental = takeIncrementalFlag(&argc, argv);
+
     /*
      * Check argument count is greater than or equal to 9. The program requires 
      * at least 9 arguments to be provided:
@@ -102,9 +117,36 @@ int main(int argc, char **argv)
     int subDEMamount = (argc - 4) / 5;
     gtopoSubDEM *subDEMs = (gtopoSubDEM *) malloc(sizeof(gtopoSubDEM) * subDEMamount);
 
+    // The sub-DEMs are read into an arena and released together once assembled.
+    gtopoArena *subDEMArena = createArena();
+    gtopoGeoReference *origin = NULL;
+    gtopoMosaic *mosaic = NULL;
+
+    error = checkAllocated(subDEMs);
+    if (error == NULL)
+        error = checkAllocated(subDEMArena);
+
+    // An incremental assembly keeps a manifest of the sub-DEMs beside the output.
+    if (error == NULL && incremental)
+    {
+        mosaic = createMosaic(argv[1], widthDEM, heightDEM, 1, subDEMamount);
+        error = checkAllocated(mosaic);
+    }
+
+    if (error != NULL)
+    {
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
+        return displayError(error);
+    }
+
+    /*
+     * Sub-DEMs placed at auto auto are positioned by their .HDR files, relative
+     * to the north-west corner of them all.
+     */
+    origin = readPlacementOrigin(argv + 4, subDEMamount, 5);
     if (error != NULL)
     {
-        freeSubDEMs(subDEMs, subDEMamount);
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
         return displayError(error);
     }
 
@@ -113,84 +155,94 @@ int main(int argc, char **argv)
     int argIndex = 4;
     for (count = 0; count < subDEMamount; count++) 
     {
-        // Read the row location to insert the image at.
-        char *row;
-        int rowDEM = strtol(argv[argIndex], &row, 10);
-
-        error = checkInvalidPosition(rowDEM, heightDEM, *row);
+        // Read where to insert the sub-DEM, which can be auto auto to place it by its coordinates.
+        parsePlacement(origin, argv[argIndex], argv[argIndex + 1], argv[argIndex + 2], widthDEM, heightDEM,
+            &subDEMs[count].startRow, &subDEMs[count].startColumn);
         if (error != NULL)
         {
-            freeSubDEMs(subDEMs, subDEMamount);
+            freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
             return displayError(error);
         }
 
-        // Store the sub-DEM's row starting position if no error occurred.
-        subDEMs[count].startRow = rowDEM;
-
-
-        // Read the column location to insert the image at.
-        char *column;
-        int columnDEM = strtol(argv[argIndex + 1], &column, 10);
-
-        error = checkInvalidPosition(columnDEM, widthDEM, *column);
+        // Read the sub-DEM's width and height, which can both be auto.
+        parseDimensions(argv[argIndex + 2], argv[argIndex + 3], argv[argIndex + 4], &subDEMs[count].width,
+            &subDEMs[count].height);
         if (error != NULL)
         {
-            freeSubDEMs(subDEMs, subDEMamount);
+            freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
             return displayError(error);
         }
 
-        // Store the sub-DEM's column starting position if no error occurred.
-        subDEMs[count].startColumn = columnDEM;
+        if (mosaic != NULL)
+            setMosaicInput(mosaic, count, argv[argIndex + 2], subDEMs[count].startRow, subDEMs[count].startColumn,
+                subDEMs[count].width, subDEMs[count].height);
 
-        /* 
-         * Convert the width CLI argument to an integer. Check that the width is valid.
-         * Has to be an integer greater than one.
-         */
-        int subWidthDEM = strtol(argv[argIndex + 3], &width, 10);
+        // Add 5 to argIndex to point to the next sub-DEM to insert.
+        argIndex = argIndex + 5;
+    }
 
-        error = checkInvalidWidth(subWidthDEM, *width);
-        if (error != NULL)
-        {
-            freeSubDEMs(subDEMs, subDEMamount);
-            return displayError(error);
-        }
+    /*
+     * If the output is as the last incremental assembly left it, only the
+     * sub-DEMs that have changed since are read, and patched into it in place.
+     */
+    if (mosaic != NULL && planMosaicUpdate(mosaic))
+    {
+        profilePhase(PHASE_WRITE);
 
-        /* 
-         * Convert the height CLI argument to an integer. Check that the height is valid.
-         * Has to be an integer greater than one.
-         */
-        int subHeightDEM = strtol(argv[argIndex + 4], &height, 10);
+        patchMosaic(mosaic);
+        if (error == NULL)
+            saveManifest(mosaic);
 
-        error = checkInvalidHeight(subHeightDEM, *height);
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
         if (error != NULL)
-        {
-            freeSubDEMs(subDEMs, subDEMamount);
             return displayError(error);
-        }
 
+        printf(STR_ASSEMBLED);
+        return EXIT_NO_ERRORS;
+    }
+
+    if (error != NULL)
+    {
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_READ);
+
+    for (count = 0; count < subDEMamount; count++)
+    {
         // Open the sub-DEM to be assembled.
-        subDEMs[count].subDEM = readDEM(argv[argIndex + 2], subWidthDEM, subHeightDEM);
-        
+        subDEMs[count].subDEM = readArenaDEM(subDEMArena, argv[4 + 5 * count + 2], subDEMs[count].width,
+            subDEMs[count].height);
+
         // If the external error pointer is no longer null, a file read error has been detected.
         if (error != NULL)
         {
-            freeSubDEMs(subDEMs, subDEMamount);
+            freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
             return displayError(error);
         }
-
-        // Add 5 to argIndex to point to the next sub-DEM to insert.
-        argIndex = argIndex + 5;
     }
 
-    // Initialise the image that we assemble the sub-DEMs onto if no error occurred.
-    gtopoDEM *parentDEM = createDEM(widthDEM, heightDEM);
+    profilePhase(PHASE_COMPUTE);
 
-    // Check that the image was allocated.
+    /*
+     * Initialise the image that we assemble the sub-DEMs onto if no error occurred.
+     * It is not filled, as the sub-DEMs usually cover all of it. Instead the
+     * points they cover are recorded, and only the gaps are set to no data.
+     */
+    gtopoDEM *parentDEM = createUnfilledDEM(NULL, widthDEM, heightDEM);
+    gtopoCoverage *coverage = createCoverage(widthDEM, heightDEM);
+
+    // Check that the image and its coverage were allocated.
     error = checkDEMallocated(parentDEM);
+    if (error == NULL)
+        error = checkAllocated(coverage);
+
     if (error != NULL)
     {
         freeDEM(parentDEM);
-        freeSubDEMs(subDEMs, subDEMamount);
+        freeCoverage(coverage);
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
         return displayError(error);
     }
 
@@ -203,27 +255,46 @@ int main(int argc, char **argv)
         // If pixels to add were outside of the image, exit.
         if (success == 1)
         {
-            freeSubDEMs(subDEMs, subDEMamount);
+            freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
             freeDEM(parentDEM);
+            freeCoverage(coverage);
             printf(STR_BAD_LAYOUT);
             return EXIT_BAD_LAYOUT;
         }
 
+        coverRegion(coverage, subDEMs[count].startRow, subDEMs[count].startColumn,
+            getWidth(subDEMs[count].subDEM), getHeight(subDEMs[count].subDEM));
     }
 
+    // Set the points no sub-DEM covered to have no data.
+    fillUncovered(parentDEM, coverage, NO_DATA);
+    freeCoverage(coverage);
+
+    profilePhase(PHASE_WRITE);
+
     // Write the final DEM data to disk with the path stored in argv[1].
     echoDEM(parentDEM, argv[1]);
 
+    // A DEM assembled by coordinates keeps its georeferencing in a .HDR file.
+    if (error == NULL && origin != NULL)
+        writeGeoReference(origin, argv[1], widthDEM, heightDEM);
+
     // Check that the file wrote to disk properly.
     if (error != NULL)
     {
-        freeSubDEMs(subDEMs, subDEMamount);
+        freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
         freeDEM(parentDEM);
         return displayError(error);
     }
 
+    // Record the sub-DEMs this output was assembled from, for the next incremental assembly.
+    if (mosaic != NULL)
+        saveManifest(mosaic);
+
+    profilePhase(PHASE_FREE);
+
     // Clean up before exiting.
-    freeSubDEMs(subDEMs, subDEMamount);
+    freeSubDEMs(subDEMs, subDEMArena, origin, mosaic);
     freeDEM(parentDEM);
 
     // Display success string and exit the program.
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopobatch.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is exactly equal to 2. The program requires only 2
+     * arguments to be provided:
+     *
+     * argv[0] = Program name
+     * argv[1] = Job file path, with one echo, reduce, tile or printland job per line
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s jobFile\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 2)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    // Read and check every job before running any of them.
+    gtopoBatch *batch = readBatch(argv[1]);
+
+    // If the external error pointer is no longer null, the job file could not be read.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    /*
+     * Run the jobs on the worker threads, reading each input DEM once for all of
+     * the jobs that use it. Every failed job is reported with its line.
+     */
+    runBatch(batch);
+    int code = reportBatch(batch);
+
+    profilePhase(PHASE_FREE);
+
+    freeBatch(batch);
+
+    if (code != EXIT_NO_ERRORS)
+        return code;
+
+    // Display success string and exit the program.
+    printf(STR_BATCHED);
+    return EXIT_NO_ERRORS;
+}
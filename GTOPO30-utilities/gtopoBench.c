@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopocompare.h"
+#include "gtopogroup.h"
+#include "gtopoland.h"
+#include "gtoposhrink.h"
+
+#define DEFAULT_REPEATS 3
+#define BENCH_REDUCE_FACTOR 2
+#define BENCH_TILE_FACTOR 4
+
+// Elevations of the synthetic DEM below this are ocean (NO_DATA), as in GTOPO30.
+#define BENCH_COAST 400
+
+
+/*
+ * The DEMs and scratch files shared by the benchmarks. Each benchmark times one
+ * operation on them, doing any setup and tidying outside of the timed section.
+ */
+typedef struct benchState
+{
+    gtopoDEM *dem;
+    gtopoDEM *readBack;
+    gtopoDEM ***tiles;
+    char *demPath;
+    char *landPath;
+    char *pyramidPath;
+} benchState;
+
+
+/*
+ * Returns the time in seconds from a monotonic clock.
+ */
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+
+/*
+ * Resets the peak resident memory of the process to what it holds now, so that
+ * each benchmark reports its own peak rather than the largest one before it.
+ * Linux supports this through clear_refs. Elsewhere the peak is left as it is.
+ */
+static void resetPeakResident()
+{
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+
+/*
+ * Returns the peak resident memory of the process since resetPeakResident() in
+ * kilobytes, or since it started where that cannot be reset.
+ */
+static long peakResidentKB()
+{
+    long peak = -1;
+    char line[256];
+    FILE *file = fopen("/proc/self/status", "r");
+
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "VmHWM: %ld", &peak) == 1)
+            break;
+    }
+
+    if (file != NULL)
+        fclose(file);
+
+    if (peak >= 0)
+        return peak;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+/*
+ * Fills the DEM with rolling synthetic terrain, leaving the low ground as ocean
+ * so that the data has the mix of NO_DATA and land of a real GTOPO30 tile. The
+ * same size always gives the same DEM.
+ */
+static void fillTerrain(gtopoDEM *dem)
+{
+    signed short **raster = getRaster(dem);
+    unsigned int noise = 12345;
+
+    int row;
+    int column;
+
+    for (row = 0; row < getHeight(dem); row++)
+    {
+        for (column = 0; column < getWidth(dem); column++)
+        {
+            noise = noise * 1103515245 + 12345;
+            int elevation = 2000 + 1800 * sin(row * 0.002) * cos(column * 0.003) + (int) (noise >> 16) % 200 - 100;
+            raster[row][column] = elevation < BENCH_COAST ? NO_DATA : elevation;
+        }
+    }
+}
+
+
+static double benchEcho(benchState *state)
+{
+    double start = now();
+    echoDEM(state->dem, state->demPath);
+    return now() - start;
+}
+
+
+static double benchRead(benchState *state)
+{
+    freeDEM(state->readBack);
+
+    double start = now();
+    state->readBack = readDEM(state->demPath, getWidth(state->dem), getHeight(state->dem));
+    return now() - start;
+}
+
+
+static double benchReduce(benchState *state)
+{
+    double start = now();
+    gtopoDEM *reduced = reduce(state->dem, BENCH_REDUCE_FACTOR);
+    double seconds = now() - start;
+
+    freeDEM(reduced);
+    return seconds;
+}
+
+
+static double benchTile(benchState *state)
+{
+    if (state->tiles != NULL)
+        freeTiles(state->tiles, BENCH_TILE_FACTOR);
+
+    double start = now();
+    state->tiles = tile(state->dem, BENCH_TILE_FACTOR, NULL);
+    return now() - start;
+}
+
+
+static double benchAssemble(benchState *state)
+{
+    gtopoDEM *assembled = createDEM(getWidth(state->dem), getHeight(state->dem));
+    error = checkDEMallocated(assembled);
+    if (error != NULL)
+        return 0;
+
+    int row;
+    int column;
+    int startRow = 0;
+
+    double start = now();
+    for (row = 0; row < BENCH_TILE_FACTOR; row++)
+    {
+        int startColumn = 0;
+        for (column = 0; column < BENCH_TILE_FACTOR; column++)
+        {
+            addDEM(assembled, state->tiles[row][column], startRow, startColumn);
+            startColumn += getWidth(state->tiles[row][column]);
+        }
+        startRow += getHeight(state->tiles[row][0]);
+    }
+    double seconds = now() - start;
+
+    freeDEM(assembled);
+    return seconds;
+}
+
+
+// Keeps the result of compare, which the release build would otherwise optimise away.
+static volatile int compared;
+
+
+static double benchCompare(benchState *state)
+{
+    double start = now();
+    compared = compare(state->dem, state->readBack);
+    return now() - start;
+}
+
+
+/*
+ * Times printing land with the min/max pyramid built from scratch, removing the
+ * one the run before left so the fastest run cannot be one that reused it.
+ */
+static double benchPrintLand(benchState *state)
+{
+    unlink(state->pyramidPath);
+
+    double start = now();
+    printLand(state->demPath, getWidth(state->dem), getHeight(state->dem), state->landPath, 0, 500, 1500);
+    return now() - start;
+}
+
+
+/*
+ * Runs a benchmark the given number of times and prints a line for its fastest
+ * run. MB/s counts the bytes of elevation data processed, 2 for each sample.
+ * Returns 1 if the benchmark failed, leaving the error set.
+ */
+static int runBench(char *name, double (*bench)(benchState *state), benchState *state, int repeats)
+{
+    double fastest = 0;
+
+    resetPeakResident();
+
+    int repeat;
+    for (repeat = 0; repeat < repeats; repeat++)
+    {
+        error = NULL;
+        double seconds = bench(state);
+
+        if (error != NULL)
+            return 1;
+
+        if (repeat == 0 || seconds < fastest)
+            fastest = seconds;
+    }
+
+    // Avoid dividing by zero for DEMs too small to time.
+    if (fastest <= 0)
+        fastest = 1e-9;
+
+    double samples = (double) getWidth(state->dem) * getHeight(state->dem);
+    printf("%s,%d,%d,%.6f,%.2f,%.0f,%ld\n", name, getWidth(state->dem), getHeight(state->dem), fastest,
+        samples * 2 / fastest / 1e6, samples / fastest, peakResidentKB());
+    fflush(stdout);
+    return 0;
+}
+
+
+/*
+ * Returns the path of a scratch file in the directory, which the caller frees.
+ */
+static char* scratchPath(char *directory, char *name)
+{
+    char *path = (char *) malloc(strlen(directory) + strlen(name) + 2);
+
+    if (path != NULL)
+        sprintf(path, "%s/%s", directory, name);
+
+    return path;
+}
+
+
+int main(int argc, char **argv)
+{
+    /*
+     * Check argument count is between 3 and 5. The program requires these
+     * arguments to be provided:
+     *
+     * argv[0] = Program name
+     * argv[1] = Width of the synthetic DEM
+     * argv[2] = Height of the synthetic DEM
+     * argv[3] = Number of times to run each benchmark, keeping the fastest (optional)
+     * argv[4] = Directory for the scratch files (optional, the current directory by default)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s width height [repeats] [scratchDirectory]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc < 3 || argc > 5)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Convert the width and height CLI arguments to integers. They have the same
+     * limits as any DEM, up to the full 43200x21600 GTOPO30 grid.
+     */
+    char *end;
+    int width = strtol(argv[1], &end, 10);
+    error = checkInvalidWidth(width, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    int height = strtol(argv[2], &end, 10);
+    error = checkInvalidHeight(height, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    // The repeat count is checked like a factor: an integer greater than 0.
+    int repeats = DEFAULT_REPEATS;
+    if (argc > 3)
+    {
+        repeats = strtol(argv[3], &end, 10);
+        error = checkInvalidFactor(repeats, *end);
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    char *directory = argc > 4 ? argv[4] : ".";
+
+    benchState state;
+    memset(&state, 0, sizeof(benchState));
+    state.demPath = scratchPath(directory, "gtopoBench.dem");
+    state.landPath = scratchPath(directory, "gtopoBench.txt");
+    state.pyramidPath = scratchPath(directory, "gtopoBench.dem.pyr");
+    state.dem = createDEM(width, height);
+
+    error = checkDEMallocated(state.dem);
+    if (error == NULL && (state.demPath == NULL || state.landPath == NULL || state.pyramidPath == NULL))
+        error = checkAllocated(NULL);
+
+    if (error != NULL)
+        goto cleanup;
+
+    fillTerrain(state.dem);
+
+    // Each benchmark uses the results of those before it, so stop at the first failure.
+    printf("benchmark,width,height,seconds,mb_per_second,samples_per_second,peak_rss_kb\n");
+
+    if (runBench("echoDEM", benchEcho, &state, repeats) ||
+        runBench("readDEM", benchRead, &state, repeats) ||
+        runBench("reduce", benchReduce, &state, repeats) ||
+        runBench("tile", benchTile, &state, repeats) ||
+        runBench("addDEM", benchAssemble, &state, repeats) ||
+        runBench("compare", benchCompare, &state, repeats) ||
+        runBench("printLand", benchPrintLand, &state, repeats))
+        goto cleanup;
+
+    goto cleanup;
+
+    cleanup:
+    if (state.demPath != NULL)
+        unlink(state.demPath);
+    if (state.landPath != NULL)
+        unlink(state.landPath);
+    if (state.pyramidPath != NULL)
+        unlink(state.pyramidPath);
+
+    if (state.tiles != NULL)
+        freeTiles(state.tiles, BENCH_TILE_FACTOR);
+
+    freeDEM(state.dem);
+    freeDEM(state.readBack);
+    free(state.demPath);
+    free(state.landPath);
+    free(state.pyramidPath);
+
+    if (error != NULL)
+        return displayError(error);
+
+    return EXIT_NO_ERRORS;
+}
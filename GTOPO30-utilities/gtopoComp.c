@@ -3,9 +3,19 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "gtopocompare.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
     /*
      * Check argument count is exactly equal to 5. The program requires only 5
      * arguments to be provided:
@@ -28,29 +38,18 @@ int main(int argc, char **argv)
     }
 
 
-    // Read width and height from argv[2] and argv[3] respectively.
-
-    /* 
-     * Convert the width CLI argument to an integer. Check that the width is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
      */
-    char *width;
-    int widthDEM = strtol(argv[2], &width, 10);
-
-    error = checkInvalidWidth(widthDEM, *width);
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
     if (error != NULL)
         return displayError(error);
 
-    /* 
-     * Convert the height CLI argument to an integer. Check that the height is valid.
-     * Has to be an integer greater than one.
-     */
-    char *height;
-    int heightDEM = strtol(argv[3], &height, 10);
-
-    error = checkInvalidHeight(heightDEM, *height);
-    if (error != NULL)
-        return displayError(error);
+    profilePhase(PHASE_READ);
 
     // Read DEM file 1 and store returned pointer to the DEM structure. 
     gtopoDEM *inputDEMOne = readDEM(argv[1], widthDEM, heightDEM);
@@ -79,6 +78,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_COMPUTE);
+
     // Compare the two images and determine logical equivalence.
     int result = compare(inputDEMOne, inputDEMTwo);
 
@@ -92,6 +93,8 @@ int main(int argc, char **argv)
         printf(STR_DIFFERENT);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Free memory allocated to the images and exit.
     freeDEM(inputDEMOne);
     freeDEM(inputDEMTwo);    
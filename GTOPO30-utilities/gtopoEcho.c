@@ -1,55 +1,71 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "gtopoio.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 // DEM (Digital Elevation Model)
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
     /*
-     * Check argument count is exactly equal to 5. The program requires only 5
-     * arguments to be provided:
+     * Check argument count is equal to 5 or 6. The program requires 5 arguments
+     * to be provided, with an optional sixth:
      * 
      * argv[0] = Program name
      * argv[1] = Input file path
      * argv[2] = Width of the DEM data 
      * argv[3] = Height of the DEM data
      * argv[4] = Output file path
+     * argv[5] = Write mode, 0 for raw (default) or 1 for bit-packed (optional)
      */
     if (argc == 1)
     {
-        printf("Usage: %s inputFile width height outputFile\n", argv[0]);
+        printf("Usage: %s inputFile width height outputFile [writeMode]\n", argv[0]);
         return EXIT_NO_ERRORS;
     }
-    else if (argc != 5)
+    else if (argc != 5 && argc != 6)
     {
         printf(STR_BAD_ARGS_COUNT);
         return EXIT_BAD_ARGS_COUNT;
     }
 
-    // Read width and height from argv[2] and argv[3] respectively.
-
-    /* 
-     * Convert the width CLI argument to an integer. Check that the width is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
      */
-    char *width;
-    int widthDEM = strtol(argv[2], &width, 10);
-
-    error = checkInvalidWidth(widthDEM, *width);
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
     if (error != NULL)
         return displayError(error);
 
-    /* 
-     * Convert the height CLI argument to an integer. Check that the height is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Convert the optional write mode CLI argument to an integer. Check that the mode
+     * is valid. Has to be either 0 or 1.
      */
-    char *height;
-    int heightDEM = strtol(argv[3], &height, 10);
+    int writeMode = RAW;
+    if (argc == 6)
+    {
+        char *mode;
+        writeMode = strtol(argv[5], &mode, 10);
 
-    error = checkInvalidHeight(heightDEM, *height);
-    if (error != NULL)
-        return displayError(error);
+        error = checkInvalidWriteMode(*mode == '\0' ? writeMode : -1);
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    profilePhase(PHASE_READ);
 
     // Read DEM and store returned pointer to the elevation structure. 
     gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
@@ -63,8 +79,10 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
-    // Write the data referenced by the image pointer to a new file with same formatting.
-    echoDEM(inputDEM, argv[4]);
+    profilePhase(PHASE_WRITE);
+
+    // Write the data referenced by the image pointer to a new file in the chosen format.
+    echoDEMEncoded(inputDEM, argv[4], writeMode);
 
     // If the external error pointer is no longer null, a file write error has been detected.
     if (error != NULL)
@@ -73,6 +91,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeDEM(inputDEM);
     printf(STR_ECHOED);
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtoposhade.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 5 or 8. The program requires 5 arguments
+     * to be provided, with the light source and exaggeration optional:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data
+     * argv[3] = Height of the DEM data
+     * argv[4] = Output pgm file path
+     * 
+     * argv[5] = Azimuth of the light in degrees clockwise from north (optional, default 315)
+     * argv[6] = Altitude of the light in degrees above the horizon (default 45)
+     * argv[7] = Z-factor exaggerating the relief (default 1)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height outputFile.pgm [azimuth altitude zFactor]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 5 && argc != 8)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Convert the optional light source and z-factor CLI arguments and check them.
+    double azimuth = 315;
+    double altitude = 45;
+    double zFactor = 1;
+
+    if (argc == 8)
+    {
+        char *azimuthEnd;
+        azimuth = strtod(argv[5], &azimuthEnd);
+
+        char *altitudeEnd;
+        altitude = strtod(argv[6], &altitudeEnd);
+
+        char *zFactorEnd;
+        zFactor = strtod(argv[7], &zFactorEnd);
+
+        error = checkShadingSettings(azimuth, altitude, zFactor, *azimuthEnd, *altitudeEnd, *zFactorEnd);
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Stream the DEM and write its hillshade.
+    hillshade(argv[1], widthDEM, heightDEM, argv[4], azimuth, altitude, zFactor);
+
+    // If the external error pointer is no longer null, a read or write error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    // Display success string and exit the program.
+    printf(STR_SHADED);
+    return EXIT_NO_ERRORS;
+}
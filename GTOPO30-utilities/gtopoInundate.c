@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopoflood.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is exactly equal to 6. The program requires only 6
+     * arguments to be provided:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data
+     * argv[3] = Height of the DEM data
+     * argv[4] = Output file path
+     * argv[5] = Sea level
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height outputFile seaLevel\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 6)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Convert the sea level CLI argument to an integer and check it is a valid elevation.
+    char *seaLevelEnd;
+    int seaLevel = strtol(argv[5], &seaLevelEnd, 10);
+
+    error = checkSeaLevel(seaLevel, *seaLevelEnd);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Flood the DEM from the ocean and write the map of inundated land.
+    inundate(argv[1], widthDEM, heightDEM, argv[4], seaLevel);
+
+    // If the external error pointer is no longer null, a read or write error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    // Display success string and exit the program.
+    printf(STR_INUNDATED);
+    return EXIT_NO_ERRORS;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtopoio.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is exactly equal to 5. The program requires only 5
+     * arguments to be provided:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data 
+     * argv[3] = Height of the DEM data
+     * argv[4] = Output packed file path
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height outputFile\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 5)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_READ);
+
+    // Read DEM and store returned pointer to the elevation structure. 
+    gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+    {
+        if (inputDEM != NULL)
+            freeDEM(inputDEM);
+
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_WRITE);
+
+    // Write the DEM in the packed block format.
+    echoPackedDEM(inputDEM, argv[4]);
+
+    // If the external error pointer is no longer null, a file write error has been detected.
+    if (error != NULL)
+    {
+        freeDEM(inputDEM);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    freeDEM(inputDEM);
+    printf(STR_PACKED);
+    return EXIT_NO_ERRORS;
+}
@@ -1,80 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include "gtopoio.h"
-
-// DEM (Digital Elevation Model)
-
-/*
- * Prints the DEM raster data to the console using the following key:
- * 
- * ' ' (space): Sea (i.e. value <= sea)
- * '.' (full stop): Low ground (sea < value <= hill)
- * '^' (caret): Hills (hill < value <= mountain)
- * 'A': Mountains (mountain < value)
- */
-void printLand(gtopoDEM *inputDEM, char *filePath, int sea, int hill, int mountain)
-{
-    // Open an ASCII file for writing.
-    FILE *outputFile = fopen(filePath, "w");
-
-    // Check that the file opened successfully.
-    error = checkInvalidFileName(outputFile, filePath);
-    if (error != NULL)
-        goto cleanup;
-
-    // Get the DEM raster data.
-    signed short **raster = getRaster(inputDEM);
-
-    /* Print the land using the key based on the elevation values of the
-     * raster and user inputted elevation values for sea, hill and mountain to the
-     * file.
-     */
-    int row;
-    int column;
-    signed short elevation = 0;
-
-    for (row = 0; row < getHeight(inputDEM); row++)
-    {
-        for (column = 0; column < getWidth(inputDEM); column++)
-        {
-            elevation = getElevation(inputDEM, row, column);
-
-            if (elevation <= sea)
-            {
-                fputc(' ', outputFile);
-            }
-            else if (elevation <= hill && elevation > sea)
-            {
-                fputc('.', outputFile);
-            }
-            else if (elevation <= mountain && elevation > hill)
-            {
-                fputc('^', outputFile);
-            }
-            else if (elevation > mountain)
-            {
-                fputc('A', outputFile);
-            }
-        }
-
-        // Append a new line character to the end of each row, except from the last.
-        if (row != getHeight(inputDEM) - 1)
-            fputc('\n', outputFile);
-    }
-
-    // We are now done with the file. Close it.
-    goto cleanup;
-
-    cleanup:
-    if (outputFile != NULL)
-        fclose(outputFile);
-
-    return;
-}
 
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopoland.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
     /*
      * Check argument count is exactly equal to 8. The program requires only 8
      * arguments to be provided:
@@ -99,27 +41,14 @@ int main(int argc, char **argv)
         return EXIT_BAD_ARGS_COUNT;
     }
 
-    // Read width and height from argv[2] and argv[3] respectively.
-
-    /* 
-     * Convert the width CLI argument to an integer. Check that the width is valid.
-     * Has to be an integer greater than one.
-     */
-    char *width;
-    int widthDEM = strtol(argv[2], &width, 10);
-
-    error = checkInvalidWidth(widthDEM, *width);
-    if (error != NULL)
-        return displayError(error);
-
-    /* 
-     * Convert the height CLI argument to an integer. Check that the height is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
      */
-    char *height;
-    int heightDEM = strtol(argv[3], &height, 10);
-
-    error = checkInvalidHeight(heightDEM, *height);
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
     if (error != NULL)
         return displayError(error);
 
@@ -149,31 +78,42 @@ int main(int argc, char **argv)
     if (error != NULL)
         return displayError(error);
 
-    // Read DEM and store returned pointer to the elevation structure. 
-    gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
-
-    // If the external error pointer is no longer null, a file read error has been detected.
-    if (error != NULL)
+    /*
+     * Write the data to the output file in argv[4] using the symbols/keys. A raw
+     * DEM is streamed, skipping blocks that its min/max pyramid shows to be uniform.
+     */
+    if (canStreamDEM(argv[1]))
     {
-        if (inputDEM != NULL)
-            freeDEM(inputDEM);
+        profilePhase(PHASE_COMPUTE);
 
-        return displayError(error);
+        printLand(argv[1], widthDEM, heightDEM, argv[4], seaDEM, hillDEM, mountainDEM);
+
+        // Check if an error occurred attempting to read or write the files.
+        if (error != NULL)
+            return displayError(error);
+
+        return EXIT_NO_ERRORS;
     }
 
-    // Write the data to the output file in argv[4] using the symbols/keys.
-    printLand(inputDEM, argv[4], seaDEM, hillDEM, mountainDEM);
+    profilePhase(PHASE_READ);
 
-    // Check if an error occurred attempting to write the file.
+    // Bit-packed DEMs, and rasters that need converting, are read whole.
+    gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
     if (error != NULL)
-    {
-        if (inputDEM != NULL)
-            freeDEM(inputDEM);
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    printLandDEM(inputDEM, argv[4], seaDEM, hillDEM, mountainDEM);
+
+    profilePhase(PHASE_FREE);
 
+    freeDEM(inputDEM);
+
+    // Check if an error occurred attempting to write the file.
+    if (error != NULL)
         return displayError(error);
-    }
 
     // Exit the program.
-    freeDEM(inputDEM);
     return EXIT_NO_ERRORS;
 }
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopoland.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is exactly equal to 7. The program requires only 7
+     * arguments to be provided:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data
+     * argv[3] = Height of the DEM data
+     * argv[4] = Output file path
+     * argv[5] = Lowest elevation to find
+     * argv[6] = Highest elevation to find
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height outputFile low high\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 7)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Convert the range CLI arguments to integers and check they are ordered elevations.
+    char *low;
+    int lowDEM = strtol(argv[5], &low, 10);
+
+    char *high;
+    int highDEM = strtol(argv[6], &high, 10);
+
+    error = checkElevationRange(lowDEM, highDEM, *low, *high);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Find the elevation points within the range, skipping blocks outside it.
+    findElevations(argv[1], widthDEM, heightDEM, argv[4], lowDEM, highDEM);
+
+    // If the external error pointer is no longer null, a read or write error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    // Display success string and exit the program.
+    printf(STR_QUERIED);
+    return EXIT_NO_ERRORS;
+}
@@ -4,9 +4,22 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "gtoposhrink.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    // Remove any --mean flag, which averages each block instead of keeping its top-left point.
+    int mean = takeMeanFlag(&argc, argv);
+
     /*
      * Check argument count is exactly equal to 6. The program requires only 6
      * arguments to be provided:
@@ -29,27 +42,14 @@ int main(int argc, char **argv)
         return EXIT_BAD_ARGS_COUNT;
     }
 
-    // Read width and height from argv[2] and argv[3] respectively.
-
-    /* 
-     * Convert the width CLI argument to an integer. Check that the width is valid.
-     * Has to be an integer greater than one.
-     */
-    char *width;
-    int widthDEM = strtol(argv[2], &width, 10);
-
-    error = checkInvalidWidth(widthDEM, *width);
-    if (error != NULL)
-        return displayError(error);
-
-    /* 
-     * Convert the height CLI argument to an integer. Check that the height is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
      */
-    char *height;
-    int heightDEM = strtol(argv[3], &height, 10);
-
-    error = checkInvalidHeight(heightDEM, *height);
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
     if (error != NULL)
         return displayError(error);
 
@@ -63,6 +63,24 @@ int main(int argc, char **argv)
     if (error != NULL)
         return displayError(error);
 
+    /*
+     * A raw DEM is streamed through the pipeline, reducing each chunk of rows
+     * as it is read and writing the reduced rows as they are made.
+     */
+    if (canStreamDEM(argv[1]))
+    {
+        profilePhase(PHASE_COMPUTE);
+
+        reduceFile(argv[1], widthDEM, heightDEM, factor, mean, argv[5]);
+        if (error != NULL)
+            return displayError(error);
+
+        printf(STR_REDUCED);
+        return EXIT_NO_ERRORS;
+    }
+
+    profilePhase(PHASE_READ);
+
     // Read image file and store returned pointer to the image structure. 
     gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
 
@@ -75,8 +93,12 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_COMPUTE);
+
     // If checks pass, reduce the image.
-    gtopoDEM *reducedDEM = reduce(inputDEM, factor);
+    gtopoDEM *reducedDEM = mean ? reduceMean(inputDEM, factor) : reduce(inputDEM, factor);
+
+    profilePhase(PHASE_WRITE);
 
     // Write the data referenced by the reduced image pointer to a new file with same formatting.
     echoDEM(reducedDEM, argv[5]);
@@ -89,6 +111,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeDEM(inputDEM);
     freeDEM(reducedDEM);
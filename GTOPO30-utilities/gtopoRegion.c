@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtoposat.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is exactly equal to 6. The program requires only 6
+     * arguments to be provided:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input summed-area table file path
+     * argv[2] = Row of the top-left corner of the region
+     * argv[3] = Column of the top-left corner of the region
+     * argv[4] = Width of the region
+     * argv[5] = Height of the region
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s integralFile row column width height\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 6)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    // Convert the region CLI arguments to integers.
+    char *row;
+    int regionRow = strtol(argv[2], &row, 10);
+
+    char *column;
+    int regionColumn = strtol(argv[3], &column, 10);
+
+    /* 
+     * Check that the width and height of the region are valid. Whether the region
+     * lies within the DEM is checked once the header has been read.
+     */
+    char *width;
+    int regionWidth = strtol(argv[4], &width, 10);
+
+    error = checkInvalidWidth(regionWidth, *width);
+    if (error != NULL)
+        return displayError(error);
+
+    char *height;
+    int regionHeight = strtol(argv[5], &height, 10);
+
+    error = checkInvalidHeight(regionHeight, *height);
+    if (error != NULL)
+        return displayError(error);
+
+    error = checkInvalidPosition(regionRow, MAX_ROWS, *row);
+    if (error != NULL)
+        return displayError(error);
+
+    error = checkInvalidPosition(regionColumn, MAX_COLUMNS, *column);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_READ);
+
+    // Open the summed-area table, which stores the dimensions of its DEM.
+    gtopoIntegral *index = openIntegral(argv[1]);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Look up the statistics of the region from the corners of the table.
+    double mean;
+    double landFraction;
+    regionStatistics(index, regionRow, regionColumn, regionWidth, regionHeight, &mean, &landFraction);
+
+    profilePhase(PHASE_FREE);
+
+    closeIntegral(index);
+
+    if (error != NULL)
+        return displayError(error);
+
+    // Print the mean elevation and the fraction of the region with data.
+    printf("%.2f %.4f\n", mean, landFraction);
+    return EXIT_NO_ERRORS;
+}
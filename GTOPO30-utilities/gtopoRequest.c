@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "gtoposerve.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// Longest status line of a reply from gtopoServe.
+#define MAX_REPLY_LINE 256
+
+/*
+ * Reads a line of the reply, up to and including its new line, one byte at a
+ * time so that no elevations after it are consumed. Returns 1 if the server
+ * closed the connection first and 0 otherwise.
+ */
+static int readReplyLine(int socket, char *line)
+{
+    int length = 0;
+
+    while (length < MAX_REPLY_LINE - 1)
+    {
+        if (recv(socket, line + length, 1, 0) != 1)
+            return 1;
+
+        length++;
+
+        if (line[length - 1] == '\n')
+        {
+            line[length] = '\0';
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Reads size bytes of the reply. Returns 1 if the server closed the connection
+ * first and 0 otherwise.
+ */
+static int readReplyBytes(int socket, char *bytes, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t received = recv(socket, bytes, size, 0);
+        if (received <= 0)
+            return 1;
+
+        bytes = bytes + received;
+        size = size - received;
+    }
+
+    return 0;
+}
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 3 or 4. The program requires 3 arguments
+     * to be provided, with the output file optional:
+     *
+     * argv[0] = Program name
+     * argv[1] = Path of the Unix socket gtopoServe is listening on
+     * argv[2] = Request, such as "WINDOW 0 0 100 100"
+     *
+     * argv[3] = Output file path for the elevations of a WINDOW or OVERVIEW (optional)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s socketPath request [outputFile]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 3 && argc != 4)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    // Requests are single lines.
+    error = checkRequest(strlen(argv[2]) < MAX_REPLY_LINE && strchr(argv[2], '\n') == NULL);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_READ);
+
+    int server = connectServer(argv[1]);
+
+    // If the external error pointer is no longer null, there is no server on the socket.
+    if (error != NULL)
+        return displayError(error);
+
+    char line[MAX_REPLY_LINE];
+    sprintf(line, "%s\n", argv[2]);
+
+    error = checkRowData(send(server, line, strlen(line), MSG_NOSIGNAL) != (ssize_t) strlen(line) ||
+        readReplyLine(server, line) != 0, argv[1]);
+
+    if (error != NULL)
+    {
+        close(server);
+        return displayError(error);
+    }
+
+    // The server could not answer the request. Display its error.
+    if (strncmp(line, "ERROR", 5) == 0)
+    {
+        close(server);
+        printf("%s", line);
+        return EXIT_MISC;
+    }
+
+    // Replies to WINDOW and OVERVIEW, of OK width height, are followed by that many big-endian elevations.
+    int width;
+    int height;
+    char *elevations = NULL;
+    size_t size = 0;
+    int window = strncmp(argv[2], "WINDOW", 6) == 0 || strncmp(argv[2], "OVERVIEW", 8) == 0;
+
+    if (window && sscanf(line, "OK %d %d", &width, &height) == 2)
+    {
+        size = sizeof(signed short) * (size_t) width * height;
+        elevations = (char *) malloc(size);
+
+        error = checkAllocated(elevations);
+        if (error == NULL)
+            error = checkRowData(readReplyBytes(server, elevations, size), argv[1]);
+    }
+
+    close(server);
+
+    profilePhase(PHASE_WRITE);
+
+    // They are written as they arrive, which is the layout of a raw DEM.
+    if (error == NULL && elevations != NULL && argc == 4)
+    {
+        FILE *outputFile = fopen(argv[3], "wb");
+
+        error = checkInvalidFileName(outputFile, argv[3]);
+        if (error == NULL)
+        {
+            fwrite(elevations, 1, size, outputFile);
+            fclose(outputFile);
+        }
+    }
+
+    profilePhase(PHASE_FREE);
+
+    free(elevations);
+
+    if (error != NULL)
+        return displayError(error);
+
+    // Display the status line of the reply and exit the program.
+    printf("%s", line);
+    return EXIT_NO_ERRORS;
+}
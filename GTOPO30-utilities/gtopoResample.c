@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopofilter.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 7 or 8. The program requires 7 arguments
+     * to be provided, with the filter optional:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data 
+     * argv[3] = Height of the DEM data
+     * argv[4] = Output file path
+     * argv[5] = Width of the output DEM
+     * argv[6] = Height of the output DEM
+     * 
+     * argv[7] = Filter: nearest, bilinear, bicubic or lanczos (optional, default bilinear)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height outputFile outputWidth outputHeight [filter]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 7 && argc != 8)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Convert the output dimensions to integers and check they are valid.
+    char *outputWidth;
+    int outputWidthDEM = strtol(argv[5], &outputWidth, 10);
+
+    error = checkInvalidWidth(outputWidthDEM, *outputWidth);
+    if (error != NULL)
+        return displayError(error);
+
+    char *outputHeight;
+    int outputHeightDEM = strtol(argv[6], &outputHeight, 10);
+
+    error = checkInvalidHeight(outputHeightDEM, *outputHeight);
+    if (error != NULL)
+        return displayError(error);
+
+    // Look up the optional filter.
+    int filter = argc == 8 ? parseFilter(argv[7]) : BILINEAR;
+
+    error = checkInvalidFilter(filter);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Stream the DEM and write it resampled to the output dimensions.
+    resample(argv[1], widthDEM, heightDEM, argv[4], outputWidthDEM, outputHeightDEM, filter);
+
+    // If the external error pointer is no longer null, a read or write error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    // Display success string and exit the program.
+    printf(STR_RESAMPLED);
+    return EXIT_NO_ERRORS;
+}
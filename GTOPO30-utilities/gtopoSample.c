@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtoposample.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 7 or 8. The program requires 7 arguments
+     * to be provided, with the filter optional:
+     *
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data
+     * argv[3] = Height of the DEM data
+     * argv[4] = Units of the points, cells (row column) or degrees (latitude longitude)
+     * argv[5] = Points file path, with one point per line
+     * argv[6] = Output file path, for one elevation per line
+     *
+     * argv[7] = Filter, nearest (default) or bilinear (optional)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height units pointsFile outputFile [filter]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 7 && argc != 8)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Read the units and the filter. Points are sampled at the nearest cell unless told otherwise.
+    int units = parsePointUnits(argv[4]);
+    int filter = argc == 8 ? parseSampleFilter(argv[7]) : SAMPLE_NEAREST;
+
+    error = checkSampleSettings(units >= 0, filter >= 0);
+    if (error != NULL)
+        return displayError(error);
+
+    // Points in degrees are found on the grid given by the .HDR file of the DEM.
+    gtopoGeoReference *reference = NULL;
+
+    if (units == POINT_DEGREES)
+    {
+        reference = readGeoReference(argv[1]);
+
+        if (error == NULL)
+            error = checkPointGeoReference(reference != NULL);
+
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    profilePhase(PHASE_READ);
+
+    gtopoSamplePoints *points = readSamplePoints(argv[5], reference);
+    freeGeoReference(reference);
+
+    // If the external error pointer is no longer null, a points file error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Sample the DEM at every point, reading only the spans of rows they fall on.
+    samplePoints(points, argv[1], widthDEM, heightDEM, filter);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+    {
+        freeSamplePoints(points);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_WRITE);
+
+    writeSamples(points, argv[6]);
+
+    // If the external error pointer is no longer null, a file write error has been detected.
+    if (error != NULL)
+    {
+        freeSamplePoints(points);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    freeSamplePoints(points);
+    printf(STR_SAMPLED);
+    return EXIT_NO_ERRORS;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "gtoposerve.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// Cached blocks when no cache size is given, 64MB of elevations.
+#define DEFAULT_CACHE_BLOCKS 512
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 5 or 6. The program requires 5 arguments
+     * to be provided, with the cache size optional:
+     *
+     * argv[0] = Program name
+     * argv[1] = Path of the Unix socket to listen on
+     * argv[2] = Input file path, of a raw or packed DEM
+     * argv[3] = Width of the DEM data
+     * argv[4] = Height of the DEM data
+     *
+     * argv[5] = Number of 256 x 256 blocks of elevations to keep cached (optional)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s socketPath inputFile width height [cacheBlocks]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 5 && argc != 6)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[3] and argv[4] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[2], argv[3], argv[4], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    // Convert the cache size CLI argument to an integer. Check that it is positive.
+    int cacheBlocks = DEFAULT_CACHE_BLOCKS;
+
+    if (argc == 6)
+    {
+        char *blocks;
+        cacheBlocks = strtol(argv[5], &blocks, 10);
+
+        error = checkCacheSize(cacheBlocks, *blocks);
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    profilePhase(PHASE_READ);
+
+    // Blocks of the DEM are only read when a request first needs them.
+    gtopoCache *cache = createCache(argv[2], widthDEM, heightDEM, cacheBlocks);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    gtopoServer *server = openServer(argv[1], cache, argv[2]);
+
+    // If the external error pointer is no longer null, the socket could not be created.
+    if (error != NULL)
+    {
+        freeCache(cache);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Clients that disconnect mid-reply must not end the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    // Answer requests until a client asks the server to shut down.
+    runServer(server);
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    closeServer(server);
+    freeCache(cache);
+    printf(STR_SERVED);
+    return EXIT_NO_ERRORS;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Includes gtopoio.h. We can use DEM input/output functions and track the external error.
+#include "gtopohistogram.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 4 or 5. The program requires 4 arguments
+     * to be provided, with the histogram file optional:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the DEM data 
+     * argv[3] = Height of the DEM data
+     * 
+     * argv[4] = Output histogram file path (optional)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile width height [histogramFile]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 4 && argc != 5)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
+     */
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_COMPUTE);
+
+    // Count the elevations of the DEM in one pass.
+    gtopoStats *stats = computeStats(argv[1], widthDEM, heightDEM);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_WRITE);
+
+    // Write the histogram, if a file was given for it.
+    if (argc == 5)
+    {
+        writeHistogram(stats, argv[4]);
+
+        if (error != NULL)
+        {
+            free(stats);
+            return displayError(error);
+        }
+    }
+
+    // Display the statistics and exit the program.
+    printf("MIN %d\n", stats->minimum);
+    printf("MAX %d\n", stats->maximum);
+    printf("MEAN %.2f\n", stats->mean);
+    printf("STDDEV %.2f\n", stats->standardDeviation);
+    printf("NO_DATA %lld\n", (long long) stats->noData);
+
+    profilePhase(PHASE_FREE);
+
+    free(stats);
+    return EXIT_NO_ERRORS;
+}
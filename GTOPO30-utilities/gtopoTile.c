@@ -2,96 +2,63 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define ROW_TAG "<row>"
-#define COL_TAG "<column>"
-
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "gtopogroup.h"
-
-void freeTiles(gtopoDEM ***tiles, int factor)
-{
-    int row;
-    int column;
-
-    for (row = 0; row < factor; row++)
-    {
-        free(tiles[row]);
-    }
-    free(tiles);
-}
+#include "gtopogeo.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
 
 
-char* buildPath(char *format, int rowNumber, int columnNumber)
+/*
+ * Gives each tile written by tileFile() its own .HDR file, if the DEM it was
+ * tiled from has one. Every tile but the last in a row or column has the size of
+ * the first. Can return an error.
+ */
+static void writeTileReferences(char *inputPath, int width, int height, int factor, char *outputTemplate)
 {
-    // Counter variable.
-    int x;
+    gtopoGeoReference *reference = readGeoReference(inputPath);
+    if (error != NULL || reference == NULL)
+        return;
 
-    // Copy the output file path format so that we can manipulate it.
-    char *template = (char *) malloc(sizeof(char) * strlen(format) + 1);
-    strcpy(template, format);
-
-    // Convert the row number to a decimal representation
-    char row[10];
-    sprintf(row, "%d", rowNumber);
-
-    // Convert the column number to a decimal representation.
-    char column[10];
-    sprintf(column, "%d", columnNumber);
-
-    // Get starting address of <row> and <column>
-    char *rowTagStart = strstr(template, ROW_TAG);
-    char *columnTagStart = strstr(template, COL_TAG);
-
-    // Set the memory of <row> to -1 to identify it for replacement.
-    for (x = 0; x < strlen(ROW_TAG); x++)
-    {
-        rowTagStart[x] = '\377';
-    }
+    int tileWidth = width / factor;
+    int tileHeight = height / factor;
+    int row;
+    int column;
 
-    // Set the memory of <column> in the template to -2 to identify it for replacement.
-    for (x = 0; x < strlen(COL_TAG); x++)
+    for (row = 0; row < factor && error == NULL; row++)
     {
-        columnTagStart[x] = '\376';
-    }
+        for (column = 0; column < factor && error == NULL; column++)
+        {
+            gtopoGeoReference *tileReference = offsetGeoReference(reference, row * tileHeight, column * tileWidth);
+            error = checkAllocated(tileReference);
 
-    /*
-     * Allocate memory to the path string to return, zeroed by calloc to avoid corrupted
-     * file names that are difficult to delete.
-     */
-    int pathLength = strlen(template) + strlen(row) + strlen(column) - (strlen(ROW_TAG) - strlen(COL_TAG));
-    char *path = (char *) calloc(pathLength, sizeof(char));
+            if (error == NULL)
+            {
+                char *path = buildPath(outputTemplate, row, column);
+                writeGeoReference(tileReference, path,
+                    column == factor - 1 ? tileWidth + width % factor : tileWidth,
+                    row == factor - 1 ? tileHeight + height % factor : tileHeight);
+                free(path);
+            }
 
-    int rowWritten = 0;
-    int columnWritten = 0;
-    for (x = 0; x < strlen(template); x++)
-    {
-        char currentChar[2] = {template[x], '\0'};
-        if (template[x] != '\377' && template[x] != '\376')
-        {
-            // The current character isn't part of a tag. Append the character.
-            strcat(path, currentChar);
-        }
-        else if (template[x] == '\377' && rowWritten == 0)
-        {
-            // Current character is -1, flagging position of <row> tag. Append row number.
-            strcat(path, row);
-            rowWritten = 1;
-        }
-        else if (template[x] == '\376' && columnWritten == 0)
-        {
-            // Current character is -2, flagging position of <column> tag. Append column number.
-            strcat(path, column);
-            columnWritten = 1;
+            freeGeoReference(tileReference);
         }
     }
 
-    free(template);
-    return path;
+    freeGeoReference(reference);
 }
 
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
     /*
      * Check argument count is exactly equal to 6. The program requires only 6
      * arguments to be provided:
@@ -114,27 +81,14 @@ int main(int argc, char **argv)
         return EXIT_BAD_ARGS_COUNT;
     }
 
-    // Read width and height from argv[2] and argv[3] respectively.
-
-    /* 
-     * Convert the width CLI argument to an integer. Check that the width is valid.
-     * Has to be an integer greater than one.
-     */
-    char *width;
-    int widthDEM = strtol(argv[2], &width, 10);
-
-    error = checkInvalidWidth(widthDEM, *width);
-    if (error != NULL)
-        return displayError(error);
-
-    /* 
-     * Convert the height CLI argument to an integer. Check that the height is valid.
-     * Has to be an integer greater than one.
+    /*
+     * Read width and height from argv[2] and argv[3] respectively. Each has to be
+     * an integer greater than one, or both can be auto to take them from the
+     * header of the DEM or its .HDR file.
      */
-    char *height;
-    int heightDEM = strtol(argv[3], &height, 10);
-
-    error = checkInvalidHeight(heightDEM, *height);
+    int widthDEM;
+    int heightDEM;
+    parseDimensions(argv[1], argv[2], argv[3], &widthDEM, &heightDEM);
     if (error != NULL)
         return displayError(error);
 
@@ -155,6 +109,28 @@ int main(int argc, char **argv)
    if (error != NULL)
         return displayError(error);
 
+    /*
+     * A raw DEM is streamed through the pipeline a row of tiles at a time,
+     * writing each row of the DEM to its tiles as it is read. Tiles of a DEM
+     * with a .HDR file are then given their own.
+     */
+    if (canStreamDEM(argv[1]) && factor <= MAX_STREAMED_TILES)
+    {
+        profilePhase(PHASE_COMPUTE);
+
+        tileFile(argv[1], widthDEM, heightDEM, factor, argv[5]);
+        if (error == NULL)
+            writeTileReferences(argv[1], widthDEM, heightDEM, factor, argv[5]);
+
+        if (error != NULL)
+            return displayError(error);
+
+        printf(STR_TILED);
+        return EXIT_NO_ERRORS;
+    }
+
+    profilePhase(PHASE_READ);
+
     // Read image file and store returned pointer to the image structure if checks pass.
     gtopoDEM *inputDEM = readDEM(argv[1], widthDEM, heightDEM);
 
@@ -167,8 +143,33 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
-    // If checks pass, tile the image.
-    gtopoDEM*** tiledDEM = tile(inputDEM, factor);
+    profilePhase(PHASE_COMPUTE);
+
+    /*
+     * If checks pass, tile the image. The tiles are allocated from an arena so
+     * that they can all be released at once, however large the factor.
+     */
+    gtopoArena *tileArena = createArena();
+
+    error = checkAllocated(tileArena);
+    if (error != NULL)
+    {
+        freeDEM(inputDEM);
+        return displayError(error);
+    }
+
+    gtopoDEM*** tiledDEM = tile(inputDEM, factor, tileArena);
+
+    // If the DEM is georeferenced by a .HDR file, each tile gets one of its own.
+    gtopoGeoReference *reference = readGeoReference(argv[1]);
+    if (error != NULL)
+    {
+        freeDEM(inputDEM);
+        freeArena(tileArena);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_WRITE);
 
     int row;
     int column;
@@ -181,11 +182,27 @@ int main(int argc, char **argv)
             char *path = buildPath(argv[5], row, column);
             echoDEM(tiledDEM[row][column], path);
 
+            // Every tile but the last in a row or column has the size of the first.
+            if (error == NULL && reference != NULL)
+            {
+                gtopoGeoReference *tileReference = offsetGeoReference(reference,
+                    row * getHeight(tiledDEM[0][0]), column * getWidth(tiledDEM[0][0]));
+                error = checkAllocated(tileReference);
+
+                if (error == NULL)
+                    writeGeoReference(tileReference, path, getWidth(tiledDEM[row][column]),
+                        getHeight(tiledDEM[row][column]));
+
+                freeGeoReference(tileReference);
+            }
+
             // Check if an error occurred when writing the image.
             if (error != NULL)
             {
+                free(path);
                 freeDEM(inputDEM);
-                freeTiles(tiledDEM, factor);
+                freeArena(tileArena);
+                freeGeoReference(reference);
                 return displayError(error);
             }
 
@@ -194,9 +211,12 @@ int main(int argc, char **argv)
         }
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeDEM(inputDEM);
-    freeTiles(tiledDEM, factor);
+    freeArena(tileArena);
+    freeGeoReference(reference);
     printf(STR_TILED);
     return EXIT_NO_ERRORS;
 }
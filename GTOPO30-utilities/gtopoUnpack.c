@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtopoio.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 3 or 7. The program requires 3 arguments
+     * to unpack a whole DEM, or 7 to unpack a window of it:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input packed file path
+     * argv[2] = Output file path
+     * 
+     * argv[3] = Row of the top-left corner of the window (optional)
+     * argv[4] = Column of the top-left corner of the window
+     * argv[5] = Width of the window
+     * argv[6] = Height of the window
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputFile outputFile [row column width height]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 3 && argc != 7)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    gtopoDEM *outputDEM = NULL;
+
+    if (argc == 3)
+    {
+        profilePhase(PHASE_READ);
+
+        // Read the entire packed DEM. Its dimensions are stored in the file.
+        outputDEM = readPackedDEM(argv[1]);
+    }
+    else
+    {
+        // Convert the window CLI arguments to integers.
+        char *row;
+        int windowRow = strtol(argv[3], &row, 10);
+
+        char *column;
+        int windowColumn = strtol(argv[4], &column, 10);
+
+        /* 
+         * Check that the width and height of the window are valid. Whether the window
+         * lies within the DEM is checked once the header has been read.
+         */
+        char *width;
+        int windowWidth = strtol(argv[5], &width, 10);
+
+        error = checkInvalidWidth(windowWidth, *width);
+        if (error != NULL)
+            return displayError(error);
+
+        char *height;
+        int windowHeight = strtol(argv[6], &height, 10);
+
+        error = checkInvalidHeight(windowHeight, *height);
+        if (error != NULL)
+            return displayError(error);
+
+        error = checkInvalidPosition(windowRow, MAX_ROWS, *row);
+        if (error != NULL)
+            return displayError(error);
+
+        error = checkInvalidPosition(windowColumn, MAX_COLUMNS, *column);
+        if (error != NULL)
+            return displayError(error);
+
+        profilePhase(PHASE_READ);
+
+        // Read only the blocks of the packed DEM that the window overlaps.
+        outputDEM = readPackedWindow(argv[1], windowRow, windowColumn, windowWidth, windowHeight);
+    }
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_WRITE);
+
+    // Write the unpacked elevation points as a raw DEM.
+    echoDEM(outputDEM, argv[2]);
+
+    // If the external error pointer is no longer null, a file write error has been detected.
+    if (error != NULL)
+    {
+        freeDEM(outputDEM);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    freeDEM(outputDEM);
+    printf(STR_UNPACKED);
+    return EXIT_NO_ERRORS;
+}
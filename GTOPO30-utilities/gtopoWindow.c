@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtopoio.h"
+#include "gtopogeo.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// DEM (Digital Elevation Model)
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 7. The program requires 7 arguments to be
+     * provided:
+     *
+     * argv[0] = Program name
+     * argv[1] = Directory of GTOPO30 source tiles (W140N90.DEM and W140N90.HDR and so on)
+     * argv[2] = Output file path
+     * argv[3] = Longitude of the west edge of the window, in degrees east
+     * argv[4] = Latitude of the south edge of the window, in degrees north
+     * argv[5] = Longitude of the east edge of the window
+     * argv[6] = Latitude of the north edge of the window
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s sourceDirectory outputFile west south east north\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 7)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    // Convert the bounds CLI arguments to degrees. Check that they lie on the globe.
+    char *west;
+    double westBound = strtod(argv[3], &west);
+
+    char *south;
+    double southBound = strtod(argv[4], &south);
+
+    char *east;
+    double eastBound = strtod(argv[5], &east);
+
+    char *north;
+    double northBound = strtod(argv[6], &north);
+
+    error = checkInvalidBounds(westBound, southBound, eastBound, northBound, *west, *south, *east, *north);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_READ);
+
+    // Read the window from only the source tiles it overlaps.
+    gtopoGeoReference *windowReference = NULL;
+    gtopoDEM *outputDEM = readSourceWindow(argv[1], westBound, southBound, eastBound, northBound, &windowReference);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_WRITE);
+
+    // Write the window as a raw DEM, with a .HDR file giving where it lies.
+    echoDEM(outputDEM, argv[2]);
+
+    if (error == NULL)
+        writeGeoReference(windowReference, argv[2], getWidth(outputDEM), getHeight(outputDEM));
+
+    // If the external error pointer is no longer null, a file write error has been detected.
+    if (error != NULL)
+    {
+        freeDEM(outputDEM);
+        freeGeoReference(windowReference);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    freeDEM(outputDEM);
+    freeGeoReference(windowReference);
+    printf(STR_WINDOWED);
+    return EXIT_NO_ERRORS;
+}
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include "gtopoarena.h"
+#include "gtopoprofile.h"
+
+// Size of the chunks small allocations are carved from.
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+// Every allocation starts on a multiple of this, which suits any type.
+#define ARENA_ALIGNMENT 16
+
+
+/*
+ * A block of memory that allocations are carved from in order. The data follows
+ * the header, which is padded to keep the data aligned.
+ */
+typedef struct arenaChunk
+{
+    struct arenaChunk *next;
+    size_t size;
+    size_t used;
+} arenaChunk;
+
+#define CHUNK_HEADER_SIZE ((sizeof(arenaChunk) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+
+/*
+ * A region of memory that many objects are allocated from and then released all
+ * at once by freeArena(), instead of being freed one by one. The first chunk is
+ * the one being filled. An arena is not safe to allocate from on several
+ * threads at once.
+ */
+typedef struct arena
+{
+    arenaChunk *chunks;
+} arena;
+
+
+/*
+ * Allocates a chunk able to hold size bytes of data. Returns NULL if there is no
+ * memory.
+ */
+static arenaChunk* createChunk(size_t size)
+{
+    arenaChunk *chunk = (arenaChunk *) malloc(CHUNK_HEADER_SIZE + size);
+    countAllocation();
+
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+
+/*
+ * Creates an empty arena. Returns NULL if there is no memory.
+ */
+arena* createArena()
+{
+    arena *newArena = (arena *) malloc(sizeof(arena));
+    countAllocation();
+
+    if (newArena != NULL)
+        newArena->chunks = NULL;
+
+    return newArena;
+}
+
+
+/*
+ * Returns size bytes from the arena, which stay allocated until the arena is
+ * freed. Allocations larger than a chunk get a chunk of their own, placed behind
+ * the one being filled so that its free space is not lost. Returns NULL if there
+ * is no memory.
+ */
+void* arenaAllocate(arena *targetArena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    arenaChunk *current = targetArena->chunks;
+
+    if (current != NULL && current->size - current->used >= size)
+    {
+        void *memory = (char *) current + CHUNK_HEADER_SIZE + current->used;
+        current->used += size;
+        return memory;
+    }
+
+    arenaChunk *chunk = createChunk(size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->used = size;
+
+    if (size > ARENA_CHUNK_SIZE && current != NULL)
+    {
+        chunk->next = current->next;
+        current->next = chunk;
+    }
+    else
+    {
+        chunk->next = current;
+        targetArena->chunks = chunk;
+    }
+
+    return (char *) chunk + CHUNK_HEADER_SIZE;
+}
+
+
+/*
+ * Releases the arena and everything allocated from it.
+ */
+void freeArena(arena *targetArena)
+{
+    if (targetArena == NULL)
+        return;
+
+    arenaChunk *chunk = targetArena->chunks;
+    while (chunk != NULL)
+    {
+        arenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    free(targetArena);
+}
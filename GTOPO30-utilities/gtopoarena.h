@@ -0,0 +1,7 @@
+#include <stddef.h>
+
+typedef struct arena gtopoArena;
+
+gtopoArena* createArena();
+void* arenaAllocate(gtopoArena *arena, size_t size);
+void freeArena(gtopoArena *arena);
@@ -0,0 +1,551 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gtopobatch.h"
+#include "gtopogroup.h"
+#include "gtopoland.h"
+#include "gtoposhrink.h"
+#include "gtopothreads.h"
+
+// Longest line of a job file, including its new line.
+#define MAX_JOB_LINE 4096
+
+// Most words on a line: the operation followed by the arguments of printland.
+#define MAX_JOB_WORDS 8
+
+#define JOB_ECHO 0
+#define JOB_REDUCE 1
+#define JOB_TILE 2
+#define JOB_PRINT_LAND 3
+
+
+/*
+ * A DEM read by one or more jobs. It is read by the first job to need it and
+ * freed by the last, so it is only ever read once and is shared read-only in
+ * between. The lock is held while the DEM is read, so the other jobs wait for it.
+ * Each input is allocated on its own, so that its lock never moves once made.
+ */
+typedef struct batchInput
+{
+    char *path;
+    int width;
+    int height;
+    gtopoDEM *dem;
+    gtopoError *error;
+    int loaded;
+    int users;
+    pthread_mutex_t lock;
+} batchInput;
+
+
+/*
+ * One line of the job file. The factor is the write mode of an echo job.
+ */
+typedef struct batchJob
+{
+    int operation;
+    int line;
+    int input;
+    char *output;
+    int factor;
+    int sea;
+    int hill;
+    int mountain;
+    gtopoError *error;
+} batchJob;
+
+
+/*
+ * The jobs of a job file and the DEMs they read. Jobs are run in the order of
+ * their inputs, so each DEM is used by a run of consecutive jobs and only a few
+ * are held in memory at once.
+ */
+typedef struct batch
+{
+    char *path;
+    batchJob *jobs;
+    int jobCount;
+    batchInput **inputs;
+    int inputCount;
+    int *order;
+} batch;
+
+
+/*
+ * Copies a string, returning NULL if there is no memory.
+ */
+static char* copyString(char *string)
+{
+    char *copy = (char *) malloc(strlen(string) + 1);
+
+    if (copy != NULL)
+        strcpy(copy, string);
+
+    return copy;
+}
+
+
+/*
+ * Returns the index of the input with the path and dimensions, adding it if no
+ * earlier job reads it. Returns -1 if there is no memory.
+ */
+static int findInput(batch *jobBatch, char *path, int width, int height)
+{
+    int x;
+    for (x = 0; x < jobBatch->inputCount; x++)
+    {
+        batchInput *input = jobBatch->inputs[x];
+
+        if (input->width == width && input->height == height && strcmp(input->path, path) == 0)
+            return x;
+    }
+
+    batchInput **inputs = (batchInput **) realloc(jobBatch->inputs, sizeof(batchInput *) * (jobBatch->inputCount + 1));
+    if (inputs == NULL)
+        return -1;
+
+    jobBatch->inputs = inputs;
+
+    batchInput *input = (batchInput *) malloc(sizeof(batchInput));
+    if (input == NULL)
+        return -1;
+
+    input->path = copyString(path);
+    input->width = width;
+    input->height = height;
+    input->dem = NULL;
+    input->error = NULL;
+    input->loaded = 0;
+    input->users = 0;
+    pthread_mutex_init(&input->lock, NULL);
+
+    if (input->path == NULL)
+    {
+        pthread_mutex_destroy(&input->lock);
+        free(input);
+        return -1;
+    }
+
+    inputs[jobBatch->inputCount] = input;
+    return jobBatch->inputCount++;
+}
+
+
+/*
+ * Reads the operation and arguments of one line into the job, checking them as
+ * the program of the same name would. The arguments follow the same order as
+ * that program's. Can return an error.
+ */
+static void parseJob(batch *jobBatch, batchJob *job, char **words, int count)
+{
+    char *operation = words[0];
+    int valid = 0;
+
+    if (strcmp(operation, "echo") == 0)
+    {
+        job->operation = JOB_ECHO;
+        valid = count == 5 || count == 6;
+    }
+    else if (strcmp(operation, "reduce") == 0)
+    {
+        job->operation = JOB_REDUCE;
+        valid = count == 6;
+    }
+    else if (strcmp(operation, "tile") == 0)
+    {
+        job->operation = JOB_TILE;
+        valid = count == 6;
+    }
+    else if (strcmp(operation, "printland") == 0)
+    {
+        job->operation = JOB_PRINT_LAND;
+        valid = count == 8;
+    }
+
+    error = checkJobFormat(valid);
+    if (error != NULL)
+        return;
+
+    char *end;
+    char *output;
+    int width;
+    int height;
+    parseDimensions(words[1], words[2], words[3], &width, &height);
+    if (error != NULL)
+        return;
+
+    if (job->operation == JOB_ECHO)
+    {
+        output = words[4];
+        job->factor = RAW;
+
+        if (count == 6)
+        {
+            job->factor = strtol(words[5], &end, 10);
+            error = checkInvalidWriteMode(*end == '\0' ? job->factor : -1);
+        }
+    }
+    else if (job->operation == JOB_REDUCE || job->operation == JOB_TILE)
+    {
+        job->factor = strtol(words[4], &end, 10);
+        error = checkInvalidFactor(job->factor, *end);
+        output = words[5];
+
+        if (error == NULL && job->operation == JOB_TILE)
+            error = checkTagsPresent(output, ROW_TAG, COL_TAG);
+    }
+    else
+    {
+        char *sea;
+        char *hill;
+        char *mountain;
+        output = words[4];
+        job->sea = strtol(words[5], &sea, 10);
+        job->hill = strtol(words[6], &hill, 10);
+        job->mountain = strtol(words[7], &mountain, 10);
+        error = checkElevationSettings(job->sea, job->hill, job->mountain, *sea, *hill, *mountain);
+    }
+
+    if (error != NULL)
+        return;
+
+    job->output = copyString(output);
+    error = checkAllocated(job->output);
+    if (error != NULL)
+        return;
+
+    job->input = findInput(jobBatch, words[1], width, height);
+    if (job->input < 0)
+    {
+        error = checkAllocated(NULL);
+        return;
+    }
+
+    jobBatch->inputs[job->input]->users++;
+}
+
+
+/*
+ * Orders the jobs by their input, keeping jobs on the same input in file order.
+ * Can return an error.
+ */
+static void orderJobs(batch *jobBatch)
+{
+    jobBatch->order = (int *) malloc(sizeof(int) * (jobBatch->jobCount + 1));
+    error = checkAllocated(jobBatch->order);
+    if (error != NULL)
+        return;
+
+    int position = 0;
+    int input;
+    int job;
+
+    for (input = 0; input < jobBatch->inputCount; input++)
+    {
+        for (job = 0; job < jobBatch->jobCount; job++)
+        {
+            if (jobBatch->jobs[job].input == input)
+                jobBatch->order[position++] = job;
+        }
+    }
+}
+
+
+/*
+ * Reads the job file at jobPath. Each line holds one job: an operation followed
+ * by the arguments of the program it stands for, without the program name:
+ *
+ * echo inputFile width height outputFile [writeMode]
+ * reduce inputFile width height reduction_factor outputFile
+ * tile inputFile width height tiling_factor outputFile_<row>_<column>
+ * printland inputFile width height outputFile sea hill mountain
+ *
+ * Blank lines and lines starting with '#' are skipped. Jobs run in any order,
+ * so no job may read a file written by another. Every job is checked before any
+ * is run. Returns NULL and an error if a line is not a valid job.
+ */
+gtopoBatch* readBatch(char *jobPath)
+{
+    error = NULL;
+
+    FILE *jobFile = fopen(jobPath, "r");
+    batch *jobBatch = NULL;
+    int lineNumber = 0;
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(jobFile, jobPath);
+    if (error != NULL)
+        goto cleanup;
+
+    jobBatch = (batch *) calloc(1, sizeof(batch));
+    error = checkAllocated(jobBatch);
+    if (error != NULL)
+        goto cleanup;
+
+    jobBatch->path = copyString(jobPath);
+    error = checkAllocated(jobBatch->path);
+    if (error != NULL)
+        goto cleanup;
+
+    char line[MAX_JOB_LINE];
+    int capacity = 0;
+
+    while (fgets(line, MAX_JOB_LINE, jobFile) != NULL)
+    {
+        lineNumber++;
+
+        // A line that does not fit in the buffer cannot be a valid job.
+        int complete = strchr(line, '\n') != NULL || feof(jobFile);
+        error = checkJobFormat(complete);
+        if (error != NULL)
+            goto cleanup;
+
+        char *words[MAX_JOB_WORDS + 1];
+        char *state;
+        int count = 0;
+        char *word = strtok_r(line, " \t\r\n", &state);
+
+        while (word != NULL && count <= MAX_JOB_WORDS)
+        {
+            words[count++] = word;
+            word = strtok_r(NULL, " \t\r\n", &state);
+        }
+
+        if (count == 0 || words[0][0] == '#')
+            continue;
+
+        if (jobBatch->jobCount == capacity)
+        {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            batchJob *jobs = (batchJob *) realloc(jobBatch->jobs, sizeof(batchJob) * capacity);
+
+            error = checkAllocated(jobs);
+            if (error != NULL)
+                goto cleanup;
+
+            jobBatch->jobs = jobs;
+        }
+
+        batchJob *job = &jobBatch->jobs[jobBatch->jobCount];
+        memset(job, 0, sizeof(batchJob));
+        job->line = lineNumber;
+        job->input = -1;
+
+        parseJob(jobBatch, job, words, count);
+        jobBatch->jobCount++;
+
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    orderJobs(jobBatch);
+
+    goto cleanup;
+
+    cleanup:
+    if (jobFile != NULL)
+        fclose(jobFile);
+
+    if (error != NULL && jobBatch != NULL)
+    {
+        error = locateJobError(error, jobPath, lineNumber);
+        freeBatch(jobBatch);
+        jobBatch = NULL;
+    }
+
+    return jobBatch;
+}
+
+
+/*
+ * Returns the DEM of the input, reading it if this is the first job to use it.
+ * Returns NULL if the DEM could not be read, leaving the error with the input.
+ */
+static gtopoDEM* acquireInput(batchInput *input)
+{
+    pthread_mutex_lock(&input->lock);
+
+    if (input->loaded == 0)
+    {
+        input->dem = readDEM(input->path, input->width, input->height);
+        input->error = error;
+        input->loaded = 1;
+        error = NULL;
+
+        if (input->error != NULL)
+        {
+            freeDEM(input->dem);
+            input->dem = NULL;
+        }
+    }
+
+    gtopoDEM *inputDEM = input->dem;
+    pthread_mutex_unlock(&input->lock);
+    return inputDEM;
+}
+
+
+/*
+ * Marks a job on the input as finished, freeing the DEM after the last one.
+ */
+static void releaseInput(batchInput *input)
+{
+    pthread_mutex_lock(&input->lock);
+
+    input->users--;
+    if (input->users == 0)
+    {
+        freeDEM(input->dem);
+        input->dem = NULL;
+    }
+
+    pthread_mutex_unlock(&input->lock);
+}
+
+
+/*
+ * Writes every tile of the DEM, stopping at the first that fails. The tiles are
+ * allocated from an arena of the job's own, as jobs run on several threads. Can
+ * return an error.
+ */
+static void tileJob(gtopoDEM *inputDEM, batchJob *job)
+{
+    gtopoArena *tileArena = createArena();
+
+    error = checkAllocated(tileArena);
+    if (error != NULL)
+        return;
+
+    gtopoDEM ***tiles = tile(inputDEM, job->factor, tileArena);
+
+    int row;
+    int column;
+
+    for (row = 0; row < job->factor && error == NULL; row++)
+    {
+        for (column = 0; column < job->factor && error == NULL; column++)
+        {
+            char *path = buildPath(job->output, row, column);
+            echoDEM(tiles[row][column], path);
+            free(path);
+        }
+    }
+
+    freeArena(tileArena);
+}
+
+
+/*
+ * Runs the job at a position of the run order, keeping any error with the job.
+ * Run by parallelFor() for each job.
+ */
+static void runJob(int index, void *batchPointer)
+{
+    batch *jobBatch = (batch *) batchPointer;
+    batchJob *job = &jobBatch->jobs[jobBatch->order[index]];
+    batchInput *input = jobBatch->inputs[job->input];
+
+    gtopoDEM *inputDEM = acquireInput(input);
+    error = NULL;
+
+    if (inputDEM != NULL && job->operation == JOB_ECHO)
+    {
+        echoDEMEncoded(inputDEM, job->output, job->factor);
+    }
+    else if (inputDEM != NULL && job->operation == JOB_REDUCE)
+    {
+        gtopoDEM *reducedDEM = reduce(inputDEM, job->factor);
+        echoDEM(reducedDEM, job->output);
+        freeDEM(reducedDEM);
+    }
+    else if (inputDEM != NULL && job->operation == JOB_TILE)
+    {
+        tileJob(inputDEM, job);
+    }
+    else if (inputDEM != NULL && job->operation == JOB_PRINT_LAND)
+    {
+        printLandDEM(inputDEM, job->output, job->sea, job->hill, job->mountain);
+    }
+
+    job->error = error;
+    error = NULL;
+    releaseInput(input);
+}
+
+
+/*
+ * Runs every job of the batch on the worker threads. A job that fails does not
+ * stop the others; its error is kept for reportBatch().
+ */
+void runBatch(gtopoBatch *jobBatch)
+{
+    parallelFor(jobBatch->jobCount, runJob, jobBatch);
+}
+
+
+/*
+ * Displays the error of every failed job in file order, along with its line.
+ * An input that could not be read is reported once, by the first job that reads
+ * it. Returns the exit code of the first failed job, or EXIT_NO_ERRORS.
+ */
+int reportBatch(gtopoBatch *jobBatch)
+{
+    int code = EXIT_NO_ERRORS;
+    int x;
+
+    for (x = 0; x < jobBatch->jobCount; x++)
+    {
+        batchJob *job = &jobBatch->jobs[x];
+        batchInput *input = jobBatch->inputs[job->input];
+        gtopoError *jobError = job->error;
+
+        if (jobError == NULL)
+        {
+            jobError = input->error;
+            input->error = NULL;
+        }
+
+        job->error = NULL;
+
+        if (jobError != NULL)
+        {
+            int jobCode = displayError(locateJobError(jobError, jobBatch->path, job->line));
+
+            if (code == EXIT_NO_ERRORS)
+                code = jobCode;
+        }
+    }
+
+    return code;
+}
+
+
+/*
+ * Frees the batch, including any DEMs that are still held.
+ */
+void freeBatch(gtopoBatch *jobBatch)
+{
+    if (jobBatch == NULL)
+        return;
+
+    int x;
+    for (x = 0; x < jobBatch->jobCount; x++)
+    {
+        free(jobBatch->jobs[x].output);
+    }
+
+    for (x = 0; x < jobBatch->inputCount; x++)
+    {
+        free(jobBatch->inputs[x]->path);
+        freeDEM(jobBatch->inputs[x]->dem);
+        pthread_mutex_destroy(&jobBatch->inputs[x]->lock);
+        free(jobBatch->inputs[x]);
+    }
+
+    free(jobBatch->path);
+    free(jobBatch->jobs);
+    free(jobBatch->inputs);
+    free(jobBatch->order);
+    free(jobBatch);
+}
@@ -0,0 +1,8 @@
+#include "gtopoio.h"
+
+typedef struct batch gtopoBatch;
+
+gtopoBatch* readBatch(char *jobPath);
+void runBatch(gtopoBatch *batch);
+int reportBatch(gtopoBatch *batch);
+void freeBatch(gtopoBatch *batch);
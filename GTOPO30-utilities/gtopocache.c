@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gtopoio.h"
+#include "gtopocache.h"
+
+#define PACK_MAGIC "GTPK"
+
+// States of a cached block. Threads that want a block being loaded wait for it.
+#define BLOCK_LOADING 0
+#define BLOCK_READY 1
+
+
+/*
+ * A block of CACHE_BLOCK_SIZE x CACHE_BLOCK_SIZE decoded elevations, smaller at
+ * the right and bottom edges of the DEM. Blocks that are pinned are being read
+ * by a thread and are never evicted.
+ */
+typedef struct cacheBlock
+{
+    signed short *elevations;
+    int index;
+    int pins;
+    int state;
+    struct cacheBlock *newer;
+    struct cacheBlock *older;
+} cacheBlock;
+
+
+/*
+ * A bounded cache of the decoded blocks of one DEM, shared between threads.
+ * Resident blocks are found by their index in blocks, and kept in a list from
+ * the most to the least recently used. Once capacity blocks are resident, the
+ * least recently used block that is not pinned makes room for the next.
+ */
+typedef struct cache
+{
+    char *path;
+    int packed;
+    gtopoRowReader *reader;
+    int width;
+    int height;
+    int blocksAcross;
+    int blocksDown;
+    int capacity;
+    int resident;
+    cacheBlock **blocks;
+    cacheBlock *newest;
+    cacheBlock *oldest;
+    long hits;
+    long misses;
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+} cache;
+
+
+/*
+ * Opens a raw or packed DEM for serving through a cache of at most capacity
+ * blocks. Raw DEMs are read a span of rows at a time, and packed DEMs a packed
+ * block at a time, so only the blocks that are asked for are ever read. Returns
+ * NULL if the DEM could not be opened. Can return an error.
+ */
+cache* createCache(char *path, int width, int height, int capacity)
+{
+    error = NULL;
+
+    cache *newCache = (cache *) calloc(1, sizeof(cache));
+    error = checkAllocated(newCache);
+    if (error != NULL)
+        return NULL;
+
+    pthread_mutex_init(&newCache->lock, NULL);
+    pthread_cond_init(&newCache->loaded, NULL);
+
+    newCache->width = width;
+    newCache->height = height;
+    newCache->blocksAcross = (width + CACHE_BLOCK_SIZE - 1) / CACHE_BLOCK_SIZE;
+    newCache->blocksDown = (height + CACHE_BLOCK_SIZE - 1) / CACHE_BLOCK_SIZE;
+    newCache->capacity = capacity;
+    newCache->path = (char *) malloc(strlen(path) + 1);
+    newCache->blocks = (cacheBlock **) calloc(newCache->blocksAcross * newCache->blocksDown, sizeof(cacheBlock *));
+
+    error = checkAllocated(newCache->path);
+    if (error == NULL)
+        error = checkAllocated(newCache->blocks);
+
+    if (error != NULL)
+    {
+        freeCache(newCache);
+        return NULL;
+    }
+
+    strcpy(newCache->path, path);
+
+    // Packed DEMs start with a magic number. Anything else is streamed as a raw DEM.
+    char magic[4];
+    FILE *file = fopen(path, "rb");
+
+    error = checkInvalidFileName(file, path);
+    if (error != NULL)
+    {
+        freeCache(newCache);
+        return NULL;
+    }
+
+    newCache->packed = fread(magic, 1, 4, file) == 4 && memcmp(magic, PACK_MAGIC, 4) == 0;
+    fclose(file);
+
+    if (!newCache->packed)
+    {
+        newCache->reader = openDEMRows(path, width, height);
+        if (error != NULL)
+        {
+            freeCache(newCache);
+            return NULL;
+        }
+    }
+    else
+    {
+        // Check up front that the packed DEM has the dimensions it is served with.
+        int packedWidth;
+        int packedHeight;
+        parseDimensions(path, "auto", "auto", &packedWidth, &packedHeight);
+        if (error == NULL)
+            error = checkMatchingDimensions(packedWidth, packedHeight, width, height, path);
+
+        if (error != NULL)
+        {
+            freeCache(newCache);
+            return NULL;
+        }
+    }
+
+    return newCache;
+}
+
+
+/*
+ * Returns the width of the block in the given block column.
+ */
+static int blockWidth(cache *targetCache, int blockColumn)
+{
+    int remaining = targetCache->width - blockColumn * CACHE_BLOCK_SIZE;
+    return remaining < CACHE_BLOCK_SIZE ? remaining : CACHE_BLOCK_SIZE;
+}
+
+
+/*
+ * Returns the height of the block in the given block row.
+ */
+static int blockHeight(cache *targetCache, int blockRow)
+{
+    int remaining = targetCache->height - blockRow * CACHE_BLOCK_SIZE;
+    return remaining < CACHE_BLOCK_SIZE ? remaining : CACHE_BLOCK_SIZE;
+}
+
+
+/*
+ * Removes a block from the recently used list.
+ */
+static void unlinkBlock(cache *targetCache, cacheBlock *block)
+{
+    if (block->newer != NULL)
+        block->newer->older = block->older;
+    else
+        targetCache->newest = block->older;
+
+    if (block->older != NULL)
+        block->older->newer = block->newer;
+    else
+        targetCache->oldest = block->newer;
+
+    block->newer = NULL;
+    block->older = NULL;
+}
+
+
+/*
+ * Puts a block at the most recently used end of the list.
+ */
+static void linkNewest(cache *targetCache, cacheBlock *block)
+{
+    block->older = targetCache->newest;
+    block->newer = NULL;
+
+    if (targetCache->newest != NULL)
+        targetCache->newest->newer = block;
+    else
+        targetCache->oldest = block;
+
+    targetCache->newest = block;
+}
+
+
+/*
+ * Removes a block from the cache and frees it. Must be called with the lock held.
+ */
+static void dropBlock(cache *targetCache, cacheBlock *block)
+{
+    unlinkBlock(targetCache, block);
+    targetCache->blocks[block->index] = NULL;
+    targetCache->resident--;
+    free(block->elevations);
+    free(block);
+}
+
+
+/*
+ * Evicts the least recently used blocks that are not pinned until there is room
+ * for another. If every block is pinned the cache briefly grows past capacity,
+ * rather than making threads wait for each other. Must be called with the lock
+ * held.
+ */
+static void makeRoom(cache *targetCache)
+{
+    cacheBlock *block = targetCache->oldest;
+
+    while (targetCache->resident >= targetCache->capacity && block != NULL)
+    {
+        cacheBlock *newer = block->newer;
+
+        if (block->pins == 0 && block->state == BLOCK_READY)
+            dropBlock(targetCache, block);
+
+        block = newer;
+    }
+}
+
+
+/*
+ * Reads and decodes a block from the DEM. Runs without the lock held, so other
+ * threads can use the cache meanwhile. Returns 1 if the block could not be read
+ * and 0 otherwise.
+ */
+static int loadBlock(cache *targetCache, cacheBlock *block)
+{
+    int blockRow = block->index / targetCache->blocksAcross;
+    int blockColumn = block->index % targetCache->blocksAcross;
+    int width = blockWidth(targetCache, blockColumn);
+    int height = blockHeight(targetCache, blockRow);
+    int row;
+
+    block->elevations = (signed short *) malloc(sizeof(signed short) * width * height);
+    if (block->elevations == NULL)
+        return 1;
+
+    if (!targetCache->packed)
+    {
+        // Read each row of the block as one span, straight into the block.
+        for (row = 0; row < height; row++)
+        {
+            if (readDEMSpan(targetCache->reader, blockRow * CACHE_BLOCK_SIZE + row, blockColumn * CACHE_BLOCK_SIZE,
+                width, block->elevations + row * width) != 0)
+                return 1;
+        }
+
+        return 0;
+    }
+
+    // Blocks line up with the blocks of the packed DEM, so each decodes one of them.
+    gtopoDEM *window = readPackedWindow(targetCache->path, blockRow * CACHE_BLOCK_SIZE,
+        blockColumn * CACHE_BLOCK_SIZE, width, height);
+
+    // The reason is not needed, as the request that wanted the block just fails.
+    if (window == NULL)
+    {
+        freeError(error);
+        error = NULL;
+        return 1;
+    }
+
+    memcpy(block->elevations, getRaster(window)[0], sizeof(signed short) * width * height);
+    freeDEM(window);
+    return 0;
+}
+
+
+/*
+ * Returns a block, pinned so that it stays in the cache until releaseBlock() is
+ * called, reading it from the DEM if it is not resident. Rows of the block are
+ * blockWidth() elevations apart. Returns NULL if the block could not be read.
+ * Safe to call from any number of threads at once.
+ */
+static cacheBlock* acquireBlock(cache *targetCache, int blockRow, int blockColumn)
+{
+    int index = blockRow * targetCache->blocksAcross + blockColumn;
+
+    pthread_mutex_lock(&targetCache->lock);
+
+    cacheBlock *block = targetCache->blocks[index];
+
+    // Wait for another thread that is already reading the block.
+    while (block != NULL && block->state == BLOCK_LOADING)
+    {
+        pthread_cond_wait(&targetCache->loaded, &targetCache->lock);
+        block = targetCache->blocks[index];
+    }
+
+    if (block != NULL)
+    {
+        targetCache->hits++;
+        block->pins++;
+        unlinkBlock(targetCache, block);
+        linkNewest(targetCache, block);
+        pthread_mutex_unlock(&targetCache->lock);
+        return block;
+    }
+
+    targetCache->misses++;
+    makeRoom(targetCache);
+
+    block = (cacheBlock *) calloc(1, sizeof(cacheBlock));
+    if (block == NULL)
+    {
+        pthread_mutex_unlock(&targetCache->lock);
+        return NULL;
+    }
+
+    block->index = index;
+    block->pins = 1;
+    block->state = BLOCK_LOADING;
+    targetCache->blocks[index] = block;
+    targetCache->resident++;
+    linkNewest(targetCache, block);
+    pthread_mutex_unlock(&targetCache->lock);
+
+    int failed = loadBlock(targetCache, block);
+
+    pthread_mutex_lock(&targetCache->lock);
+
+    // A block that failed to load is dropped, so the next request tries again.
+    if (failed)
+    {
+        dropBlock(targetCache, block);
+        block = NULL;
+    }
+    else
+    {
+        block->state = BLOCK_READY;
+    }
+
+    pthread_cond_broadcast(&targetCache->loaded);
+    pthread_mutex_unlock(&targetCache->lock);
+    return block;
+}
+
+
+/*
+ * Unpins a block returned by acquireBlock(), so that it can be evicted.
+ */
+static void releaseBlock(cache *targetCache, cacheBlock *block)
+{
+    pthread_mutex_lock(&targetCache->lock);
+    block->pins--;
+    pthread_mutex_unlock(&targetCache->lock);
+}
+
+
+/*
+ * Copies a window of the DEM into elevations, width elevations per row, through
+ * the cache. The window must lie within the DEM. Returns 1 if a block it
+ * overlaps could not be read and 0 otherwise. Safe to call from any number of
+ * threads at once.
+ */
+int readCachedWindow(cache *targetCache, int row, int column, int width, int height, signed short *elevations)
+{
+    int firstBlockRow = row / CACHE_BLOCK_SIZE;
+    int lastBlockRow = (row + height - 1) / CACHE_BLOCK_SIZE;
+    int firstBlockColumn = column / CACHE_BLOCK_SIZE;
+    int lastBlockColumn = (column + width - 1) / CACHE_BLOCK_SIZE;
+    int blockRow;
+    int blockColumn;
+
+    for (blockRow = firstBlockRow; blockRow <= lastBlockRow; blockRow++)
+    {
+        for (blockColumn = firstBlockColumn; blockColumn <= lastBlockColumn; blockColumn++)
+        {
+            cacheBlock *block = acquireBlock(targetCache, blockRow, blockColumn);
+            if (block == NULL)
+                return 1;
+
+            // Find the part of the block that the window covers.
+            int top = blockRow * CACHE_BLOCK_SIZE;
+            int left = blockColumn * CACHE_BLOCK_SIZE;
+            int stride = blockWidth(targetCache, blockColumn);
+            int firstRow = row > top ? row : top;
+            int endRow = row + height < top + blockHeight(targetCache, blockRow) ?
+                row + height : top + blockHeight(targetCache, blockRow);
+            int firstColumn = column > left ? column : left;
+            int endColumn = column + width < left + stride ? column + width : left + stride;
+            int y;
+
+            for (y = firstRow; y < endRow; y++)
+            {
+                memcpy(elevations + (long) (y - row) * width + firstColumn - column,
+                    block->elevations + (y - top) * stride + firstColumn - left,
+                    sizeof(signed short) * (endColumn - firstColumn));
+            }
+
+            releaseBlock(targetCache, block);
+        }
+    }
+
+    return 0;
+}
+
+
+int getCacheWidth(cache *targetCache)
+{
+    return targetCache->width;
+}
+
+
+int getCacheHeight(cache *targetCache)
+{
+    return targetCache->height;
+}
+
+
+/*
+ * Reads the number of requests for a block that were served from memory and
+ * that had to read the DEM, and the number of blocks now resident.
+ */
+void getCacheCounts(cache *targetCache, long *hits, long *misses, int *resident)
+{
+    pthread_mutex_lock(&targetCache->lock);
+    *hits = targetCache->hits;
+    *misses = targetCache->misses;
+    *resident = targetCache->resident;
+    pthread_mutex_unlock(&targetCache->lock);
+}
+
+
+/*
+ * Frees the cache and every block in it, and closes the DEM.
+ */
+void freeCache(cache *targetCache)
+{
+    if (targetCache == NULL)
+        return;
+
+    if (targetCache->blocks != NULL)
+    {
+        while (targetCache->oldest != NULL)
+            dropBlock(targetCache, targetCache->oldest);
+    }
+
+    closeDEMRows(targetCache->reader);
+    pthread_mutex_destroy(&targetCache->lock);
+    pthread_cond_destroy(&targetCache->loaded);
+    free(targetCache->blocks);
+    free(targetCache->path);
+    free(targetCache);
+}
@@ -0,0 +1,11 @@
+// Blocks line up with those of packed DEMs written with the default block size.
+#define CACHE_BLOCK_SIZE PACK_BLOCK_SIZE
+
+typedef struct cache gtopoCache;
+
+gtopoCache* createCache(char *path, int width, int height, int capacity);
+int readCachedWindow(gtopoCache *targetCache, int row, int column, int width, int height, signed short *elevations);
+int getCacheWidth(gtopoCache *targetCache);
+int getCacheHeight(gtopoCache *targetCache);
+void getCacheCounts(gtopoCache *targetCache, long *hits, long *misses, int *resident);
+void freeCache(gtopoCache *targetCache);
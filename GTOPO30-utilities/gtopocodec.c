@@ -0,0 +1,664 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MODE_STORED 0
+#define MODE_COMPRESSED 1
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define HASH_BITS 12
+
+
+/*
+ * Block codec used by the packed DEM container. A block of elevation points is
+ * encoded in three stages:
+ *
+ * Prediction: Each elevation is replaced by its difference from the elevation to
+ * its left (or above it, for the first column). Neighbouring elevations are
+ * strongly correlated, so the residuals cluster around 0.
+ *
+ * Zigzag and byte planes: Residuals are zigzag encoded so that small negative and
+ * positive values both become small unsigned values, then split into a plane of
+ * high bytes followed by a plane of low bytes. The high plane is almost entirely
+ * zero.
+ *
+ * Compression: The planes are compressed with a small LZ77 compressor using the
+ * LZ4 sequence layout (token, literals, 16-bit offset, match length). If this does
+ * not make the block smaller, the planes are stored as they are.
+ *
+ * The first byte of an encoded block records which of the two modes was used.
+ */
+
+
+/*
+ * Maps a signed residual onto an unsigned value, interleaving negative and
+ * positive values (0, -1, 1, -2, 2 ... becomes 0, 1, 2, 3, 4 ...).
+ */
+static unsigned short zigzag(int residual)
+{
+    return (unsigned short) ((residual << 1) ^ (residual >> 31));
+}
+
+
+/*
+ * Reverses zigzag().
+ */
+static int unzigzag(unsigned short value)
+{
+    return (value >> 1) ^ -(value & 1);
+}
+
+
+/*
+ * Writes the byte planes of the zigzagged prediction residuals of the block.
+ */
+static void buildPlanes(signed short *samples, int width, int height, unsigned char *planes)
+{
+    int count = width * height;
+    int row;
+    int column;
+    int index = 0;
+    signed short predicted = 0;
+
+    for (row = 0; row < height; row++)
+    {
+        for (column = 0; column < width; column++)
+        {
+            if (column == 0)
+                predicted = (row == 0) ? 0 : samples[index - width];
+            else
+                predicted = samples[index - 1];
+
+            // Residuals wrap around within 16 bits, so any pair of elevations can be encoded.
+            unsigned short value = zigzag((signed short) (samples[index] - predicted));
+            planes[index] = value >> 8;
+            planes[count + index] = value & 0xFF;
+            index++;
+        }
+    }
+}
+
+
+/*
+ * Rebuilds the elevation points of the block from its byte planes.
+ */
+static void restorePlanes(unsigned char *planes, int width, int height, signed short *samples)
+{
+    int count = width * height;
+    int row;
+    int column;
+    int index = 0;
+    signed short predicted = 0;
+
+    for (row = 0; row < height; row++)
+    {
+        for (column = 0; column < width; column++)
+        {
+            if (column == 0)
+                predicted = (row == 0) ? 0 : samples[index - width];
+            else
+                predicted = samples[index - 1];
+
+            unsigned short value = (planes[index] << 8) | planes[count + index];
+            samples[index] = (signed short) (predicted + unzigzag(value));
+            index++;
+        }
+    }
+}
+
+
+/*
+ * Writes a length that did not fit in its token nibble as a run of 255 bytes
+ * followed by the remainder.
+ */
+static unsigned char* writeLength(unsigned char *output, int length)
+{
+    while (length >= 255)
+    {
+        *output++ = 255;
+        length = length - 255;
+    }
+    *output++ = (unsigned char) length;
+    return output;
+}
+
+
+/*
+ * Hashes the four bytes starting at the given address.
+ */
+static unsigned int hashBytes(unsigned char *bytes)
+{
+    unsigned int sequence = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int) bytes[3] << 24);
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+
+/*
+ * Compresses the input into the output, returning the number of bytes written.
+ * The output must be able to hold at least size + size / 255 + 16 bytes.
+ */
+static int compress(unsigned char *input, int size, unsigned char *output)
+{
+    int table[1 << HASH_BITS];
+    int position = 0;
+    int anchor = 0;
+    unsigned char *out = output;
+
+    memset(table, -1, sizeof(table));
+
+    while (position + MIN_MATCH <= size)
+    {
+        unsigned int hash = hashBytes(input + position);
+        int candidate = table[hash];
+        table[hash] = position;
+
+        if (candidate < 0 || position - candidate > MAX_OFFSET ||
+            memcmp(input + candidate, input + position, MIN_MATCH) != 0)
+        {
+            position++;
+            continue;
+        }
+
+        // Extend the match as far as it goes.
+        int length = MIN_MATCH;
+        while (position + length < size && input[candidate + length] == input[position + length])
+            length++;
+
+        // Emit the token, the pending literals, the offset and the match length.
+        int literals = position - anchor;
+        unsigned char *token = out++;
+        *token = (literals < 15 ? literals : 15) << 4;
+        if (literals >= 15)
+            out = writeLength(out, literals - 15);
+
+        memcpy(out, input + anchor, literals);
+        out = out + literals;
+
+        int offset = position - candidate;
+        *out++ = offset & 0xFF;
+        *out++ = offset >> 8;
+
+        int extra = length - MIN_MATCH;
+        *token |= (extra < 15 ? extra : 15);
+        if (extra >= 15)
+            out = writeLength(out, extra - 15);
+
+        position = position + length;
+        anchor = position;
+    }
+
+    // The final sequence only holds literals.
+    int literals = size - anchor;
+    *out++ = (literals < 15 ? literals : 15) << 4;
+    if (literals >= 15)
+        out = writeLength(out, literals - 15);
+
+    memcpy(out, input + anchor, literals);
+    out = out + literals;
+
+    return out - output;
+}
+
+
+/*
+ * Reads a length continued past its token nibble. Returns -1 if the input ran out.
+ */
+static int readLength(unsigned char **input, unsigned char *end, int length)
+{
+    unsigned char next = 255;
+    while (next == 255)
+    {
+        if (*input >= end)
+            return -1;
+
+        next = *(*input)++;
+        length = length + next;
+    }
+    return length;
+}
+
+
+/*
+ * Decompresses the input into exactly size bytes of output. Returns 0 on success
+ * and 1 if the input is corrupt.
+ */
+static int decompress(unsigned char *input, int inputSize, unsigned char *output, int size)
+{
+    unsigned char *in = input;
+    unsigned char *end = input + inputSize;
+    int written = 0;
+
+    while (in < end)
+    {
+        unsigned char token = *in++;
+
+        int literals = token >> 4;
+        if (literals == 15)
+            literals = readLength(&in, end, literals);
+
+        if (literals < 0 || literals > end - in || literals > size - written)
+            return 1;
+
+        memcpy(output + written, in, literals);
+        in = in + literals;
+        written = written + literals;
+
+        // The final sequence has no match.
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return 1;
+
+        int offset = in[0] | (in[1] << 8);
+        in = in + 2;
+
+        int length = token & 0x0F;
+        if (length == 15)
+            length = readLength(&in, end, length);
+
+        if (length < 0)
+            return 1;
+
+        length = length + MIN_MATCH;
+        if (offset == 0 || offset > written || length > size - written)
+            return 1;
+
+        // Copy byte by byte, as the match may overlap the bytes being written.
+        int x;
+        for (x = 0; x < length; x++)
+        {
+            output[written] = output[written - offset];
+            written++;
+        }
+    }
+
+    return written == size ? 0 : 1;
+}
+
+
+/*
+ * Returns the largest number of bytes encodeBlock() can write for a block of the
+ * given dimensions.
+ */
+int maxEncodedBlockSize(int width, int height)
+{
+    int planeBytes = 2 * width * height;
+    return 1 + planeBytes + planeBytes / 255 + 16;
+}
+
+
+/*
+ * Encodes a block of elevation points stored in row-major order. Returns the
+ * number of bytes written to the output, or -1 if memory allocation failed.
+ */
+int encodeBlock(signed short *samples, int width, int height, unsigned char *output)
+{
+    int planeBytes = 2 * width * height;
+    unsigned char *planes = (unsigned char *) malloc(planeBytes);
+
+    if (planes == NULL)
+        return -1;
+
+    buildPlanes(samples, width, height, planes);
+
+    int compressedSize = compress(planes, planeBytes, output + 1);
+
+    // Fall back to storing the planes if compression did not help.
+    if (compressedSize >= planeBytes)
+    {
+        output[0] = MODE_STORED;
+        memcpy(output + 1, planes, planeBytes);
+        compressedSize = planeBytes;
+    }
+    else
+    {
+        output[0] = MODE_COMPRESSED;
+    }
+
+    free(planes);
+    return compressedSize + 1;
+}
+
+
+/*
+ * Decodes a block written by encodeBlock() into row-major elevation points.
+ * Returns 0 on success and 1 if the block is corrupt or memory allocation failed.
+ */
+int decodeBlock(unsigned char *input, int inputSize, signed short *samples, int width, int height)
+{
+    int planeBytes = 2 * width * height;
+
+    if (inputSize < 1)
+        return 1;
+
+    unsigned char *planes = (unsigned char *) malloc(planeBytes);
+
+    if (planes == NULL)
+        return 1;
+
+    int failed = 0;
+
+    if (input[0] == MODE_STORED && inputSize - 1 == planeBytes)
+    {
+        memcpy(planes, input + 1, planeBytes);
+    }
+    else if (input[0] == MODE_COMPRESSED)
+    {
+        failed = decompress(input + 1, inputSize - 1, planes, planeBytes);
+    }
+    else
+    {
+        failed = 1;
+    }
+
+    if (failed == 0)
+        restorePlanes(planes, width, height, samples);
+
+    free(planes);
+    return failed;
+}
+
+
+/*
+ * Bit-packed predictive row codec used by the bit-packed DEM format. Rows are
+ * encoded one at a time, each depending only on the row above it:
+ *
+ * Prediction: Each elevation is predicted from its left, upper and upper-left
+ * neighbours with the Paeth predictor, which follows slopes and ridges better
+ * than the left neighbour alone. The first column is predicted from above, and
+ * the first row from the left.
+ *
+ * Bit packing: Zigzagged residuals are packed in groups of GROUP_SIZE, each group
+ * using the fewest bits that hold its largest residual. A group is stored as one
+ * byte holding that bit width followed by bits * GROUP_SIZE / 8 bytes. Within a
+ * group, residual n belongs to lane n % LANES and the lanes are packed side by
+ * side into 16-bit words, so every lane does the same shifts at the same time and
+ * the loops compile to vector instructions. Groups of sea (NO_DATA) or flat land
+ * take a single byte.
+ */
+
+#define LANES 8
+#define GROUP_SIZE 128
+#define VALUES_PER_LANE (GROUP_SIZE / LANES)
+
+
+/*
+ * Returns the Paeth prediction of an elevation given its left, upper and upper-left
+ * neighbours.
+ */
+static signed short paeth(signed short left, signed short upper, signed short upperLeft)
+{
+    int estimate = left + upper - upperLeft;
+    int distanceLeft = abs(estimate - left);
+    int distanceUpper = abs(estimate - upper);
+    int distanceUpperLeft = abs(estimate - upperLeft);
+
+    if (distanceLeft <= distanceUpper && distanceLeft <= distanceUpperLeft)
+        return left;
+    else if (distanceUpper <= distanceUpperLeft)
+        return upper;
+
+    return upperLeft;
+}
+
+
+/*
+ * Writes the zigzagged Paeth residuals of a row, padding the final group with 0.
+ */
+static void predictRow(signed short *row, signed short *previous, int width, unsigned short *residuals)
+{
+    int column;
+    for (column = 0; column < width; column++)
+    {
+        signed short upper = previous != NULL ? previous[column] : 0;
+        signed short left = column > 0 ? row[column - 1] : upper;
+        signed short upperLeft = column > 0 && previous != NULL ? previous[column - 1] : upper;
+
+        // Without a row above, predict from the left.
+        if (previous == NULL)
+            upperLeft = upper = left;
+
+        residuals[column] = zigzag((signed short) (row[column] - paeth(left, upper, upperLeft)));
+    }
+
+    int padded = (width + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+    for (column = width; column < padded; column++)
+    {
+        residuals[column] = 0;
+    }
+}
+
+
+/*
+ * Reverses predictRow(), rebuilding the row from its residuals.
+ */
+static void reconstructRow(unsigned short *residuals, signed short *previous, int width, signed short *row)
+{
+    int column;
+    for (column = 0; column < width; column++)
+    {
+        signed short upper = previous != NULL ? previous[column] : 0;
+        signed short left = column > 0 ? row[column - 1] : upper;
+        signed short upperLeft = column > 0 && previous != NULL ? previous[column - 1] : upper;
+
+        if (previous == NULL)
+            upperLeft = upper = left;
+
+        row[column] = (signed short) (paeth(left, upper, upperLeft) + unzigzag(residuals[column]));
+    }
+}
+
+
+/*
+ * Returns the number of bits needed to hold every value of a group.
+ */
+static int groupBits(unsigned short *values)
+{
+    unsigned short combined = 0;
+    int x;
+    for (x = 0; x < GROUP_SIZE; x++)
+    {
+        combined |= values[x];
+    }
+
+    int bits = 0;
+    while (combined >> bits)
+        bits++;
+
+    return bits;
+}
+
+
+/*
+ * Packs a group of values into bits * LANES words, lane by lane.
+ */
+static void packGroup(unsigned short *values, int bits, unsigned short *words)
+{
+    unsigned short pending[LANES] = {0};
+    int filled = 0;
+    int word = 0;
+    int step;
+    int lane;
+
+    for (step = 0; step < VALUES_PER_LANE; step++)
+    {
+        for (lane = 0; lane < LANES; lane++)
+            pending[lane] |= values[step * LANES + lane] << filled;
+
+        filled = filled + bits;
+        if (filled >= 16)
+        {
+            filled = filled - 16;
+            for (lane = 0; lane < LANES; lane++)
+            {
+                words[word * LANES + lane] = pending[lane];
+
+                // Carry the bits of this value that did not fit into the next word.
+                pending[lane] = filled > 0 ? values[step * LANES + lane] >> (bits - filled) : 0;
+            }
+            word++;
+        }
+    }
+}
+
+
+/*
+ * Reverses packGroup().
+ */
+static void unpackGroup(unsigned short *words, int bits, unsigned short *values)
+{
+    unsigned int mask = (1U << bits) - 1;
+    int filled = 0;
+    int word = 0;
+    int step;
+    int lane;
+
+    for (step = 0; step < VALUES_PER_LANE; step++)
+    {
+        if (filled + bits > 16)
+        {
+            for (lane = 0; lane < LANES; lane++)
+                values[step * LANES + lane] = ((words[word * LANES + lane] >> filled) |
+                    ((unsigned int) words[(word + 1) * LANES + lane] << (16 - filled))) & mask;
+        }
+        else
+        {
+            for (lane = 0; lane < LANES; lane++)
+                values[step * LANES + lane] = (words[word * LANES + lane] >> filled) & mask;
+        }
+
+        filled = filled + bits;
+        if (filled >= 16)
+        {
+            filled = filled - 16;
+            word++;
+        }
+    }
+}
+
+
+/*
+ * Returns the largest number of bytes packRow() can write for a row of the given
+ * width.
+ */
+int maxPackedRowSize(int width)
+{
+    int groups = (width + GROUP_SIZE - 1) / GROUP_SIZE;
+    return groups * (1 + 2 * GROUP_SIZE);
+}
+
+
+/*
+ * Encodes a row of elevation points given the row above it, or NULL for the first
+ * row. Returns the number of bytes written, or -1 if memory allocation failed.
+ */
+int packRow(signed short *row, signed short *previous, int width, unsigned char *output)
+{
+    int groups = (width + GROUP_SIZE - 1) / GROUP_SIZE;
+    unsigned short *residuals = (unsigned short *) malloc(sizeof(unsigned short) * groups * GROUP_SIZE);
+
+    if (residuals == NULL)
+        return -1;
+
+    predictRow(row, previous, width, residuals);
+
+    unsigned short words[16 * LANES];
+    unsigned char *out = output;
+    int group;
+    int x;
+
+    for (group = 0; group < groups; group++)
+    {
+        int bits = groupBits(residuals + group * GROUP_SIZE);
+        packGroup(residuals + group * GROUP_SIZE, bits, words);
+
+        // Words are stored little-endian.
+        *out++ = (unsigned char) bits;
+        for (x = 0; x < bits * LANES; x++)
+        {
+            *out++ = words[x] & 0xFF;
+            *out++ = words[x] >> 8;
+        }
+    }
+
+    free(residuals);
+    return out - output;
+}
+
+
+/*
+ * Decodes a row written by packRow() given the row above it, or NULL for the first
+ * row. Returns the number of bytes of input used, or -1 if the input is corrupt or
+ * memory allocation failed.
+ */
+int unpackRow(unsigned char *input, int inputSize, signed short *previous, int width, signed short *row)
+{
+    int groups = (width + GROUP_SIZE - 1) / GROUP_SIZE;
+    unsigned short *residuals = (unsigned short *) malloc(sizeof(unsigned short) * groups * GROUP_SIZE);
+
+    if (residuals == NULL)
+        return -1;
+
+    unsigned short words[16 * LANES];
+    unsigned char *in = input;
+    unsigned char *end = input + inputSize;
+    int group;
+    int x;
+
+    for (group = 0; group < groups; group++)
+    {
+        if (in >= end || *in > 16 || end - in - 1 < *in * LANES * 2)
+        {
+            free(residuals);
+            return -1;
+        }
+
+        int bits = *in++;
+        for (x = 0; x < bits * LANES; x++)
+        {
+            words[x] = in[0] | (in[1] << 8);
+            in = in + 2;
+        }
+
+        unpackGroup(words, bits, residuals + group * GROUP_SIZE);
+    }
+
+    reconstructRow(residuals, previous, width, row);
+
+    free(residuals);
+    return in - input;
+}
+
+
+/*
+ * Stores and loads unsigned integers in big-endian, the byte order of raw DEMs,
+ * for the headers of the file formats built on top of them.
+ */
+void putUint32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+}
+
+
+uint32_t getUint32(unsigned char *bytes)
+{
+    return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+
+void putUint64(unsigned char *bytes, uint64_t value)
+{
+    putUint32(bytes, value >> 32);
+    putUint32(bytes + 4, value & 0xFFFFFFFF);
+}
+
+
+uint64_t getUint64(unsigned char *bytes)
+{
+    return ((uint64_t) getUint32(bytes) << 32) | getUint32(bytes + 4);
+}
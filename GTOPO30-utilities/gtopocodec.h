@@ -0,0 +1,12 @@
+#include <stdint.h>
+
+int maxEncodedBlockSize(int width, int height);
+int encodeBlock(signed short *samples, int width, int height, unsigned char *output);
+int decodeBlock(unsigned char *input, int inputSize, signed short *samples, int width, int height);
+int maxPackedRowSize(int width);
+int packRow(signed short *row, signed short *previous, int width, unsigned char *output);
+int unpackRow(unsigned char *input, int inputSize, signed short *previous, int width, signed short *row);
+void putUint32(unsigned char *bytes, uint32_t value);
+uint32_t getUint32(unsigned char *bytes);
+void putUint64(unsigned char *bytes, uint64_t value);
+uint64_t getUint64(unsigned char *bytes);
@@ -1,26 +1,61 @@
+#include <string.h>
 #include "gtopodata.h"
+#include "gtopothreads.h"
 
 
 /*
- * Checks if the same elevation point from each DEM file both have the value.
- * Returns 1 if both are identical, 0 otherwise.
+ * Two rasters being compared, and whether a difference has been found.
  */
-static int compareRasters(signed short **rasterOne, signed short **rasterTwo, int width, int height)
+typedef struct comparison
 {
-    int row;
-    int column;
+    signed short **rasterOne;
+    signed short **rasterTwo;
+    int width;
+    int different;
+} comparison;
+
+
+/*
+ * Checks if the same elevation points of a band of rows of each DEM have the same
+ * values, stopping early once any band has found a difference. Run by
+ * parallelRows() for each band.
+ */
+static void compareRows(int firstRow, int rows, void *comparisonPointer)
+{
+    comparison *job = (comparison *) comparisonPointer;
 
-    for (row = 0; row < height; row++)
+    int row;
+    for (row = firstRow; row < firstRow + rows; row++)
     {
-        for (column = 0; column < width; column++)
+        if (__atomic_load_n(&job->different, __ATOMIC_RELAXED))
+            return;
+
+        if (memcmp(job->rasterOne[row], job->rasterTwo[row], sizeof(signed short) * job->width) != 0)
         {
-            if (rasterOne[row][column] != rasterTwo[row][column])
-                return 0;
+            __atomic_store_n(&job->different, 1, __ATOMIC_RELAXED);
+            return;
         }
     }
+}
+
+
+/*
+ * Checks if the same elevation point from each DEM file both have the value.
+ * Returns 1 if both are identical, 0 otherwise. Bands of rows are compared in
+ * parallel.
+ */
+static int compareRasters(signed short **rasterOne, signed short **rasterTwo, int width, int height)
+{
+    comparison job;
+    job.rasterOne = rasterOne;
+    job.rasterTwo = rasterTwo;
+    job.width = width;
+    job.different = 0;
+
+    parallelRows(height, width, compareRows, &job);
 
     // Return 1 to indicate no pixels were different, hence the images are the same.
-    return 1;
+    return !job.different;
 }
 
 
@@ -0,0 +1,8 @@
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+#define SIMD_NEON 4
+
+int getSimdLevel();
+char* getSimdName(int level);
@@ -1,5 +1,19 @@
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "gtopolimits.h"
+#include "gtopodata.h"
+#include "gtopothreads.h"
+#include "gtopoprofile.h"
+
+// Environment variable that selects how the rasters of DEMs are allocated.
+#define ALLOC_POLICY_VARIABLE "GTOPO_ALLOC_POLICY"
+
+// Size of a transparent huge page, which spread rasters are aligned to.
+#define HUGE_PAGE_SIZE (2 << 20)
+
+// Most elevations copied at once when filling, small enough to stay in cache.
+#define FILL_CHUNK 4096
 
 // Enable this #define directive for testing memory allocation failure.
 // #define malloc(...) NULL
@@ -8,74 +22,189 @@
 // http://netpbm.sourceforge.net/doc/pgm.html 
 
 
+typedef struct DEM DEM;
+
+
 /*
- * Stores all required data related to a DEM (Digital Elevation Model) that is to
- * be handled by a program. Properties of a DEM include:
- * 
- * Width and height: The width and height of the raster of the DEM which consists
- * of elevation points, each being a 16-bit signed integer stored in big-endian
- * format.
- * 
- * Raster: Each elevation point in the raster represents an elevation between
- * -407 and 8752 inclusive. Each is a signed integer of 16-bits - a signed short.
- * Each elevation occupies 2 bytes in big-endian format.
+ * Allocates memory from an arena, or from the heap when there is no arena.
  */
-typedef struct DEM
+static void* allocate(gtopoArena *arena, size_t size)
 {
-    int width; 
-    int height;
-    signed short **raster;
-} DEM;
+    if (arena != NULL)
+        return arenaAllocate(arena, size);
+
+    countAllocation();
+    return malloc(size);
+}
 
 
 /*
- * Dynamically allocates memory to an DEM structure and returns a pointer to
- * the allocated memory. If memory allocation fails, the DEM and its raster are
- * set to NULL.
+ * Sets count consecutive elevations to the value. Only the first is written one
+ * at a time; the rest are copied from the filled start with memcpy(), which the C
+ * library vectorizes, in copies that double up to a chunk that stays in cache.
  */
-DEM* createDEM(int width, int height)
+static void fillSamples(signed short *samples, size_t count, signed short value)
 {
-    // Allocate memory to a new image and set initial NULL/empty values. 
-    DEM *newDEM = (DEM *) malloc(sizeof(DEM));
+    if (count == 0)
+        return;
+
+    samples[0] = value;
+    size_t filled = 1;
+
+    while (filled < count)
+    {
+        size_t copy = filled < FILL_CHUNK ? filled : FILL_CHUNK;
+
+        if (copy > count - filled)
+            copy = count - filled;
+
+        memcpy(samples + filled, samples, sizeof(signed short) * copy);
+        filled += copy;
+    }
+}
+
+
+/*
+ * Returns whether rasters should be spread, as selected by setting the
+ * GTOPO_ALLOC_POLICY environment variable to "spread". A spread raster is
+ * aligned to and advised to use transparent huge pages, and its elevations are
+ * first written by the worker threads through parallelRows(). Linux places
+ * each page on the NUMA node of the thread that first writes it, so the rows of
+ * a globe-sized DEM are spread across the nodes like the threads that later
+ * process them, rather than all landing on the node of the main thread.
+ */
+static int spreadRasters()
+{
+    char *policy = getenv(ALLOC_POLICY_VARIABLE);
+    return policy != NULL && strcmp(policy, "spread") == 0;
+}
+
+
+/*
+ * Allocates the samples of a spread raster. Rasters of at least a huge page are
+ * aligned to one and advised to use them. Returns NULL if there is no memory.
+ */
+static signed short* allocateSpreadSamples(size_t size)
+{
+    countAllocation();
+
+    if (size < HUGE_PAGE_SIZE)
+        return (signed short *) malloc(size);
+
+    void *samples = NULL;
+    if (posix_memalign(&samples, HUGE_PAGE_SIZE, size) != 0)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    // This is only advice. Without transparent huge pages it changes nothing.
+    madvise(samples, size, MADV_HUGEPAGE);
+#endif
+
+    return (signed short *) samples;
+}
+
+
+/*
+ * Sets every elevation of one band of rows of a spread raster to have no data.
+ * Run by parallelRows() for each band.
+ */
+static void fillRows(int firstRow, int rows, void *DEMPointer)
+{
+    DEM *targetDEM = (DEM *) DEMPointer;
+    fillSamples(targetDEM->raster[firstRow], (size_t) rows * targetDEM->width, NO_DATA);
+}
+
+
+/*
+ * Dynamically allocates memory to a DEM structure and returns a pointer to it.
+ * The elevations are held in one block with the row pointers into it, so a DEM
+ * is three allocations however tall it is. If fill is 1, every elevation is set
+ * to have no data. A spread raster is always filled, as the fill is what places
+ * its pages. Returns NULL if memory allocation fails.
+ */
+static DEM* allocateDEM(gtopoArena *arena, int width, int height, int fill)
+{
+    // Allocate memory to a new DEM and set initial NULL/empty values. 
+    DEM *newDEM = (DEM *) allocate(arena, sizeof(DEM));
 
     // Check for failed memory allocation and return NULL if this occurred.
     if (newDEM == NULL)
         return NULL;
 
+    int spread = arena == NULL && spreadRasters();
+    size_t size = sizeof(signed short) * width * height;
+
     newDEM->width = width;
     newDEM->height = height;
-    newDEM->raster = (signed short **) malloc(sizeof(signed short *) * height);
+    newDEM->arena = arena;
+    newDEM->raster = (signed short **) allocate(arena, sizeof(signed short *) * height);
+    signed short *samples = spread ? allocateSpreadSamples(size) : (signed short *) allocate(arena, size);
 
-    if (newDEM->raster == NULL)
-        return;
-
-    // Allocate memory to each pixel in the raster and set them to have no data.
-    int row;
-    int column;
-
-    for (row = 0; row < height; row++)
+    if (newDEM->raster == NULL || samples == NULL)
     {
-        newDEM->raster[row] = (signed short *) malloc(sizeof(signed short) * width);
-
-        if (newDEM->raster[row] == NULL)
+        if (arena == NULL)
         {
-            newDEM->raster = NULL;
-            return;
+            free(newDEM->raster);
+            free(samples);
+            free(newDEM);
         }
+
+        return NULL;
     }
 
+    // Point each row into the block.
+    int row;
     for (row = 0; row < height; row++)
     {
-        for (column = 0; column < width; column++)
-        {
-            newDEM->raster[row][column] = NO_DATA;
-        }
+        newDEM->raster[row] = samples + (size_t) row * width;
     }
 
+    // Set every elevation to have no data, touching the pages of a spread raster on the worker threads
+    // in the same shares of rows that parallelRows() gives the kernels that later process it.
+    if (spread)
+        parallelRows(height, width, fillRows, newDEM);
+    else if (fill)
+        fillSamples(samples, (size_t) width * height, NO_DATA);
+
     return newDEM;
 }
 
 
+/*
+ * Dynamically allocates memory to a DEM structure, with every elevation set to
+ * have no data. If an arena is given, the DEM is allocated from it and is
+ * released with the arena rather than by freeDEM(). Otherwise the raster follows
+ * the GTOPO_ALLOC_POLICY environment variable. Returns NULL if memory allocation
+ * fails.
+ */
+DEM* createArenaDEM(gtopoArena *arena, int width, int height)
+{
+    return allocateDEM(arena, width, height, 1);
+}
+
+
+/*
+ * Dynamically allocates memory to a DEM structure without setting its
+ * elevations, for DEMs that are about to be entirely overwritten, such as by
+ * reading, reducing or tiling. This saves a pass over the whole raster. The
+ * arena is used as by createArenaDEM(). Returns NULL if memory allocation fails.
+ */
+DEM* createUnfilledDEM(gtopoArena *arena, int width, int height)
+{
+    return allocateDEM(arena, width, height, 0);
+}
+
+
+/*
+ * Dynamically allocates memory to a DEM structure from the heap. Returns NULL if
+ * memory allocation fails.
+ */
+DEM* createDEM(int width, int height)
+{
+    return createArenaDEM(NULL, width, height);
+}
+
+
 int getWidth(DEM *targetDEM)
 {
     return targetDEM->width;
@@ -94,11 +223,16 @@ signed short** getRaster(DEM *targetDEM)
 }
 
 
+// Always define the out-of-line accessors, which gtopodata.h may have replaced.
+#undef getElevation
+#undef setElevation
+
+
 /*
  * Returns the value of the elevation in the raster given a pointer to the DEM and
  * the row and column this elevation should come from.
  */
-unsigned char getElevation(DEM *targetDEM, int row, int column)
+signed short getElevation(DEM *targetDEM, int row, int column)
 {
     return targetDEM->raster[row][column];
 }
@@ -114,25 +248,32 @@ void setElevation(DEM *targetDEM, signed short value, int row, int column)
 
 
 /*
- * Frees all dynamically allocated data related to an image given its pointer
- * which includes the raster and comments.
+ * Sets every elevation in a region of the DEM to the value, given the row and
+ * column of its top-left corner and its dimensions. Used to fill the parts of a
+ * DEM created by createUnfilledDEM() that will not be overwritten.
  */
-void freeDEM(DEM *targetDEM)
+void fillElevations(DEM *targetDEM, signed short value, int row, int column, int width, int height)
 {
-    // Only free if the DEM is initialised.
-    if (targetDEM != NULL)
+    int x;
+    for (x = row; x < row + height; x++)
     {
-        // Free memory allocated to the image raster if it was allocated.
-        if (targetDEM->raster != NULL)
-        {
-            int x;
-            for (x = 0; x < targetDEM->height; x++)
-            {
-                free(targetDEM->raster[x]);
-            }
-            free(targetDEM->raster);
-        }
+        fillSamples(targetDEM->raster[x] + column, width, value);
+    }
+}
+
 
+/*
+ * Frees all dynamically allocated data related to a DEM given its pointer, which
+ * includes the raster. DEMs allocated from an arena are left to be released with
+ * the arena.
+ */
+void freeDEM(DEM *targetDEM)
+{
+    // Only free if the DEM is initialised and does not belong to an arena.
+    if (targetDEM != NULL && targetDEM->arena == NULL)
+    {
+        free(targetDEM->raster[0]);
+        free(targetDEM->raster);
         free(targetDEM);
     }
 }
@@ -1,9 +1,64 @@
+#ifndef GTOPODATA_H
+#define GTOPODATA_H
+
+#include "gtopoarena.h"
+
+/*
+ * Stores all required data related to a DEM (Digital Elevation Model) that is to
+ * be handled by a program. Properties of a DEM include:
+ *
+ * Width and height: The width and height of the raster of the DEM which consists
+ * of elevation points, each being a 16-bit signed integer stored in big-endian
+ * format.
+ *
+ * Raster: Each elevation point in the raster represents an elevation between
+ * -407 and 8752 inclusive. Each is a signed integer of 16-bits - a signed short.
+ * Each elevation occupies 2 bytes in big-endian format.
+ *
+ * Programs should use the functions below rather than the fields, which are only
+ * here so that the accessors can be inlined.
+ */
+struct DEM
+{
+    int width;
+    int height;
+    signed short **raster;
+    gtopoArena *arena;
+};
+
 typedef struct DEM gtopoDEM;
 
 gtopoDEM* createDEM(int width, int height);
+gtopoDEM* createArenaDEM(gtopoArena *arena, int width, int height);
+gtopoDEM* createUnfilledDEM(gtopoArena *arena, int width, int height);
 int getWidth(gtopoDEM *targetDEM);
 int getHeight(gtopoDEM *targetDEM);
 signed short** getRaster(gtopoDEM *targetDEM);
 signed short getElevation(gtopoDEM *targetDEM, int row, int column);
 void setElevation(gtopoDEM *targetDEM, signed short value, int row, int column);
+void fillElevations(gtopoDEM *targetDEM, signed short value, int row, int column, int width, int height);
 void freeDEM(gtopoDEM *image);
+
+/*
+ * The release and pgo builds define INLINE_ACCESSORS, replacing the per-point
+ * accessors with these so that they cost no call in the loops that use them.
+ * gtopodata.c still defines the functions above for objects built without it.
+ */
+#ifdef INLINE_ACCESSORS
+
+static inline signed short inlineGetElevation(gtopoDEM *targetDEM, int row, int column)
+{
+    return targetDEM->raster[row][column];
+}
+
+static inline void inlineSetElevation(gtopoDEM *targetDEM, signed short value, int row, int column)
+{
+    targetDEM->raster[row][column] = value;
+}
+
+#define getElevation inlineGetElevation
+#define setElevation inlineSetElevation
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include "gtopodata.h"
 #include "gtopolimits.h"
 #include "gtopoexit.h"
@@ -19,10 +20,15 @@ typedef struct gtopoErr
 
 
 /*
- *
+ * Allocates an error with the given exit code and a message built from the
+ * prefix and, in brackets, the string. Errors are only allocated once a check
+ * has failed, so the checks made on every sample of a raster cost nothing when
+ * they pass.
  */
-static void createError(gtopoErr *err, int code, char *prefix , char *string)
+static gtopoErr* createError(int code, char *prefix , char *string)
 {
+    gtopoErr *err = (gtopoErr *) malloc(sizeof(gtopoErr));
+
     // Allocate enough memory to the error string and build it.
     err->errorMsg = (char *) calloc(strlen(prefix) + strlen(string) + 10, sizeof(char));
     err->errorCode = code;
@@ -38,6 +44,7 @@ static void createError(gtopoErr *err, int code, char *prefix , char *string)
         strcat(err->errorMsg, ")");
         
     strcat(err->errorMsg, "\n");
+    return err;
 }
 
 
@@ -46,16 +53,27 @@ static void createError(gtopoErr *err, int code, char *prefix , char *string)
  */
 gtopoErr* checkInvalidFileName(FILE *file, char *path)
 {
-    gtopoErr *invalidFileName = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (file == NULL)
     {
         // We will free the error when we display it.
-        createError(invalidFileName, EXIT_BAD_FILE_NAME, STR_BAD_FILE_NAME, path);
-        return invalidFileName;
+        return createError(EXIT_BAD_FILE_NAME, STR_BAD_FILE_NAME, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the write mode for a DEM is either 0 (raw) or 1 (bit-packed).
+ */
+gtopoErr* checkInvalidWriteMode(int mode)
+{
+    if (mode != RAW && mode != BITPACKED)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_BAD_WRITE_MODE, "");
     }
 
-    free(invalidFileName);
     return NULL;
 }
 
@@ -65,15 +83,11 @@ gtopoErr* checkInvalidFileName(FILE *file, char *path)
  */
 gtopoErr* checkInvalidFactor(int factor, char lastChar)
 {
-    gtopoErr *invalidFactor = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (factor <= 0 || lastChar != '\0')
     {
-        createError(invalidFactor, EXIT_MISC, STR_MISC, STR_BAD_FACTOR);
-        return invalidFactor;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_FACTOR);
     }
 
-    free(invalidFactor);
     return NULL;
 }
 
@@ -83,15 +97,11 @@ gtopoErr* checkInvalidFactor(int factor, char lastChar)
  */
 gtopoErr* checkInvalidWidth(int width, char lastChar)
 {
-    gtopoErr *invalidWidth = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (width < MIN_DIMENSION || width > MAX_COLUMNS || lastChar != '\0')
     {
-        createError(invalidWidth, EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
-        return invalidWidth;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
     }
 
-    free(invalidWidth);
     return NULL;
 }
 
@@ -101,15 +111,11 @@ gtopoErr* checkInvalidWidth(int width, char lastChar)
  */
 gtopoErr* checkInvalidHeight(int height, char lastChar)
 {
-    gtopoErr *invalidHeight = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (height < MIN_DIMENSION || height > MAX_ROWS || lastChar != '\0')
     {
-        createError(invalidHeight, EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
-        return invalidHeight;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
     }
 
-    free(invalidHeight);
     return NULL;
 }
 
@@ -119,15 +125,11 @@ gtopoErr* checkInvalidHeight(int height, char lastChar)
  */
 gtopoErr* checkInvalidPosition(int axisPosition, int axisEnd, char lastChar)
 {
-    gtopoErr *invalidPosition = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (axisPosition < MIN_DIMENSION - 1 || axisPosition > axisEnd - 1 || lastChar != '\0')
     {
-        createError(invalidPosition, EXIT_MISC, STR_MISC, STR_BAD_ROW);
-        return invalidPosition;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_ROW);
     }
 
-    free(invalidPosition);
     return NULL;
 }
 
@@ -138,28 +140,22 @@ gtopoErr* checkInvalidPosition(int axisPosition, int axisEnd, char lastChar)
  */
 gtopoErr* checkTagsPresent(char *template, char *rowTag, char *colTag)
 {
-    gtopoErr *tagMissing = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     char *rowTagAddress = strstr(template, rowTag);
     char *columnTagAddress = strstr(template, colTag);
 
     if (rowTagAddress == NULL && columnTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_TAGS);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_TAGS);
     }
     else if (rowTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_ROW_TAG);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_ROW_TAG);
     }
     else if (columnTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_COL_TAG);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_COL_TAG);
     }
 
-    free(tagMissing);
     return NULL;
 }
 
@@ -169,16 +165,12 @@ gtopoErr* checkTagsPresent(char *template, char *rowTag, char *colTag)
  */
 gtopoErr* checkEOF(int scanned, char *path)
 {
-    gtopoErr *eofDetected = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (scanned == 0)
     {
         // We will free the error when we display it.
-        createError(eofDetected, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return eofDetected;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
     
-    free(eofDetected);
     return NULL;
 }
 
@@ -188,28 +180,29 @@ gtopoErr* checkEOF(int scanned, char *path)
  */
 gtopoErr* checkDEMallocated(gtopoDEM *targetDEM)
 {
-    gtopoErr *notAllocated = (gtopoErr *) malloc(sizeof(gtopoErr));
-    signed short **raster = getRaster(targetDEM);
-
-    if (targetDEM == NULL || raster == NULL)
+    // The raster is allocated with the DEM, so a DEM is either whole or NULL.
+    if (targetDEM == NULL || getRaster(targetDEM) == NULL)
     {
         // We will free the error when we display it.
-        createError(notAllocated, EXIT_MALLOC_FAILED, STR_MALLOC_FAILED, "");
-        return notAllocated;
+        return createError(EXIT_MALLOC_FAILED, STR_MALLOC_FAILED, "");
     }
 
-    int row;
-    for (row = 0; row < getHeight(targetDEM); row++)
+    return NULL;
+}
+
+
+/*
+ * Checks whether a working buffer used while reading or writing a file was
+ * allocated.
+ */
+gtopoErr* checkAllocated(void *pointer)
+{
+    if (pointer == NULL)
     {
-        if (raster[row] == NULL)
-        {
-            createError(notAllocated, EXIT_MALLOC_FAILED, STR_MALLOC_FAILED, "");
-            return notAllocated;
-        }
+        // We will free the error when we display it.
+        return createError(EXIT_MALLOC_FAILED, STR_MALLOC_FAILED, "");
     }
-    
-    // Error not triggered. Free it.
-    free(notAllocated);
+
     return NULL;
 }
 
@@ -219,17 +212,12 @@ gtopoErr* checkDEMallocated(gtopoDEM *targetDEM)
  */
 gtopoErr* checkElevation(signed short elevation, int scanned, char *path)
 {
-    gtopoErr *badElevation = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (elevation != NO_DATA && (scanned != 1 || elevation > MAX_ELEVATION_VALUE || elevation < MIN_ELEVATION_VALUE))
     {
         // We will free this error when we display it.
-        createError(badElevation, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return badElevation;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
 
-    // Error not triggered. Free it.
-    free(badElevation);
     return NULL;
 }
 
@@ -239,17 +227,28 @@ gtopoErr* checkElevation(signed short elevation, int scanned, char *path)
  */
 gtopoErr* checkElevationCount(int count, int expected, char *path)
 {
-    gtopoErr *missingElevation = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     if (count != expected)
     {
         // We will free this error when we display it.
-        createError(missingElevation, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return missingElevation;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the dimensions stored in a file match the dimensions it was
+ * expected to have.
+ */
+gtopoErr* checkMatchingDimensions(int width, int height, int expectedWidth, int expectedHeight, char *path)
+{
+    if (width != expectedWidth || height != expectedHeight)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DIMENSIONS, STR_BAD_DIMENSIONS, path);
     }
 
-    // Error not triggered. Free it.
-    free(missingElevation);
     return NULL;
 }
 
@@ -267,30 +266,25 @@ gtopoErr* checkElevationSettings(int sea, int hill, int mountain,
                 char lastCharSea, char lastCharHill, char lastCharMountain
 )
 {
-    gtopoErr *invalidSettings = (gtopoErr *) malloc(sizeof(gtopoErr));
-
     // Check the values were read from the command line correctly.
     if (lastCharSea != '\0' || lastCharHill != '\0' || lastCharMountain != '\0')
     {
         // We will free this error when we display it.
-        createError(invalidSettings, EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
-        return invalidSettings;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
     }
 
     // Any two of the three values should not equal each other.
     if (sea == hill || sea == mountain || hill == mountain)
     {
         // We will free this error when we display it.
-        createError(invalidSettings, EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
-        return invalidSettings;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
     }
 
     // Mountain should be greater than hill and hill should be greater than sea.
     if (sea > hill || sea > mountain || hill > mountain)
     {
         // We will free this error when we display it.
-        createError(invalidSettings, EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
-        return invalidSettings;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
     }
 
     // Check the elevation values are in the valid ranges with special case of -9999.
@@ -299,16 +293,401 @@ gtopoErr* checkElevationSettings(int sea, int hill, int mountain,
         (mountain != NO_DATA && (mountain < MIN_ELEVATION_VALUE || mountain > MAX_ELEVATION_VALUE)))
     {
         // We will free this error when we display it.
-        createError(invalidSettings, EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
-        return invalidSettings;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SETTINGS);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the header or a block of a packed DEM could not be decoded.
+ */
+gtopoErr* checkPackedData(int corrupt, char *path)
+{
+    if (corrupt != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the header, size or an entry of a summed-area table written by
+ * gtopoIntegral could not be read or does not match.
+ */
+gtopoErr* checkIntegralData(int corrupt, char *path)
+{
+    if (corrupt != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DATA, STR_BAD_INTEGRAL, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether an output file could not be written in full or closed, as when
+ * the disk is full.
+ */
+gtopoErr* checkOutputWritten(int failed, char *path)
+{
+    if (failed != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the .HDR file beside a DEM could not be understood.
+ */
+gtopoErr* checkHeaderData(int corrupt, char *path)
+{
+    if (corrupt != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the dimensions of a DEM given as auto could be found in a .HDR
+ * file or the header of the DEM.
+ */
+gtopoErr* checkDimensionsKnown(int known)
+{
+    if (known == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_NO_HEADER);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a DEM that is streamed or mapped has big-endian elevations.
+ */
+gtopoErr* checkByteOrder(int bigEndian, char *path)
+{
+    if (bigEndian == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a bounding box in degrees lies on the globe and has a positive
+ * extent.
+ */
+gtopoErr* checkInvalidBounds(double west, double south, double east, double north,
+    char lastCharWest, char lastCharSouth, char lastCharEast, char lastCharNorth)
+{
+    if (west < -180 || east > 180 || south < -90 || north > 90 || west >= east || south >= north ||
+        lastCharWest != '\0' || lastCharSouth != '\0' || lastCharEast != '\0' || lastCharNorth != '\0')
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_BOUNDS);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a DEM placed by its coordinates had the georeferencing to do so.
+ */
+gtopoErr* checkGeoReference(int valid)
+{
+    if (valid == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_NO_GEOREFERENCE);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a Unix socket could be created, bound or connected to.
+ */
+gtopoErr* checkSocket(int failed, char *path)
+{
+    if (failed != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_FILE_NAME, STR_BAD_FILE_NAME, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the number of blocks a cache may hold is greater than 0.
+ */
+gtopoErr* checkCacheSize(int blocks, char lastChar)
+{
+    if (blocks <= 0 || lastChar != '\0')
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_CACHE_SIZE);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether points were given in known units, and are to be sampled with a
+ * filter that reads no more than the 2x2 cells around them.
+ */
+gtopoErr* checkSampleSettings(int validUnits, int validFilter)
+{
+    if (validUnits == 0 || validFilter == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SAMPLING);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a line of a points file held two numbers.
+ */
+gtopoErr* checkPointFormat(int valid)
+{
+    if (valid == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_POINT);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a DEM sampled at points in degrees had the georeferencing to
+ * find them.
+ */
+gtopoErr* checkPointGeoReference(int valid)
+{
+    if (valid == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_NO_POINT_GEOREFERENCE);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a request to the server was understood.
+ */
+gtopoErr* checkRequest(int valid)
+{
+    if (valid == 0)
+    {
+        // We will free this error when we send it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_REQUEST);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the thread count given with the -j flag was valid.
+ */
+gtopoErr* checkThreadCount(int invalid)
+{
+    if (invalid != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_THREADS);
     }
 
-    // Error not triggered. Free it.
-    free(invalidSettings);
     return NULL;
 }
 
 
+/*
+ * Checks whether a window of elevation points lies entirely within a DEM.
+ */
+gtopoErr* checkInvalidWindow(int row, int column, int width, int height, int demWidth, int demHeight)
+{
+    if (row < 0 || column < 0 || width < MIN_DIMENSION || height < MIN_DIMENSION ||
+        width > demWidth - column || height > demHeight - row)
+    {
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_WINDOW);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a row of a streamed DEM could not be read or held an invalid
+ * elevation.
+ */
+gtopoErr* checkRowData(int failed, char *path)
+{
+    if (failed != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the light source and exaggeration settings for hillshading are
+ * valid. The azimuth is in degrees clockwise from north, the altitude in degrees
+ * above the horizon.
+ */
+gtopoErr* checkShadingSettings(double azimuth, double altitude, double zFactor,
+                char lastCharAzimuth, char lastCharAltitude, char lastCharZFactor
+)
+{
+    if (lastCharAzimuth != '\0' || lastCharAltitude != '\0' || lastCharZFactor != '\0' ||
+        azimuth < 0 || azimuth > 360 || altitude < 0 || altitude > 90 || zFactor <= 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SHADING);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a gradient neighbourhood width is valid: 3 or 5.
+ */
+gtopoErr* checkInvalidNeighbourhood(int neighbourhood, char lastChar)
+{
+    if (lastChar != '\0' || (neighbourhood != 3 && neighbourhood != 5))
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_NEIGHBOURHOOD);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a sea level is an integer within the range of valid elevations.
+ */
+gtopoErr* checkSeaLevel(int seaLevel, char lastChar)
+{
+    if (lastChar != '\0' || seaLevel < MIN_ELEVATION_VALUE || seaLevel > MAX_ELEVATION_VALUE)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_SEA_LEVEL);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a range of elevations to search for is valid: two integers within
+ * the range of valid elevations, the first no greater than the second.
+ */
+gtopoErr* checkElevationRange(int low, int high, char lastCharLow, char lastCharHigh)
+{
+    if (lastCharLow != '\0' || lastCharHigh != '\0' || low > high ||
+        low < MIN_ELEVATION_VALUE || high > MAX_ELEVATION_VALUE)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_RANGE);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a resampling filter was recognised.
+ */
+gtopoErr* checkInvalidFilter(int filter)
+{
+    if (filter < 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_FILTER);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a line of a batch job file names a known operation with the
+ * right number of arguments.
+ */
+gtopoErr* checkJobFormat(int valid)
+{
+    if (valid == 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_JOB);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Adds the line of the batch job file that an error came from to its message,
+ * so that one failed job among thousands can be found. Returns the same error.
+ */
+gtopoErr* locateJobError(gtopoErr *err, char *path, int line)
+{
+    if (err == NULL)
+        return NULL;
+
+    char *located = (char *) calloc(strlen(err->errorMsg) + strlen(path) + 32, sizeof(char));
+
+    // Keep the original message if there is no memory to extend it.
+    if (located == NULL)
+        return err;
+
+    // Replace the new line that ends the message with the location.
+    size_t length = strlen(err->errorMsg) - 1;
+    memcpy(located, err->errorMsg, length);
+    sprintf(located + length, " on line %d of %s\n", line, path);
+
+    free(err->errorMsg);
+    err->errorMsg = located;
+    return err;
+}
+
+
 /*
  * Displays the occurrance of an error to the user, printing the error string
  * and returning the exit code that should be used to exit the program with.
@@ -322,3 +701,31 @@ int displayError(gtopoErr *err)
     err = NULL;
     return code;
 }
+
+
+/*
+ * Sends the error string to a client over a socket instead of displaying it,
+ * freeing the error and returning its exit code. The string is sent as one line
+ * starting with ERROR, so a client can tell it from a reply.
+ */
+int sendError(gtopoErr *err, int socket)
+{
+    send(socket, err->errorMsg, strlen(err->errorMsg), MSG_NOSIGNAL);
+    int code = err->errorCode;
+    free(err->errorMsg);
+    free(err);
+    return code;
+}
+
+
+/*
+ * Frees an error that has been handled without being displayed.
+ */
+void freeError(gtopoErr *err)
+{
+    if (err != NULL)
+    {
+        free(err->errorMsg);
+        free(err);
+    }
+}
@@ -3,6 +3,7 @@
 typedef struct gtopoErr gtopoError;
 
 gtopoError* checkInvalidFileName(FILE *file, char *path);
+gtopoError* checkInvalidWriteMode(int mode);
 gtopoError* checkInvalidFactor(int factor, char lastChar);
 gtopoError* checkInvalidWidth(int width, char lastChar);
 gtopoError* checkInvalidHeight(int height, char lastChar);
@@ -10,8 +11,38 @@ gtopoError* checkInvalidPosition(int axisPosition, int axisEnd, char lastChar);
 gtopoError* checkTagsPresent(char *template, char *rowTag, char *colTag);
 gtopoError* checkEOF(int scanned, char *path);
 gtopoError* checkDEMallocated(gtopoDEM *targetDEM);
+gtopoError* checkAllocated(void *pointer);
 gtopoError* checkElevation(signed short elevation, int scanned, char *path);
 gtopoError* checkElevationCount(int count, int expected, char *path);
+gtopoError* checkMatchingDimensions(int width, int height, int expectedWidth, int expectedHeight, char *path);
 gtopoError* checkElevationSettings(int sea, int hill, int mountain,
                 char lastCharSea, char lastCharHill, char lastCharMountain);
+gtopoError* checkPackedData(int corrupt, char *path);
+gtopoError* checkIntegralData(int corrupt, char *path);
+gtopoError* checkOutputWritten(int failed, char *path);
+gtopoError* checkHeaderData(int corrupt, char *path);
+gtopoError* checkDimensionsKnown(int known);
+gtopoError* checkByteOrder(int bigEndian, char *path);
+gtopoError* checkInvalidBounds(double west, double south, double east, double north,
+                char lastCharWest, char lastCharSouth, char lastCharEast, char lastCharNorth);
+gtopoError* checkGeoReference(int valid);
+gtopoError* checkSocket(int failed, char *path);
+gtopoError* checkCacheSize(int blocks, char lastChar);
+gtopoError* checkRequest(int valid);
+gtopoError* checkSampleSettings(int validUnits, int validFilter);
+gtopoError* checkPointFormat(int valid);
+gtopoError* checkPointGeoReference(int valid);
+gtopoError* checkThreadCount(int invalid);
+gtopoError* checkInvalidWindow(int row, int column, int width, int height, int demWidth, int demHeight);
+gtopoError* checkRowData(int failed, char *path);
+gtopoError* checkShadingSettings(double azimuth, double altitude, double zFactor,
+                char lastCharAzimuth, char lastCharAltitude, char lastCharZFactor);
+gtopoError* checkInvalidNeighbourhood(int neighbourhood, char lastChar);
+gtopoError* checkSeaLevel(int seaLevel, char lastChar);
+gtopoError* checkElevationRange(int low, int high, char lastCharLow, char lastCharHigh);
+gtopoError* checkInvalidFilter(int filter);
+gtopoError* checkJobFormat(int valid);
+gtopoError* locateJobError(gtopoError *err, char *path, int line);
 int displayError(gtopoError *err);
+int sendError(gtopoError *err, int socket);
+void freeError(gtopoError *err);
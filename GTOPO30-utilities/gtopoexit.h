@@ -5,6 +5,19 @@
 #define STR_REDUCED "REDUCED\n"
 #define STR_TILED "TILED\n"
 #define STR_ASSEMBLED "ASSEMBLED\n"
+#define STR_PACKED "PACKED\n"
+#define STR_UNPACKED "UNPACKED\n"
+#define STR_SHADED "SHADED\n"
+#define STR_SLOPED "SLOPED\n"
+#define STR_ASPECTED "ASPECTED\n"
+#define STR_INUNDATED "INUNDATED\n"
+#define STR_INDEXED "INDEXED\n"
+#define STR_QUERIED "QUERIED\n"
+#define STR_RESAMPLED "RESAMPLED\n"
+#define STR_BATCHED "BATCHED\n"
+#define STR_WINDOWED "WINDOWED\n"
+#define STR_SERVED "SERVED\n"
+#define STR_SAMPLED "SAMPLED\n"
 
 #define EXIT_BAD_ARGS_COUNT 1
 #define STR_BAD_ARGS_COUNT "ERROR: Bad Argument Count\n"
@@ -20,6 +33,7 @@
 
 #define EXIT_BAD_DATA 8
 #define STR_BAD_DATA "ERROR: Bad Data"
+#define STR_BAD_INTEGRAL "ERROR: Bad Summed-Area Table"
 
 #define EXIT_OUTPUT_FAILED 9
 #define STR_OUTPUT_FAILED "ERROR: Output Failed"
@@ -40,3 +54,19 @@
 #define STR_BAD_COLUMN "Columns must be integers greater than or equal to 0 and less than the width (indexing from 0)"
 
 #define STR_BAD_SETTINGS "Incorrect values for sea, hill and mountain"
+#define STR_BAD_SHADING "Azimuth must be between 0 and 360, altitude between 0 and 90 and the z-factor greater than 0"
+#define STR_BAD_NEIGHBOURHOOD "Neighbourhood must be 3 or 5"
+#define STR_BAD_SEA_LEVEL "Sea level must be an integer between -407 and 8752"
+#define STR_BAD_RANGE "Low and high must be integers between -407 and 8752, with low no greater than high"
+#define STR_BAD_FILTER "Filter must be nearest, bilinear, bicubic or lanczos"
+#define STR_BAD_JOB "Jobs must be echo, reduce, tile or printland followed by the arguments of that program"
+#define STR_NO_HEADER "Width and height can only be auto for a DEM with a .HDR file or a bit-packed or packed header"
+#define STR_BAD_BOUNDS "Bounds must be west south east north in degrees, with west less than east and south less than north"
+#define STR_NO_GEOREFERENCE "DEMs placed by coordinates must have a .HDR file and share a cell size"
+#define STR_BAD_CACHE_SIZE "Cache size must be an integer number of blocks greater than 0"
+#define STR_BAD_REQUEST "Requests must be POINT row column, WINDOW row column width height, OVERVIEW factor row column width height, STATS or SHUTDOWN"
+#define STR_BAD_SAMPLING "Points must be given in cells or degrees, and sampled with the nearest or bilinear filter"
+#define STR_BAD_POINT "Points must be a row and column, or a latitude and longitude, separated by white space"
+#define STR_NO_POINT_GEOREFERENCE "Points can only be given in degrees for a DEM with a .HDR file"
+#define STR_BAD_WINDOW "Window must have positive dimensions and lie within the DEM"
+#define STR_BAD_THREADS "Thread count given with -j must be an integer from 1 to 1024"
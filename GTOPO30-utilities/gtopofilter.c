@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "gtopofilter.h"
+#include "gtopothreads.h"
+
+#define PI 3.14159265358979323846
+
+// Number of output rows computed by each task.
+#define ROWS_PER_BAND 64
+
+// Output points with less than this share of their weight on valid elevations have no data.
+#define MIN_COVERAGE 0.5f
+
+
+/*
+ * Precomputed weights for resampling along one axis. Output point i takes a
+ * weighted sum of count[i] input points starting at first[i], with weights
+ * weights[i * taps] onwards. Rows of weights are padded with zeros up to taps.
+ */
+typedef struct weightTable
+{
+    int taps;
+    int *first;
+    int *count;
+    float *weights;
+} weightTable;
+
+
+/*
+ * Shared state for resampling a DEM in bands of output rows.
+ */
+typedef struct resampleJob
+{
+    gtopoRowReader *reader;
+    int outputDescriptor;
+    int width;
+    int outputWidth;
+    int outputHeight;
+    weightTable *columns;
+    weightTable *rows;
+    int *failed;
+    int writeFailed;
+} resampleJob;
+
+
+/*
+ * Returns the filter named on the command line, or -1 if there is no such filter.
+ */
+int parseFilter(char *name)
+{
+    if (strcmp(name, "nearest") == 0)
+        return NEAREST;
+    else if (strcmp(name, "bilinear") == 0)
+        return BILINEAR;
+    else if (strcmp(name, "bicubic") == 0)
+        return BICUBIC;
+    else if (strcmp(name, "lanczos") == 0)
+        return LANCZOS;
+
+    return -1;
+}
+
+
+/*
+ * Returns how far either side of its centre a filter reaches, in input points.
+ */
+static double filterSupport(int filter)
+{
+    if (filter == BILINEAR)
+        return 1;
+    else if (filter == BICUBIC)
+        return 2;
+    else
+        return 3;
+}
+
+
+/*
+ * Evaluates a filter at a distance from its centre, in input points.
+ */
+static double filterWeight(int filter, double x)
+{
+    x = fabs(x);
+
+    if (filter == BILINEAR)
+        return x < 1 ? 1 - x : 0;
+
+    // Keys' cubic convolution with a = -0.5.
+    if (filter == BICUBIC)
+    {
+        if (x < 1)
+            return (1.5 * x - 2.5) * x * x + 1;
+        else if (x < 2)
+            return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+
+        return 0;
+    }
+
+    // Three-lobed Lanczos.
+    if (x == 0)
+        return 1;
+    else if (x >= 3)
+        return 0;
+
+    return 3 * sin(PI * x) * sin(PI * x / 3) / (PI * PI * x * x);
+}
+
+
+/*
+ * Frees a weight table.
+ */
+static void freeWeights(weightTable *table)
+{
+    if (table != NULL)
+    {
+        free(table->first);
+        free(table->count);
+        free(table->weights);
+        free(table);
+    }
+}
+
+
+/*
+ * Computes the weights for resampling inputSize points to outputSize points with
+ * a filter. Points are treated as cells, so output point i is centred on input
+ * coordinate (i + 0.5) * inputSize / outputSize. When shrinking, the filter is
+ * stretched to cover every input point it replaces. Weights falling outside the
+ * input are dropped and the rest renormalised. Returns NULL if memory could not
+ * be allocated.
+ */
+static weightTable* createWeights(int inputSize, int outputSize, int filter)
+{
+    double scale = (double) inputSize / outputSize;
+    double stretch = scale > 1 ? scale : 1;
+    double support = filter == NEAREST ? 0 : filterSupport(filter) * stretch;
+
+    weightTable *table = (weightTable *) calloc(1, sizeof(weightTable));
+    if (table == NULL)
+        return NULL;
+
+    table->taps = filter == NEAREST ? 1 : (int) ceil(2 * support) + 1;
+    table->first = (int *) malloc(sizeof(int) * outputSize);
+    table->count = (int *) malloc(sizeof(int) * outputSize);
+    table->weights = (float *) calloc((size_t) outputSize * table->taps, sizeof(float));
+
+    if (table->first == NULL || table->count == NULL || table->weights == NULL)
+    {
+        freeWeights(table);
+        return NULL;
+    }
+
+    int i;
+    int j;
+    for (i = 0; i < outputSize; i++)
+    {
+        double centre = (i + 0.5) * scale;
+        float *weights = table->weights + (size_t) i * table->taps;
+
+        if (filter == NEAREST)
+        {
+            int nearest = (int) centre;
+            table->first[i] = nearest < inputSize ? nearest : inputSize - 1;
+            table->count[i] = 1;
+            weights[0] = 1;
+            continue;
+        }
+
+        int low = (int) ceil(centre - support - 0.5);
+        int high = (int) floor(centre + support - 0.5);
+        low = low > 0 ? low : 0;
+        high = high < inputSize - 1 ? high : inputSize - 1;
+
+        double total = 0;
+        for (j = low; j <= high && j - low < table->taps; j++)
+        {
+            weights[j - low] = filterWeight(filter, (j + 0.5 - centre) / stretch);
+            total += weights[j - low];
+        }
+
+        table->first[i] = low;
+        table->count[i] = j - low;
+
+        for (j = 0; j < table->count[i] && total != 0; j++)
+            weights[j] /= total;
+    }
+
+    return table;
+}
+
+
+/*
+ * Resamples one input row horizontally. Each output point gets the weighted sum
+ * of the valid elevations under it and the total weight on them, so that NO_DATA
+ * never bleeds into its neighbours.
+ */
+static void resampleRow(signed short *elevations, weightTable *columns, int outputWidth,
+                float *values, float *coverage)
+{
+    int x;
+    int tap;
+    for (x = 0; x < outputWidth; x++)
+    {
+        signed short *input = elevations + columns->first[x];
+        float *weights = columns->weights + (size_t) x * columns->taps;
+        float value = 0;
+        float weight = 0;
+
+        for (tap = 0; tap < columns->count[x]; tap++)
+        {
+            float valid = input[tap] != NO_DATA;
+            value += weights[tap] * valid * input[tap];
+            weight += weights[tap] * valid;
+        }
+
+        values[x] = value;
+        coverage[x] = weight;
+    }
+}
+
+
+/*
+ * Resamples one band of output rows and writes them in place in the output file.
+ * The input rows under the band are read and resampled horizontally into a
+ * buffer first, then combined vertically. The vertical loops run along
+ * contiguous rows so that they can be vectorized. A band that could not be read
+ * is marked in failed, and one that could not be written sets writeFailed. Run
+ * by parallelFor() for each band index.
+ */
+static void resampleBand(int band, void *jobPointer)
+{
+    resampleJob *job = (resampleJob *) jobPointer;
+    weightTable *rows = job->rows;
+    int outputWidth = job->outputWidth;
+
+    int firstRow = band * ROWS_PER_BAND;
+    int lastRow = firstRow + ROWS_PER_BAND < job->outputHeight ? firstRow + ROWS_PER_BAND : job->outputHeight;
+
+    // The input rows under the band. Each output row's first input row is no lower than the last's.
+    int firstInput = rows->first[firstRow];
+    int lastInput = firstInput;
+
+    int row;
+    for (row = firstRow; row < lastRow; row++)
+    {
+        int end = rows->first[row] + rows->count[row];
+        lastInput = end > lastInput ? end : lastInput;
+    }
+
+    int inputRows = lastInput - firstInput;
+    size_t planeSize = (size_t) inputRows * outputWidth;
+
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * job->width);
+    float *values = (float *) malloc(sizeof(float) * planeSize);
+    float *coverage = (float *) malloc(sizeof(float) * planeSize);
+    float *value = (float *) malloc(sizeof(float) * outputWidth);
+    float *weight = (float *) malloc(sizeof(float) * outputWidth);
+    signed short *output = (signed short *) malloc(sizeof(signed short) * outputWidth);
+
+    job->failed[band] = 1;
+    if (elevations == NULL || values == NULL || coverage == NULL || value == NULL || weight == NULL || output == NULL)
+        goto cleanup;
+
+    int failed = 0;
+    for (row = 0; row < inputRows && failed == 0; row++)
+    {
+        failed |= readDEMRow(job->reader, firstInput + row, elevations);
+        resampleRow(elevations, job->columns, outputWidth,
+            values + (size_t) row * outputWidth, coverage + (size_t) row * outputWidth);
+    }
+
+    int writeFailed = 0;
+    int x;
+    int tap;
+    for (row = firstRow; row < lastRow && failed == 0 && writeFailed == 0; row++)
+    {
+        memset(value, 0, sizeof(float) * outputWidth);
+        memset(weight, 0, sizeof(float) * outputWidth);
+
+        for (tap = 0; tap < rows->count[row]; tap++)
+        {
+            float rowWeight = rows->weights[(size_t) row * rows->taps + tap];
+            size_t offset = (size_t) (rows->first[row] + tap - firstInput) * outputWidth;
+            float *inputValues = values + offset;
+            float *inputCoverage = coverage + offset;
+
+            for (x = 0; x < outputWidth; x++)
+            {
+                value[x] += rowWeight * inputValues[x];
+                weight[x] += rowWeight * inputCoverage[x];
+            }
+        }
+
+        for (x = 0; x < outputWidth; x++)
+        {
+            float elevation = roundf(value[x] / weight[x]);
+
+            // Sharpening filters can overshoot the range of elevations.
+            elevation = elevation < MIN_ELEVATION_VALUE ? MIN_ELEVATION_VALUE : elevation;
+            elevation = elevation > MAX_ELEVATION_VALUE ? MAX_ELEVATION_VALUE : elevation;
+
+            signed short point = weight[x] < MIN_COVERAGE ? NO_DATA : (signed short) elevation;
+            output[x] = (point << 8) | ((point >> 8) & 0xFF);
+        }
+
+        size_t rowBytes = sizeof(signed short) * outputWidth;
+        writeFailed = pwrite(job->outputDescriptor, output, rowBytes, (off_t) row * rowBytes) != rowBytes;
+    }
+
+    if (writeFailed)
+        __atomic_store_n(&job->writeFailed, 1, __ATOMIC_RELAXED);
+
+    job->failed[band] = failed;
+    goto cleanup;
+
+    cleanup:
+    free(elevations);
+    free(values);
+    free(coverage);
+    free(value);
+    free(weight);
+    free(output);
+}
+
+
+/*
+ * Resamples the DEM at inputPath to outputWidth by outputHeight points with the
+ * given filter, writing a raw DEM to outputPath. The filters are separable, so
+ * rows are resampled first and columns second, each with a table of weights
+ * computed once. Bands of output rows are resampled in parallel, each reading
+ * only the input rows under it. Output points that rest mostly on NO_DATA have no
+ * data themselves; the others are weighted over their valid elevations only. Can
+ * return an error.
+ */
+void resample(char *inputPath, int width, int height, char *outputPath,
+                int outputWidth, int outputHeight, int filter)
+{
+    error = NULL;
+
+    int bands = (outputHeight + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    FILE *outputFile = NULL;
+    resampleJob job;
+    job.columns = NULL;
+    job.rows = NULL;
+    job.failed = NULL;
+    job.writeFailed = 0;
+
+    job.reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    job.width = width;
+    job.outputWidth = outputWidth;
+    job.outputHeight = outputHeight;
+    job.columns = createWeights(width, outputWidth, filter);
+    job.rows = createWeights(height, outputHeight, filter);
+    job.failed = (int *) malloc(sizeof(int) * bands);
+
+    error = checkAllocated(job.columns);
+    if (error == NULL)
+        error = checkAllocated(job.rows);
+    if (error == NULL)
+        error = checkAllocated(job.failed);
+    if (error != NULL)
+        goto cleanup;
+
+    outputFile = fopen(outputPath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    job.outputDescriptor = fileno(outputFile);
+
+    parallelFor(bands, resampleBand, &job);
+
+    // Check that every band was read.
+    int band;
+    for (band = 0; band < bands; band++)
+    {
+        error = checkRowData(job.failed[band], inputPath);
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    // Check that every band was written.
+    job.writeFailed |= fclose(outputFile) != 0;
+    outputFile = NULL;
+    error = checkOutputWritten(job.writeFailed, outputPath);
+    goto cleanup;
+
+    cleanup:
+    if (outputFile != NULL)
+        fclose(outputFile);
+
+    closeDEMRows(job.reader);
+    freeWeights(job.columns);
+    freeWeights(job.rows);
+    free(job.failed);
+}
@@ -0,0 +1,10 @@
+#include "gtopoio.h"
+
+#define NEAREST 0
+#define BILINEAR 1
+#define BICUBIC 2
+#define LANCZOS 3
+
+int parseFilter(char *name);
+void resample(char *inputPath, int width, int height, char *outputPath,
+                int outputWidth, int outputHeight, int filter);
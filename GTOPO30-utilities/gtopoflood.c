@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "gtopoflood.h"
+#include "gtopothreads.h"
+
+// Number of rows labelled by each task.
+#define ROWS_PER_BAND 64
+
+// Label of an elevation point that is above sea level or has no data.
+#define DRY -1
+
+
+/*
+ * The connected components of one band that later bands and the merge step need:
+ * how many there are, which of them touch the ocean, and the labels along the
+ * band's top and bottom rows.
+ */
+typedef struct floodBand
+{
+    int components;
+    unsigned char *touchesOcean;
+    int *firstLabels;
+    int *lastLabels;
+} floodBand;
+
+
+/*
+ * Shared state for inundating a DEM in row bands.
+ */
+typedef struct floodJob
+{
+    gtopoRowReader *reader;
+    int outputDescriptor;
+    int width;
+    int height;
+    int seaLevel;
+    floodBand *bands;
+    int *offsets;
+    unsigned char *oceanic;
+    int *failed;
+    int writeFailed;
+} floodJob;
+
+
+/*
+ * Returns the root of a union-find tree, halving the path on the way.
+ */
+static int findRoot(int *parent, int node)
+{
+    while (parent[node] != node)
+    {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+
+    return node;
+}
+
+
+/*
+ * Joins the trees of two nodes. The larger root always points to the smaller, so
+ * every node's parent precedes it.
+ */
+static void joinRoots(int *parent, int first, int second)
+{
+    first = findRoot(parent, first);
+    second = findRoot(parent, second);
+
+    if (first < second)
+        parent[second] = first;
+    else if (second < first)
+        parent[first] = second;
+}
+
+
+/*
+ * Returns the number of rows in a band.
+ */
+static int bandRows(floodJob *job, int band)
+{
+    int firstRow = band * ROWS_PER_BAND;
+    return firstRow + ROWS_PER_BAND < job->height ? ROWS_PER_BAND : job->height - firstRow;
+}
+
+
+/*
+ * Reads a band into a buffer with a border of one elevation point all round. The
+ * border holds the neighbouring rows, or NO_DATA beyond the edges of the DEM so
+ * that the edges count as ocean.
+ */
+static int readBand(floodJob *job, int band, signed short *elevations)
+{
+    int paddedWidth = job->width + 2;
+    int rows = bandRows(job, band);
+    int failed = 0;
+
+    int row;
+    for (row = 0; row < rows + 2; row++)
+    {
+        signed short *padded = elevations + row * paddedWidth;
+        int demRow = band * ROWS_PER_BAND + row - 1;
+
+        padded[0] = NO_DATA;
+        padded[paddedWidth - 1] = NO_DATA;
+
+        if (demRow < 0 || demRow >= job->height)
+        {
+            int column;
+            for (column = 1; column <= job->width; column++)
+                padded[column] = NO_DATA;
+        }
+        else
+        {
+            failed |= readDEMRow(job->reader, demRow, padded + 1);
+        }
+    }
+
+    return failed;
+}
+
+
+/*
+ * Labels the 4-connected regions of a band at or below sea level, numbering them
+ * from 0 in the order their first point is met and giving dry points DRY. Returns
+ * the number of regions. The labels are deterministic, so a band can be labelled
+ * again rather than kept in memory.
+ */
+static int labelBand(floodJob *job, int band, signed short *elevations, int *labels)
+{
+    int paddedWidth = job->width + 2;
+    int points = bandRows(job, band) * job->width;
+    int seaLevel = job->seaLevel;
+
+    int point;
+    for (point = 0; point < points; point++)
+    {
+        int row = point / job->width;
+        int column = point % job->width;
+        signed short elevation = elevations[(row + 1) * paddedWidth + column + 1];
+
+        if (elevation == NO_DATA || elevation > seaLevel)
+        {
+            labels[point] = DRY;
+            continue;
+        }
+
+        labels[point] = point;
+
+        if (column > 0 && labels[point - 1] != DRY)
+            joinRoots(labels, point - 1, point);
+
+        if (row > 0 && labels[point - job->width] != DRY)
+            joinRoots(labels, point - job->width, point);
+    }
+
+    /*
+     * Replace the trees with region numbers in one pass. As every parent precedes
+     * its child, a parent has already been numbered by the time its child is met.
+     * Numbers are stored as -2 - number while the pass runs, keeping them apart
+     * from unvisited parent indices and from DRY.
+     */
+    int regions = 0;
+
+    for (point = 0; point < points; point++)
+    {
+        if (labels[point] == DRY)
+            continue;
+
+        if (labels[point] == point)
+            labels[point] = -2 - regions++;
+        else
+            labels[point] = labels[labels[point]];
+    }
+
+    for (point = 0; point < points; point++)
+    {
+        if (labels[point] != DRY)
+            labels[point] = -2 - labels[point];
+    }
+
+    return regions;
+}
+
+
+/*
+ * Labels a band and records which of its regions touch NO_DATA or the edge of the
+ * DEM, along with the labels of its first and last rows. Run by parallelFor() for
+ * each band index.
+ */
+static void findBandRegions(int band, void *jobPointer)
+{
+    floodJob *job = (floodJob *) jobPointer;
+    floodBand *regions = &job->bands[band];
+    int width = job->width;
+    int paddedWidth = width + 2;
+    int rows = bandRows(job, band);
+
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * (rows + 2) * paddedWidth);
+    int *labels = (int *) malloc(sizeof(int) * rows * width);
+
+    job->failed[band] = 1;
+    if (elevations == NULL || labels == NULL || readBand(job, band, elevations) != 0)
+        goto cleanup;
+
+    regions->components = labelBand(job, band, elevations, labels);
+    regions->touchesOcean = (unsigned char *) calloc(regions->components + 1, sizeof(unsigned char));
+    regions->firstLabels = (int *) malloc(sizeof(int) * width);
+    regions->lastLabels = (int *) malloc(sizeof(int) * width);
+
+    if (regions->touchesOcean == NULL || regions->firstLabels == NULL || regions->lastLabels == NULL)
+        goto cleanup;
+
+    int row;
+    int column;
+    for (row = 0; row < rows; row++)
+    {
+        for (column = 0; column < width; column++)
+        {
+            int label = labels[row * width + column];
+            if (label == DRY)
+                continue;
+
+            signed short *centre = elevations + (row + 1) * paddedWidth + column + 1;
+            if (centre[-1] == NO_DATA || centre[1] == NO_DATA ||
+                centre[-paddedWidth] == NO_DATA || centre[paddedWidth] == NO_DATA)
+                regions->touchesOcean[label] = 1;
+        }
+    }
+
+    for (column = 0; column < width; column++)
+    {
+        regions->firstLabels[column] = labels[column];
+        regions->lastLabels[column] = labels[(rows - 1) * width + column];
+    }
+
+    job->failed[band] = 0;
+    goto cleanup;
+
+    cleanup:
+    free(elevations);
+    free(labels);
+}
+
+
+/*
+ * Labels a band again and writes it as ASCII rows, each followed by a new line
+ * except the last row of the DEM. A band that could not be read is marked in
+ * failed, and one that could not be written sets writeFailed. Run by
+ * parallelFor() for each band index.
+ */
+static void writeBand(int band, void *jobPointer)
+{
+    floodJob *job = (floodJob *) jobPointer;
+    int width = job->width;
+    int paddedWidth = width + 2;
+    int rows = bandRows(job, band);
+
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * (rows + 2) * paddedWidth);
+    int *labels = (int *) malloc(sizeof(int) * rows * width);
+    char *text = (char *) malloc(width + 1);
+
+    job->failed[band] = 1;
+    if (elevations == NULL || labels == NULL || text == NULL || readBand(job, band, elevations) != 0)
+        goto cleanup;
+
+    labelBand(job, band, elevations, labels);
+    unsigned char *oceanic = job->oceanic + job->offsets[band];
+
+    int writeFailed = 0;
+    int row;
+    int column;
+    for (row = 0; row < rows && writeFailed == 0; row++)
+    {
+        for (column = 0; column < width; column++)
+        {
+            int label = labels[row * width + column];
+
+            if (elevations[(row + 1) * paddedWidth + column + 1] == NO_DATA)
+                text[column] = ' ';
+            else if (label != DRY && oceanic[label])
+                text[column] = '~';
+            else
+                text[column] = '.';
+        }
+
+        int demRow = band * ROWS_PER_BAND + row;
+        size_t rowBytes = demRow == job->height - 1 ? width : width + 1;
+        text[width] = '\n';
+
+        writeFailed = pwrite(job->outputDescriptor, text, rowBytes, (off_t) demRow * (width + 1)) != rowBytes;
+    }
+
+    if (writeFailed)
+        __atomic_store_n(&job->writeFailed, 1, __ATOMIC_RELAXED);
+
+    job->failed[band] = 0;
+    goto cleanup;
+
+    cleanup:
+    free(elevations);
+    free(labels);
+    free(text);
+}
+
+
+/*
+ * Joins the regions of every band into regions of the whole DEM, where they meet
+ * across band boundaries, and marks every region connected to the ocean. Leaves
+ * the marks null if memory could not be allocated.
+ */
+static void mergeBands(floodJob *job, int bandCount)
+{
+    int total = job->offsets[bandCount];
+    int *parent = (int *) malloc(sizeof(int) * (total + 1));
+    job->oceanic = (unsigned char *) calloc(total + 1, sizeof(unsigned char));
+
+    if (parent == NULL || job->oceanic == NULL)
+    {
+        free(parent);
+        free(job->oceanic);
+        job->oceanic = NULL;
+        return;
+    }
+
+    int node;
+    for (node = 0; node < total; node++)
+        parent[node] = node;
+
+    int band;
+    int column;
+    for (band = 0; band < bandCount - 1; band++)
+    {
+        int *above = job->bands[band].lastLabels;
+        int *below = job->bands[band + 1].firstLabels;
+
+        for (column = 0; column < job->width; column++)
+        {
+            if (above[column] != DRY && below[column] != DRY)
+                joinRoots(parent, job->offsets[band] + above[column], job->offsets[band + 1] + below[column]);
+        }
+    }
+
+    for (band = 0; band < bandCount; band++)
+    {
+        for (node = 0; node < job->bands[band].components; node++)
+        {
+            if (job->bands[band].touchesOcean[node])
+                job->oceanic[findRoot(parent, job->offsets[band] + node)] = 1;
+        }
+    }
+
+    // Parents precede their children, so one ascending pass spreads the marks.
+    for (node = 0; node < total; node++)
+        job->oceanic[node] = job->oceanic[findRoot(parent, node)];
+
+    free(parent);
+}
+
+
+/*
+ * Writes an ASCII map of the DEM at inputPath flooded to seaLevel, using the
+ * following key:
+ *
+ * ' ' (space): Ocean (i.e. NO_DATA)
+ * '~' (tilde): Inundated (value <= seaLevel, connected to the ocean)
+ * '.' (full stop): Dry land, including basins below seaLevel cut off from the ocean
+ *
+ * Points are connected through their four edge neighbours, and the edges of the
+ * DEM count as ocean. Bands of rows are labelled in parallel with a union-find,
+ * the bands are joined in a serial merge step, and then labelled again in
+ * parallel to write the map. Can return an error.
+ */
+void inundate(char *inputPath, int width, int height, char *outputPath, int seaLevel)
+{
+    error = NULL;
+
+    int bandCount = (height + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    int band;
+    FILE *outputFile = NULL;
+    floodJob job;
+    job.bands = NULL;
+    job.offsets = NULL;
+    job.oceanic = NULL;
+    job.failed = NULL;
+    job.writeFailed = 0;
+
+    job.reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    job.width = width;
+    job.height = height;
+    job.seaLevel = seaLevel;
+    job.bands = (floodBand *) calloc(bandCount, sizeof(floodBand));
+    job.offsets = (int *) malloc(sizeof(int) * (bandCount + 1));
+    job.failed = (int *) malloc(sizeof(int) * bandCount);
+
+    error = checkAllocated(job.bands);
+    if (error == NULL)
+        error = checkAllocated(job.offsets);
+    if (error == NULL)
+        error = checkAllocated(job.failed);
+    if (error != NULL)
+        goto cleanup;
+
+    parallelFor(bandCount, findBandRegions, &job);
+
+    // Check that every band was read, and number the regions of the whole DEM.
+    job.offsets[0] = 0;
+    for (band = 0; band < bandCount; band++)
+    {
+        error = checkRowData(job.failed[band], inputPath);
+        if (error != NULL)
+            goto cleanup;
+
+        job.offsets[band + 1] = job.offsets[band] + job.bands[band].components;
+    }
+
+    mergeBands(&job, bandCount);
+
+    error = checkAllocated(job.oceanic);
+    if (error != NULL)
+        goto cleanup;
+
+    outputFile = fopen(outputPath, "w");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    job.outputDescriptor = fileno(outputFile);
+
+    parallelFor(bandCount, writeBand, &job);
+
+    // Check that every band was read again.
+    for (band = 0; band < bandCount; band++)
+    {
+        error = checkRowData(job.failed[band], inputPath);
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    // Check that every band was written.
+    job.writeFailed |= fclose(outputFile) != 0;
+    outputFile = NULL;
+    error = checkOutputWritten(job.writeFailed, outputPath);
+    goto cleanup;
+
+    cleanup:
+    if (outputFile != NULL)
+        fclose(outputFile);
+
+    if (job.bands != NULL)
+    {
+        for (band = 0; band < bandCount; band++)
+        {
+            free(job.bands[band].touchesOcean);
+            free(job.bands[band].firstLabels);
+            free(job.bands[band].lastLabels);
+        }
+    }
+
+    closeDEMRows(job.reader);
+    free(job.bands);
+    free(job.offsets);
+    free(job.oceanic);
+    free(job.failed);
+}
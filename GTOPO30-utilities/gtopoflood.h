@@ -0,0 +1,3 @@
+#include "gtopoio.h"
+
+void inundate(char *inputPath, int width, int height, char *outputPath, int seaLevel);
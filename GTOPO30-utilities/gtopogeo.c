@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gtopoio.h"
+#include "gtopoheader.h"
+#include "gtopogeo.h"
+
+// Fraction of a cell within which a coordinate is taken to lie on a cell edge.
+#define EDGE_TOLERANCE 1e-6
+
+
+/*
+ * Where the rows and columns of a DEM lie on the globe. ulx and uly are the
+ * longitude and latitude of the centre of its top-left cell, and xdim and ydim
+ * the size of a cell in degrees, exactly as in a .HDR file.
+ */
+typedef struct geoReference
+{
+    double ulx;
+    double uly;
+    double xdim;
+    double ydim;
+} geoReference;
+
+
+/*
+ * One of the 33 files the GTOPO30 globe is distributed as, named after the
+ * corner it starts at. From 90N to 60S there are 27 tiles of 40 by 50 degrees
+ * (4800x6000 points), and Antarctica is split into 6 tiles of 60 by 30 degrees
+ * (7200x3600 points).
+ */
+typedef struct sourceTile
+{
+    char *name;
+    double west;
+    double north;
+    double width;
+    double height;
+} sourceTile;
+
+static sourceTile sourceTiles[SOURCE_TILE_COUNT] =
+{
+    {"W180N90", -180, 90, 40, 50}, {"W140N90", -140, 90, 40, 50}, {"W100N90", -100, 90, 40, 50},
+    {"W060N90", -60, 90, 40, 50}, {"W020N90", -20, 90, 40, 50}, {"E020N90", 20, 90, 40, 50},
+    {"E060N90", 60, 90, 40, 50}, {"E100N90", 100, 90, 40, 50}, {"E140N90", 140, 90, 40, 50},
+    {"W180N40", -180, 40, 40, 50}, {"W140N40", -140, 40, 40, 50}, {"W100N40", -100, 40, 40, 50},
+    {"W060N40", -60, 40, 40, 50}, {"W020N40", -20, 40, 40, 50}, {"E020N40", 20, 40, 40, 50},
+    {"E060N40", 60, 40, 40, 50}, {"E100N40", 100, 40, 40, 50}, {"E140N40", 140, 40, 40, 50},
+    {"W180S10", -180, -10, 40, 50}, {"W140S10", -140, -10, 40, 50}, {"W100S10", -100, -10, 40, 50},
+    {"W060S10", -60, -10, 40, 50}, {"W020S10", -20, -10, 40, 50}, {"E020S10", 20, -10, 40, 50},
+    {"E060S10", 60, -10, 40, 50}, {"E100S10", 100, -10, 40, 50}, {"E140S10", 140, -10, 40, 50},
+    {"W180S60", -180, -60, 60, 30}, {"W120S60", -120, -60, 60, 30}, {"W060S60", -60, -60, 60, 30},
+    {"W000S60", 0, -60, 60, 30}, {"E060S60", 60, -60, 60, 30}, {"E120S60", 120, -60, 60, 30}
+};
+
+
+/*
+ * Creates a georeference from the centre of the top-left cell and the size of a
+ * cell in degrees. Returns NULL if it could not be allocated.
+ */
+geoReference* createGeoReference(double ulx, double uly, double xdim, double ydim)
+{
+    geoReference *newReference = (geoReference *) malloc(sizeof(geoReference));
+
+    if (newReference == NULL)
+        return NULL;
+
+    newReference->ulx = ulx;
+    newReference->uly = uly;
+    newReference->xdim = xdim;
+    newReference->ydim = ydim;
+    return newReference;
+}
+
+
+/*
+ * Creates the georeference of the whole GTOPO30 globe, 43200x21600 points.
+ */
+geoReference* createGlobalGeoReference()
+{
+    return createGeoReference(GTOPO30_ULX, GTOPO30_ULY, GTOPO30_CELL_DEGREES, GTOPO30_CELL_DEGREES);
+}
+
+
+/*
+ * Reads the georeference of a DEM from the .HDR file beside it. Returns NULL,
+ * without an error, if there is no such file. Can return an error.
+ */
+geoReference* readGeoReference(char *demPath)
+{
+    gtopoHeader *header = readHeader(demPath);
+    if (header == NULL)
+        return NULL;
+
+    geoReference *newReference = createGeoReference(getHeaderULX(header), getHeaderULY(header),
+        getHeaderXDim(header), getHeaderYDim(header));
+    freeHeader(header);
+
+    error = checkAllocated(newReference);
+    return newReference;
+}
+
+
+/*
+ * Creates the georeference of the part of a DEM that starts at the given row
+ * and column, such as a tile or a window.
+ */
+geoReference* offsetGeoReference(geoReference *origin, int row, int column)
+{
+    return createGeoReference(origin->ulx + column * origin->xdim, origin->uly - row * origin->ydim,
+        origin->xdim, origin->ydim);
+}
+
+
+/*
+ * Creates the georeference of a DEM reduced by the given factor. Each of its
+ * cells covers factor * factor cells of the original, so its top-left cell has
+ * a centre further into the DEM.
+ */
+geoReference* scaleGeoReference(geoReference *origin, int factor)
+{
+    return createGeoReference(origin->ulx + (factor - 1) * origin->xdim / 2,
+        origin->uly - (factor - 1) * origin->ydim / 2, origin->xdim * factor, origin->ydim * factor);
+}
+
+
+/*
+ * Finds the window of cells, on the grid of the georeference, that a bounding
+ * box in degrees covers any part of. A box edge that falls on a cell edge does
+ * not take in the cell beyond it. The window may lie partly outside the DEM.
+ */
+void locateWindow(geoReference *reference, double west, double south, double east, double north,
+    int *row, int *column, int *width, int *height)
+{
+    // The outer edges of the top-left cell.
+    double left = reference->ulx - reference->xdim / 2;
+    double top = reference->uly + reference->ydim / 2;
+
+    int firstColumn = (int) floor((west - left) / reference->xdim + EDGE_TOLERANCE);
+    int endColumn = (int) ceil((east - left) / reference->xdim - EDGE_TOLERANCE);
+    int firstRow = (int) floor((top - north) / reference->ydim + EDGE_TOLERANCE);
+    int endRow = (int) ceil((top - south) / reference->ydim - EDGE_TOLERANCE);
+
+    *row = firstRow;
+    *column = firstColumn;
+    *width = endColumn > firstColumn ? endColumn - firstColumn : 1;
+    *height = endRow > firstRow ? endRow - firstRow : 1;
+}
+
+
+/*
+ * Finds the fractional row and column of a point in degrees on the grid of the
+ * georeference, where the centre of the top-left cell is at 0, 0.
+ */
+void locatePoint(geoReference *reference, double longitude, double latitude, double *row, double *column)
+{
+    *column = (longitude - reference->ulx) / reference->xdim;
+    *row = (reference->uly - latitude) / reference->ydim;
+}
+
+
+/*
+ * Finds the row and column of the origin's grid that the top-left cell of a
+ * placed DEM falls on. Returns 1 if the two grids have different cell sizes, so
+ * that one cannot be placed on the other, and 0 otherwise.
+ */
+int placeGeoReference(geoReference *origin, geoReference *placed, int *row, int *column)
+{
+    if (fabs(placed->xdim - origin->xdim) > origin->xdim * EDGE_TOLERANCE ||
+        fabs(placed->ydim - origin->ydim) > origin->ydim * EDGE_TOLERANCE)
+        return 1;
+
+    *column = (int) lround((placed->ulx - origin->ulx) / origin->xdim);
+    *row = (int) lround((origin->uly - placed->uly) / origin->ydim);
+    return 0;
+}
+
+
+/*
+ * Moves the top-left corner of the origin north and west as far as needed for
+ * the placed DEM to start within it.
+ */
+void extendGeoReference(geoReference *origin, geoReference *placed)
+{
+    if (placed->ulx < origin->ulx)
+        origin->ulx = placed->ulx;
+
+    if (placed->uly > origin->uly)
+        origin->uly = placed->uly;
+}
+
+
+/*
+ * Finds the origin of an assembled DEM from the tuples of its sub-DEMs, which
+ * are tupleSize arguments each of row, column and input file and so on. The
+ * origin is the north-west corner of every sub-DEM whose row and column are both
+ * auto, read from the .HDR file beside it. Returns NULL, without an error, if no
+ * sub-DEM is placed that way. Can return an error.
+ */
+geoReference* readPlacementOrigin(char **tuples, int tupleCount, int tupleSize)
+{
+    error = NULL;
+
+    geoReference *origin = NULL;
+    int tuple;
+
+    for (tuple = 0; tuple < tupleCount; tuple++)
+    {
+        char **arguments = tuples + tuple * tupleSize;
+
+        if (strcmp(arguments[0], "auto") != 0 || strcmp(arguments[1], "auto") != 0)
+            continue;
+
+        geoReference *placed = readGeoReference(arguments[2]);
+        if (error == NULL)
+            error = checkGeoReference(placed != NULL);
+
+        if (error != NULL)
+        {
+            freeGeoReference(origin);
+            return NULL;
+        }
+
+        if (origin == NULL)
+        {
+            origin = placed;
+            continue;
+        }
+
+        extendGeoReference(origin, placed);
+        freeGeoReference(placed);
+    }
+
+    return origin;
+}
+
+
+/*
+ * Reads where a sub-DEM is placed on a DEM of the given size. The row and column
+ * are either integers, or both auto to place the sub-DEM by the .HDR file beside
+ * it, relative to the origin from readPlacementOrigin(). Can return an error.
+ */
+void parsePlacement(geoReference *origin, char *rowArgument, char *columnArgument, char *filePath,
+    int width, int height, int *row, int *column)
+{
+    error = NULL;
+
+    if (strcmp(rowArgument, "auto") == 0 && strcmp(columnArgument, "auto") == 0)
+    {
+        geoReference *placed = readGeoReference(filePath);
+        if (error != NULL)
+            return;
+
+        error = checkGeoReference(origin != NULL && placed != NULL && placeGeoReference(origin, placed, row, column) == 0);
+        freeGeoReference(placed);
+        if (error != NULL)
+            return;
+
+        error = checkInvalidPosition(*row, height, '\0');
+        if (error != NULL)
+            return;
+
+        error = checkInvalidPosition(*column, width, '\0');
+        return;
+    }
+
+    // Read the row location to insert the DEM at.
+    char *end;
+    *row = strtol(rowArgument, &end, 10);
+
+    error = checkInvalidPosition(*row, height, *end);
+    if (error != NULL)
+        return;
+
+    // Read the column location to insert the DEM at.
+    *column = strtol(columnArgument, &end, 10);
+
+    error = checkInvalidPosition(*column, width, *end);
+}
+
+
+/*
+ * Writes the georeference of a raw DEM to a .HDR file beside it. Can return an
+ * error.
+ */
+void writeGeoReference(geoReference *reference, char *demPath, int width, int height)
+{
+    writeHeader(demPath, width, height, reference->ulx, reference->uly, reference->xdim, reference->ydim);
+}
+
+
+/*
+ * Finds which of the GTOPO30 source tiles a bounding box in degrees overlaps,
+ * so that only those files need to be opened. The indexes of the tiles are
+ * written to tiles, which must have room for SOURCE_TILE_COUNT, and their number
+ * is returned.
+ */
+int findSourceTiles(double west, double south, double east, double north, int *tiles)
+{
+    int count = 0;
+    int tile;
+
+    for (tile = 0; tile < SOURCE_TILE_COUNT; tile++)
+    {
+        sourceTile *source = &sourceTiles[tile];
+
+        if (source->west < east && source->west + source->width > west &&
+            source->north > south && source->north - source->height < north)
+        {
+            tiles[count] = tile;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+/*
+ * Returns the name of a GTOPO30 source tile, such as W140N90.
+ */
+char* getSourceTileName(int tile)
+{
+    return sourceTiles[tile].name;
+}
+
+
+/*
+ * Returns the path of a GTOPO30 source tile in the directory, such as
+ * directory/W140N90.DEM, which must be freed.
+ */
+static char* buildSourcePath(char *directory, int tile)
+{
+    char *path = (char *) malloc(strlen(directory) + strlen(sourceTiles[tile].name) + 6);
+    if (path != NULL)
+        sprintf(path, "%s/%s.DEM", directory, sourceTiles[tile].name);
+
+    return path;
+}
+
+
+/*
+ * Copies the part of a source tile that falls within the window, streaming only
+ * the spans of the rows that overlap it. The tile is placed on the globe by the
+ * .HDR file beside it. Can return an error.
+ */
+static void readSourceSpans(char *path, geoReference *globe, gtopoDEM *window, int windowRow, int windowColumn)
+{
+    // Check that the source tile exists before looking for its .HDR file.
+    FILE *file = fopen(path, "rb");
+    error = checkInvalidFileName(file, path);
+    if (error != NULL)
+        return;
+
+    fclose(file);
+
+    gtopoHeader *header = readHeader(path);
+    if (error != NULL)
+        return;
+
+    int sourceRow = 0;
+    int sourceColumn = 0;
+    geoReference *source = header == NULL ? NULL : createGeoReference(getHeaderULX(header), getHeaderULY(header),
+        getHeaderXDim(header), getHeaderYDim(header));
+
+    error = checkGeoReference(source != NULL && placeGeoReference(globe, source, &sourceRow, &sourceColumn) == 0);
+    freeGeoReference(source);
+    if (error != NULL)
+    {
+        freeHeader(header);
+        return;
+    }
+
+    int sourceWidth = getHeaderWidth(header);
+    int sourceHeight = getHeaderHeight(header);
+    freeHeader(header);
+
+    // Find the rows and columns, on the globe, that the tile and the window share.
+    int firstRow = windowRow > sourceRow ? windowRow : sourceRow;
+    int endRow = windowRow + getHeight(window) < sourceRow + sourceHeight ?
+        windowRow + getHeight(window) : sourceRow + sourceHeight;
+    int firstColumn = windowColumn > sourceColumn ? windowColumn : sourceColumn;
+    int endColumn = windowColumn + getWidth(window) < sourceColumn + sourceWidth ?
+        windowColumn + getWidth(window) : sourceColumn + sourceWidth;
+
+    if (firstRow >= endRow || firstColumn >= endColumn)
+        return;
+
+    gtopoRowReader *reader = openDEMRows(path, sourceWidth, sourceHeight);
+    if (error != NULL)
+        return;
+
+    signed short **raster = getRaster(window);
+    int row;
+
+    // Each row of the overlap is one read, straight into the window.
+    for (row = firstRow; row < endRow; row++)
+    {
+        int failed = readDEMSpan(reader, row - sourceRow, firstColumn - sourceColumn, endColumn - firstColumn,
+            raster[row - windowRow] + firstColumn - windowColumn);
+
+        error = checkRowData(failed, path);
+        if (error != NULL)
+            break;
+    }
+
+    closeDEMRows(reader);
+}
+
+
+/*
+ * Reads the points of the globe within a bounding box in degrees from a
+ * directory of GTOPO30 source tiles, opening only the tiles that the box
+ * overlaps. The window covers every cell the box touches, and its georeference
+ * is returned through windowReference. Returns NULL if the read failed.
+ */
+gtopoDEM* readSourceWindow(char *directory, double west, double south, double east, double north,
+    geoReference **windowReference)
+{
+    error = NULL;
+    *windowReference = NULL;
+
+    gtopoDEM *window = NULL;
+    geoReference *globe = createGlobalGeoReference();
+
+    error = checkAllocated(globe);
+    if (error != NULL)
+        goto cleanup;
+
+    int row;
+    int column;
+    int width;
+    int height;
+    locateWindow(globe, west, south, east, north, &row, &column, &width, &height);
+
+    // Keep the window on the globe, whatever the rounding at its edges.
+    row = row < 0 ? 0 : row;
+    column = column < 0 ? 0 : column;
+    width = column + width > MAX_COLUMNS ? MAX_COLUMNS - column : width;
+    height = row + height > MAX_ROWS ? MAX_ROWS - row : height;
+
+    // Points that no source tile covers are left with no data.
+    window = createDEM(width, height);
+    error = checkDEMallocated(window);
+    if (error != NULL)
+        goto cleanup;
+
+    *windowReference = offsetGeoReference(globe, row, column);
+    error = checkAllocated(*windowReference);
+    if (error != NULL)
+        goto cleanup;
+
+    int tiles[SOURCE_TILE_COUNT];
+    int tileCount = findSourceTiles(west, south, east, north, tiles);
+    int tile;
+
+    for (tile = 0; tile < tileCount; tile++)
+    {
+        char *path = buildSourcePath(directory, tiles[tile]);
+        error = checkAllocated(path);
+        if (error != NULL)
+            goto cleanup;
+
+        readSourceSpans(path, globe, window, row, column);
+        free(path);
+
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    goto cleanup;
+
+    cleanup:
+    freeGeoReference(globe);
+
+    if (error != NULL)
+    {
+        freeDEM(window);
+        freeGeoReference(*windowReference);
+        *windowReference = NULL;
+        return NULL;
+    }
+
+    return window;
+}
+
+
+void freeGeoReference(geoReference *reference)
+{
+    free(reference);
+}
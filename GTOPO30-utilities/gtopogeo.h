@@ -0,0 +1,23 @@
+#define SOURCE_TILE_COUNT 33
+
+typedef struct geoReference gtopoGeoReference;
+
+gtopoGeoReference* createGeoReference(double ulx, double uly, double xdim, double ydim);
+gtopoGeoReference* createGlobalGeoReference();
+gtopoGeoReference* readGeoReference(char *demPath);
+gtopoGeoReference* offsetGeoReference(gtopoGeoReference *origin, int row, int column);
+gtopoGeoReference* scaleGeoReference(gtopoGeoReference *origin, int factor);
+void locateWindow(gtopoGeoReference *reference, double west, double south, double east, double north,
+    int *row, int *column, int *width, int *height);
+void locatePoint(gtopoGeoReference *reference, double longitude, double latitude, double *row, double *column);
+int placeGeoReference(gtopoGeoReference *origin, gtopoGeoReference *placed, int *row, int *column);
+void extendGeoReference(gtopoGeoReference *origin, gtopoGeoReference *placed);
+gtopoGeoReference* readPlacementOrigin(char **tuples, int tupleCount, int tupleSize);
+void parsePlacement(gtopoGeoReference *origin, char *rowArgument, char *columnArgument, char *filePath,
+    int width, int height, int *row, int *column);
+void writeGeoReference(gtopoGeoReference *reference, char *demPath, int width, int height);
+int findSourceTiles(double west, double south, double east, double north, int *tiles);
+char* getSourceTileName(int tile);
+gtopoDEM* readSourceWindow(char *directory, double west, double south, double east, double north,
+    gtopoGeoReference **windowReference);
+void freeGeoReference(gtopoGeoReference *reference);
@@ -1,16 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include "gtopodata.h"
 #include "gtopoerror.h"
+#include "gtopogroup.h"
+#include "gtopopipeline.h"
+#include "gtopothreads.h"
 
-typedef struct point
+/*
+ * The DEM being tiled, its factor x factor tiles, and the size of all but the
+ * right-most and bottom-most of them.
+ */
+typedef struct tiling
 {
-    int widthCoord;
-    int heightCoord;
-} point;
+    gtopoDEM *inputDEM;
+    gtopoDEM ***tiles;
+    int factor;
+    int tileWidth;
+    int tileHeight;
+} tiling;
 
 
-static gtopoDEM*** createTiles(gtopoDEM *targetDEM, int factor)
+/*
+ * Allocates memory from an arena, or from the heap when there is no arena.
+ */
+static void* allocate(gtopoArena *arena, size_t size)
+{
+    if (arena != NULL)
+        return arenaAllocate(arena, size);
+
+    return malloc(size);
+}
+
+
+static gtopoDEM*** createTiles(gtopoDEM *targetDEM, int factor, gtopoArena *arena)
 {
     // Calculate the width of right-most tiles.
     int tileRightWidth = (getWidth(targetDEM) / factor) + (getWidth(targetDEM) % factor);
@@ -26,33 +50,33 @@ static gtopoDEM*** createTiles(gtopoDEM *targetDEM, int factor)
     int row;
     int column;
 
-    gtopoDEM ***tiles = (gtopoDEM ***) malloc(sizeof(gtopoDEM **) * factor);
+    gtopoDEM ***tiles = (gtopoDEM ***) allocate(arena, sizeof(gtopoDEM **) * factor);
 
     for (row = 0; row < factor; row++)
     {
-        tiles[row] = (gtopoDEM **) malloc(sizeof(gtopoDEM *) * factor);
+        tiles[row] = (gtopoDEM **) allocate(arena, sizeof(gtopoDEM *) * factor);
     }
     
-    // Initialise the tiles and set their dimensions.
+    // Initialise the tiles and set their dimensions. tile() overwrites every point, so they are not filled.
     for (row = 0; row < factor; row++)
     {
         for (column = 0; column < factor; column++)
         {
             if (row < factor - 1 && column < factor - 1)
             {
-                tiles[row][column] = createDEM(tileWidth, tileHeight);
+                tiles[row][column] = createUnfilledDEM(arena, tileWidth, tileHeight);
             }
             else if (row < factor - 1 && column == factor - 1)
             {
-                tiles[row][column] = createDEM(tileRightWidth, tileHeight);
+                tiles[row][column] = createUnfilledDEM(arena, tileRightWidth, tileHeight);
             }
             else if (row == factor - 1 && column < factor - 1)
             {
-                tiles[row][column] = createDEM(tileWidth, tileBottomHeight);   
+                tiles[row][column] = createUnfilledDEM(arena, tileWidth, tileBottomHeight);   
             }
             else if (row == factor - 1 && column == factor - 1)
             {
-                tiles[row][column] = createDEM(tileRightWidth, tileBottomHeight);
+                tiles[row][column] = createUnfilledDEM(arena, tileRightWidth, tileBottomHeight);
             }
         }
     }
@@ -61,131 +85,498 @@ static gtopoDEM*** createTiles(gtopoDEM *targetDEM, int factor)
 }
 
 
-static point** calculateReadPoints(gtopoDEM *targetDEM, gtopoDEM ***tiles, int factor)
+/*
+ * Copies each row of a band of the DEM to the tiles it is split between. Run by
+ * parallelRows() for each band.
+ */
+static void tileRows(int firstRow, int rows, void *tilingPointer)
 {
-    // Allocate memory to the coordinates where each tile begins.
-    point **points = (point **) malloc(sizeof(point *) * factor);
+    tiling *job = (tiling *) tilingPointer;
+    signed short **input = getRaster(job->inputDEM);
 
     int row;
     int column;
 
-    for (row = 0; row < factor; row++)
+    for (row = firstRow; row < firstRow + rows; row++)
     {
-        points[row] = (point *) malloc(sizeof(point) * factor);
-    }
+        // The bottom tiles also take the rows left over by the factor.
+        int tileRow = job->tileHeight > 0 ? row / job->tileHeight : job->factor - 1;
+        tileRow = tileRow < job->factor ? tileRow : job->factor - 1;
 
-    int currentWidth = 0;
-    int currentHeight = 0;
-
-    for (row = 0; row < factor; row++)
-    {
-        for (column = 0; column < factor; column++)
-        {   
-            points[row][column].widthCoord = currentWidth;
-            points[row][column].heightCoord = currentHeight;
+        for (column = 0; column < job->factor; column++)
+        {
+            gtopoDEM *targetTile = job->tiles[tileRow][column];
 
-            currentWidth = currentWidth + getWidth(tiles[row][column]);
+            memcpy(getRaster(targetTile)[row - tileRow * job->tileHeight], input[row] + column * job->tileWidth,
+                sizeof(signed short) * getWidth(targetTile));
         }
-
-        currentWidth = 0;
-        currentHeight = currentHeight + getHeight(tiles[row][0]);
     }
-
-    return points;
 }
 
 
-gtopoDEM*** tile(gtopoDEM *inputDEM, int factor)
+/*
+ * Splits the input DEM into factor x factor tiles. If an arena is given, the
+ * tiles and their arrays are allocated from it and are released with the arena,
+ * which saves allocating and freeing each tile at large factors. Otherwise they
+ * are freed with freeTiles().
+ */
+gtopoDEM*** tile(gtopoDEM *inputDEM, int factor, gtopoArena *arena)
 {
     /* 
      * We need to split the input image into (factor * factor) smaller images. We
      * need an array of (factor * factor) image structs.
      */
-    gtopoDEM ***DEMTiles = createTiles(inputDEM, factor);
+    gtopoDEM ***DEMTiles = createTiles(inputDEM, factor, arena);
+
+    tiling job;
+    job.inputDEM = inputDEM;
+    job.tiles = DEMTiles;
+    job.factor = factor;
+    job.tileWidth = getWidth(inputDEM) / factor;
+    job.tileHeight = getHeight(inputDEM) / factor;
+
+    // Bands of rows of the DEM are copied to their tiles in parallel.
+    parallelRows(getHeight(inputDEM), getWidth(inputDEM), tileRows, &job);
+
+    return DEMTiles;
+}
+
+
+/*
+ * A sub-DEM being added to a larger DEM, where it is placed, and how many of its
+ * points fit inside the larger DEM across each row.
+ */
+typedef struct addition
+{
+    gtopoDEM *parent;
+    gtopoDEM *child;
+    int startRow;
+    int startColumn;
+    int columns;
+} addition;
+
+
+/*
+ * Copies a band of rows of the child DEM into the parent. Run by parallelRows()
+ * for each band.
+ */
+static void addRows(int firstRow, int rows, void *additionPointer)
+{
+    addition *job = (addition *) additionPointer;
+    signed short **parent = getRaster(job->parent);
+    signed short **child = getRaster(job->child);
+
+    int row;
+    for (row = firstRow; row < firstRow + rows; row++)
+    {
+        memcpy(parent[job->startRow + row] + job->startColumn, child[row], sizeof(signed short) * job->columns);
+    }
+}
+
+
+/*
+ * Adds the child DEM to the parent DEM with the top-left corner of the DEM
+ * placed at the specified row and column values. Returns 0 on success and 1 on
+ * failure if elevation points of a sub-DEM are placed outside of the larger DEM,
+ * in which case only the points inside it are added. Bands of rows are copied
+ * in parallel.
+ */
+int addDEM(gtopoDEM *parent, gtopoDEM *child, int startRow, int startColumn)
+{
+    addition job;
+    job.parent = parent;
+    job.child = child;
+    job.startRow = startRow;
+    job.startColumn = startColumn;
+
+    // Clip the sub-DEM to the part of it inside the larger DEM.
+    int rows = getHeight(parent) - startRow < getHeight(child) ? getHeight(parent) - startRow : getHeight(child);
+    job.columns = getWidth(parent) - startColumn < getWidth(child) ? getWidth(parent) - startColumn : getWidth(child);
 
-    // Calculate the coordinates where each tile begins (top-left corner).
-    point **readPoints = calculateReadPoints(inputDEM, DEMTiles, factor);
+    if (startRow < 0 || startColumn < 0)
+        return 1;
+
+    if (rows > 0 && job.columns > 0)
+        parallelRows(rows, job.columns, addRows, &job);
+
+    // Check that all pixels of the child/sub-image were written.
+    return rows != getHeight(child) || job.columns != getWidth(child);
+}
+
+
+/*
+ * Records which points of a DEM being assembled have been written, one bit per
+ * point in rows of 64-bit words, so that only the gaps between the sub-DEMs need
+ * to be filled with no data.
+ */
+typedef struct coverage
+{
+    int width;
+    int height;
+    int wordsPerRow;
+    uint64_t *bits;
+} coverage;
+
+
+/*
+ * Creates an empty coverage bitmap for a DEM of the given dimensions. Returns
+ * NULL if memory allocation fails.
+ */
+coverage* createCoverage(int width, int height)
+{
+    coverage *newCoverage = (coverage *) malloc(sizeof(coverage));
+
+    if (newCoverage == NULL)
+        return NULL;
+
+    newCoverage->width = width;
+    newCoverage->height = height;
+    newCoverage->wordsPerRow = (width + 63) / 64;
+    newCoverage->bits = (uint64_t *) calloc((size_t) newCoverage->wordsPerRow * height, sizeof(uint64_t));
+
+    if (newCoverage->bits == NULL)
+    {
+        free(newCoverage);
+        return NULL;
+    }
 
+    return newCoverage;
+}
+
+
+/*
+ * Marks a region as written, given the row and column of its top-left corner and
+ * its dimensions. Any part outside of the DEM is ignored, as in addDEM().
+ */
+void coverRegion(coverage *targetCoverage, int row, int column, int width, int height)
+{
+    int lastRow = row + height < targetCoverage->height ? row + height : targetCoverage->height;
+    int lastColumn = column + width < targetCoverage->width ? column + width : targetCoverage->width;
+
+    if (column >= lastColumn)
+        return;
+
+    int firstWord = column / 64;
+    int lastWord = (lastColumn - 1) / 64;
+    uint64_t firstMask = ~(uint64_t) 0 << (column % 64);
+    uint64_t lastMask = ~(uint64_t) 0 >> (63 - (lastColumn - 1) % 64);
+
+    int x;
+    int word;
+
+    for (x = row; x < lastRow; x++)
+    {
+        uint64_t *bits = targetCoverage->bits + (size_t) x * targetCoverage->wordsPerRow;
+
+        if (firstWord == lastWord)
+        {
+            bits[firstWord] |= firstMask & lastMask;
+            continue;
+        }
+
+        bits[firstWord] |= firstMask;
+
+        for (word = firstWord + 1; word < lastWord; word++)
+        {
+            bits[word] = ~(uint64_t) 0;
+        }
+
+        bits[lastWord] |= lastMask;
+    }
+}
+
+
+/*
+ * Sets every point of the DEM that was not covered to the value, a run of
+ * consecutive points at a time. Whole words of covered points are skipped.
+ */
+void fillUncovered(gtopoDEM *targetDEM, coverage *targetCoverage, signed short value)
+{
     int row;
     int column;
-    int subRow;
-    int subColumn;
 
-    // Loop over tiles by row and column.
-    for (row = 0; row < factor; row++)
+    for (row = 0; row < targetCoverage->height; row++)
     {
-        for (column = 0; column < factor; column++)
+        uint64_t *bits = targetCoverage->bits + (size_t) row * targetCoverage->wordsPerRow;
+        int runStart = -1;
+
+        for (column = 0; column < targetCoverage->width; column++)
         {
-            // Loop over pixels within tiles by row and column.
-            for (subRow = 0; subRow < getHeight(DEMTiles[row][column]); subRow++)
+            uint64_t word = bits[column / 64];
+
+            // Skip whole words that are entirely covered outside of a run, or entirely uncovered within one.
+            if (column % 64 == 0 && ((runStart < 0 && word == ~(uint64_t) 0) || (runStart >= 0 && word == 0)))
+            {
+                column += 63;
+                continue;
+            }
+
+            int covered = (word >> (column % 64)) & 1;
+
+            if (!covered && runStart < 0)
             {
-                for (subColumn = 0; subColumn < getWidth(DEMTiles[row][column]); subColumn++)
-                {
-                    // Assign current pixel to corresponding tile.
-                    setElevation(DEMTiles[row][column], 
-                        getElevation(inputDEM, readPoints[row][column].heightCoord + subRow,
-                            readPoints[row][column].widthCoord + subColumn),
-                        subRow, subColumn);
-                }
+                runStart = column;
+            }
+            else if (covered && runStart >= 0)
+            {
+                fillElevations(targetDEM, value, row, runStart, column - runStart, 1);
+                runStart = -1;
             }
         }
+
+        if (runStart >= 0)
+            fillElevations(targetDEM, value, row, runStart, targetCoverage->width - runStart, 1);
     }
+}
 
-    // Free memory allocated to read points.
-    for (row = 0; row < factor; row++)
+
+/*
+ * Frees a coverage bitmap.
+ */
+void freeCoverage(coverage *targetCoverage)
+{
+    if (targetCoverage != NULL)
     {
-        free(readPoints[row]);
+        free(targetCoverage->bits);
+        free(targetCoverage);
     }
-    free(readPoints);
-
-    return DEMTiles;
 }
 
 
 /*
- * Adds the child DEM to the parent DEM with the top-left corner of the DEM
- * placed at the specified row and column values. Returns 0 on success and 1 on
- * failure if elevation points of a sub-DEM are placed outside of the larger DEM.
+ * Frees the factor x factor tiles made by tile(), along with the tile arrays.
  */
-int addDEM(gtopoDEM *parent, gtopoDEM *child, int startRow, int startColumn)
+void freeTiles(gtopoDEM ***tiles, int factor)
 {
-    int parentRow;
-    int parentColumn;
-    int childRow = 0;
-    int childColumn = 0;
-    int pointsWritten = 0;
+    int row;
+    int column;
 
-    for (parentRow = startRow; parentRow < getHeight(parent); parentRow++)
+    for (row = 0; row < factor; row++)
     {
-        if (startRow + childRow > getHeight(parent) || childRow == getHeight(child))
+        for (column = 0; column < factor; column++)
         {
-            break;
+            freeDEM(tiles[row][column]);
         }
+        free(tiles[row]);
+    }
+    free(tiles);
+}
 
-        for (parentColumn = startColumn; parentColumn < getWidth(parent); parentColumn++)
-        {
-            if (startColumn + childColumn > getWidth(parent) || childColumn == getWidth(child))
-            {
-                break;
-            }
 
-            setElevation(parent, getElevation(child, childRow, childColumn), parentRow, parentColumn);
-            childColumn++;
-            pointsWritten++;
-        }
+/*
+ * Builds the path of the tile at rowNumber and columnNumber by replacing the
+ * <row> and <column> tags of the format. The caller frees the path.
+ */
+char* buildPath(char *format, int rowNumber, int columnNumber)
+{
+    // Counter variable.
+    int x;
+
+    // Copy the output file path format so that we can manipulate it.
+    char *template = (char *) malloc(sizeof(char) * strlen(format) + 1);
+    strcpy(template, format);
+
+    // Convert the row number to a decimal representation
+    char row[10];
+    sprintf(row, "%d", rowNumber);
+
+    // Convert the column number to a decimal representation.
+    char column[10];
+    sprintf(column, "%d", columnNumber);
 
-        childRow++;
-        childColumn = 0;
+    // Get starting address of <row> and <column>
+    char *rowTagStart = strstr(template, ROW_TAG);
+    char *columnTagStart = strstr(template, COL_TAG);
+
+    // Set the memory of <row> to -1 to identify it for replacement.
+    for (x = 0; x < strlen(ROW_TAG); x++)
+    {
+        rowTagStart[x] = '\377';
     }
 
-    // Check that all pixels of the child/sub-image were written.
-    if (pointsWritten != getWidth(child) * getHeight(child))
+    // Set the memory of <column> in the template to -2 to identify it for replacement.
+    for (x = 0; x < strlen(COL_TAG); x++)
     {
-        return 1;
+        columnTagStart[x] = '\376';
+    }
+
+    /*
+     * Allocate memory to the path string to return, zeroed by calloc to avoid corrupted
+     * file names that are difficult to delete.
+     */
+    int pathLength = strlen(template) + strlen(row) + strlen(column) - (strlen(ROW_TAG) - strlen(COL_TAG));
+    char *path = (char *) calloc(pathLength, sizeof(char));
+
+    int rowWritten = 0;
+    int columnWritten = 0;
+    for (x = 0; x < strlen(template); x++)
+    {
+        char currentChar[2] = {template[x], '\0'};
+        if (template[x] != '\377' && template[x] != '\376')
+        {
+            // The current character isn't part of a tag. Append the character.
+            strcat(path, currentChar);
+        }
+        else if (template[x] == '\377' && rowWritten == 0)
+        {
+            // Current character is -1, flagging position of <row> tag. Append row number.
+            strcat(path, row);
+            rowWritten = 1;
+        }
+        else if (template[x] == '\376' && columnWritten == 0)
+        {
+            // Current character is -2, flagging position of <column> tag. Append column number.
+            strcat(path, column);
+            columnWritten = 1;
+        }
+    }
+
+    free(template);
+    return path;
+}
+
+
+/*
+ * The open files of one row of tiles being written by tileFile(), whether each
+ * could not be written, and the size of the tiles.
+ */
+typedef struct tileJob
+{
+    int *outputFiles;
+    int *writeFailed;
+    int factor;
+    int firstRow;
+    int tileWidth;
+    int tileRightWidth;
+    int width;
+} tileJob;
+
+
+/*
+ * Splits each row of a chunk between the tiles of the current row of tiles, and
+ * writes each part in place in its tile. A tile that could not be written is
+ * marked in writeFailed, and the chunks after it are skipped.
+ */
+static int tileChunk(int firstRow, int rows, signed short *elevations, void *jobPointer)
+{
+    tileJob *job = (tileJob *) jobPointer;
+
+    int writeFailed = 0;
+    int row;
+    int column;
+
+    for (column = 0; column < job->factor; column++)
+        writeFailed |= __atomic_load_n(&job->writeFailed[column], __ATOMIC_RELAXED);
+
+    for (row = 0; row < rows && writeFailed == 0; row++)
+    {
+        signed short *inputRow = elevations + (long) row * job->width;
+        long tileRow = firstRow + row - job->firstRow;
+
+        for (column = 0; column < job->factor && writeFailed == 0; column++)
+        {
+            int width = column == job->factor - 1 ? job->tileRightWidth : job->tileWidth;
+            writeFailed = writeDEMSpan(job->outputFiles[column], tileRow * width, inputRow + column * job->tileWidth, width);
+
+            if (writeFailed)
+                __atomic_store_n(&job->writeFailed[column], 1, __ATOMIC_RELAXED);
+        }
     }
-    else
+
+    return 0;
+}
+
+
+/*
+ * Splits the raw DEM at inputPath into factor x factor tiles, as tile() does, and
+ * writes each to the path made from the template by buildPath(), without holding
+ * the DEM in memory. Each row of tiles is written by streaming its rows of the
+ * DEM through the pipeline, with the files of that row of tiles open. The DEM
+ * must be one canStreamDEM() accepts, and the factor at most MAX_STREAMED_TILES,
+ * as a file is held open for each tile of a row.
+ * Can return an error.
+ */
+void tileFile(char *inputPath, int width, int height, int factor, char *outputTemplate)
+{
+    error = NULL;
+
+    FILE **outputFiles = (FILE **) calloc(factor, sizeof(FILE *));
+    int *descriptors = (int *) malloc(sizeof(int) * factor);
+    int *writeFailed = (int *) calloc(factor, sizeof(int));
+    gtopoRowReader *reader = NULL;
+
+    error = checkAllocated(outputFiles);
+    if (error == NULL)
+        error = checkAllocated(descriptors);
+    if (error == NULL)
+        error = checkAllocated(writeFailed);
+
+    if (error != NULL)
+        goto cleanup;
+
+    reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    // Tiles on the right and bottom also take the points left over by the factor.
+    tileJob job;
+    job.outputFiles = descriptors;
+    job.writeFailed = writeFailed;
+    job.factor = factor;
+    job.width = width;
+    job.tileWidth = width / factor;
+    job.tileRightWidth = width / factor + width % factor;
+
+    int tileHeight = height / factor;
+    int chunkRows = getChunkRows(width);
+    int row;
+    int column;
+
+    for (row = 0; row < factor && error == NULL; row++)
     {
-        return 0;
+        for (column = 0; column < factor && error == NULL; column++)
+        {
+            char *path = buildPath(outputTemplate, row, column);
+            outputFiles[column] = fopen(path, "wb");
+            writeFailed[column] = 0;
+
+            // Check that the file path exists.
+            error = checkInvalidFileName(outputFiles[column], path);
+            free(path);
+
+            if (error == NULL)
+                descriptors[column] = fileno(outputFiles[column]);
+        }
+
+        job.firstRow = row * tileHeight;
+        int endRow = row == factor - 1 ? height : job.firstRow + tileHeight;
+
+        if (error == NULL)
+            error = checkRowData(streamDEMRows(reader, width, job.firstRow, endRow, chunkRows, tileChunk, &job),
+                inputPath);
+
+        for (column = 0; column < factor; column++)
+        {
+            if (outputFiles[column] != NULL)
+                writeFailed[column] |= fclose(outputFiles[column]) != 0;
+
+            outputFiles[column] = NULL;
+
+            // Check that the tile was written, naming it as it was opened.
+            if (error == NULL && writeFailed[column])
+            {
+                char *path = buildPath(outputTemplate, row, column);
+                error = checkOutputWritten(1, path);
+                free(path);
+            }
+        }
     }
 
+    goto cleanup;
+
+    cleanup:
+    closeDEMRows(reader);
+    free(outputFiles);
+    free(descriptors);
+    free(writeFailed);
 }
@@ -1,4 +1,19 @@
 #include "gtopoio.h"
 
-gtopoDEM*** tile(gtopoDEM *inputDEM, int factor);
+#define ROW_TAG "<row>"
+#define COL_TAG "<column>"
+
+// Tile columns whose files tileFile() holds open at once.
+#define MAX_STREAMED_TILES 256
+
+typedef struct coverage gtopoCoverage;
+
+gtopoDEM*** tile(gtopoDEM *inputDEM, int factor, gtopoArena *arena);
+void tileFile(char *inputPath, int width, int height, int factor, char *outputTemplate);
 int addDEM(gtopoDEM *parent, gtopoDEM *child, int startRow, int startColumn);
+void freeTiles(gtopoDEM ***tiles, int factor);
+gtopoCoverage* createCoverage(int width, int height);
+void coverRegion(gtopoCoverage *targetCoverage, int row, int column, int width, int height);
+void fillUncovered(gtopoDEM *targetDEM, gtopoCoverage *targetCoverage, signed short value);
+void freeCoverage(gtopoCoverage *targetCoverage);
+char* buildPath(char *format, int rowNumber, int columnNumber);
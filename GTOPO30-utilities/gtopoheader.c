@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "gtopoio.h"
+#include "gtopoheader.h"
+
+// Longest line of a .HDR file that is read. Real ones are under 40 characters.
+#define MAX_HEADER_LINE 256
+
+
+/*
+ * The contents of the .HDR file that the USGS ships beside each GTOPO30 .DEM
+ * tile. It is plain text, one "KEYWORD value" pair per line:
+ *
+ * NROWS and NCOLS: The height and width of the raster. Both are required.
+ *
+ * BYTEORDER: M (Motorola) for big-endian elevations, which is what every GTOPO30
+ * tile uses, or I (Intel) for little-endian.
+ *
+ * NODATA: The value of points without an elevation, -9999 for GTOPO30.
+ *
+ * ULXMAP and ULYMAP: The longitude and latitude of the centre of the top-left
+ * cell in degrees. XDIM and YDIM: The size of a cell in degrees.
+ *
+ * Keywords that are left out take their GTOPO30 values. Others that describe the
+ * layout (NBITS, NBANDS, LAYOUT, BANDROWBYTES, TOTALROWBYTES and BANDGAPBYTES)
+ * are checked to describe a single band of 16-bit points with no padding, which
+ * is the only layout that can be read.
+ */
+typedef struct header
+{
+    int width;
+    int height;
+    int bigEndian;
+    signed short noData;
+    double ulx;
+    double uly;
+    double xdim;
+    double ydim;
+} header;
+
+
+/*
+ * Returns the path of the .HDR file beside a DEM, which has the same name with
+ * the extension replaced, in the given case. The path must be freed.
+ */
+static char* buildHeaderPath(char *demPath, char *extension)
+{
+    char *slash = strrchr(demPath, '/');
+    char *dot = strrchr(demPath, '.');
+    size_t stem = dot != NULL && (slash == NULL || dot > slash) ? (size_t) (dot - demPath) : strlen(demPath);
+
+    char *path = (char *) malloc(stem + strlen(extension) + 1);
+    if (path == NULL)
+        return NULL;
+
+    memcpy(path, demPath, stem);
+    strcpy(path + stem, extension);
+    return path;
+}
+
+
+/*
+ * Opens the .HDR file beside a DEM, trying an upper case extension and then a
+ * lower case one. Returns NULL if there is neither, with the path of the last
+ * tried in headerPath, which must be freed.
+ */
+static FILE* openHeader(char *demPath, char **headerPath)
+{
+    *headerPath = buildHeaderPath(demPath, ".HDR");
+    if (*headerPath == NULL)
+        return NULL;
+
+    FILE *file = fopen(*headerPath, "r");
+    if (file != NULL)
+        return file;
+
+    free(*headerPath);
+    *headerPath = buildHeaderPath(demPath, ".hdr");
+    if (*headerPath == NULL)
+        return NULL;
+
+    return fopen(*headerPath, "r");
+}
+
+
+/*
+ * Reads the keywords of a .HDR file into the header. Returns 1 if the file is
+ * malformed, or describes a layout that cannot be read, and 0 otherwise.
+ */
+static int parseHeader(header *targetHeader, FILE *file)
+{
+    char line[MAX_HEADER_LINE];
+    char key[MAX_HEADER_LINE];
+    char value[MAX_HEADER_LINE];
+    long rows = -1;
+    long columns = -1;
+    long rowBytes[2] = {-1, -1};
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        int scanned = sscanf(line, "%255s %255s", key, value);
+
+        // Skip blank lines.
+        if (scanned <= 0)
+            continue;
+
+        if (scanned != 2)
+            return 1;
+
+        char *end;
+        long number = strtol(value, &end, 10);
+        int integer = *end == '\0';
+        double real = strtod(value, &end);
+        int isReal = *end == '\0';
+
+        if (strcasecmp(key, "NROWS") == 0 && integer)
+            rows = number;
+        else if (strcasecmp(key, "NCOLS") == 0 && integer)
+            columns = number;
+        else if (strcasecmp(key, "BYTEORDER") == 0 && (strcasecmp(value, "M") == 0 || strcasecmp(value, "I") == 0))
+            targetHeader->bigEndian = strcasecmp(value, "M") == 0;
+        else if (strcasecmp(key, "NODATA") == 0 && integer && number >= -32768 && number <= 32767)
+            targetHeader->noData = (signed short) number;
+        else if (strcasecmp(key, "ULXMAP") == 0 && isReal)
+            targetHeader->ulx = real;
+        else if (strcasecmp(key, "ULYMAP") == 0 && isReal)
+            targetHeader->uly = real;
+        else if (strcasecmp(key, "XDIM") == 0 && isReal && real > 0)
+            targetHeader->xdim = real;
+        else if (strcasecmp(key, "YDIM") == 0 && isReal && real > 0)
+            targetHeader->ydim = real;
+        else if ((strcasecmp(key, "NBITS") == 0 && (!integer || number != 16)) ||
+            (strcasecmp(key, "NBANDS") == 0 && (!integer || number != 1)) ||
+            (strcasecmp(key, "LAYOUT") == 0 && strcasecmp(value, "BIL") != 0) ||
+            (strcasecmp(key, "BANDGAPBYTES") == 0 && (!integer || number != 0)))
+            return 1;
+        else if ((strcasecmp(key, "BANDROWBYTES") == 0 || strcasecmp(key, "TOTALROWBYTES") == 0) && integer)
+            rowBytes[strcasecmp(key, "BANDROWBYTES") == 0 ? 0 : 1] = number;
+        else if (strcasecmp(key, "NROWS") == 0 || strcasecmp(key, "NCOLS") == 0 ||
+            strcasecmp(key, "BYTEORDER") == 0 || strcasecmp(key, "NODATA") == 0 ||
+            strcasecmp(key, "ULXMAP") == 0 || strcasecmp(key, "ULYMAP") == 0 ||
+            strcasecmp(key, "XDIM") == 0 || strcasecmp(key, "YDIM") == 0 ||
+            strcasecmp(key, "BANDROWBYTES") == 0 || strcasecmp(key, "TOTALROWBYTES") == 0)
+            return 1;
+    }
+
+    if (rows < MIN_DIMENSION || rows > MAX_ROWS || columns < MIN_DIMENSION || columns > MAX_COLUMNS)
+        return 1;
+
+    // Rows must be packed with no padding between them.
+    if ((rowBytes[0] >= 0 && rowBytes[0] != columns * 2) || (rowBytes[1] >= 0 && rowBytes[1] != columns * 2))
+        return 1;
+
+    targetHeader->width = (int) columns;
+    targetHeader->height = (int) rows;
+    return 0;
+}
+
+
+/*
+ * Reads the .HDR file beside a DEM, such as W140N90.HDR for W140N90.DEM. Returns
+ * NULL without an error if there is no such file, as derived DEMs have none.
+ * Returns NULL with an error if it is malformed. Can return an error.
+ */
+header* readHeader(char *demPath)
+{
+    error = NULL;
+
+    char *headerPath = NULL;
+    header *newHeader = NULL;
+    FILE *file = openHeader(demPath, &headerPath);
+
+    if (file == NULL)
+        goto cleanup;
+
+    newHeader = (header *) malloc(sizeof(header));
+    error = checkAllocated(newHeader);
+    if (error != NULL)
+        goto cleanup;
+
+    newHeader->bigEndian = 1;
+    newHeader->noData = NO_DATA;
+    newHeader->ulx = GTOPO30_ULX;
+    newHeader->uly = GTOPO30_ULY;
+    newHeader->xdim = GTOPO30_CELL_DEGREES;
+    newHeader->ydim = GTOPO30_CELL_DEGREES;
+
+    error = checkHeaderData(parseHeader(newHeader, file), headerPath);
+    if (error != NULL)
+        goto cleanup;
+
+    goto cleanup;
+
+    cleanup:
+    if (file != NULL)
+        fclose(file);
+
+    free(headerPath);
+
+    if (error != NULL)
+    {
+        free(newHeader);
+        return NULL;
+    }
+
+    return newHeader;
+}
+
+
+int getHeaderWidth(header *targetHeader)
+{
+    return targetHeader->width;
+}
+
+
+int getHeaderHeight(header *targetHeader)
+{
+    return targetHeader->height;
+}
+
+
+/*
+ * Returns 1 if the elevations are big-endian (BYTEORDER M) and 0 otherwise.
+ */
+int isHeaderBigEndian(header *targetHeader)
+{
+    return targetHeader->bigEndian;
+}
+
+
+signed short getHeaderNoData(header *targetHeader)
+{
+    return targetHeader->noData;
+}
+
+
+double getHeaderULX(header *targetHeader)
+{
+    return targetHeader->ulx;
+}
+
+
+double getHeaderULY(header *targetHeader)
+{
+    return targetHeader->uly;
+}
+
+
+double getHeaderXDim(header *targetHeader)
+{
+    return targetHeader->xdim;
+}
+
+
+double getHeaderYDim(header *targetHeader)
+{
+    return targetHeader->ydim;
+}
+
+
+/*
+ * Writes a .HDR file beside a raw DEM, in the layout the USGS uses for GTOPO30
+ * tiles, so that it keeps its dimensions and georeferencing. Can return an error,
+ * including when the file could not be written.
+ */
+void writeHeader(char *demPath, int width, int height, double ulx, double uly, double xdim, double ydim)
+{
+    error = NULL;
+
+    char *headerPath = buildHeaderPath(demPath, ".HDR");
+    error = checkAllocated(headerPath);
+    if (error != NULL)
+        return;
+
+    FILE *file = fopen(headerPath, "w");
+
+    // Check that the file could be created.
+    error = checkInvalidFileName(file, headerPath);
+    if (error != NULL)
+    {
+        free(headerPath);
+        return;
+    }
+
+    fprintf(file, "BYTEORDER      M\n");
+    fprintf(file, "LAYOUT         BIL\n");
+    fprintf(file, "NROWS          %d\n", height);
+    fprintf(file, "NCOLS          %d\n", width);
+    fprintf(file, "NBANDS         1\n");
+    fprintf(file, "NBITS          16\n");
+    fprintf(file, "BANDROWBYTES   %d\n", width * 2);
+    fprintf(file, "TOTALROWBYTES  %d\n", width * 2);
+    fprintf(file, "BANDGAPBYTES   0\n");
+    fprintf(file, "NODATA         %d\n", NO_DATA);
+    fprintf(file, "ULXMAP         %.15g\n", ulx);
+    fprintf(file, "ULYMAP         %.15g\n", uly);
+    fprintf(file, "XDIM           %.15g\n", xdim);
+    fprintf(file, "YDIM           %.15g\n", ydim);
+
+    // Check that every line was written and reached the disk.
+    int failed = ferror(file);
+    failed |= fclose(file) != 0;
+    error = checkOutputWritten(failed, headerPath);
+    free(headerPath);
+}
+
+
+void freeHeader(header *targetHeader)
+{
+    free(targetHeader);
+}
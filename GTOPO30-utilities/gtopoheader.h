@@ -0,0 +1,13 @@
+typedef struct header gtopoHeader;
+
+gtopoHeader* readHeader(char *demPath);
+int getHeaderWidth(gtopoHeader *targetHeader);
+int getHeaderHeight(gtopoHeader *targetHeader);
+int isHeaderBigEndian(gtopoHeader *targetHeader);
+signed short getHeaderNoData(gtopoHeader *targetHeader);
+double getHeaderULX(gtopoHeader *targetHeader);
+double getHeaderULY(gtopoHeader *targetHeader);
+double getHeaderXDim(gtopoHeader *targetHeader);
+double getHeaderYDim(gtopoHeader *targetHeader);
+void writeHeader(char *demPath, int width, int height, double ulx, double uly, double xdim, double ydim);
+void freeHeader(gtopoHeader *targetHeader);
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "gtopohistogram.h"
+#include "gtopothreads.h"
+
+// Number of rows counted by each task.
+#define ROWS_PER_BAND 64
+
+
+/*
+ * Shared state for counting a mapped DEM in row bands, or a DEM read whole when it
+ * cannot be mapped. Each band counts into its own histogram, then adds it to the
+ * totals under the lock.
+ */
+typedef struct histogramJob
+{
+    unsigned char *samples;
+    gtopoDEM *dem;
+    int width;
+    int height;
+    gtopoStats *stats;
+    int invalid;
+    pthread_mutex_t lock;
+} histogramJob;
+
+
+/*
+ * Counts the elevations of one band. Run by parallelFor() for each band index.
+ */
+static void countBand(int band, void *jobPointer)
+{
+    histogramJob *job = (histogramJob *) jobPointer;
+    int64_t *histogram = (int64_t *) calloc(HISTOGRAM_BINS, sizeof(int64_t));
+
+    int firstRow = band * ROWS_PER_BAND;
+    int rows = firstRow + ROWS_PER_BAND < job->height ? ROWS_PER_BAND : job->height - firstRow;
+    size_t points = (size_t) rows * job->width;
+    unsigned char *bytes = job->samples != NULL ? job->samples + (size_t) firstRow * job->width * sizeof(signed short) : NULL;
+    signed short *elevations = job->dem != NULL ? getRaster(job->dem)[firstRow] : NULL;
+
+    int64_t noData = 0;
+    int invalid = histogram == NULL;
+
+    size_t x;
+    for (x = 0; x < points && histogram != NULL; x++)
+    {
+        // Mapped samples are big-endian, while a DEM read whole is already converted.
+        signed short elevation = elevations != NULL ? elevations[x] : (signed short) ((bytes[2 * x] << 8) | bytes[2 * x + 1]);
+
+        // Anything else outside the bins is an invalid elevation.
+        unsigned int bin = (unsigned int) (elevation - MIN_ELEVATION_VALUE);
+
+        if (elevation == NO_DATA)
+            noData++;
+        else if (bin < HISTOGRAM_BINS)
+            histogram[bin]++;
+        else
+            invalid = 1;
+    }
+
+    pthread_mutex_lock(&job->lock);
+
+    job->invalid |= invalid;
+    job->stats->noData += noData;
+
+    int bin;
+    for (bin = 0; bin < HISTOGRAM_BINS && histogram != NULL; bin++)
+        job->stats->histogram[bin] += histogram[bin];
+
+    pthread_mutex_unlock(&job->lock);
+
+    free(histogram);
+}
+
+
+/*
+ * Derives the minimum, maximum, mean and standard deviation from the histogram.
+ * Summing over the bins is exact for the counts and needs only a few thousand
+ * steps however large the DEM is.
+ */
+static void summarizeHistogram(gtopoStats *stats)
+{
+    stats->minimum = NO_DATA;
+    stats->maximum = NO_DATA;
+    stats->mean = NO_DATA;
+    stats->standardDeviation = 0;
+    stats->valid = 0;
+
+    int64_t sum = 0;
+    int bin;
+    for (bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        if (stats->histogram[bin] == 0)
+            continue;
+
+        signed short elevation = MIN_ELEVATION_VALUE + bin;
+        if (stats->valid == 0)
+            stats->minimum = elevation;
+
+        stats->maximum = elevation;
+        stats->valid += stats->histogram[bin];
+        sum += stats->histogram[bin] * elevation;
+    }
+
+    if (stats->valid == 0)
+        return;
+
+    stats->mean = (double) sum / stats->valid;
+
+    double squares = 0;
+    for (bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        double difference = MIN_ELEVATION_VALUE + bin - stats->mean;
+        squares += stats->histogram[bin] * difference * difference;
+    }
+
+    stats->standardDeviation = sqrt(squares / stats->valid);
+}
+
+
+/*
+ * Computes the statistics and 1 metre histogram of the DEM at inputPath in one
+ * pass. The DEM is mapped into memory rather than read point by point, and bands
+ * of rows are counted in parallel. DEMs that canStreamDEM() does not accept, such
+ * as bit-packed ones, are read whole with readDEM() instead. Can return an error.
+ */
+gtopoStats* computeStats(char *inputPath, int width, int height)
+{
+    error = NULL;
+
+    gtopoStats *stats = NULL;
+    unsigned char *samples = NULL;
+    gtopoDEM *inputDEM = NULL;
+
+    if (canStreamDEM(inputPath))
+        samples = mapDEM(inputPath, width, height);
+    else
+        inputDEM = readDEM(inputPath, width, height);
+
+    if (error != NULL)
+        return NULL;
+
+    stats = (gtopoStats *) calloc(1, sizeof(gtopoStats));
+    error = checkAllocated(stats);
+    if (error != NULL)
+        goto cleanup;
+
+    histogramJob job;
+    job.samples = samples;
+    job.dem = inputDEM;
+    job.width = width;
+    job.height = height;
+    job.stats = stats;
+    job.invalid = 0;
+    pthread_mutex_init(&job.lock, NULL);
+
+    parallelFor((height + ROWS_PER_BAND - 1) / ROWS_PER_BAND, countBand, &job);
+
+    pthread_mutex_destroy(&job.lock);
+
+    // Check that every elevation was valid, and every band was counted.
+    error = checkRowData(job.invalid, inputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    summarizeHistogram(stats);
+
+    goto cleanup;
+
+    cleanup:
+    if (error != NULL)
+    {
+        free(stats);
+        stats = NULL;
+    }
+
+    unmapDEM(samples, width, height);
+    freeDEM(inputDEM);
+    return stats;
+}
+
+
+/*
+ * Writes the histogram as one "elevation count" line per metre from the lowest
+ * to the highest valid elevation, including empty bins. Can return an error.
+ */
+void writeHistogram(gtopoStats *stats, char *outputPath)
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(outputPath, "w");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        return;
+
+    int bin;
+    for (bin = 0; bin < HISTOGRAM_BINS; bin++)
+        fprintf(outputFile, "%d %lld\n", MIN_ELEVATION_VALUE + bin, (long long) stats->histogram[bin]);
+
+    // Check that every bin reached the file, which closing it flushes.
+    int failed = ferror(outputFile);
+    failed |= fclose(outputFile) != 0;
+
+    error = checkOutputWritten(failed, outputPath);
+}
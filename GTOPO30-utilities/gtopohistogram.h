@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include "gtopoio.h"
+
+// One bin per metre of valid elevation.
+#define HISTOGRAM_BINS (MAX_ELEVATION_VALUE - MIN_ELEVATION_VALUE + 1)
+
+typedef struct elevationStats gtopoStats;
+
+/*
+ * Statistics of the valid (non NO_DATA) elevation points of a DEM, and the number
+ * of points without data. histogram[bin] counts the elevation
+ * MIN_ELEVATION_VALUE + bin. The minimum, maximum and mean of a DEM without valid
+ * points are NO_DATA.
+ */
+struct elevationStats
+{
+    signed short minimum;
+    signed short maximum;
+    double mean;
+    double standardDeviation;
+    int64_t valid;
+    int64_t noData;
+    int64_t histogram[HISTOGRAM_BINS];
+};
+
+gtopoStats* computeStats(char *inputPath, int width, int height);
+void writeHistogram(gtopoStats *stats, char *outputPath);
@@ -1,11 +1,36 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "gtopodata.h"
 #include "gtopolimits.h"
 #include "gtopoerror.h"
+#include "gtopocodec.h"
+#include "gtopothreads.h"
+#include "gtopoheader.h"
+#include "gtopocpu.h"
 
-// Used to signal file errors to the programs that include this module.
-gtopoError *error = NULL;
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define PACK_MAGIC "GTPK"
+#define PACK_HEADER_SIZE 20
+#define BITPACK_MAGIC "GTBP"
+#define BITPACK_HEADER_SIZE 16
+
+/*
+ * Used to signal file errors to the programs that include this module. Each
+ * thread has its own, so jobs run on worker threads can fail independently.
+ */
+_Thread_local gtopoError *error = NULL;
 
 
 /*
@@ -19,65 +44,313 @@ static signed short switchEndianness(signed short value)
 
 
 /*
- * Reads the DEM raster, interpreting it as raw byte data. Can return an error.
+ * Converts elevations from big-endian in place from the point first up to count.
+ * Returns 1 if any is invalid and 0 otherwise. This is the scalar kernel, and
+ * the vector kernels finish with it.
  */
-static void readRaster(gtopoDEM *inputDEM, FILE *file, char *path)
+static int convertElevationsFrom(signed short *elevations, long first, long count)
 {
-    int row;
-    int column;
-    int scanCount = 0;
-    int pointsRead = 0;
-    signed short elevation = 0;
+    long x;
+    int invalid = 0;
+    for (x = first; x < count; x++)
+    {
+        signed short elevation = switchEndianness(elevations[x]);
+        invalid |= elevation != NO_DATA && (elevation < MIN_ELEVATION_VALUE || elevation > MAX_ELEVATION_VALUE);
+        elevations[x] = elevation;
+    }
 
-    // Skip preceeding whitespace.
-    fscanf(file, " ");
+    return invalid;
+}
 
-    // Start reading the binary raster data.
-    for (row = 0; row < getHeight(inputDEM); row++)
-    {   
-        for (column = 0; column < getWidth(inputDEM); column++)
-        {
-            scanCount = fread(&elevation, sizeof(signed short), 1, file);
 
-            // Since the read value was in big endian, we need to convert it to little endian.
-            elevation = switchEndianness(elevation);
+/*
+ * The vector kernels swap the bytes of each elevation with a pair of shifts, and
+ * gather the points that are neither NO_DATA nor in range into one mask, checked
+ * once at the end.
+ */
+#if defined(__x86_64__)
+static int convertElevationsSSE2(signed short *elevations, long count)
+{
+    __m128i lowest = _mm_set1_epi16(MIN_ELEVATION_VALUE);
+    __m128i highest = _mm_set1_epi16(MAX_ELEVATION_VALUE);
+    __m128i noData = _mm_set1_epi16(NO_DATA);
+    __m128i invalid = _mm_setzero_si128();
+    long x;
 
-            // Check that the requested number of bytes was read.
-            error = checkEOF(scanCount, path);
-            if (error != NULL)
-                return;
+    for (x = 0; x + 8 <= count; x += 8)
+    {
+        __m128i *points = (__m128i *) (elevations + x);
+        __m128i value = _mm_loadu_si128(points);
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
 
-            // Check that the pixel we read is within valid range.
-            error = checkElevation(elevation, scanCount, path);
-            if (error != NULL)
-                return;
+        __m128i outside = _mm_or_si128(_mm_cmplt_epi16(value, lowest), _mm_cmpgt_epi16(value, highest));
+        invalid = _mm_or_si128(invalid, _mm_andnot_si128(_mm_cmpeq_epi16(value, noData), outside));
+        _mm_storeu_si128(points, value);
+    }
+
+    return (_mm_movemask_epi8(invalid) != 0) | convertElevationsFrom(elevations, x, count);
+}
+
+
+__attribute__((target("avx2")))
+static int convertElevationsAVX2(signed short *elevations, long count)
+{
+    __m256i lowest = _mm256_set1_epi16(MIN_ELEVATION_VALUE);
+    __m256i highest = _mm256_set1_epi16(MAX_ELEVATION_VALUE);
+    __m256i noData = _mm256_set1_epi16(NO_DATA);
+    __m256i invalid = _mm256_setzero_si256();
+    long x;
+
+    for (x = 0; x + 16 <= count; x += 16)
+    {
+        __m256i *points = (__m256i *) (elevations + x);
+        __m256i value = _mm256_loadu_si256(points);
+        value = _mm256_or_si256(_mm256_slli_epi16(value, 8), _mm256_srli_epi16(value, 8));
+
+        // AVX2 has no signed less-than, so lowest > value is used instead.
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi16(lowest, value), _mm256_cmpgt_epi16(value, highest));
+        invalid = _mm256_or_si256(invalid, _mm256_andnot_si256(_mm256_cmpeq_epi16(value, noData), outside));
+        _mm256_storeu_si256(points, value);
+    }
+
+    return (_mm256_movemask_epi8(invalid) != 0) | convertElevationsFrom(elevations, x, count);
+}
+
+
+__attribute__((target("avx512bw")))
+static int convertElevationsAVX512(signed short *elevations, long count)
+{
+    __m512i lowest = _mm512_set1_epi16(MIN_ELEVATION_VALUE);
+    __m512i highest = _mm512_set1_epi16(MAX_ELEVATION_VALUE);
+    __m512i noData = _mm512_set1_epi16(NO_DATA);
+    __mmask32 invalid = 0;
+    long x;
+
+    for (x = 0; x + 32 <= count; x += 32)
+    {
+        void *points = elevations + x;
+        __m512i value = _mm512_loadu_si512(points);
+        value = _mm512_or_si512(_mm512_slli_epi16(value, 8), _mm512_srli_epi16(value, 8));
+
+        __mmask32 outside = _mm512_cmplt_epi16_mask(value, lowest) | _mm512_cmpgt_epi16_mask(value, highest);
+        invalid |= outside & _mm512_cmpneq_epi16_mask(value, noData);
+        _mm512_storeu_si512(points, value);
+    }
+
+    return (invalid != 0) | convertElevationsFrom(elevations, x, count);
+}
+#elif defined(__aarch64__)
+static int convertElevationsNEON(signed short *elevations, long count)
+{
+    int16x8_t lowest = vdupq_n_s16(MIN_ELEVATION_VALUE);
+    int16x8_t highest = vdupq_n_s16(MAX_ELEVATION_VALUE);
+    int16x8_t noData = vdupq_n_s16(NO_DATA);
+    uint16x8_t invalid = vdupq_n_u16(0);
+    long x;
+
+    for (x = 0; x + 8 <= count; x += 8)
+    {
+        int16x8_t value = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(vld1q_s16(elevations + x))));
+
+        uint16x8_t outside = vorrq_u16(vcltq_s16(value, lowest), vcgtq_s16(value, highest));
+        invalid = vorrq_u16(invalid, vbicq_u16(outside, vceqq_s16(value, noData)));
+        vst1q_s16(elevations + x, value);
+    }
+
+    return (vmaxvq_u16(invalid) != 0) | convertElevationsFrom(elevations, x, count);
+}
+#endif
+
+
+/*
+ * Converts elevations read from a raw DEM from big-endian in place, with the
+ * kernel for the instruction set getSimdLevel() chooses. Returns 1 if any is
+ * invalid and 0 otherwise. Swapping the bytes twice restores them, so this also
+ * converts elevations to big-endian for writing, when the result is ignored.
+ */
+static int convertElevations(signed short *elevations, long count)
+{
+    switch (getSimdLevel())
+    {
+#if defined(__x86_64__)
+        case SIMD_AVX512:
+            return convertElevationsAVX512(elevations, count);
+        case SIMD_AVX2:
+            return convertElevationsAVX2(elevations, count);
+        case SIMD_SSE2:
+            return convertElevationsSSE2(elevations, count);
+#elif defined(__aarch64__)
+        case SIMD_NEON:
+            return convertElevationsNEON(elevations, count);
+#endif
+        default:
+            return convertElevationsFrom(elevations, 0, count);
+    }
+}
+
+
+/*
+ * Checks that a raw DEM file holds exactly width * height elevation points.
+ */
+static gtopoError* checkRawSize(FILE *inputFile, int width, int height, char *filePath)
+{
+    struct stat fileStatus;
+    fstat(fileno(inputFile), &fileStatus);
+
+    long points = fileStatus.st_size % sizeof(signed short) == 0 ? fileStatus.st_size / sizeof(signed short) : -1;
+    return checkElevationCount(points >= 0 && points <= INT_MAX ? (int) points : -1, width * height, filePath);
+}
+
+
+/*
+ * Reads the DEM raster, interpreting it as raw byte data in the given byte order.
+ * Points equal to noData, which is NO_DATA unless a .HDR file says otherwise, are
+ * stored as NO_DATA. The size of the file is checked before anything is read, and
+ * the raster is then read in a single call. Can return an error.
+ */
+static void readRaster(gtopoDEM *inputDEM, FILE *file, char *path, int bigEndian, signed short noData)
+{
+    int width = getWidth(inputDEM);
+    int height = getHeight(inputDEM);
+    long count = (long) width * height;
+
+    // Check that the file holds exactly the points of the raster, no more and no less.
+    error = checkRawSize(file, width, height, path);
+    if (error != NULL)
+        return;
+
+    // The raster is one contiguous block, so it can be read straight into.
+    signed short *elevations = getRaster(inputDEM)[0];
+
+    error = checkEOF(fread(elevations, sizeof(signed short), count, file) == count, path);
+    if (error != NULL)
+        return;
+
+    /*
+     * A big-endian raster marking missing points with NO_DATA, as GTOPO30 tiles
+     * are, is converted and checked by the vector kernel. If it holds an invalid
+     * elevation, the loop below finds it in the converted points.
+     */
+    if (bigEndian && noData == NO_DATA)
+    {
+        if (convertElevations(elevations, count) == 0)
+            return;
+
+        bigEndian = 0;
+    }
+
+    long point;
+    for (point = 0; point < count; point++)
+    {
+        signed short elevation = elevations[point];
 
-            // Set the value if check passes.
-            setElevation(inputDEM, elevation, row, column);
-            pointsRead++;
+        // GTOPO30 tiles are big endian, so convert them to the order of this machine.
+        if (bigEndian)
+            elevation = switchEndianness(elevation);
+
+        if (elevation == noData)
+            elevation = NO_DATA;
+
+        // Check that the point we read is within valid range.
+        if (elevation != NO_DATA && (elevation < MIN_ELEVATION_VALUE || elevation > MAX_ELEVATION_VALUE))
+        {
+            error = checkElevation(elevation, 1, path);
+            return;
         }
+
+        elevations[point] = elevation;
+    }
+}
+
+
+/*
+ * Reads the raster of a bit-packed DEM, after its magic number. The dimensions in
+ * the header must match those of the DEM. Can return an error.
+ */
+static void readBitPackedRaster(gtopoDEM *inputDEM, FILE *file, char *path)
+{
+    int width = getWidth(inputDEM);
+    int height = getHeight(inputDEM);
+    unsigned char header[BITPACK_HEADER_SIZE - 4];
+
+    error = checkPackedData(fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        getUint32(header) != BITPACK_VERSION, path);
+    if (error != NULL)
+        return;
+
+    error = checkMatchingDimensions(getUint32(header + 4), getUint32(header + 8), width, height, path);
+    if (error != NULL)
+        return;
+
+    // Read the packed rows in one go, then decode them from memory.
+    struct stat fileStatus;
+    fstat(fileno(file), &fileStatus);
+    long size = fileStatus.st_size - BITPACK_HEADER_SIZE;
+
+    unsigned char *packed = (unsigned char *) malloc(size > 0 ? size : 1);
+    error = checkAllocated(packed);
+    if (error != NULL)
+        return;
+
+    error = checkPackedData(fread(packed, 1, size, file) != size, path);
+    if (error != NULL)
+    {
+        free(packed);
+        return;
     }
 
-    // Check whether the file contains more data than expected.
-    elevation = NO_DATA - 1;
-    while (fread(&elevation, sizeof(signed short), 1, file) != 0)
+    signed short **raster = getRaster(inputDEM);
+    long position = 0;
+    int row;
+    int column;
+
+    for (row = 0; row < height; row++)
     {
-        if (elevation != NO_DATA - 1)
-            pointsRead++;
+        int used = unpackRow(packed + position, size - position, row > 0 ? raster[row - 1] : NULL, width, raster[row]);
+
+        error = checkPackedData(used < 0, path);
+        if (error != NULL)
+            break;
+
+        position = position + used;
+
+        // Check that every elevation we decoded is within valid range.
+        for (column = 0; column < width; column++)
+        {
+            signed short elevation = raster[row][column];
+            if (elevation != NO_DATA && (elevation < MIN_ELEVATION_VALUE || elevation > MAX_ELEVATION_VALUE))
+            {
+                error = checkElevation(elevation, 1, path);
+                break;
+            }
+        }
+
+        if (error != NULL)
+            break;
     }
 
-    // Check that the number of elevation points read matched the dimensions.
-    error = checkElevationCount(pointsRead, getWidth(inputDEM) * getHeight(inputDEM), path);
+    // Check that the file does not contain more data than the rows.
+    if (error == NULL)
+        error = checkPackedData(position != size, path);
+
+    free(packed);
 }
 
 
+// Defined with the rest of the packed format below.
+static gtopoDEM* readArenaPackedDEM(gtopoArena *arena, char *filePath, int width, int height);
+
+
 /*
- * Opens the file in read binary mode, and reads the DEM data. Returns NULL if
- * read failed.
+ * Opens the file in read binary mode, and reads the DEM data into a DEM allocated
+ * from the arena, or from the heap if the arena is NULL. Raw DEMs, bit-packed DEMs
+ * written by echoDEMEncoded() and packed DEMs written by gtopoPack are all
+ * accepted. Returns NULL if read failed.
  */
-gtopoDEM* readDEM(char *filePath, int width, int height)
+gtopoDEM* readArenaDEM(gtopoArena *arena, char *filePath, int width, int height)
 {
     error = NULL;
+    gtopoDEM *newDEM = NULL;
 
     // Open a file for reading.
     FILE *inputFile = fopen(filePath, "rb");
@@ -87,16 +360,52 @@ gtopoDEM* readDEM(char *filePath, int width, int height)
     if (error != NULL)
         goto cleanup;
 
-    // Initialise the image.
-    gtopoDEM *newDEM = createDEM(width, height);
+    // Packed and bit-packed DEMs start with a magic number. Raw DEMs have no header.
+    unsigned char magic[4];
+    int magicRead = fread(magic, 1, 4, inputFile) == 4;
+
+    // Packed DEMs are decoded block by block, straight into a DEM of their own.
+    if (magicRead && memcmp(magic, PACK_MAGIC, 4) == 0)
+    {
+        newDEM = readArenaPackedDEM(arena, filePath, width, height);
+        goto cleanup;
+    }
+
+    // Initialise the image. Every elevation is read into it, so it is not filled first.
+    newDEM = createUnfilledDEM(arena, width, height);
 
     // Check that the image was allocated memory correctly.
     error = checkDEMallocated(newDEM);
     if (error != NULL)
         goto cleanup;
 
-    // Read raster data, and check if an error occurred.
-    readRaster(newDEM, inputFile, filePath);
+    if (magicRead && memcmp(magic, BITPACK_MAGIC, 4) == 0)
+    {
+        readBitPackedRaster(newDEM, inputFile, filePath);
+    }
+    else
+    {
+        // A raw DEM may have a .HDR file beside it, giving its dimensions and byte order.
+        gtopoHeader *header = readHeader(filePath);
+        if (error != NULL)
+            goto cleanup;
+
+        int bigEndian = header == NULL || isHeaderBigEndian(header);
+        signed short noData = header == NULL ? NO_DATA : getHeaderNoData(header);
+
+        if (header != NULL)
+            error = checkMatchingDimensions(getHeaderWidth(header), getHeaderHeight(header), width, height, filePath);
+
+        freeHeader(header);
+        if (error != NULL)
+            goto cleanup;
+
+        // Read raster data from the start of the file.
+        rewind(inputFile);
+        readRaster(newDEM, inputFile, filePath, bigEndian, noData);
+    }
+
+    // Check if an error occurred reading the raster.
     if (error != NULL)
         goto cleanup;
 
@@ -108,60 +417,1048 @@ gtopoDEM* readDEM(char *filePath, int width, int height)
         fclose(inputFile);
     
     if (error != NULL)
+    {
+        freeDEM(newDEM);
         return NULL;
+    }
     
     return newDEM;
 }
 
 
 /*
- * Writes the image raster to a file in raw byte format.
+ * Opens the file in read binary mode, and reads the DEM data into a DEM allocated
+ * from the heap. Returns NULL if read failed.
  */
-static void writeRaster(gtopoDEM *inputDEM, FILE *file)
+gtopoDEM* readDEM(char *filePath, int width, int height)
 {
-    int width = getWidth(inputDEM);
-    int height = getHeight(inputDEM);
+    return readArenaDEM(NULL, filePath, width, height);
+}
 
-    signed short elevation = 0;
-    int row;
-    int column;
-    for (row = 0; row < height; row++)
+
+/*
+ * A raw DEM opened for reading row by row, so that programs can stream a DEM
+ * without holding all of it in memory. Rows are read with pread(), so any number
+ * of threads can read rows of the same reader at once. A DEM that cannot be read
+ * in place, such as a bit-packed one, is read whole into dem instead and its rows
+ * are copied from memory.
+ */
+typedef struct rowReader
+{
+    FILE *file;
+    int fileDescriptor;
+    int width;
+    int height;
+    gtopoDEM *dem;
+} rowReader;
+
+
+/*
+ * Checks a .HDR file beside a raw DEM that is streamed or mapped, if there is
+ * one, against the dimensions given for it. Such DEMs are read in place, so they
+ * must also be big-endian. Can return an error.
+ */
+static gtopoError* checkRawHeader(char *filePath, int width, int height)
+{
+    gtopoHeader *header = readHeader(filePath);
+    if (error != NULL || header == NULL)
+        return error;
+
+    gtopoError *headerError = checkMatchingDimensions(getHeaderWidth(header), getHeaderHeight(header), width, height, filePath);
+    if (headerError == NULL)
+        headerError = checkByteOrder(isHeaderBigEndian(header), filePath);
+
+    freeHeader(header);
+    return headerError;
+}
+
+
+/*
+ * Returns 1 if a DEM can be streamed with openDEMRows(): a raw DEM that is
+ * big-endian and marks missing points with NO_DATA, as any without a .HDR file
+ * is. Packed and bit-packed DEMs, and rasters whose .HDR file asks for them to
+ * be converted, have to be read whole with readDEM(), which openDEMRows() does
+ * for them.
+ */
+int canStreamDEM(char *filePath)
+{
+    FILE *inputFile = fopen(filePath, "rb");
+    if (inputFile == NULL)
+        return 0;
+
+    unsigned char magic[4];
+    int encoded = fread(magic, 1, 4, inputFile) == 4 &&
+        (memcmp(magic, BITPACK_MAGIC, 4) == 0 || memcmp(magic, PACK_MAGIC, 4) == 0);
+    fclose(inputFile);
+
+    if (encoded)
+        return 0;
+
+    gtopoHeader *header = readHeader(filePath);
+    if (error != NULL)
     {
-        for (column = 0; column < width; column++)
-        {
-            elevation = getElevation(inputDEM, row, column);
-            
-            // DEM files store bytes in big-endian, we need to covert the little endian value.
-            elevation = switchEndianness(elevation);
+        error = NULL;
+        return 0;
+    }
 
-            fwrite(&elevation, sizeof(signed short), 1, file);
-        }
+    int streamable = header == NULL || (isHeaderBigEndian(header) && getHeaderNoData(header) == NO_DATA);
+    freeHeader(header);
+    return streamable;
+}
+
+
+/*
+ * Opens a DEM that canStreamDEM() does not accept by reading it whole with
+ * readDEM(), so that its rows can be served from memory. Returns NULL if the DEM
+ * could not be read.
+ */
+static rowReader* openDEMInMemory(char *filePath, int width, int height)
+{
+    gtopoDEM *inputDEM = readDEM(filePath, width, height);
+    if (error != NULL)
+        return NULL;
+
+    rowReader *reader = (rowReader *) malloc(sizeof(rowReader));
+    error = checkAllocated(reader);
+    if (error != NULL)
+    {
+        freeDEM(inputDEM);
+        return NULL;
     }
+
+    reader->file = NULL;
+    reader->fileDescriptor = -1;
+    reader->width = width;
+    reader->height = height;
+    reader->dem = inputDEM;
+    return reader;
 }
 
 
 /*
- * Writes an image to disk given an image pointer and the file path, with the 
- * same raster data formatting as the original image. Can return an error.
+ * Opens a raw DEM for streaming, checking up front that the file holds exactly
+ * width * height elevation points. Bit-packed DEMs, and rasters whose .HDR file
+ * asks for them to be converted, are read whole instead. Returns NULL if the
+ * file could not be opened.
  */
-void echoDEM(gtopoDEM *inputDEM, char *filePath)
+rowReader* openDEMRows(char *filePath, int width, int height)
 {
     error = NULL;
 
-    FILE *outputFile = fopen(filePath, "wb");
+    if (!canStreamDEM(filePath))
+        return openDEMInMemory(filePath, width, height);
+
+    FILE *inputFile = fopen(filePath, "rb");
 
     // Check that the file path exists.
-    error = checkInvalidFileName(outputFile, filePath);
+    error = checkInvalidFileName(inputFile, filePath);
     if (error != NULL)
-        goto cleanup;
+        return NULL;
 
-    // Write the file if checks pass.
-    writeRaster(inputDEM, outputFile);
+    // Check that the size of the file, and any .HDR file, matches the dimensions.
+    error = checkRawSize(inputFile, width, height, filePath);
+    if (error == NULL)
+        error = checkRawHeader(filePath, width, height);
 
-    // We are now done with the file. Close it.
-    goto cleanup;
+    if (error != NULL)
+    {
+        fclose(inputFile);
+        return NULL;
+    }
 
-    cleanup:
-    if (outputFile != NULL)
-        fclose(outputFile);
+    rowReader *reader = (rowReader *) malloc(sizeof(rowReader));
+    error = checkAllocated(reader);
+    if (error != NULL)
+    {
+        fclose(inputFile);
+        return NULL;
+    }
+
+    reader->file = inputFile;
+    reader->fileDescriptor = fileno(inputFile);
+    reader->width = width;
+    reader->height = height;
+    reader->dem = NULL;
+    return reader;
+}
+
+
+/*
+ * Reads count elevations of a streamed DEM, starting at the given row and column,
+ * into the given buffer, converting them from big-endian. Returns 0 on success,
+ * and 1 if the span lies outside the DEM, could not be read or holds an invalid
+ * elevation. Does not set the external error, so it is safe to call from several
+ * threads.
+ */
+int readDEMSpan(rowReader *reader, int row, int column, int count, signed short *elevations)
+{
+    if (row < 0 || row >= reader->height || column < 0 || count < 0 || column + count > reader->width)
+        return 1;
+
+    size_t spanBytes = sizeof(signed short) * count;
+    off_t offset = ((off_t) row * reader->width + column) * sizeof(signed short);
+
+    // Elevations read into memory were converted and checked when they were read.
+    if (reader->dem != NULL)
+    {
+        memcpy(elevations, getRaster(reader->dem)[row] + column, spanBytes);
+        return 0;
+    }
+
+    if (pread(reader->fileDescriptor, elevations, spanBytes, offset) != spanBytes)
+        return 1;
+
+    return convertElevations(elevations, count);
+}
+
+
+/*
+ * Reads count whole rows of a streamed DEM, starting at the given row, into the
+ * given buffer in one read, converting them from big-endian. Returns 0 on success,
+ * and 1 if the rows lie outside the DEM, could not be read or hold an invalid
+ * elevation. Does not set the external error, so it is safe to call from several
+ * threads.
+ */
+int readDEMRows(rowReader *reader, int row, int count, signed short *elevations)
+{
+    if (row < 0 || count < 0 || row + count > reader->height)
+        return 1;
+
+    long points = (long) count * reader->width;
+    size_t rowsBytes = sizeof(signed short) * points;
+    off_t offset = (off_t) row * reader->width * sizeof(signed short);
+
+    if (reader->dem != NULL)
+    {
+        int x;
+        for (x = 0; x < count; x++)
+            memcpy(elevations + (long) x * reader->width, getRaster(reader->dem)[row + x], sizeof(signed short) * reader->width);
+
+        return 0;
+    }
+
+    if (pread(reader->fileDescriptor, elevations, rowsBytes, offset) != rowsBytes)
+        return 1;
+
+    return convertElevations(elevations, points);
+}
+
+
+/*
+ * Reads a row of a streamed DEM into the given buffer of width elevations. Returns
+ * 0 on success, and 1 if the row could not be read or holds an invalid elevation.
+ */
+int readDEMRow(rowReader *reader, int row, signed short *elevations)
+{
+    return readDEMSpan(reader, row, 0, reader->width, elevations);
+}
+
+
+/*
+ * Closes a streamed DEM and frees the reader.
+ */
+void closeDEMRows(rowReader *reader)
+{
+    if (reader != NULL)
+    {
+        if (reader->file != NULL)
+            fclose(reader->file);
+
+        freeDEM(reader->dem);
+        free(reader);
+    }
+}
+
+
+/*
+ * Writes count elevations to a raw DEM open for writing, starting firstPoint
+ * points into it, converting them to big-endian in place so the buffer is
+ * left in big-endian. Returns 0 on success and 1 if they could not be written.
+ * Does not set the external error, so it is safe to call from several threads.
+ */
+int writeDEMSpan(int fileDescriptor, long firstPoint, signed short *elevations, int count)
+{
+    convertElevations(elevations, count);
+
+    size_t spanBytes = sizeof(signed short) * count;
+    return pwrite(fileDescriptor, elevations, spanBytes, (off_t) firstPoint * sizeof(signed short)) != spanBytes;
+}
+
+
+/*
+ * Maps a raw DEM into memory for bulk reading, checking up front that the file
+ * holds exactly width * height elevation points. The elevations are left in
+ * big-endian and are not validated. Can return an error.
+ */
+unsigned char* mapDEM(char *filePath, int width, int height)
+{
+    error = NULL;
+
+    FILE *inputFile = fopen(filePath, "rb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(inputFile, filePath);
+    if (error != NULL)
+        return NULL;
+
+    unsigned char *samples = NULL;
+
+    // Check that the size of the file, and any .HDR file, matches the dimensions.
+    error = checkRawSize(inputFile, width, height, filePath);
+    if (error == NULL)
+        error = checkRawHeader(filePath, width, height);
+
+    if (error != NULL)
+        goto cleanup;
+
+    size_t bytes = (size_t) width * height * sizeof(signed short);
+    samples = (unsigned char *) mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fileno(inputFile), 0);
+
+    if (samples == MAP_FAILED)
+        samples = NULL;
+
+    error = checkAllocated(samples);
+    if (error != NULL)
+        goto cleanup;
+
+    // The whole file is about to be read once, front to back.
+    madvise(samples, bytes, MADV_SEQUENTIAL);
+
+    goto cleanup;
+
+    cleanup:
+    // The mapping stays valid once the file is closed.
+    fclose(inputFile);
+    return samples;
+}
+
+
+/*
+ * Unmaps a DEM mapped by mapDEM().
+ */
+void unmapDEM(unsigned char *samples, int width, int height)
+{
+    if (samples != NULL)
+        munmap(samples, (size_t) width * height * sizeof(signed short));
+}
+
+
+/*
+ * Writes the image raster to a file in raw byte format, a row at a time. Returns
+ * 1 if any row could not be written and 0 otherwise. Can return an error.
+ */
+static int writeRaster(gtopoDEM *inputDEM, FILE *file)
+{
+    int width = getWidth(inputDEM);
+    int height = getHeight(inputDEM);
+    signed short **raster = getRaster(inputDEM);
+
+    // Each row is converted in a copy, so the DEM itself is left as it was.
+    signed short *converted = (signed short *) malloc(sizeof(signed short) * width);
+    error = checkAllocated(converted);
+    if (error != NULL)
+        return 0;
+
+    int failed = 0;
+    int row;
+    for (row = 0; row < height; row++)
+    {
+        memcpy(converted, raster[row], sizeof(signed short) * width);
+
+        // DEM files store bytes in big-endian, we need to covert the little endian values.
+        convertElevations(converted, width);
+
+        failed |= fwrite(converted, sizeof(signed short), width, file) != width;
+    }
+
+    free(converted);
+    return failed;
+}
+
+
+/*
+ * Writes the DEM as a bit-packed header and rows. Returns 1 if any of them could
+ * not be written and 0 otherwise. Can return an error.
+ */
+static int writeBitPackedRaster(gtopoDEM *inputDEM, FILE *file)
+{
+    int width = getWidth(inputDEM);
+    int height = getHeight(inputDEM);
+    signed short **raster = getRaster(inputDEM);
+
+    unsigned char *packed = (unsigned char *) malloc(maxPackedRowSize(width));
+    error = checkAllocated(packed);
+    if (error != NULL)
+        return 0;
+
+    unsigned char header[BITPACK_HEADER_SIZE];
+    memcpy(header, BITPACK_MAGIC, 4);
+    putUint32(header + 4, BITPACK_VERSION);
+    putUint32(header + 8, width);
+    putUint32(header + 12, height);
+    int failed = fwrite(header, 1, BITPACK_HEADER_SIZE, file) != BITPACK_HEADER_SIZE;
+
+    int row;
+    for (row = 0; row < height; row++)
+    {
+        int size = packRow(raster[row], row > 0 ? raster[row - 1] : NULL, width, packed);
+
+        error = checkAllocated(size < 0 ? NULL : packed);
+        if (error != NULL)
+            break;
+
+        failed |= fwrite(packed, 1, size, file) != size;
+    }
+
+    free(packed);
+    return failed;
+}
+
+
+/*
+ * Writes a DEM to disk given its pointer, the file path, and whether the output
+ * should be raw or bit-packed. A value of 0 writes the raw big-endian elevations,
+ * whilst a value of 1 writes the lossless bit-packed format, which readDEM() also
+ * accepts. Can return an error.
+ */
+void echoDEMEncoded(gtopoDEM *inputDEM, char *filePath, int rawOrBitPacked)
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(filePath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, filePath);
+    if (error != NULL)
+        goto cleanup;
+
+    // Check that the specified output format is valid.
+    error = checkInvalidWriteMode(rawOrBitPacked);
+    if (error != NULL)
+        goto cleanup;
+
+    // Write the file in the chosen format if checks pass.
+    int failed = 0;
+    if (rawOrBitPacked == RAW)
+    {
+        failed = writeRaster(inputDEM, outputFile);
+    }
+    else if (rawOrBitPacked == BITPACKED)
+    {
+        failed = writeBitPackedRaster(inputDEM, outputFile);
+    }
+
+    if (error != NULL)
+        goto cleanup;
+
+    // We are now done with the file. Check that all of it reached the file, which closing it flushes.
+    failed |= fclose(outputFile) != 0;
+    outputFile = NULL;
+
+    error = checkOutputWritten(failed, filePath);
+    goto cleanup;
+
+    cleanup:
+    if (outputFile != NULL)
+        fclose(outputFile);
+}
+
+
+/*
+ * Writes an image to disk given an image pointer and the file path, with the 
+ * same raster data formatting as the original image. Can return an error.
+ */
+void echoDEM(gtopoDEM *inputDEM, char *filePath)
+{
+    echoDEMEncoded(inputDEM, filePath, RAW);
+}
+
+
+/*
+ * Packed DEM container. All integers are stored in big-endian, like the
+ * elevation points of a raw DEM. The file consists of:
+ *
+ * Header: The magic "GTPK", followed by the format version, width, height and
+ * block size, each 4 bytes.
+ *
+ * Block index: An 8-byte file offset for each block in row-major block order,
+ * followed by the offset of the end of the last block. Block n occupies the bytes
+ * from offset n up to offset n + 1.
+ *
+ * Blocks: The raster is split into blocks of blockSize x blockSize elevation
+ * points (smaller along the right and bottom edges). Each block is encoded on its
+ * own by gtopocodec, so a window only needs the blocks it overlaps to be decoded.
+ */
+typedef struct packedLayout
+{
+    int width;
+    int height;
+    int blockSize;
+    int blocksAcross;
+    int blocksDown;
+    uint64_t *offsets;
+} packedLayout;
+
+
+/*
+ * Work shared by the threads encoding or decoding the blocks of a packed DEM.
+ * When reading, the window is the region of the DEM being decoded and blocks are
+ * numbered from the top-left block that the window overlaps.
+ */
+typedef struct packedJob
+{
+    gtopoDEM *targetDEM;
+    packedLayout *layout;
+    int fileDescriptor;
+    int windowRow;
+    int windowColumn;
+    int firstBlockRow;
+    int firstBlockColumn;
+    int windowBlocksAcross;
+    unsigned char **encoded;
+    int *sizes;
+    int *failed;
+    signed short *invalid;
+} packedJob;
+
+
+/*
+ * Sets the block grid of a layout for a DEM of the given dimensions.
+ */
+static void setLayout(packedLayout *layout, int width, int height, int blockSize)
+{
+    layout->width = width;
+    layout->height = height;
+    layout->blockSize = blockSize;
+    layout->blocksAcross = (width + blockSize - 1) / blockSize;
+    layout->blocksDown = (height + blockSize - 1) / blockSize;
+    layout->offsets = NULL;
+}
+
+
+/*
+ * Returns the width of blocks in the given block column, and the height of blocks
+ * in the given block row.
+ */
+static int blockWidth(packedLayout *layout, int blockColumn)
+{
+    int remaining = layout->width - blockColumn * layout->blockSize;
+    return remaining < layout->blockSize ? remaining : layout->blockSize;
+}
+
+
+static int blockHeight(packedLayout *layout, int blockRow)
+{
+    int remaining = layout->height - blockRow * layout->blockSize;
+    return remaining < layout->blockSize ? remaining : layout->blockSize;
+}
+
+
+/*
+ * Encodes a single block of the DEM. Run by parallelFor() for each block index.
+ */
+static void encodePackedBlock(int index, void *jobPointer)
+{
+    packedJob *job = (packedJob *) jobPointer;
+    packedLayout *layout = job->layout;
+
+    int blockRow = index / layout->blocksAcross;
+    int blockColumn = index % layout->blocksAcross;
+    int width = blockWidth(layout, blockColumn);
+    int height = blockHeight(layout, blockRow);
+
+    signed short *samples = (signed short *) malloc(sizeof(signed short) * width * height);
+    unsigned char *encoded = (unsigned char *) malloc(maxEncodedBlockSize(width, height));
+    job->encoded[index] = encoded;
+    job->sizes[index] = -1;
+
+    if (samples == NULL || encoded == NULL)
+    {
+        free(samples);
+        return;
+    }
+
+    // Gather the block into a contiguous buffer.
+    signed short **raster = getRaster(job->targetDEM);
+    int row;
+    for (row = 0; row < height; row++)
+    {
+        memcpy(samples + row * width, raster[blockRow * layout->blockSize + row] + blockColumn * layout->blockSize,
+            sizeof(signed short) * width);
+    }
+
+    job->sizes[index] = encodeBlock(samples, width, height, encoded);
+    free(samples);
+}
+
+
+/*
+ * Writes a DEM to disk in the packed container format. Blocks are encoded in
+ * parallel. Can return an error.
+ */
+void echoPackedDEM(gtopoDEM *inputDEM, char *filePath)
+{
+    error = NULL;
+
+    packedLayout layout;
+    setLayout(&layout, getWidth(inputDEM), getHeight(inputDEM), PACK_BLOCK_SIZE);
+    int blockCount = layout.blocksAcross * layout.blocksDown;
+    int indexSize = sizeof(uint64_t) * (blockCount + 1);
+
+    unsigned char **encoded = (unsigned char **) calloc(blockCount, sizeof(unsigned char *));
+    int *sizes = (int *) calloc(blockCount, sizeof(int));
+    unsigned char *index = (unsigned char *) malloc(indexSize);
+
+    FILE *outputFile = fopen(filePath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, filePath);
+    if (error != NULL)
+        goto cleanup;
+
+    // Check that the working buffers were allocated.
+    error = checkAllocated(encoded != NULL && sizes != NULL && index != NULL ? index : NULL);
+    if (error != NULL)
+        goto cleanup;
+
+    packedJob job;
+    job.targetDEM = inputDEM;
+    job.layout = &layout;
+    job.encoded = encoded;
+    job.sizes = sizes;
+    parallelFor(blockCount, encodePackedBlock, &job);
+
+    // Build the block index from the encoded sizes, checking every block was encoded.
+    uint64_t offset = PACK_HEADER_SIZE + indexSize;
+    int block;
+    for (block = 0; block < blockCount; block++)
+    {
+        error = checkAllocated(sizes[block] < 0 ? NULL : encoded[block]);
+        if (error != NULL)
+            goto cleanup;
+
+        putUint64(index + block * sizeof(uint64_t), offset);
+        offset = offset + sizes[block];
+    }
+    putUint64(index + blockCount * sizeof(uint64_t), offset);
+
+    unsigned char header[PACK_HEADER_SIZE];
+    memcpy(header, PACK_MAGIC, 4);
+    putUint32(header + 4, PACK_VERSION);
+    putUint32(header + 8, layout.width);
+    putUint32(header + 12, layout.height);
+    putUint32(header + 16, layout.blockSize);
+
+    int failed = fwrite(header, 1, PACK_HEADER_SIZE, outputFile) != PACK_HEADER_SIZE;
+    failed |= fwrite(index, 1, indexSize, outputFile) != indexSize;
+    for (block = 0; block < blockCount; block++)
+    {
+        failed |= fwrite(encoded[block], 1, sizes[block], outputFile) != sizes[block];
+    }
+
+    // We are now done with the file. Check that all of it reached the file, which closing it flushes.
+    failed |= fclose(outputFile) != 0;
+    outputFile = NULL;
+
+    error = checkOutputWritten(failed, filePath);
+    goto cleanup;
+
+    cleanup:
+    if (outputFile != NULL)
+        fclose(outputFile);
+
+    if (encoded != NULL)
+    {
+        for (block = 0; block < blockCount; block++)
+        {
+            free(encoded[block]);
+        }
+    }
+    free(encoded);
+    free(sizes);
+    free(index);
+}
+
+
+/*
+ * Reads and validates the header and block index of a packed DEM. Returns 0 on
+ * success and 1 if the file is not a valid packed DEM.
+ */
+static int readPackedLayout(packedLayout *layout, FILE *file)
+{
+    unsigned char header[PACK_HEADER_SIZE];
+
+    if (fread(header, 1, PACK_HEADER_SIZE, file) != PACK_HEADER_SIZE)
+        return 1;
+
+    if (memcmp(header, PACK_MAGIC, 4) != 0 || getUint32(header + 4) != PACK_VERSION)
+        return 1;
+
+    uint32_t width = getUint32(header + 8);
+    uint32_t height = getUint32(header + 12);
+    uint32_t blockSize = getUint32(header + 16);
+
+    if (width < MIN_DIMENSION || width > MAX_COLUMNS || height < MIN_DIMENSION || height > MAX_ROWS ||
+        blockSize < 1 || blockSize > MAX_COLUMNS)
+        return 1;
+
+    setLayout(layout, width, height, blockSize);
+    int blockCount = layout->blocksAcross * layout->blocksDown;
+    int indexSize = sizeof(uint64_t) * (blockCount + 1);
+
+    unsigned char *index = (unsigned char *) malloc(indexSize);
+    layout->offsets = (uint64_t *) malloc(sizeof(uint64_t) * (blockCount + 1));
+
+    if (index == NULL || layout->offsets == NULL || fread(index, 1, indexSize, file) != indexSize)
+    {
+        free(index);
+        return 1;
+    }
+
+    // The blocks must follow the index in order and end within the file.
+    struct stat fileStatus;
+    fstat(fileno(file), &fileStatus);
+
+    uint64_t previous = PACK_HEADER_SIZE + indexSize;
+    int block;
+    for (block = 0; block <= blockCount; block++)
+    {
+        layout->offsets[block] = getUint64(index + block * sizeof(uint64_t));
+
+        if (layout->offsets[block] < previous || layout->offsets[block] > (uint64_t) fileStatus.st_size)
+        {
+            free(index);
+            return 1;
+        }
+
+        previous = layout->offsets[block];
+    }
+
+    free(index);
+    return 0;
+}
+
+
+/*
+ * Decodes a single block overlapping the window being read and copies the part
+ * inside the window into the DEM. A block that decodes but holds an elevation
+ * outside the valid range records it in invalid, which is otherwise NO_DATA. Run
+ * by parallelFor() for each block index.
+ */
+static void decodePackedBlock(int index, void *jobPointer)
+{
+    packedJob *job = (packedJob *) jobPointer;
+    packedLayout *layout = job->layout;
+
+    int blockRow = job->firstBlockRow + index / job->windowBlocksAcross;
+    int blockColumn = job->firstBlockColumn + index % job->windowBlocksAcross;
+    int block = blockRow * layout->blocksAcross + blockColumn;
+    int width = blockWidth(layout, blockColumn);
+    int height = blockHeight(layout, blockRow);
+
+    int encodedSize = layout->offsets[block + 1] - layout->offsets[block];
+    unsigned char *encoded = (unsigned char *) malloc(encodedSize);
+    signed short *samples = (signed short *) malloc(sizeof(signed short) * width * height);
+
+    job->failed[index] = 1;
+    job->invalid[index] = NO_DATA;
+
+    if (encoded != NULL && samples != NULL &&
+        pread(job->fileDescriptor, encoded, encodedSize, layout->offsets[block]) == encodedSize &&
+        decodeBlock(encoded, encodedSize, samples, width, height) == 0)
+    {
+        // Check that every elevation we decoded is within valid range.
+        int point;
+        for (point = 0; point < width * height; point++)
+        {
+            signed short elevation = samples[point];
+            if (elevation != NO_DATA && (elevation < MIN_ELEVATION_VALUE || elevation > MAX_ELEVATION_VALUE))
+            {
+                job->invalid[index] = elevation;
+                break;
+            }
+        }
+
+        // Copy the intersection of the block and the window into the DEM.
+        int top = blockRow * layout->blockSize;
+        int left = blockColumn * layout->blockSize;
+        int firstRow = top > job->windowRow ? top : job->windowRow;
+        int lastRow = top + height < job->windowRow + getHeight(job->targetDEM) ?
+            top + height : job->windowRow + getHeight(job->targetDEM);
+        int firstColumn = left > job->windowColumn ? left : job->windowColumn;
+        int lastColumn = left + width < job->windowColumn + getWidth(job->targetDEM) ?
+            left + width : job->windowColumn + getWidth(job->targetDEM);
+
+        signed short **raster = getRaster(job->targetDEM);
+        int row;
+        for (row = firstRow; row < lastRow; row++)
+        {
+            memcpy(raster[row - job->windowRow] + (firstColumn - job->windowColumn),
+                samples + (row - top) * width + (firstColumn - left),
+                sizeof(signed short) * (lastColumn - firstColumn));
+        }
+
+        job->failed[index] = 0;
+    }
+
+    free(encoded);
+    free(samples);
+}
+
+
+/*
+ * Reads a window of a packed DEM into a DEM allocated from the arena, or from the
+ * heap if the arena is NULL. Used by readPackedWindow() and readArenaPackedDEM().
+ */
+static gtopoDEM* readArenaPackedWindow(gtopoArena *arena, char *filePath, int row, int column, int width, int height)
+{
+    error = NULL;
+
+    gtopoDEM *newDEM = NULL;
+    int *failed = NULL;
+    signed short *invalid = NULL;
+    packedLayout layout;
+    layout.offsets = NULL;
+
+    // Open a file for reading.
+    FILE *inputFile = fopen(filePath, "rb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(inputFile, filePath);
+    if (error != NULL)
+        goto cleanup;
+
+    // Read the header and block index.
+    error = checkPackedData(readPackedLayout(&layout, inputFile), filePath);
+    if (error != NULL)
+        goto cleanup;
+
+    // Check that the window lies within the DEM.
+    error = checkInvalidWindow(row, column, width, height, layout.width, layout.height);
+    if (error != NULL)
+        goto cleanup;
+
+    // Initialise the DEM the window is decoded into, which the blocks cover entirely.
+    newDEM = createUnfilledDEM(arena, width, height);
+
+    error = checkDEMallocated(newDEM);
+    if (error != NULL)
+        goto cleanup;
+
+    // Decode every block the window overlaps.
+    packedJob job;
+    job.targetDEM = newDEM;
+    job.layout = &layout;
+    job.fileDescriptor = fileno(inputFile);
+    job.windowRow = row;
+    job.windowColumn = column;
+    job.firstBlockRow = row / layout.blockSize;
+    job.firstBlockColumn = column / layout.blockSize;
+    job.windowBlocksAcross = (column + width - 1) / layout.blockSize - job.firstBlockColumn + 1;
+
+    int windowBlocksDown = (row + height - 1) / layout.blockSize - job.firstBlockRow + 1;
+    int blockCount = job.windowBlocksAcross * windowBlocksDown;
+
+    failed = (int *) malloc(sizeof(int) * blockCount);
+    invalid = (signed short *) malloc(sizeof(signed short) * blockCount);
+    job.failed = failed;
+    job.invalid = invalid;
+
+    error = checkAllocated(failed);
+    if (error == NULL)
+        error = checkAllocated(invalid);
+
+    if (error != NULL)
+        goto cleanup;
+
+    parallelFor(blockCount, decodePackedBlock, &job);
+
+    // Check that every block was decoded, and held only valid elevations.
+    int block;
+    for (block = 0; block < blockCount; block++)
+    {
+        error = checkPackedData(failed[block], filePath);
+        if (error == NULL)
+            error = checkElevation(invalid[block], 1, filePath);
+
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    // We are finished with the file, tidy up.
+    goto cleanup;
+
+    cleanup:
+    if (inputFile != NULL)
+        fclose(inputFile);
+
+    free(layout.offsets);
+    free(failed);
+    free(invalid);
+
+    if (error != NULL)
+    {
+        freeDEM(newDEM);
+        return NULL;
+    }
+
+    return newDEM;
+}
+
+
+/*
+ * Reads a window of a packed DEM, given the row and column of its top-left corner
+ * and its dimensions. Only the blocks the window overlaps are read and decoded,
+ * in parallel. Returns NULL if read failed.
+ */
+gtopoDEM* readPackedWindow(char *filePath, int row, int column, int width, int height)
+{
+    return readArenaPackedWindow(NULL, filePath, row, column, width, height);
+}
+
+
+/*
+ * Reads an entire packed DEM into a DEM allocated from the arena, or from the heap
+ * if the arena is NULL, checking the dimensions in its header against those given.
+ * Returns NULL if read failed.
+ */
+static gtopoDEM* readArenaPackedDEM(gtopoArena *arena, char *filePath, int width, int height)
+{
+    error = NULL;
+
+    FILE *inputFile = fopen(filePath, "rb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(inputFile, filePath);
+    if (error != NULL)
+        return NULL;
+
+    // Only the header is needed here to check the dimensions of the DEM.
+    packedLayout layout;
+    layout.offsets = NULL;
+    int corrupt = readPackedLayout(&layout, inputFile);
+    fclose(inputFile);
+    free(layout.offsets);
+
+    error = checkPackedData(corrupt, filePath);
+    if (error == NULL)
+        error = checkMatchingDimensions(layout.width, layout.height, width, height, filePath);
+
+    if (error != NULL)
+        return NULL;
+
+    return readArenaPackedWindow(arena, filePath, 0, 0, width, height);
+}
+
+
+/*
+ * Reads an entire packed DEM. Its dimensions are taken from the file header.
+ * Returns NULL if read failed.
+ */
+gtopoDEM* readPackedDEM(char *filePath)
+{
+    error = NULL;
+
+    FILE *inputFile = fopen(filePath, "rb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(inputFile, filePath);
+    if (error != NULL)
+        return NULL;
+
+    // Only the header is needed here to find the dimensions of the DEM.
+    packedLayout layout;
+    layout.offsets = NULL;
+    int corrupt = readPackedLayout(&layout, inputFile);
+    fclose(inputFile);
+    free(layout.offsets);
+
+    error = checkPackedData(corrupt, filePath);
+    if (error != NULL)
+        return NULL;
+
+    return readPackedWindow(filePath, 0, 0, layout.width, layout.height);
+}
+
+
+/*
+ * Reads the width and height of a DEM from the command line. If both arguments
+ * are "auto", they are taken from the header of a bit-packed or packed DEM, or
+ * else from the .HDR file beside a raw one, so that no buffer needs to be sized
+ * before they are known. Can return an error.
+ */
+void parseDimensions(char *filePath, char *widthArgument, char *heightArgument, int *width, int *height)
+{
+    error = NULL;
+
+    if (strcmp(widthArgument, "auto") == 0 && strcmp(heightArgument, "auto") == 0)
+    {
+        int known = 0;
+        unsigned char header[BITPACK_HEADER_SIZE];
+        FILE *file = fopen(filePath, "rb");
+
+        // Check that the file path exists.
+        error = checkInvalidFileName(file, filePath);
+        if (error != NULL)
+            return;
+
+        // Both headers hold the version, width and height after the magic number.
+        if (fread(header, 1, sizeof(header), file) == sizeof(header) &&
+            ((memcmp(header, BITPACK_MAGIC, 4) == 0 && getUint32(header + 4) == BITPACK_VERSION) ||
+            (memcmp(header, PACK_MAGIC, 4) == 0 && getUint32(header + 4) == PACK_VERSION)))
+        {
+            *width = (int) getUint32(header + 8);
+            *height = (int) getUint32(header + 12);
+            known = 1;
+        }
+
+        fclose(file);
+
+        if (!known)
+        {
+            gtopoHeader *rawHeader = readHeader(filePath);
+            if (error != NULL)
+                return;
+
+            if (rawHeader != NULL)
+            {
+                *width = getHeaderWidth(rawHeader);
+                *height = getHeaderHeight(rawHeader);
+                known = 1;
+            }
+
+            freeHeader(rawHeader);
+        }
+
+        error = checkDimensionsKnown(known);
+        if (error != NULL)
+            return;
+
+        // A header could be corrupt, so its dimensions are checked like arguments.
+        error = checkInvalidWidth(*width, '\0');
+        if (error != NULL)
+            return;
+
+        error = checkInvalidHeight(*height, '\0');
+        return;
+    }
+
+    /* 
+     * Convert the width argument to an integer. Check that the width is valid.
+     * Has to be an integer greater than one.
+     */
+    char *end;
+    *width = strtol(widthArgument, &end, 10);
+
+    error = checkInvalidWidth(*width, *end);
+    if (error != NULL)
+        return;
+
+    /* 
+     * Convert the height argument to an integer. Check that the height is valid.
+     * Has to be an integer greater than one.
+     */
+    *height = strtol(heightArgument, &end, 10);
+
+    error = checkInvalidHeight(*height, *end);
 }
@@ -3,7 +3,24 @@
 #include "gtopoerror.h"
 #include "gtopoexit.h"
 
-extern gtopoError *error;
+extern _Thread_local gtopoError *error;
+
+typedef struct rowReader gtopoRowReader;
 
 gtopoDEM* readDEM(char *filePath, int width, int height);
+gtopoDEM* readArenaDEM(gtopoArena *arena, char *filePath, int width, int height);
 void echoDEM(gtopoDEM *inputFile, char *filePath);
+void echoDEMEncoded(gtopoDEM *inputDEM, char *filePath, int rawOrBitPacked);
+void echoPackedDEM(gtopoDEM *inputDEM, char *filePath);
+gtopoDEM* readPackedDEM(char *filePath);
+gtopoDEM* readPackedWindow(char *filePath, int row, int column, int width, int height);
+gtopoRowReader* openDEMRows(char *filePath, int width, int height);
+int readDEMRow(gtopoRowReader *reader, int row, signed short *elevations);
+int readDEMSpan(gtopoRowReader *reader, int row, int column, int count, signed short *elevations);
+int readDEMRows(gtopoRowReader *reader, int row, int count, signed short *elevations);
+int writeDEMSpan(int fileDescriptor, long firstPoint, signed short *elevations, int count);
+int canStreamDEM(char *filePath);
+void closeDEMRows(gtopoRowReader *reader);
+unsigned char* mapDEM(char *filePath, int width, int height);
+void unmapDEM(unsigned char *samples, int width, int height);
+void parseDimensions(char *filePath, char *widthArgument, char *heightArgument, int *width, int *height);
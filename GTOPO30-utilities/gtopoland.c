@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gtopoland.h"
+#include "gtopopyramid.h"
+#include "gtopothreads.h"
+#include "gtopopipeline.h"
+
+// Number of bands whose matches are held in memory at once by findElevations().
+#define QUERY_ROUND_BANDS 256
+
+// Longest line written for a match: "row column elevation\n".
+#define MAX_MATCH_LENGTH 24
+
+
+/*
+ * Shared state for scanning a DEM in bands with its pyramid.
+ */
+typedef struct landJob
+{
+    gtopoPyramid *pyramid;
+    gtopoRowReader *reader;
+    FILE *outputFile;
+    int width;
+    int height;
+    int low;
+    int middle;
+    int high;
+    int firstBand;
+    struct landBand *bands;
+    int *failed;
+    int writeFailed;
+} landJob;
+
+
+/*
+ * The part of the output made by one band: the text of its rows for printLand(),
+ * or its matching elevation points for findElevations().
+ */
+typedef struct landBand
+{
+    landJob *job;
+    int firstRow;
+    char *text;
+    size_t length;
+    size_t capacity;
+} landBand;
+
+
+/*
+ * Returns the symbol printLand() uses for an elevation, given the sea, hill and
+ * mountain values stored as low, middle and high. The symbol only ever rises
+ * with the elevation, so a block shares one symbol if its minimum and maximum do.
+ */
+static char landSymbol(signed short elevation, landJob *job)
+{
+    if (elevation <= job->low)
+        return ' ';
+    else if (elevation <= job->middle)
+        return '.';
+    else if (elevation <= job->high)
+        return '^';
+    else
+        return 'A';
+}
+
+
+/*
+ * Fills the columns of a band covered by a pyramid node with one symbol if the
+ * whole node has it, so its elevations need not be read.
+ */
+static int skipUniformLand(signed short minimum, signed short maximum, int column, int columns, void *bandPointer)
+{
+    landBand *band = (landBand *) bandPointer;
+    landJob *job = band->job;
+    char symbol = landSymbol(minimum, job);
+
+    if (symbol != landSymbol(maximum, job))
+        return 0;
+
+    int row;
+    for (row = 0; row < PYRAMID_BLOCK_SIZE; row++)
+        memset(band->text + (size_t) row * (job->width + 1) + column, symbol, columns);
+
+    return 1;
+}
+
+
+/*
+ * Writes the symbols of a run of elevations read from a mixed block.
+ */
+static void printElevations(int row, int column, signed short *elevations, int count, void *bandPointer)
+{
+    landBand *band = (landBand *) bandPointer;
+    landJob *job = band->job;
+    char *text = band->text + (size_t) (row - band->firstRow) * (job->width + 1) + column;
+
+    int x;
+    for (x = 0; x < count; x++)
+        text[x] = landSymbol(elevations[x], job);
+}
+
+
+/*
+ * Prints one band of the land and writes it in place in the output file. A band
+ * that could not be printed is marked in failed, and one that could not be
+ * written sets writeFailed. Run by parallelFor() for each band index.
+ */
+static void printBand(int bandIndex, void *jobPointer)
+{
+    landJob *job = (landJob *) jobPointer;
+    size_t rowBytes = job->width + 1;
+
+    landBand band;
+    band.job = job;
+    band.firstRow = bandIndex * PYRAMID_BLOCK_SIZE;
+    band.text = (char *) malloc(rowBytes * PYRAMID_BLOCK_SIZE);
+
+    job->failed[bandIndex] = 1;
+    if (band.text == NULL)
+        return;
+
+    int rows = band.firstRow + PYRAMID_BLOCK_SIZE < job->height ? PYRAMID_BLOCK_SIZE : job->height - band.firstRow;
+
+    int row;
+    for (row = 0; row < rows; row++)
+        band.text[row * rowBytes + job->width] = '\n';
+
+    int failed = scanBand(job->pyramid, job->reader, bandIndex, skipUniformLand, printElevations, &band);
+
+    // Every row but the last is followed by a new line.
+    size_t bytes = rows * rowBytes - (band.firstRow + rows == job->height ? 1 : 0);
+    off_t offset = (off_t) band.firstRow * rowBytes;
+
+    if (failed == 0 && pwrite(fileno(job->outputFile), band.text, bytes, offset) != bytes)
+        __atomic_store_n(&job->writeFailed, 1, __ATOMIC_RELAXED);
+
+    job->failed[bandIndex] = failed;
+    free(band.text);
+}
+
+
+/*
+ * Opens the DEM at inputPath for scanning with its pyramid, and the output file.
+ * Can return an error.
+ */
+static void openLandJob(landJob *job, char *inputPath, int width, int height, char *outputPath)
+{
+    job->width = width;
+    job->height = height;
+    job->reader = NULL;
+    job->outputFile = NULL;
+    job->bands = NULL;
+    job->failed = NULL;
+    job->writeFailed = 0;
+
+    job->pyramid = loadPyramid(inputPath, width, height);
+    if (error != NULL)
+        return;
+
+    job->reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        return;
+
+    job->failed = (int *) malloc(sizeof(int) * getPyramidBands(job->pyramid));
+    error = checkAllocated(job->failed);
+    if (error != NULL)
+        return;
+
+    job->outputFile = fopen(outputPath, "w");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(job->outputFile, outputPath);
+}
+
+
+/*
+ * Closes everything opened by openLandJob(). Returns 1 if the output file could
+ * not be closed, which is when what was left of it failed to reach the disk, and
+ * 0 otherwise.
+ */
+static int closeLandJob(landJob *job)
+{
+    int failed = job->outputFile != NULL && fclose(job->outputFile) != 0;
+
+    freePyramid(job->pyramid);
+    closeDEMRows(job->reader);
+    free(job->bands);
+    free(job->failed);
+    return failed;
+}
+
+
+/*
+ * Prints the DEM raster data at inputPath to the file at outputPath using the
+ * following key:
+ * 
+ * ' ' (space): Sea (i.e. value <= sea)
+ * '.' (full stop): Low ground (sea < value <= hill)
+ * '^' (caret): Hills (hill < value <= mountain)
+ * 'A': Mountains (mountain < value)
+ *
+ * The DEM's min/max pyramid is loaded (or built), and blocks whose minimum and
+ * maximum share a symbol are printed without reading their elevations. Bands are
+ * printed on the pipeline's workers, several in flight at once, each written in
+ * place as soon as it is printed. Can return an error.
+ */
+void printLand(char *inputPath, int width, int height, char *outputPath, int sea, int hill, int mountain)
+{
+    error = NULL;
+
+    landJob job;
+    job.low = sea;
+    job.middle = hill;
+    job.high = mountain;
+
+    openLandJob(&job, inputPath, width, height, outputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    // Bands wait on their reads and writes, so they are run on the pipeline's workers.
+    int bands = getPyramidBands(job.pyramid);
+    runPipeline(bands, printBand, &job);
+
+    // Check that every band was read.
+    int band;
+    for (band = 0; band < bands; band++)
+    {
+        error = checkRowData(job.failed[band], inputPath);
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    goto cleanup;
+
+    cleanup:
+    job.writeFailed |= closeLandJob(&job);
+    if (error == NULL)
+        error = checkOutputWritten(job.writeFailed, outputPath);
+}
+
+
+/*
+ * A DEM held in memory being printed by printLandDEM(), and whether any of its
+ * bands could not be printed or written.
+ */
+typedef struct landDEMJob
+{
+    landJob *job;
+    signed short **raster;
+    int outputFile;
+    int failed;
+} landDEMJob;
+
+
+/*
+ * Prints a band of rows of a DEM held in memory and writes it in place in the
+ * output file. Run by parallelRows() for each band.
+ */
+static void printRows(int firstRow, int rows, void *printPointer)
+{
+    landDEMJob *print = (landDEMJob *) printPointer;
+    landJob *job = print->job;
+    size_t rowBytes = job->width + 1;
+
+    char *text = (char *) malloc(rowBytes * rows);
+    if (text == NULL)
+    {
+        __atomic_store_n(&print->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    int row;
+    int column;
+
+    for (row = 0; row < rows; row++)
+    {
+        char *rowText = text + row * rowBytes;
+
+        for (column = 0; column < job->width; column++)
+            rowText[column] = landSymbol(print->raster[firstRow + row][column], job);
+
+        rowText[job->width] = '\n';
+    }
+
+    // Every row but the last is followed by a new line.
+    size_t bytes = rows * rowBytes - (firstRow + rows == job->height ? 1 : 0);
+
+    if (pwrite(print->outputFile, text, bytes, (off_t) firstRow * rowBytes) != bytes)
+        __atomic_store_n(&print->failed, 1, __ATOMIC_RELAXED);
+
+    free(text);
+}
+
+
+/*
+ * Prints a DEM already held in memory to the file at outputPath with the same key
+ * as printLand(). The DEM is only read, so several threads may print it at once.
+ * Bands of rows are printed in parallel, each written in place. Can return an
+ * error.
+ */
+void printLandDEM(gtopoDEM *inputDEM, char *outputPath, int sea, int hill, int mountain)
+{
+    error = NULL;
+
+    landJob job;
+    job.low = sea;
+    job.middle = hill;
+    job.high = mountain;
+    job.width = getWidth(inputDEM);
+    job.height = getHeight(inputDEM);
+
+    FILE *outputFile = fopen(outputPath, "w");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        return;
+
+    landDEMJob print;
+    print.job = &job;
+    print.raster = getRaster(inputDEM);
+    print.outputFile = fileno(outputFile);
+    print.failed = 0;
+
+    parallelRows(job.height, job.width, printRows, &print);
+
+    print.failed |= fclose(outputFile) != 0;
+    error = checkOutputWritten(print.failed, outputPath);
+}
+
+
+/*
+ * Skips a pyramid node whose elevations all lie outside the query range.
+ */
+static int skipOutsideRange(signed short minimum, signed short maximum, int column, int columns, void *bandPointer)
+{
+    landBand *band = (landBand *) bandPointer;
+    return maximum < band->job->low || minimum > band->job->high;
+}
+
+
+/*
+ * Appends the elevation points of a run that lie within the query range to the
+ * matches of a band. A band whose matches cannot be stored is marked as failed by
+ * freeing its text.
+ */
+static void collectInRange(int row, int column, signed short *elevations, int count, void *bandPointer)
+{
+    landBand *band = (landBand *) bandPointer;
+    landJob *job = band->job;
+
+    int x;
+    for (x = 0; x < count && band->text != NULL; x++)
+    {
+        if (elevations[x] < job->low || elevations[x] > job->high)
+            continue;
+
+        if (band->length + MAX_MATCH_LENGTH > band->capacity)
+        {
+            band->capacity = 2 * band->capacity + MAX_MATCH_LENGTH;
+            char *text = (char *) realloc(band->text, band->capacity);
+
+            if (text == NULL)
+                free(band->text);
+
+            band->text = text;
+            if (text == NULL)
+                return;
+        }
+
+        band->length += sprintf(band->text + band->length, "%d %d %d\n", row, column + x, elevations[x]);
+    }
+}
+
+
+/*
+ * Finds the elevation points of one band within the query range. Run by
+ * parallelFor() for each band of the current round.
+ */
+static void queryBand(int index, void *jobPointer)
+{
+    landJob *job = (landJob *) jobPointer;
+    int bandIndex = job->firstBand + index;
+    landBand *band = &job->bands[index];
+
+    band->job = job;
+    band->firstRow = bandIndex * PYRAMID_BLOCK_SIZE;
+    band->length = 0;
+    band->capacity = MAX_MATCH_LENGTH;
+    band->text = (char *) malloc(band->capacity);
+
+    job->failed[bandIndex] = 1;
+    if (band->text == NULL)
+        return;
+
+    int failed = scanBand(job->pyramid, job->reader, bandIndex, skipOutsideRange, collectInRange, band);
+    job->failed[bandIndex] = failed || band->text == NULL;
+}
+
+
+/*
+ * Writes every elevation point of the DEM at inputPath from low to high inclusive
+ * to the file at outputPath, one "row column elevation" line each, in row order.
+ * Blocks whose minimum and maximum put them outside the range are skipped without
+ * reading their elevations, so a search for peaks reads only the blocks around
+ * them. Bands are searched in parallel, a round at a time. Can return an error.
+ */
+void findElevations(char *inputPath, int width, int height, char *outputPath, int low, int high)
+{
+    error = NULL;
+
+    int failed = 0;
+    landJob job;
+    job.low = low;
+    job.high = high;
+
+    openLandJob(&job, inputPath, width, height, outputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    job.bands = (landBand *) malloc(sizeof(landBand) * QUERY_ROUND_BANDS);
+    error = checkAllocated(job.bands);
+    if (error != NULL)
+        goto cleanup;
+
+    int bands = getPyramidBands(job.pyramid);
+
+    for (job.firstBand = 0; job.firstBand < bands; job.firstBand += QUERY_ROUND_BANDS)
+    {
+        int roundBands = bands - job.firstBand < QUERY_ROUND_BANDS ? bands - job.firstBand : QUERY_ROUND_BANDS;
+        parallelFor(roundBands, queryBand, &job);
+
+        // Write the matches of the round in band order.
+        int band;
+        for (band = 0; band < roundBands; band++)
+        {
+            if (error == NULL)
+                error = checkRowData(job.failed[job.firstBand + band], inputPath);
+
+            if (error == NULL)
+                failed |= fwrite(job.bands[band].text, 1, job.bands[band].length, job.outputFile) != job.bands[band].length;
+
+            free(job.bands[band].text);
+        }
+
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    goto cleanup;
+
+    cleanup:
+    // Check that every match reached the file, which closing it flushes.
+    failed |= closeLandJob(&job);
+    if (error == NULL)
+        error = checkOutputWritten(failed, outputPath);
+}
@@ -0,0 +1,5 @@
+#include "gtopoio.h"
+
+void printLand(char *inputPath, int width, int height, char *outputPath, int sea, int hill, int mountain);
+void findElevations(char *inputPath, int width, int height, char *outputPath, int low, int high);
+void printLandDEM(gtopoDEM *inputDEM, char *outputPath, int sea, int hill, int mountain);
@@ -4,3 +4,15 @@
 #define MIN_ELEVATION_VALUE -407
 #define MAX_ELEVATION_VALUE 8752
 #define NO_DATA -9999
+#define PACK_BLOCK_SIZE 256
+#define PACK_VERSION 1
+#define RAW 0
+#define BITPACKED 1
+#define BITPACK_VERSION 1
+#define CELL_SIZE 926.6
+#define INTEGRAL_VERSION 1
+#define PYRAMID_BLOCK_SIZE 16
+#define PYRAMID_VERSION 1
+#define GTOPO30_CELL_DEGREES (1.0 / 120)
+#define GTOPO30_ULX -179.99583333333334
+#define GTOPO30_ULY 89.99583333333334
@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "gtopomosaic.h"
+#include "gtoposhrink.h"
+
+#define MANIFEST_MAGIC "GTMF"
+#define MANIFEST_VERSION 1
+#define MANIFEST_EXTENSION ".manifest"
+
+// Bytes of an input read at a time while hashing it.
+#define HASH_BUFFER_SIZE (1 << 20)
+
+// Longest input path that a manifest records.
+#define MAX_MANIFEST_PATH 4096
+
+// 64-bit FNV-1a.
+#define HASH_OFFSET 0xcbf29ce484222325ULL
+#define HASH_PRIME 0x100000001b3ULL
+
+
+/*
+ * A sub-DEM of a mosaic, where it is placed, and what its file looked like:
+ * its size, modification time and a hash of its contents.
+ */
+typedef struct mosaicInput
+{
+    char *path;
+    int row;
+    int column;
+    int width;
+    int height;
+    long long size;
+    long long seconds;
+    long nanoseconds;
+    uint64_t hash;
+    int changed;
+} mosaicInput;
+
+
+/*
+ * A DEM assembled from sub-DEMs, and reduced by a factor (1 for gtopoAssemble),
+ * together with the manifest of the inputs it was last assembled from.
+ *
+ * The manifest is kept beside the output, at its path with ".manifest"
+ * appended. It is plain text:
+ *
+ * GTMF version width height factor inputs
+ * outputSize outputSeconds outputNanoseconds
+ * row column width height size seconds nanoseconds hash path (one line per input)
+ *
+ * The hash is 64-bit FNV-1a of the whole input file, in hexadecimal. An output
+ * whose size or modification time no longer matches its manifest was changed
+ * by something else, and is assembled again in full.
+ */
+struct mosaic
+{
+    char *outputPath;
+    char *manifestPath;
+    int width;
+    int height;
+    int factor;
+    int inputCount;
+    mosaicInput *inputs;
+};
+
+
+/*
+ * Removes an --incremental flag from anywhere in the arguments, so the program
+ * sees only its own. Returns 1 if one was given and 0 otherwise.
+ */
+int takeIncrementalFlag(int *argc, char **argv)
+{
+    int kept = 1;
+    int found = 0;
+    int x;
+
+    for (x = 1; x < *argc; x++)
+    {
+        if (strcmp(argv[x], "--incremental") == 0)
+            found = 1;
+        else
+            argv[kept++] = argv[x];
+    }
+
+    argv[kept] = NULL;
+    *argc = kept;
+    return found;
+}
+
+
+/*
+ * Creates a mosaic of inputCount sub-DEMs for the output, which is width x
+ * height before it is reduced by the factor. Returns NULL if it could not be
+ * allocated.
+ */
+gtopoMosaic* createMosaic(char *outputPath, int width, int height, int factor, int inputCount)
+{
+    gtopoMosaic *newMosaic = (gtopoMosaic *) calloc(1, sizeof(gtopoMosaic));
+    if (newMosaic == NULL)
+        return NULL;
+
+    newMosaic->outputPath = outputPath;
+    newMosaic->width = width;
+    newMosaic->height = height;
+    newMosaic->factor = factor;
+    newMosaic->inputCount = inputCount;
+    newMosaic->inputs = (mosaicInput *) calloc(inputCount, sizeof(mosaicInput));
+    newMosaic->manifestPath = (char *) malloc(strlen(outputPath) + strlen(MANIFEST_EXTENSION) + 1);
+
+    if (newMosaic->inputs == NULL || newMosaic->manifestPath == NULL)
+    {
+        freeMosaic(newMosaic);
+        return NULL;
+    }
+
+    sprintf(newMosaic->manifestPath, "%s%s", outputPath, MANIFEST_EXTENSION);
+    return newMosaic;
+}
+
+
+/*
+ * Records where a sub-DEM is placed in the mosaic, in the order they are added.
+ */
+void setMosaicInput(gtopoMosaic *targetMosaic, int input, char *path, int row, int column, int width, int height)
+{
+    mosaicInput *targetInput = &targetMosaic->inputs[input];
+
+    targetInput->path = path;
+    targetInput->row = row;
+    targetInput->column = column;
+    targetInput->width = width;
+    targetInput->height = height;
+}
+
+
+/*
+ * Hashes the whole of a file. Returns 1 if it could not be read and 0 otherwise.
+ */
+static int hashFile(char *path, uint64_t *hash)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *buffer = (unsigned char *) malloc(HASH_BUFFER_SIZE);
+
+    if (file == NULL || buffer == NULL)
+    {
+        if (file != NULL)
+            fclose(file);
+
+        free(buffer);
+        return 1;
+    }
+
+    *hash = HASH_OFFSET;
+    size_t count;
+
+    while ((count = fread(buffer, 1, HASH_BUFFER_SIZE, file)) > 0)
+    {
+        size_t x;
+        for (x = 0; x < count; x++)
+        {
+            *hash = (*hash ^ buffer[x]) * HASH_PRIME;
+        }
+    }
+
+    int failed = ferror(file) != 0;
+    fclose(file);
+    free(buffer);
+    return failed;
+}
+
+
+/*
+ * Reads the manifest of the last assembly into recorded, one entry per input.
+ * Returns 0 if it describes an output of the same size and factor, from the same
+ * number of inputs, that has not been changed since. Returns 1 otherwise,
+ * including when there is no manifest.
+ */
+static int readManifest(gtopoMosaic *targetMosaic, mosaicInput *recorded)
+{
+    FILE *manifestFile = fopen(targetMosaic->manifestPath, "r");
+    if (manifestFile == NULL)
+        return 1;
+
+    int version;
+    int width;
+    int height;
+    int factor;
+    int inputCount;
+    long long outputSize;
+    long long outputSeconds;
+    long outputNanoseconds;
+    struct stat outputStatus;
+
+    int stale = fscanf(manifestFile, MANIFEST_MAGIC " %d %d %d %d %d %lld %lld %ld", &version, &width, &height,
+        &factor, &inputCount, &outputSize, &outputSeconds, &outputNanoseconds) != 8 ||
+        version != MANIFEST_VERSION || width != targetMosaic->width || height != targetMosaic->height ||
+        factor != targetMosaic->factor || inputCount != targetMosaic->inputCount;
+
+    // The output must be exactly as the last assembly left it.
+    stale = stale || stat(targetMosaic->outputPath, &outputStatus) != 0 || outputStatus.st_size != outputSize ||
+        outputStatus.st_mtim.tv_sec != outputSeconds || outputStatus.st_mtim.tv_nsec != outputNanoseconds;
+
+    char path[MAX_MANIFEST_PATH];
+    int input;
+
+    for (input = 0; input < inputCount && stale == 0; input++)
+    {
+        mosaicInput *entry = &recorded[input];
+        unsigned long long hash;
+
+        stale = fscanf(manifestFile, " %d %d %d %d %lld %lld %ld %llx %4095[^\n]", &entry->row, &entry->column,
+            &entry->width, &entry->height, &entry->size, &entry->seconds, &entry->nanoseconds, &hash, path) != 9;
+
+        if (stale == 0)
+        {
+            entry->hash = hash;
+            entry->path = strdup(path);
+            stale = entry->path == NULL;
+        }
+    }
+
+    fclose(manifestFile);
+    return stale;
+}
+
+
+/*
+ * Finds which inputs have changed since the manifest was written. An input whose
+ * size and modification time are as recorded is taken to be unchanged. Any other
+ * is hashed, so an input that was only touched or copied over with the same
+ * contents is unchanged too. Returns 1 if the existing output can be patched
+ * where the changed inputs lie, and 0 if it has to be assembled in full, because
+ * there is no usable manifest or the layout of the inputs has changed. Can
+ * return an error.
+ */
+int planMosaicUpdate(gtopoMosaic *targetMosaic)
+{
+    error = NULL;
+
+    mosaicInput *recorded = (mosaicInput *) calloc(targetMosaic->inputCount, sizeof(mosaicInput));
+    error = checkAllocated(recorded);
+    if (error != NULL)
+        return 0;
+
+    int patchable = readManifest(targetMosaic, recorded) == 0;
+    int input;
+
+    for (input = 0; input < targetMosaic->inputCount && error == NULL; input++)
+    {
+        mosaicInput *current = &targetMosaic->inputs[input];
+        mosaicInput *last = &recorded[input];
+        struct stat inputStatus;
+
+        error = checkRowData(stat(current->path, &inputStatus) != 0, current->path);
+        if (error != NULL)
+            break;
+
+        current->size = inputStatus.st_size;
+        current->seconds = inputStatus.st_mtim.tv_sec;
+        current->nanoseconds = inputStatus.st_mtim.tv_nsec;
+
+        int sameFile = patchable && strcmp(current->path, last->path) == 0;
+        int samePlace = sameFile && current->row == last->row && current->column == last->column &&
+            current->width == last->width && current->height == last->height;
+
+        // A sub-DEM that moved, or lies partly outside the mosaic, needs it assembled in full.
+        patchable = samePlace && current->row >= 0 && current->column >= 0 &&
+            current->row + current->height <= targetMosaic->height &&
+            current->column + current->width <= targetMosaic->width;
+
+        if (sameFile && current->size == last->size && current->seconds == last->seconds &&
+            current->nanoseconds == last->nanoseconds)
+        {
+            current->hash = last->hash;
+            current->changed = 0;
+            continue;
+        }
+
+        error = checkRowData(hashFile(current->path, &current->hash), current->path);
+        current->changed = !sameFile || current->hash != last->hash;
+    }
+
+    for (input = 0; input < targetMosaic->inputCount; input++)
+    {
+        free(recorded[input].path);
+    }
+
+    free(recorded);
+    return error == NULL && patchable;
+}
+
+
+/*
+ * Returns the number of inputs found to have changed by planMosaicUpdate().
+ */
+int countChangedInputs(gtopoMosaic *targetMosaic)
+{
+    int changed = 0;
+    int input;
+
+    for (input = 0; input < targetMosaic->inputCount; input++)
+    {
+        changed += targetMosaic->inputs[input].changed;
+    }
+
+    return changed;
+}
+
+
+/*
+ * Copies the part of an input that falls in a window of the mosaic into the
+ * window, reading only the spans of its rows that do where the input allows it.
+ * Can return an error.
+ */
+static void readInputWindow(mosaicInput *input, gtopoDEM *window, int top, int left)
+{
+    error = NULL;
+
+    int firstRow = input->row > top ? input->row : top;
+    int endRow = input->row + input->height < top + getHeight(window) ?
+        input->row + input->height : top + getHeight(window);
+    int firstColumn = input->column > left ? input->column : left;
+    int endColumn = input->column + input->width < left + getWidth(window) ?
+        input->column + input->width : left + getWidth(window);
+
+    // The input does not overlap the window.
+    if (firstRow >= endRow || firstColumn >= endColumn)
+        return;
+
+    signed short **raster = getRaster(window);
+    int row;
+
+    if (!canStreamDEM(input->path))
+    {
+        gtopoDEM *inputDEM = readDEM(input->path, input->width, input->height);
+        if (error != NULL)
+            return;
+
+        for (row = firstRow; row < endRow; row++)
+        {
+            memcpy(raster[row - top] + firstColumn - left,
+                getRaster(inputDEM)[row - input->row] + firstColumn - input->column,
+                sizeof(signed short) * (endColumn - firstColumn));
+        }
+
+        freeDEM(inputDEM);
+        return;
+    }
+
+    gtopoRowReader *reader = openDEMRows(input->path, input->width, input->height);
+    if (error != NULL)
+        return;
+
+    int failed = 0;
+    for (row = firstRow; row < endRow && failed == 0; row++)
+    {
+        failed = readDEMSpan(reader, row - input->row, firstColumn - input->column, endColumn - firstColumn,
+            raster[row - top] + firstColumn - left);
+    }
+
+    closeDEMRows(reader);
+    error = checkRowData(failed, input->path);
+}
+
+
+/*
+ * Assembles one window of the mosaic from every input that overlaps it, in the
+ * order they were given so that later inputs cover earlier ones, and writes it
+ * reduced into place in the output. The window starts and ends on multiples of
+ * the factor, so it reduces to exactly the output points it covers. Can return
+ * an error.
+ */
+static void patchWindow(gtopoMosaic *targetMosaic, int output, int top, int left, int width, int height)
+{
+    error = NULL;
+
+    // Points that no input covers have no data, as they do when assembling in full.
+    gtopoDEM *window = createDEM(width, height);
+    error = checkDEMallocated(window);
+    if (error != NULL)
+        return;
+
+    int input;
+    for (input = 0; input < targetMosaic->inputCount && error == NULL; input++)
+    {
+        readInputWindow(&targetMosaic->inputs[input], window, top, left);
+    }
+
+    if (error == NULL && targetMosaic->factor > 1)
+    {
+        gtopoDEM *reduced = reduce(window, targetMosaic->factor);
+        freeDEM(window);
+        window = reduced;
+        error = checkDEMallocated(window);
+    }
+
+    if (error != NULL)
+    {
+        freeDEM(window);
+        return;
+    }
+
+    int factor = targetMosaic->factor;
+    int outputWidth = (targetMosaic->width + factor - 1) / factor;
+    int rowPoints = getWidth(window);
+    unsigned char *bytes = (unsigned char *) malloc(sizeof(signed short) * rowPoints);
+
+    error = checkAllocated(bytes);
+    if (error != NULL)
+    {
+        freeDEM(window);
+        return;
+    }
+
+    int failed = 0;
+    int row;
+    int column;
+
+    for (row = 0; row < getHeight(window) && failed == 0; row++)
+    {
+        signed short *elevations = getRaster(window)[row];
+
+        for (column = 0; column < rowPoints; column++)
+        {
+            bytes[2 * column] = (elevations[column] >> 8) & 0xFF;
+            bytes[2 * column + 1] = elevations[column] & 0xFF;
+        }
+
+        off_t offset = ((off_t) (top / factor + row) * outputWidth + left / factor) * sizeof(signed short);
+        size_t rowBytes = sizeof(signed short) * rowPoints;
+        failed = pwrite(output, bytes, rowBytes, offset) != rowBytes;
+    }
+
+    free(bytes);
+    freeDEM(window);
+    error = checkRowData(failed, targetMosaic->outputPath);
+}
+
+
+/*
+ * Patches the existing output in place where the changed inputs lie, writing
+ * only the rows of the output that those rectangles touch, so that changing one
+ * sub-DEM does not cost assembling them all again. Only called when
+ * planMosaicUpdate() found the output could be patched. Can return an error.
+ */
+void patchMosaic(gtopoMosaic *targetMosaic)
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(targetMosaic->outputPath, "r+b");
+    error = checkInvalidFileName(outputFile, targetMosaic->outputPath);
+    if (error != NULL)
+        return;
+
+    int factor = targetMosaic->factor;
+    int input;
+
+    for (input = 0; input < targetMosaic->inputCount && error == NULL; input++)
+    {
+        mosaicInput *changed = &targetMosaic->inputs[input];
+        if (!changed->changed)
+            continue;
+
+        // Widen the rectangle to whole blocks of the factor.
+        int top = changed->row / factor * factor;
+        int left = changed->column / factor * factor;
+        int bottom = (changed->row + changed->height + factor - 1) / factor * factor;
+        int right = (changed->column + changed->width + factor - 1) / factor * factor;
+
+        bottom = bottom < targetMosaic->height ? bottom : targetMosaic->height;
+        right = right < targetMosaic->width ? right : targetMosaic->width;
+
+        patchWindow(targetMosaic, fileno(outputFile), top, left, right - left, bottom - top);
+    }
+
+    fclose(outputFile);
+}
+
+
+/*
+ * Writes the manifest of the inputs the output was just assembled from,
+ * under a temporary name first so that it is never seen partly written. Failing
+ * to write it is not an error, as the next assembly is then just done in full.
+ * Any stale manifest is removed first, so it can never outlive the output.
+ */
+void saveManifest(gtopoMosaic *targetMosaic)
+{
+    remove(targetMosaic->manifestPath);
+
+    struct stat outputStatus;
+    if (stat(targetMosaic->outputPath, &outputStatus) != 0)
+        return;
+
+    char *temporaryPath = (char *) malloc(strlen(targetMosaic->manifestPath) + 5);
+    if (temporaryPath == NULL)
+        return;
+
+    sprintf(temporaryPath, "%s.tmp", targetMosaic->manifestPath);
+    FILE *manifestFile = fopen(temporaryPath, "w");
+
+    if (manifestFile == NULL)
+    {
+        free(temporaryPath);
+        return;
+    }
+
+    fprintf(manifestFile, "%s %d %d %d %d %d\n", MANIFEST_MAGIC, MANIFEST_VERSION, targetMosaic->width,
+        targetMosaic->height, targetMosaic->factor, targetMosaic->inputCount);
+    fprintf(manifestFile, "%lld %lld %ld\n", (long long) outputStatus.st_size,
+        (long long) outputStatus.st_mtim.tv_sec, (long) outputStatus.st_mtim.tv_nsec);
+
+    int input;
+    for (input = 0; input < targetMosaic->inputCount; input++)
+    {
+        mosaicInput *entry = &targetMosaic->inputs[input];
+
+        fprintf(manifestFile, "%d %d %d %d %lld %lld %ld %016llx %s\n", entry->row, entry->column, entry->width,
+            entry->height, entry->size, entry->seconds, entry->nanoseconds, (unsigned long long) entry->hash,
+            entry->path);
+    }
+
+    int failed = fclose(manifestFile) != 0;
+
+    if (failed || rename(temporaryPath, targetMosaic->manifestPath) != 0)
+        remove(temporaryPath);
+
+    free(temporaryPath);
+}
+
+
+void freeMosaic(gtopoMosaic *targetMosaic)
+{
+    if (targetMosaic == NULL)
+        return;
+
+    free(targetMosaic->inputs);
+    free(targetMosaic->manifestPath);
+    free(targetMosaic);
+}
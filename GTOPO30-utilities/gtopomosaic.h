@@ -0,0 +1,12 @@
+#include "gtopoio.h"
+
+typedef struct mosaic gtopoMosaic;
+
+int takeIncrementalFlag(int *argc, char **argv);
+gtopoMosaic* createMosaic(char *outputPath, int width, int height, int factor, int inputCount);
+void setMosaicInput(gtopoMosaic *targetMosaic, int input, char *path, int row, int column, int width, int height);
+int planMosaicUpdate(gtopoMosaic *targetMosaic);
+int countChangedInputs(gtopoMosaic *targetMosaic);
+void patchMosaic(gtopoMosaic *targetMosaic);
+void saveManifest(gtopoMosaic *targetMosaic);
+void freeMosaic(gtopoMosaic *targetMosaic);
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "gtopopipeline.h"
+#include "gtopothreads.h"
+
+// Elevation points read, processed and written as one chunk, rounded to whole rows.
+#define PIPELINE_CHUNK_POINTS (1 << 20)
+
+/*
+ * Chunks kept in flight at once by default, however few processors there are, so
+ * that while one chunk waits on its read or write the others are being processed.
+ */
+#define PIPELINE_DEPTH 4
+
+
+/*
+ * A DEM streamed in chunks of whole rows from firstRow up to endRow. Each chunk
+ * is read, converted from big-endian, validated, processed and written on one
+ * worker, so the chunks of the workers overlap their reads, processing and
+ * writes.
+ */
+typedef struct pipelineJob
+{
+    gtopoRowReader *reader;
+    int width;
+    int firstRow;
+    int endRow;
+    int chunkRows;
+    int (*process)(int firstRow, int rows, signed short *elevations, void *arg);
+    void *arg;
+    int *failed;
+} pipelineJob;
+
+
+/*
+ * Returns the number of worker threads a pipeline runs on: as many as the user
+ * asked for with -j or GTOPO_THREADS, or else one per processor but never fewer
+ * than the chunks it keeps in flight.
+ */
+int getPipelineThreads()
+{
+    int requested = getRequestedThreads();
+    if (requested > 0)
+        return requested;
+
+    int threads = getThreadCount();
+    return threads > PIPELINE_DEPTH ? threads : PIPELINE_DEPTH;
+}
+
+
+/*
+ * Runs task(index, arg) for every index from 0 up to count - 1 on the pipeline's
+ * workers. Tasks that block on reads and writes should be run this way rather
+ * than with parallelFor(), so that several are in flight on any machine.
+ */
+void runPipeline(int count, void (*task)(int index, void *arg), void *arg)
+{
+    parallelForThreads(count, getPipelineThreads(), task, arg);
+}
+
+
+/*
+ * Returns the number of rows of a DEM of the given width read as one chunk.
+ */
+int getChunkRows(int width)
+{
+    int rows = PIPELINE_CHUNK_POINTS / (width > 0 ? width : 1);
+    return rows > 1 ? rows : 1;
+}
+
+
+/*
+ * Reads one chunk of rows and hands them to the job's process function. Run by
+ * runPipeline() for each chunk index.
+ */
+static void streamChunk(int chunk, void *jobPointer)
+{
+    pipelineJob *job = (pipelineJob *) jobPointer;
+    int firstRow = job->firstRow + chunk * job->chunkRows;
+    int rows = job->endRow - firstRow < job->chunkRows ? job->endRow - firstRow : job->chunkRows;
+
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * rows * job->width);
+    job->failed[chunk] = 1;
+
+    if (elevations == NULL)
+        return;
+
+    int failed = readDEMRows(job->reader, firstRow, rows, elevations);
+    if (failed == 0)
+        failed = job->process(firstRow, rows, elevations, job->arg);
+
+    job->failed[chunk] = failed;
+    free(elevations);
+}
+
+
+/*
+ * Streams the rows of a DEM from firstRow up to endRow through
+ * process(firstRow, rows, elevations, arg) in chunks of chunkRows rows, which
+ * arrive converted from big-endian and validated, in any order and several at
+ * once. Process returns 0 once it has written what it made of the chunk and 1
+ * if it failed. Returns 0 if every chunk was read and processed and 1 otherwise.
+ */
+int streamDEMRows(gtopoRowReader *reader, int width, int firstRow, int endRow, int chunkRows,
+    int (*process)(int firstRow, int rows, signed short *elevations, void *arg), void *arg)
+{
+    pipelineJob job;
+    job.reader = reader;
+    job.width = width;
+    job.firstRow = firstRow;
+    job.endRow = endRow;
+    job.chunkRows = chunkRows;
+    job.process = process;
+    job.arg = arg;
+
+    int chunks = endRow > firstRow ? (endRow - firstRow + chunkRows - 1) / chunkRows : 0;
+    job.failed = (int *) malloc(sizeof(int) * (chunks > 0 ? chunks : 1));
+
+    if (job.failed == NULL)
+        return 1;
+
+    runPipeline(chunks, streamChunk, &job);
+
+    int failed = 0;
+    int chunk;
+    for (chunk = 0; chunk < chunks; chunk++)
+        failed |= job.failed[chunk];
+
+    free(job.failed);
+    return failed;
+}
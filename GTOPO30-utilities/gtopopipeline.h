@@ -0,0 +1,7 @@
+#include "gtopoio.h"
+
+int getPipelineThreads();
+void runPipeline(int count, void (*task)(int index, void *arg), void *arg);
+int getChunkRows(int width);
+int streamDEMRows(gtopoRowReader *reader, int width, int firstRow, int endRow, int chunkRows,
+    int (*process)(int firstRow, int rows, signed short *elevations, void *arg), void *arg);
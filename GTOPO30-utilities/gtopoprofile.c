@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "gtopoprofile.h"
+#include "gtopocpu.h"
+
+#define PHASE_COUNT 5
+
+#define PROFILE_OFF 0
+#define PROFILE_TEXT 1
+#define PROFILE_JSON 2
+
+static const char *phaseNames[PHASE_COUNT] = {"args", "read", "compute", "write", "free"};
+
+
+/*
+ * The state of the profile of the running program. Time is charged to the
+ * current phase until the program moves to the next one, so a phase that is
+ * entered more than once (such as reading each input of an assembly) adds up.
+ * The I/O counters are those of the whole process, so their values at the
+ * start are kept to be subtracted.
+ */
+typedef struct profile
+{
+    int mode;
+    const char *program;
+    int phase;
+    double phaseStart;
+    double seconds[PHASE_COUNT];
+    long long startRead;
+    long long startWritten;
+} profile;
+
+static profile programProfile;
+
+// Number of blocks allocated for DEMs and arenas while profiling, by every thread.
+static unsigned long allocations = 0;
+
+
+/*
+ * Returns the time in seconds from a monotonic clock.
+ */
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+
+/*
+ * Reads the bytes the process has passed to read and write calls (including
+ * pread and pwrite) from /proc/self/io. Both are 0 where that is not available.
+ * Memory-mapped files are not counted.
+ */
+static void readIOCounters(long long *bytesRead, long long *bytesWritten)
+{
+    *bytesRead = 0;
+    *bytesWritten = 0;
+
+    FILE *counters = fopen("/proc/self/io", "r");
+    if (counters == NULL)
+        return;
+
+    char name[32];
+    long long value;
+
+    while (fscanf(counters, "%31[^:]: %lld ", name, &value) == 2)
+    {
+        if (strcmp(name, "rchar") == 0)
+            *bytesRead = value;
+        else if (strcmp(name, "wchar") == 0)
+            *bytesWritten = value;
+    }
+
+    fclose(counters);
+}
+
+
+/*
+ * Prints the profile to stderr when the program exits, as lines of text or as a
+ * single JSON object.
+ */
+static void reportProfile()
+{
+    profilePhase(programProfile.phase);
+
+    long long bytesRead;
+    long long bytesWritten;
+    readIOCounters(&bytesRead, &bytesWritten);
+    bytesRead -= programProfile.startRead;
+    bytesWritten -= programProfile.startWritten;
+
+    unsigned long allocated = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    double total = 0;
+    int phase;
+
+    if (programProfile.mode == PROFILE_JSON)
+    {
+        fprintf(stderr, "{\"program\":\"%s\",\"seconds\":{", programProfile.program);
+
+        for (phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            fprintf(stderr, "\"%s\":%.6f,", phaseNames[phase], programProfile.seconds[phase]);
+            total += programProfile.seconds[phase];
+        }
+
+        fprintf(stderr, "\"total\":%.6f},\"bytes_read\":%lld,\"bytes_written\":%lld,\"allocations\":%lu,\"peak_rss_kb\":%ld}\n",
+            total, bytesRead, bytesWritten, allocated, usage.ru_maxrss);
+    }
+    else
+    {
+        fprintf(stderr, "PROFILE %s\n", programProfile.program);
+
+        for (phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            fprintf(stderr, "%-13s %.6f s\n", phaseNames[phase], programProfile.seconds[phase]);
+            total += programProfile.seconds[phase];
+        }
+
+        fprintf(stderr, "%-13s %.6f s\n", "total", total);
+        fprintf(stderr, "%-13s %lld\n", "bytes read", bytesRead);
+        fprintf(stderr, "%-13s %lld\n", "bytes written", bytesWritten);
+        fprintf(stderr, "%-13s %lu\n", "allocations", allocated);
+        fprintf(stderr, "%-13s %ld KB\n", "peak RSS", usage.ru_maxrss);
+        fprintf(stderr, "%-13s %s\n", "simd", getSimdName(getSimdLevel()));
+    }
+}
+
+
+/*
+ * Removes a --profile or --profile=json flag from anywhere in the arguments, so
+ * the program sees only its own. If one was given, timing starts in the
+ * argument parsing phase and the profile is printed to stderr when the program
+ * exits. Called first thing in main.
+ */
+void startProfile(int *argc, char **argv)
+{
+    int kept = 1;
+    int x;
+
+    for (x = 1; x < *argc; x++)
+    {
+        if (strcmp(argv[x], "--profile") == 0)
+            programProfile.mode = PROFILE_TEXT;
+        else if (strcmp(argv[x], "--profile=json") == 0)
+            programProfile.mode = PROFILE_JSON;
+        else
+            argv[kept++] = argv[x];
+    }
+
+    argv[kept] = NULL;
+    *argc = kept;
+
+    if (programProfile.mode == PROFILE_OFF)
+        return;
+
+    char *name = strrchr(argv[0], '/');
+    programProfile.program = name != NULL ? name + 1 : argv[0];
+    programProfile.phase = PHASE_ARGS;
+    readIOCounters(&programProfile.startRead, &programProfile.startWritten);
+    programProfile.phaseStart = now();
+
+    atexit(reportProfile);
+}
+
+
+/*
+ * Charges the time since the last change of phase to the current phase, then
+ * moves to the given one. Does nothing unless profiling.
+ */
+void profilePhase(int phase)
+{
+    if (programProfile.mode == PROFILE_OFF)
+        return;
+
+    double time = now();
+    programProfile.seconds[programProfile.phase] += time - programProfile.phaseStart;
+    programProfile.phase = phase;
+    programProfile.phaseStart = time;
+}
+
+
+/*
+ * Counts a block allocated for DEM or an arena. Does nothing unless
+ * profiling, so programs run without --profile pay only this check; the C
+ * library's own allocation functions are left as they are.
+ */
+void countAllocation()
+{
+    if (programProfile.mode != PROFILE_OFF)
+        __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+}
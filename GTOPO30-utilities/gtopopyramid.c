@@ -0,0 +1,497 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "gtopopyramid.h"
+#include "gtopocodec.h"
+#include "gtopothreads.h"
+
+#define PYRAMID_MAGIC "GTMM"
+#define PYRAMID_HEADER_SIZE 40
+#define PYRAMID_EXTENSION ".pyr"
+
+// Enough levels to halve the blocks of the largest DEM down to one.
+#define MAX_LEVELS 32
+
+
+/*
+ * Min/max pyramid over a DEM. Level 0 holds the smallest and largest elevation of
+ * each PYRAMID_BLOCK_SIZE square block, counting NO_DATA as the value -9999, and
+ * each higher level covers 2x2 nodes of the level below, up to a single node over
+ * the whole DEM. The nodes of every level are stored row by row, one level after
+ * another.
+ *
+ * The pyramid is persisted next to the DEM, at its path with ".pyr" appended. All
+ * integers are stored in big-endian, like the elevation points of a raw DEM:
+ *
+ * Header: The magic "GTMM" and the format version, width, height and block size,
+ * each 4 bytes, followed by the size of the DEM file and its modification time in
+ * seconds (8 bytes each) and nanoseconds (4 bytes).
+ *
+ * Nodes: The minimum then maximum of each node, 2 bytes each.
+ *
+ * A pyramid whose header does not match the DEM is stale, and is rebuilt.
+ */
+struct minMaxPyramid
+{
+    int width;
+    int height;
+    int levels;
+    int levelWidth[MAX_LEVELS];
+    int levelHeight[MAX_LEVELS];
+    long levelOffset[MAX_LEVELS + 1];
+    signed short *minimum;
+    signed short *maximum;
+};
+
+
+/*
+ * Shared state for building level 0 of a pyramid, one row of blocks per task.
+ */
+typedef struct pyramidJob
+{
+    gtopoPyramid *pyramid;
+    gtopoRowReader *reader;
+    int *failed;
+} pyramidJob;
+
+
+/*
+ * Computes the dimensions of every level and allocates the nodes.
+ */
+static gtopoPyramid* createPyramid(int width, int height)
+{
+    gtopoPyramid *pyramid = (gtopoPyramid *) malloc(sizeof(gtopoPyramid));
+    if (pyramid == NULL)
+        return NULL;
+
+    pyramid->width = width;
+    pyramid->height = height;
+    pyramid->levelWidth[0] = (width + PYRAMID_BLOCK_SIZE - 1) / PYRAMID_BLOCK_SIZE;
+    pyramid->levelHeight[0] = (height + PYRAMID_BLOCK_SIZE - 1) / PYRAMID_BLOCK_SIZE;
+    pyramid->levelOffset[0] = 0;
+    pyramid->levels = 1;
+
+    while (pyramid->levelWidth[pyramid->levels - 1] > 1 || pyramid->levelHeight[pyramid->levels - 1] > 1)
+    {
+        int level = pyramid->levels++;
+        pyramid->levelWidth[level] = (pyramid->levelWidth[level - 1] + 1) / 2;
+        pyramid->levelHeight[level] = (pyramid->levelHeight[level - 1] + 1) / 2;
+    }
+
+    int level;
+    for (level = 0; level < pyramid->levels; level++)
+    {
+        long nodes = (long) pyramid->levelWidth[level] * pyramid->levelHeight[level];
+        pyramid->levelOffset[level + 1] = pyramid->levelOffset[level] + nodes;
+    }
+
+    long nodes = pyramid->levelOffset[pyramid->levels];
+    pyramid->minimum = (signed short *) malloc(sizeof(signed short) * nodes);
+    pyramid->maximum = (signed short *) malloc(sizeof(signed short) * nodes);
+
+    if (pyramid->minimum == NULL || pyramid->maximum == NULL)
+    {
+        freePyramid(pyramid);
+        return NULL;
+    }
+
+    return pyramid;
+}
+
+
+/*
+ * Computes level 0 for one row of blocks. Run by parallelFor() for each block row.
+ */
+static void buildBlockRow(int blockRow, void *jobPointer)
+{
+    pyramidJob *job = (pyramidJob *) jobPointer;
+    gtopoPyramid *pyramid = job->pyramid;
+    int width = pyramid->width;
+
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * width);
+
+    job->failed[blockRow] = 1;
+    if (elevations == NULL)
+        return;
+
+    signed short *minimum = pyramid->minimum + (long) blockRow * pyramid->levelWidth[0];
+    signed short *maximum = pyramid->maximum + (long) blockRow * pyramid->levelWidth[0];
+
+    int block;
+    for (block = 0; block < pyramid->levelWidth[0]; block++)
+    {
+        minimum[block] = SHRT_MAX;
+        maximum[block] = SHRT_MIN;
+    }
+
+    int firstRow = blockRow * PYRAMID_BLOCK_SIZE;
+    int lastRow = firstRow + PYRAMID_BLOCK_SIZE < pyramid->height ? firstRow + PYRAMID_BLOCK_SIZE : pyramid->height;
+    int failed = 0;
+
+    int row;
+    int column;
+    for (row = firstRow; row < lastRow && failed == 0; row++)
+    {
+        failed |= readDEMRow(job->reader, row, elevations);
+
+        for (column = 0; column < width; column++)
+        {
+            block = column / PYRAMID_BLOCK_SIZE;
+
+            if (elevations[column] < minimum[block])
+                minimum[block] = elevations[column];
+
+            if (elevations[column] > maximum[block])
+                maximum[block] = elevations[column];
+        }
+    }
+
+    job->failed[blockRow] = failed;
+    free(elevations);
+}
+
+
+/*
+ * Builds every level above level 0 from the 2x2 nodes below it.
+ */
+static void buildLevels(gtopoPyramid *pyramid)
+{
+    int level;
+    int row;
+    int column;
+    for (level = 1; level < pyramid->levels; level++)
+    {
+        int belowWidth = pyramid->levelWidth[level - 1];
+        int belowHeight = pyramid->levelHeight[level - 1];
+        signed short *belowMinimum = pyramid->minimum + pyramid->levelOffset[level - 1];
+        signed short *belowMaximum = pyramid->maximum + pyramid->levelOffset[level - 1];
+
+        for (row = 0; row < pyramid->levelHeight[level]; row++)
+        {
+            for (column = 0; column < pyramid->levelWidth[level]; column++)
+            {
+                long node = pyramid->levelOffset[level] + (long) row * pyramid->levelWidth[level] + column;
+                signed short minimum = SHRT_MAX;
+                signed short maximum = SHRT_MIN;
+
+                int childRow;
+                int childColumn;
+                for (childRow = 2 * row; childRow < 2 * row + 2 && childRow < belowHeight; childRow++)
+                {
+                    for (childColumn = 2 * column; childColumn < 2 * column + 2 && childColumn < belowWidth; childColumn++)
+                    {
+                        long child = (long) childRow * belowWidth + childColumn;
+
+                        if (belowMinimum[child] < minimum)
+                            minimum = belowMinimum[child];
+
+                        if (belowMaximum[child] > maximum)
+                            maximum = belowMaximum[child];
+                    }
+                }
+
+                pyramid->minimum[node] = minimum;
+                pyramid->maximum[node] = maximum;
+            }
+        }
+    }
+}
+
+
+/*
+ * Fills in the header identifying the DEM a pyramid was built from.
+ */
+static void putPyramidHeader(unsigned char *header, gtopoPyramid *pyramid, struct stat *demStatus)
+{
+    memcpy(header, PYRAMID_MAGIC, 4);
+    putUint32(header + 4, PYRAMID_VERSION);
+    putUint32(header + 8, pyramid->width);
+    putUint32(header + 12, pyramid->height);
+    putUint32(header + 16, PYRAMID_BLOCK_SIZE);
+    putUint64(header + 20, demStatus->st_size);
+    putUint64(header + 28, demStatus->st_mtim.tv_sec);
+    putUint32(header + 36, demStatus->st_mtim.tv_nsec);
+}
+
+
+/*
+ * Reads the persisted nodes of a pyramid. Returns 1 if the file is missing, does
+ * not match the header expected for the DEM, or is incomplete.
+ */
+static int readPyramidFile(gtopoPyramid *pyramid, char *pyramidPath, unsigned char *expectedHeader)
+{
+    FILE *pyramidFile = fopen(pyramidPath, "rb");
+    if (pyramidFile == NULL)
+        return 1;
+
+    long nodes = pyramid->levelOffset[pyramid->levels];
+    unsigned char header[PYRAMID_HEADER_SIZE];
+    unsigned char *bytes = (unsigned char *) malloc(4 * nodes);
+
+    int stale = bytes == NULL ||
+        fread(header, 1, PYRAMID_HEADER_SIZE, pyramidFile) != PYRAMID_HEADER_SIZE ||
+        memcmp(header, expectedHeader, PYRAMID_HEADER_SIZE) != 0 ||
+        fread(bytes, 4, nodes, pyramidFile) != nodes || fgetc(pyramidFile) != EOF;
+
+    long node;
+    for (node = 0; node < nodes && stale == 0; node++)
+    {
+        pyramid->minimum[node] = (signed short) ((bytes[4 * node] << 8) | bytes[4 * node + 1]);
+        pyramid->maximum[node] = (signed short) ((bytes[4 * node + 2] << 8) | bytes[4 * node + 3]);
+    }
+
+    free(bytes);
+    fclose(pyramidFile);
+    return stale;
+}
+
+
+/*
+ * Persists a pyramid, writing it under a temporary name first so that readers
+ * never see a partly written file. Failing to persist it is not an error, as the
+ * pyramid can always be rebuilt.
+ */
+static void writePyramidFile(gtopoPyramid *pyramid, char *pyramidPath, unsigned char *header)
+{
+    long nodes = pyramid->levelOffset[pyramid->levels];
+    char *temporaryPath = (char *) malloc(strlen(pyramidPath) + 5);
+    unsigned char *bytes = (unsigned char *) malloc(4 * nodes);
+    FILE *pyramidFile = NULL;
+
+    if (temporaryPath == NULL || bytes == NULL)
+        goto cleanup;
+
+    sprintf(temporaryPath, "%s.tmp", pyramidPath);
+    pyramidFile = fopen(temporaryPath, "wb");
+    if (pyramidFile == NULL)
+        goto cleanup;
+
+    long node;
+    for (node = 0; node < nodes; node++)
+    {
+        bytes[4 * node] = (pyramid->minimum[node] >> 8) & 0xFF;
+        bytes[4 * node + 1] = pyramid->minimum[node] & 0xFF;
+        bytes[4 * node + 2] = (pyramid->maximum[node] >> 8) & 0xFF;
+        bytes[4 * node + 3] = pyramid->maximum[node] & 0xFF;
+    }
+
+    int failed = fwrite(header, 1, PYRAMID_HEADER_SIZE, pyramidFile) != PYRAMID_HEADER_SIZE;
+    failed |= fwrite(bytes, 4, nodes, pyramidFile) != nodes;
+    failed |= fclose(pyramidFile) != 0;
+    pyramidFile = NULL;
+
+    if (failed || rename(temporaryPath, pyramidPath) != 0)
+        remove(temporaryPath);
+
+    goto cleanup;
+
+    cleanup:
+    if (pyramidFile != NULL)
+        fclose(pyramidFile);
+
+    free(temporaryPath);
+    free(bytes);
+}
+
+
+/*
+ * Returns the min/max pyramid of the DEM at inputPath, reading it from beside the
+ * DEM if it is there and up to date, and otherwise building it in parallel from
+ * the DEM and persisting it for next time. Can return an error.
+ */
+gtopoPyramid* loadPyramid(char *inputPath, int width, int height)
+{
+    error = NULL;
+
+    gtopoPyramid *pyramid = NULL;
+    char *pyramidPath = NULL;
+    int *failed = NULL;
+
+    gtopoRowReader *reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    struct stat demStatus;
+    error = checkRowData(stat(inputPath, &demStatus) != 0, inputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    pyramid = createPyramid(width, height);
+    pyramidPath = (char *) malloc(strlen(inputPath) + strlen(PYRAMID_EXTENSION) + 1);
+
+    error = checkAllocated(pyramid);
+    if (error == NULL)
+        error = checkAllocated(pyramidPath);
+    if (error != NULL)
+        goto cleanup;
+
+    sprintf(pyramidPath, "%s%s", inputPath, PYRAMID_EXTENSION);
+
+    unsigned char header[PYRAMID_HEADER_SIZE];
+    putPyramidHeader(header, pyramid, &demStatus);
+
+    if (readPyramidFile(pyramid, pyramidPath, header) == 0)
+        goto cleanup;
+
+    // The pyramid is missing or stale. Rebuild it from the DEM.
+    int blockRows = pyramid->levelHeight[0];
+    failed = (int *) malloc(sizeof(int) * blockRows);
+    error = checkAllocated(failed);
+    if (error != NULL)
+        goto cleanup;
+
+    pyramidJob job;
+    job.pyramid = pyramid;
+    job.reader = reader;
+    job.failed = failed;
+
+    parallelFor(blockRows, buildBlockRow, &job);
+
+    int blockRow;
+    for (blockRow = 0; blockRow < blockRows; blockRow++)
+    {
+        error = checkRowData(failed[blockRow], inputPath);
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    buildLevels(pyramid);
+    writePyramidFile(pyramid, pyramidPath, header);
+
+    goto cleanup;
+
+    cleanup:
+    if (error != NULL)
+    {
+        freePyramid(pyramid);
+        pyramid = NULL;
+    }
+
+    closeDEMRows(reader);
+    free(pyramidPath);
+    free(failed);
+    return pyramid;
+}
+
+
+/*
+ * Returns the number of bands of a pyramid. Each band is one row of level 0
+ * blocks, PYRAMID_BLOCK_SIZE rows of the DEM.
+ */
+int getPyramidBands(gtopoPyramid *pyramid)
+{
+    return pyramid->levelHeight[0];
+}
+
+
+/*
+ * Marks the level 0 blocks under a node that skip() does not handle, descending
+ * only into nodes that it does not handle as a whole.
+ */
+static void markMixedBlocks(gtopoPyramid *pyramid, int band, int level, int nodeColumn,
+                int (*skip)(signed short minimum, signed short maximum, int column, int columns, void *settings),
+                void *settings, unsigned char *mixed)
+{
+    long node = pyramid->levelOffset[level] + (long) (band >> level) * pyramid->levelWidth[level] + nodeColumn;
+
+    int column = (nodeColumn << level) * PYRAMID_BLOCK_SIZE;
+    int end = ((nodeColumn + 1) << level) * PYRAMID_BLOCK_SIZE;
+    end = end < pyramid->width ? end : pyramid->width;
+
+    if (skip(pyramid->minimum[node], pyramid->maximum[node], column, end - column, settings))
+        return;
+
+    if (level == 0)
+    {
+        mixed[nodeColumn] = 1;
+        return;
+    }
+
+    int child;
+    for (child = 2 * nodeColumn; child < 2 * nodeColumn + 2 && child < pyramid->levelWidth[level - 1]; child++)
+        markMixedBlocks(pyramid, band, level - 1, child, skip, settings, mixed);
+}
+
+
+/*
+ * Scans one band of the DEM using its pyramid. Starting from the top of the
+ * pyramid, skip() is offered the minimum and maximum of each node covering the
+ * band, along with the columns of the band it covers. If it returns 1, the node
+ * has been handled as a whole and none of its elevations are read. Otherwise its
+ * children are offered in turn, and the elevations of blocks left at level 0 are
+ * read and passed to visit(), row by row, in runs of neighbouring blocks. The cost
+ * of a band is therefore proportional to the blocks that skip() cannot decide,
+ * such as those on a coastline, rather than to its area. Returns 1 if the band
+ * could not be read. Safe to call from several threads.
+ */
+int scanBand(gtopoPyramid *pyramid, gtopoRowReader *reader, int band,
+                int (*skip)(signed short minimum, signed short maximum, int column, int columns, void *settings),
+                void (*visit)(int row, int column, signed short *elevations, int count, void *settings),
+                void *settings)
+{
+    int blocks = pyramid->levelWidth[0];
+    unsigned char *mixed = (unsigned char *) calloc(blocks, sizeof(unsigned char));
+    signed short *elevations = (signed short *) malloc(sizeof(signed short) * pyramid->width);
+    int failed = mixed == NULL || elevations == NULL;
+
+    if (failed)
+        goto cleanup;
+
+    markMixedBlocks(pyramid, band, pyramid->levels - 1, 0, skip, settings, mixed);
+
+    int firstRow = band * PYRAMID_BLOCK_SIZE;
+    int lastRow = firstRow + PYRAMID_BLOCK_SIZE < pyramid->height ? firstRow + PYRAMID_BLOCK_SIZE : pyramid->height;
+
+    int row;
+    for (row = firstRow; row < lastRow && failed == 0; row++)
+    {
+        int block = 0;
+        while (block < blocks)
+        {
+            if (!mixed[block])
+            {
+                block++;
+                continue;
+            }
+
+            // Read the run of mixed blocks starting here in one go.
+            int runEnd = block;
+            while (runEnd < blocks && mixed[runEnd])
+                runEnd++;
+
+            int column = block * PYRAMID_BLOCK_SIZE;
+            int end = runEnd * PYRAMID_BLOCK_SIZE < pyramid->width ? runEnd * PYRAMID_BLOCK_SIZE : pyramid->width;
+
+            failed |= readDEMSpan(reader, row, column, end - column, elevations);
+            if (failed)
+                break;
+
+            visit(row, column, elevations, end - column, settings);
+            block = runEnd;
+        }
+    }
+
+    goto cleanup;
+
+    cleanup:
+    free(mixed);
+    free(elevations);
+    return failed;
+}
+
+
+/*
+ * Frees a pyramid.
+ */
+void freePyramid(gtopoPyramid *pyramid)
+{
+    if (pyramid != NULL)
+    {
+        free(pyramid->minimum);
+        free(pyramid->maximum);
+        free(pyramid);
+    }
+}
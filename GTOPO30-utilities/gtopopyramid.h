@@ -0,0 +1,11 @@
+#include "gtopoio.h"
+
+typedef struct minMaxPyramid gtopoPyramid;
+
+gtopoPyramid* loadPyramid(char *inputPath, int width, int height);
+int getPyramidBands(gtopoPyramid *pyramid);
+int scanBand(gtopoPyramid *pyramid, gtopoRowReader *reader, int band,
+                int (*skip)(signed short minimum, signed short maximum, int column, int columns, void *settings),
+                void (*visit)(int row, int column, signed short *elevations, int count, void *settings),
+                void *settings);
+void freePyramid(gtopoPyramid *pyramid);
@@ -0,0 +1,481 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "gtoposample.h"
+#include "gtopothreads.h"
+
+// Longest line of a points file that is read. Real ones are under 40 characters.
+#define MAX_POINT_LINE 256
+
+// Points that a points file is first read into, doubling whenever they run out.
+#define INITIAL_POINTS 4096
+
+// Points on a row at most this many columns apart are read with one span, as
+// reading the cells between them costs less than another read call.
+#define MERGE_GAP 2048
+
+// Sorted points sampled by each task, give or take the rest of a row.
+#define POINTS_PER_TASK 65536
+
+// Samples with less than this share of their weight on valid elevations have no data.
+#define MIN_COVERAGE 0.5
+
+
+/*
+ * A point on the DEM, at the top-left cell it reads from, and its place among
+ * the points as they were given.
+ */
+typedef struct pointKey
+{
+    int row;
+    int column;
+    long index;
+} pointKey;
+
+
+/*
+ * Shared state for sampling the sorted points a run of rows at a time. Task t
+ * samples keys firsts[t] up to firsts[t + 1].
+ */
+typedef struct sampleJob
+{
+    gtopoSamplePoints *points;
+    gtopoRowReader *reader;
+    int width;
+    int height;
+    int filter;
+    pointKey *keys;
+    long *firsts;
+    int *failed;
+} sampleJob;
+
+
+/*
+ * Returns the units named on the command line, or -1 if there are no such units.
+ */
+int parsePointUnits(char *name)
+{
+    if (strcmp(name, "cells") == 0)
+        return POINT_CELLS;
+    else if (strcmp(name, "degrees") == 0)
+        return POINT_DEGREES;
+
+    return -1;
+}
+
+
+/*
+ * Returns the filter named on the command line, or -1 if points cannot be
+ * sampled with it.
+ */
+int parseSampleFilter(char *name)
+{
+    if (strcmp(name, "nearest") == 0)
+        return SAMPLE_NEAREST;
+    else if (strcmp(name, "bilinear") == 0)
+        return SAMPLE_BILINEAR;
+
+    return -1;
+}
+
+
+/*
+ * Reads the two numbers of a line of a points file. Returns 1 if the line is
+ * blank, 0 if it holds two finite numbers and nothing else, and -1 otherwise.
+ */
+static int parsePoint(char *line, double *first, double *second)
+{
+    char *end;
+    char *start = line;
+
+    while (isspace((unsigned char) *start))
+        start++;
+
+    if (*start == '\0')
+        return 1;
+
+    *first = strtod(start, &end);
+    if (end == start || !isfinite(*first))
+        return -1;
+
+    start = end;
+    *second = strtod(start, &end);
+    if (end == start || !isfinite(*second))
+        return -1;
+
+    while (isspace((unsigned char) *end))
+        end++;
+
+    return *end == '\0' ? 0 : -1;
+}
+
+
+/*
+ * Reads a points file of one point per line: a row and column of the DEM if no
+ * georeference is given, and otherwise a latitude and longitude in degrees that
+ * are found on its grid. Can return an error.
+ */
+gtopoSamplePoints* readSamplePoints(char *pointsPath, gtopoGeoReference *reference)
+{
+    error = NULL;
+
+    FILE *file = fopen(pointsPath, "r");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(file, pointsPath);
+    if (error != NULL)
+        return NULL;
+
+    gtopoSamplePoints *points = (gtopoSamplePoints *) calloc(1, sizeof(gtopoSamplePoints));
+    error = checkAllocated(points);
+    if (error != NULL)
+        goto cleanup;
+
+    long capacity = INITIAL_POINTS;
+    points->rows = (double *) malloc(sizeof(double) * capacity);
+    points->columns = (double *) malloc(sizeof(double) * capacity);
+
+    error = checkAllocated(points->rows);
+    if (error == NULL)
+        error = checkAllocated(points->columns);
+
+    char line[MAX_POINT_LINE];
+    int lineNumber = 0;
+
+    while (error == NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNumber++;
+
+        double first;
+        double second;
+        int parsed = parsePoint(line, &first, &second);
+
+        // A line too long for the buffer is never a point.
+        if (strchr(line, '\n') == NULL && !feof(file))
+            parsed = -1;
+
+        if (parsed == 1)
+            continue;
+
+        error = locateJobError(checkPointFormat(parsed == 0), pointsPath, lineNumber);
+        if (error != NULL)
+            break;
+
+        if (points->count == capacity)
+        {
+            capacity = capacity * 2;
+            double *rows = (double *) realloc(points->rows, sizeof(double) * capacity);
+            if (rows != NULL)
+                points->rows = rows;
+
+            double *columns = (double *) realloc(points->columns, sizeof(double) * capacity);
+            if (columns != NULL)
+                points->columns = columns;
+
+            error = checkAllocated(rows != NULL && columns != NULL ? rows : NULL);
+            if (error != NULL)
+                break;
+        }
+
+        if (reference == NULL)
+        {
+            points->rows[points->count] = first;
+            points->columns[points->count] = second;
+        }
+        else
+        {
+            locatePoint(reference, second, first, &points->rows[points->count], &points->columns[points->count]);
+        }
+
+        points->count++;
+    }
+
+    goto cleanup;
+
+    cleanup:
+    fclose(file);
+
+    if (error != NULL)
+    {
+        freeSamplePoints(points);
+        return NULL;
+    }
+
+    return points;
+}
+
+
+/*
+ * Orders points by row and then column, so that each row of the DEM is read once
+ * and from left to right.
+ */
+static int compareKeys(const void *first, const void *second)
+{
+    const pointKey *a = (const pointKey *) first;
+    const pointKey *b = (const pointKey *) second;
+
+    if (a->row != b->row)
+        return a->row < b->row ? -1 : 1;
+
+    if (a->column != b->column)
+        return a->column < b->column ? -1 : 1;
+
+    return 0;
+}
+
+
+/*
+ * Interpolates a point from the 2x2 cells around it, weighting only the valid
+ * ones so that NO_DATA never bleeds into the coast. spans holds the row of the
+ * point's top-left cell and the row below, width elevations apart, from column
+ * left onwards.
+ */
+static signed short interpolate(sampleJob *job, pointKey *key, signed short *spans, int left)
+{
+    double rowFraction = job->points->rows[key->index] - key->row;
+    double columnFraction = job->points->columns[key->index] - key->column;
+    double value = 0;
+    double weight = 0;
+    int tapRow;
+    int tapColumn;
+
+    for (tapRow = 0; tapRow < 2; tapRow++)
+    {
+        for (tapColumn = 0; tapColumn < 2; tapColumn++)
+        {
+            int row = key->row + tapRow;
+            int column = key->column + tapColumn;
+
+            // Cells beyond the edges of the DEM count as NO_DATA.
+            if (row < 0 || row >= job->height || column < 0 || column >= job->width)
+                continue;
+
+            signed short elevation = spans[tapRow * job->width + column - left];
+            if (elevation == NO_DATA)
+                continue;
+
+            double tapWeight = (tapRow ? rowFraction : 1 - rowFraction) * (tapColumn ? columnFraction : 1 - columnFraction);
+            value += tapWeight * elevation;
+            weight += tapWeight;
+        }
+    }
+
+    return weight < MIN_COVERAGE ? NO_DATA : (signed short) lround(value / weight);
+}
+
+
+/*
+ * Samples one task's share of the sorted points. Points on the same row that are
+ * close together are read with one span of each row they need, so a dense track
+ * costs about one read per row it crosses. Run by parallelFor() for each task
+ * index.
+ */
+static void sampleTask(int task, void *jobPointer)
+{
+    sampleJob *job = (sampleJob *) jobPointer;
+    pointKey *keys = job->keys;
+    long end = job->firsts[task + 1];
+    int taps = job->filter == SAMPLE_BILINEAR ? 2 : 1;
+
+    signed short *spans = (signed short *) malloc(sizeof(signed short) * 2 * job->width);
+
+    job->failed[task] = 1;
+    if (spans == NULL)
+        return;
+
+    int failed = 0;
+    long start = job->firsts[task];
+
+    while (start < end && failed == 0)
+    {
+        // Extend the span while the next point on the row is close enough to share it.
+        int row = keys[start].row;
+        int right = keys[start].column + taps - 1;
+        long stop = start;
+
+        while (stop + 1 < end && keys[stop + 1].row == row && keys[stop + 1].column <= right + MERGE_GAP)
+        {
+            stop++;
+            right = keys[stop].column + taps - 1;
+        }
+
+        // The cells of a point on the edge of the DEM can lie beyond it.
+        int left = keys[start].column > 0 ? keys[start].column : 0;
+        right = right < job->width - 1 ? right : job->width - 1;
+
+        int tap;
+        for (tap = 0; tap < taps; tap++)
+        {
+            if (row + tap >= 0 && row + tap < job->height)
+                failed |= readDEMSpan(job->reader, row + tap, left, right - left + 1, spans + tap * job->width);
+        }
+
+        long x;
+        for (x = start; x <= stop; x++)
+        {
+            if (job->filter == SAMPLE_BILINEAR)
+                job->points->samples[keys[x].index] = interpolate(job, &keys[x], spans, left);
+            else
+                job->points->samples[keys[x].index] = spans[keys[x].column - left];
+        }
+
+        start = stop + 1;
+    }
+
+    job->failed[task] = failed;
+    free(spans);
+}
+
+
+/*
+ * Samples the DEM at every point, with the nearest cell or interpolating the
+ * 2x2 cells around it. Points are sorted by row first, and the DEM is read in
+ * spans of only the rows and columns they fall on, so even billions of points
+ * never read it in random order or whole. Points off the DEM have no data. Can
+ * return an error.
+ */
+void samplePoints(gtopoSamplePoints *points, char *inputPath, int width, int height, int filter)
+{
+    error = NULL;
+
+    pointKey *keys = NULL;
+    long *firsts = NULL;
+    int *failed = NULL;
+
+    gtopoRowReader *reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        return;
+
+    // Allocate at least one of each, so that an empty points file is not mistaken for no memory.
+    long count = points->count > 0 ? points->count : 1;
+    free(points->samples);
+    points->samples = (signed short *) malloc(sizeof(signed short) * count);
+    keys = (pointKey *) malloc(sizeof(pointKey) * count);
+    firsts = (long *) malloc(sizeof(long) * (count / POINTS_PER_TASK + 2));
+    failed = (int *) malloc(sizeof(int) * (count / POINTS_PER_TASK + 1));
+
+    error = checkAllocated(points->samples);
+    if (error == NULL)
+        error = checkAllocated(keys);
+    if (error == NULL)
+        error = checkAllocated(firsts);
+    if (error == NULL)
+        error = checkAllocated(failed);
+    if (error != NULL)
+        goto cleanup;
+
+    long keyCount = 0;
+    long x;
+
+    for (x = 0; x < points->count; x++)
+    {
+        double row = points->rows[x];
+        double column = points->columns[x];
+
+        // Points whose nearest cell is off the DEM are not read.
+        if (row < -0.5 || row >= height - 0.5 || column < -0.5 || column >= width - 0.5)
+        {
+            points->samples[x] = NO_DATA;
+            continue;
+        }
+
+        keys[keyCount].row = (int) floor(filter == SAMPLE_BILINEAR ? row : row + 0.5);
+        keys[keyCount].column = (int) floor(filter == SAMPLE_BILINEAR ? column : column + 0.5);
+        keys[keyCount].index = x;
+        keyCount++;
+    }
+
+    qsort(keys, keyCount, sizeof(pointKey), compareKeys);
+
+    // Split the sorted points into tasks between rows, so that no row is read twice.
+    int tasks = 0;
+    firsts[0] = 0;
+
+    for (x = 1; x < keyCount; x++)
+    {
+        if (x - firsts[tasks] >= POINTS_PER_TASK && keys[x].row != keys[x - 1].row)
+        {
+            tasks++;
+            firsts[tasks] = x;
+        }
+    }
+
+    if (keyCount > 0)
+        tasks++;
+
+    firsts[tasks] = keyCount;
+
+    sampleJob job;
+    job.points = points;
+    job.reader = reader;
+    job.width = width;
+    job.height = height;
+    job.filter = filter;
+    job.keys = keys;
+    job.firsts = firsts;
+    job.failed = failed;
+
+    parallelFor(tasks, sampleTask, &job);
+
+    int task;
+    int anyFailed = 0;
+    for (task = 0; task < tasks; task++)
+    {
+        anyFailed |= failed[task];
+    }
+
+    error = checkRowData(anyFailed, inputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    goto cleanup;
+
+    cleanup:
+    closeDEMRows(reader);
+    free(keys);
+    free(firsts);
+    free(failed);
+}
+
+
+/*
+ * Writes the samples, one elevation per line in the order of the points. Can
+ * return an error.
+ */
+void writeSamples(gtopoSamplePoints *points, char *outputPath)
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(outputPath, "w");
+
+    // Check that the file could be created.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        return;
+
+    long x;
+    for (x = 0; x < points->count; x++)
+    {
+        fprintf(outputFile, "%d\n", points->samples[x]);
+    }
+
+    // Check that every line reached the file, which closing it flushes.
+    int failed = ferror(outputFile);
+    failed |= fclose(outputFile) != 0;
+
+    error = checkOutputWritten(failed, outputPath);
+}
+
+
+void freeSamplePoints(gtopoSamplePoints *points)
+{
+    if (points == NULL)
+        return;
+
+    free(points->rows);
+    free(points->columns);
+    free(points->samples);
+    free(points);
+}
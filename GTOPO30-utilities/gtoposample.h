@@ -0,0 +1,30 @@
+#include "gtopoio.h"
+#include "gtopogeo.h"
+
+#define POINT_CELLS 0
+#define POINT_DEGREES 1
+
+#define SAMPLE_NEAREST 0
+#define SAMPLE_BILINEAR 1
+
+typedef struct samplePoints gtopoSamplePoints;
+
+/*
+ * Points to sample a DEM at, in fractional rows and columns, where the centre of
+ * the top-left cell is at 0, 0. Samples are filled in by samplePoints() in the
+ * order the points were given.
+ */
+struct samplePoints
+{
+    long count;
+    double *rows;
+    double *columns;
+    signed short *samples;
+};
+
+int parsePointUnits(char *name);
+int parseSampleFilter(char *name);
+gtopoSamplePoints* readSamplePoints(char *pointsPath, gtopoGeoReference *reference);
+void samplePoints(gtopoSamplePoints *points, char *inputPath, int width, int height, int filter);
+void writeSamples(gtopoSamplePoints *points, char *outputPath);
+void freeSamplePoints(gtopoSamplePoints *points);
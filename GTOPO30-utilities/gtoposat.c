@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "gtoposat.h"
+#include "gtopocodec.h"
+
+#define INTEGRAL_MAGIC "GTSA"
+#define INTEGRAL_HEADER_SIZE 16
+
+// Each entry is an 8 byte sum followed by a 4 byte count.
+#define ENTRY_SIZE 12
+
+
+/*
+ * Summed-area table sidecar. All integers are stored in big-endian, like the
+ * elevation points of a raw DEM. The file consists of:
+ *
+ * Header: The magic "GTSA", followed by the format version, width and height of
+ * the DEM, each 4 bytes.
+ *
+ * Table: (height + 1) rows of (width + 1) entries. The entry at row r and column c
+ * holds the sum of the valid elevations above and to the left of that corner, as
+ * a signed 64-bit integer, and the number of valid (non NO_DATA) elevation points
+ * there, as an unsigned 32-bit integer. The first row and column are zero.
+ *
+ * Any rectangle's sum and count follow from the four entries at its corners, so a
+ * query reads 48 bytes however large the rectangle is.
+ */
+struct integralIndex
+{
+    FILE *file;
+    int descriptor;
+    int width;
+    int height;
+    char *path;
+};
+
+
+/*
+ * Streams the DEM at inputPath row by row and writes its summed-area table to
+ * integralPath. Only one row of running totals is kept in memory. Can return an
+ * error.
+ */
+void buildIntegral(char *inputPath, int width, int height, char *integralPath)
+{
+    error = NULL;
+
+    FILE *integralFile = NULL;
+    signed short *elevations = NULL;
+    int64_t *sums = NULL;
+    uint32_t *counts = NULL;
+    unsigned char *entries = NULL;
+
+    gtopoRowReader *reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    integralFile = fopen(integralPath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(integralFile, integralPath);
+    if (error != NULL)
+        goto cleanup;
+
+    elevations = (signed short *) malloc(sizeof(signed short) * width);
+    sums = (int64_t *) calloc(width + 1, sizeof(int64_t));
+    counts = (uint32_t *) calloc(width + 1, sizeof(uint32_t));
+    entries = (unsigned char *) calloc(width + 1, ENTRY_SIZE);
+
+    error = checkAllocated(elevations);
+    if (error == NULL)
+        error = checkAllocated(sums);
+    if (error == NULL)
+        error = checkAllocated(counts);
+    if (error == NULL)
+        error = checkAllocated(entries);
+    if (error != NULL)
+        goto cleanup;
+
+    unsigned char header[INTEGRAL_HEADER_SIZE];
+    memcpy(header, INTEGRAL_MAGIC, 4);
+    putUint32(header + 4, INTEGRAL_VERSION);
+    putUint32(header + 8, width);
+    putUint32(header + 12, height);
+    int failed = fwrite(header, 1, INTEGRAL_HEADER_SIZE, integralFile) != INTEGRAL_HEADER_SIZE;
+
+    // The first row of the table is all zeros.
+    failed |= fwrite(entries, ENTRY_SIZE, width + 1, integralFile) != width + 1;
+
+    int row;
+    int column;
+    for (row = 0; row < height; row++)
+    {
+        error = checkRowData(readDEMRow(reader, row, elevations), inputPath);
+        if (error != NULL)
+            goto cleanup;
+
+        // Add the running totals along this row to the totals of the rows above.
+        int64_t rowSum = 0;
+        uint32_t rowCount = 0;
+
+        for (column = 0; column < width; column++)
+        {
+            if (elevations[column] != NO_DATA)
+            {
+                rowSum += elevations[column];
+                rowCount++;
+            }
+
+            sums[column + 1] += rowSum;
+            counts[column + 1] += rowCount;
+
+            putUint64(entries + (column + 1) * ENTRY_SIZE, (uint64_t) sums[column + 1]);
+            putUint32(entries + (column + 1) * ENTRY_SIZE + 8, counts[column + 1]);
+        }
+
+        failed |= fwrite(entries, ENTRY_SIZE, width + 1, integralFile) != width + 1;
+    }
+
+    // Check that the whole table reached the file, which closing it flushes.
+    failed |= fclose(integralFile) != 0;
+    integralFile = NULL;
+
+    error = checkOutputWritten(failed, integralPath);
+    if (error != NULL)
+        goto cleanup;
+
+    goto cleanup;
+
+    cleanup:
+    if (integralFile != NULL)
+        fclose(integralFile);
+
+    closeDEMRows(reader);
+    free(elevations);
+    free(sums);
+    free(counts);
+    free(entries);
+}
+
+
+/*
+ * Opens a summed-area table for queries, checking its header and size. The path
+ * is kept for error messages, so must outlive the index. Can return an error.
+ */
+gtopoIntegral* openIntegral(char *integralPath)
+{
+    error = NULL;
+
+    gtopoIntegral *index = NULL;
+    FILE *integralFile = fopen(integralPath, "rb");
+
+    // Check that the file opened successfully.
+    error = checkInvalidFileName(integralFile, integralPath);
+    if (error != NULL)
+        return NULL;
+
+    unsigned char header[INTEGRAL_HEADER_SIZE];
+    int corrupt = fread(header, 1, INTEGRAL_HEADER_SIZE, integralFile) != INTEGRAL_HEADER_SIZE ||
+        memcmp(header, INTEGRAL_MAGIC, 4) != 0 || getUint32(header + 4) != INTEGRAL_VERSION;
+
+    error = checkIntegralData(corrupt, integralPath);
+    if (error != NULL)
+        goto cleanup;
+
+    int width = getUint32(header + 8);
+    int height = getUint32(header + 12);
+
+    error = checkInvalidWidth(width, '\0');
+    if (error == NULL)
+        error = checkInvalidHeight(height, '\0');
+    if (error != NULL)
+        goto cleanup;
+
+    // The table must hold exactly one entry per corner.
+    struct stat status;
+    off_t expected = INTEGRAL_HEADER_SIZE + (off_t) (width + 1) * (height + 1) * ENTRY_SIZE;
+    corrupt = fstat(fileno(integralFile), &status) != 0 || status.st_size != expected;
+
+    error = checkIntegralData(corrupt, integralPath);
+    if (error != NULL)
+        goto cleanup;
+
+    index = (gtopoIntegral *) malloc(sizeof(gtopoIntegral));
+    error = checkAllocated(index);
+    if (error != NULL)
+        goto cleanup;
+
+    index->file = integralFile;
+    index->descriptor = fileno(integralFile);
+    index->width = width;
+    index->height = height;
+    index->path = integralPath;
+    return index;
+
+    cleanup:
+    fclose(integralFile);
+    return NULL;
+}
+
+
+/*
+ * Reads the sum and count at a corner of the table into the running totals,
+ * added or subtracted according to sign. Returns 1 if the entry could not be read.
+ */
+static int addCorner(gtopoIntegral *index, int row, int column, int sign, int64_t *sum, int64_t *count)
+{
+    unsigned char entry[ENTRY_SIZE];
+    off_t offset = INTEGRAL_HEADER_SIZE + ((off_t) row * (index->width + 1) + column) * ENTRY_SIZE;
+
+    if (pread(index->descriptor, entry, ENTRY_SIZE, offset) != ENTRY_SIZE)
+        return 1;
+
+    *sum += sign * (int64_t) getUint64(entry);
+    *count += sign * (int64_t) getUint32(entry + 8);
+    return 0;
+}
+
+
+/*
+ * Computes the mean elevation and the fraction of valid (non NO_DATA) elevation
+ * points of a rectangle of the DEM from the four corner entries of its table. The
+ * mean of a rectangle without valid points is NO_DATA. Can return an error.
+ */
+void regionStatistics(gtopoIntegral *index, int row, int column, int width, int height,
+                double *mean, double *landFraction)
+{
+    error = checkInvalidWindow(row, column, width, height, index->width, index->height);
+    if (error != NULL)
+        return;
+
+    int64_t sum = 0;
+    int64_t count = 0;
+    int failed = addCorner(index, row + height, column + width, 1, &sum, &count);
+    failed |= addCorner(index, row, column + width, -1, &sum, &count);
+    failed |= addCorner(index, row + height, column, -1, &sum, &count);
+    failed |= addCorner(index, row, column, 1, &sum, &count);
+
+    error = checkIntegralData(failed, index->path);
+    if (error != NULL)
+        return;
+
+    *mean = count > 0 ? (double) sum / count : NO_DATA;
+    *landFraction = (double) count / ((double) width * height);
+}
+
+
+/*
+ * Closes a summed-area table.
+ */
+void closeIntegral(gtopoIntegral *index)
+{
+    if (index != NULL)
+    {
+        fclose(index->file);
+        free(index);
+    }
+}
@@ -0,0 +1,9 @@
+#include "gtopoio.h"
+
+typedef struct integralIndex gtopoIntegral;
+
+void buildIntegral(char *inputPath, int width, int height, char *integralPath);
+gtopoIntegral* openIntegral(char *integralPath);
+void regionStatistics(gtopoIntegral *index, int row, int column, int width, int height,
+                double *mean, double *landFraction);
+void closeIntegral(gtopoIntegral *index);
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "gtoposerve.h"
+#include "gtoposhrink.h"
+#include "gtopothreads.h"
+
+// Longest request line, including its new line.
+#define MAX_REQUEST_LINE 256
+
+// Most words in a request: OVERVIEW followed by its five arguments.
+#define MAX_REQUEST_WORDS 6
+
+// Fewest worker threads, so that a few idle clients cannot hold up the others.
+#define MIN_SERVE_WORKERS 4
+
+// How often, in milliseconds, an idle connection checks whether to shut down.
+#define IDLE_POLL_MS 200
+
+// Connections waiting to be accepted before more are refused.
+#define LISTEN_BACKLOG 64
+
+
+/*
+ * A server answering requests for the elevations of one DEM over a Unix socket.
+ * Every worker thread accepts its own connections from the listening socket and
+ * answers their requests in turn, reading the DEM through the shared cache.
+ */
+typedef struct server
+{
+    char *socketPath;
+    char *inputPath;
+    int listener;
+    gtopoCache *cache;
+    int stopping;
+    pthread_mutex_t lock;
+} server;
+
+
+/*
+ * A connection to a client, with the bytes received but not yet used.
+ */
+typedef struct connection
+{
+    int socket;
+    char buffer[MAX_REQUEST_LINE];
+    int used;
+} connection;
+
+
+/*
+ * Fills in the address of a Unix socket. Returns 1 if the path is too long.
+ */
+static int setAddress(struct sockaddr_un *address, char *socketPath)
+{
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+
+    if (strlen(socketPath) >= sizeof(address->sun_path))
+        return 1;
+
+    strcpy(address->sun_path, socketPath);
+    return 0;
+}
+
+
+/*
+ * Creates the listening socket of a server for a DEM that is read through the
+ * cache. A socket left behind by an earlier server is replaced. Can return an
+ * error.
+ */
+server* openServer(char *socketPath, gtopoCache *cache, char *inputPath)
+{
+    error = NULL;
+
+    server *newServer = (server *) malloc(sizeof(server));
+    error = checkAllocated(newServer);
+    if (error != NULL)
+        return NULL;
+
+    newServer->socketPath = socketPath;
+    newServer->inputPath = inputPath;
+    newServer->cache = cache;
+    newServer->stopping = 0;
+    pthread_mutex_init(&newServer->lock, NULL);
+
+    struct sockaddr_un address;
+    struct stat status;
+
+    // Only remove what is at the path if it is a socket.
+    if (lstat(socketPath, &status) == 0 && S_ISSOCK(status.st_mode))
+        unlink(socketPath);
+
+    newServer->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    error = checkSocket(newServer->listener < 0 || setAddress(&address, socketPath) != 0 ||
+        bind(newServer->listener, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(newServer->listener, LISTEN_BACKLOG) != 0, socketPath);
+
+    if (error != NULL)
+    {
+        if (newServer->listener >= 0)
+            close(newServer->listener);
+
+        pthread_mutex_destroy(&newServer->lock);
+        free(newServer);
+        return NULL;
+    }
+
+    return newServer;
+}
+
+
+/*
+ * Returns 1 once the server has been asked to shut down, and 0 before.
+ */
+static int isStopping(server *targetServer)
+{
+    pthread_mutex_lock(&targetServer->lock);
+    int stopping = targetServer->stopping;
+    pthread_mutex_unlock(&targetServer->lock);
+    return stopping;
+}
+
+
+/*
+ * Asks the server to shut down. Shutting the listening socket down wakes every
+ * worker waiting to accept a connection, and idle connections notice within
+ * IDLE_POLL_MS.
+ */
+static void stopServer(server *targetServer)
+{
+    pthread_mutex_lock(&targetServer->lock);
+    targetServer->stopping = 1;
+    pthread_mutex_unlock(&targetServer->lock);
+
+    shutdown(targetServer->listener, SHUT_RDWR);
+}
+
+
+/*
+ * Sends all of the bytes, however many calls it takes. Returns 1 if the client
+ * has gone and 0 otherwise.
+ */
+static int sendAll(int socket, void *data, size_t size)
+{
+    char *bytes = (char *) data;
+
+    while (size > 0)
+    {
+        ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return 1;
+
+        bytes = bytes + sent;
+        size = size - sent;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Reads the next request line from a connection into line, without its new
+ * line. Returns 1 if there is one, and 0 once the client has gone, the line is
+ * too long or the server is shutting down.
+ */
+static int readRequest(server *targetServer, connection *client, char *line)
+{
+    while (1)
+    {
+        char *end = memchr(client->buffer, '\n', client->used);
+
+        if (end != NULL)
+        {
+            int length = end - client->buffer;
+            memcpy(line, client->buffer, length);
+            line[length] = '\0';
+
+            // Keep whatever followed the line for the next request.
+            client->used = client->used - length - 1;
+            memmove(client->buffer, end + 1, client->used);
+            return 1;
+        }
+
+        if (client->used == MAX_REQUEST_LINE)
+            return 0;
+
+        struct pollfd waiting;
+        waiting.fd = client->socket;
+        waiting.events = POLLIN;
+
+        int ready = poll(&waiting, 1, IDLE_POLL_MS);
+
+        if (isStopping(targetServer))
+            return 0;
+
+        if (ready <= 0)
+            continue;
+
+        ssize_t received = recv(client->socket, client->buffer + client->used, MAX_REQUEST_LINE - client->used, 0);
+        if (received <= 0)
+            return 0;
+
+        client->used = client->used + received;
+    }
+}
+
+
+/*
+ * Sends a reply of OK width height, followed by the elevations in the big-endian
+ * order of a raw DEM, so that a client can write them straight to a file. The
+ * elevations are converted in place. Returns 1 if the client has gone.
+ */
+static int sendElevations(int socket, signed short *elevations, int width, int height)
+{
+    char reply[64];
+    sprintf(reply, "OK %d %d\n", width, height);
+
+    long count = (long) width * height;
+    unsigned char *bytes = (unsigned char *) elevations;
+    long x;
+
+    for (x = 0; x < count; x++)
+    {
+        unsigned short elevation = (unsigned short) elevations[x];
+        bytes[2 * x] = elevation >> 8;
+        bytes[2 * x + 1] = elevation & 0xFF;
+    }
+
+    return sendAll(socket, reply, strlen(reply)) || sendAll(socket, elevations, sizeof(signed short) * count);
+}
+
+
+/*
+ * Reads the integer arguments of a request. Returns 1 if every one of them is an
+ * integer and 0 otherwise.
+ */
+static int parseArguments(char **words, int count, int *arguments)
+{
+    int x;
+    for (x = 0; x < count; x++)
+    {
+        char *end;
+        arguments[x] = strtol(words[x], &end, 10);
+
+        if (*end != '\0')
+            return 0;
+    }
+
+    return 1;
+}
+
+
+/*
+ * Answers a WINDOW or OVERVIEW request for a window of the DEM, reduced by the
+ * factor for an overview. Can return an error.
+ */
+static void answerWindow(server *targetServer, int socket, int factor, int row, int column, int width, int height)
+{
+    gtopoCache *cache = targetServer->cache;
+
+    error = checkInvalidWindow(row, column, width, height, getCacheWidth(cache), getCacheHeight(cache));
+    if (error != NULL)
+        return;
+
+    error = checkInvalidFactor(factor, '\0');
+    if (error != NULL)
+        return;
+
+    gtopoDEM *window = createUnfilledDEM(NULL, width, height);
+    error = checkDEMallocated(window);
+    if (error != NULL)
+        return;
+
+    // Every point of the window is copied from the cache, so it is not filled first.
+    error = checkRowData(readCachedWindow(cache, row, column, width, height, getRaster(window)[0]),
+        targetServer->inputPath);
+
+    if (error == NULL && factor > 1)
+    {
+        gtopoDEM *reduced = reduce(window, factor);
+        freeDEM(window);
+        window = reduced;
+        error = checkDEMallocated(window);
+    }
+
+    if (error == NULL)
+        sendElevations(socket, getRaster(window)[0], getWidth(window), getHeight(window));
+
+    freeDEM(window);
+}
+
+
+/*
+ * Answers one request. Returns 1 if the connection should be closed, after a
+ * SHUTDOWN, and 0 otherwise.
+ */
+static int answerRequest(server *targetServer, int socket, char *line)
+{
+    error = NULL;
+
+    char *words[MAX_REQUEST_WORDS + 1];
+    int count = 0;
+    char *position;
+    char *word = strtok_r(line, " \t\r", &position);
+
+    while (word != NULL && count <= MAX_REQUEST_WORDS)
+    {
+        words[count] = word;
+        count++;
+        word = strtok_r(NULL, " \t\r", &position);
+    }
+
+    int arguments[MAX_REQUEST_WORDS];
+    int valid = count > 0 && count <= MAX_REQUEST_WORDS && parseArguments(words + 1, count - 1, arguments);
+    char reply[128];
+
+    if (valid && strcmp(words[0], "POINT") == 0 && count == 3)
+    {
+        signed short elevation;
+        error = checkInvalidWindow(arguments[0], arguments[1], 1, 1,
+            getCacheWidth(targetServer->cache), getCacheHeight(targetServer->cache));
+
+        if (error == NULL)
+            error = checkRowData(readCachedWindow(targetServer->cache, arguments[0], arguments[1], 1, 1, &elevation),
+                targetServer->inputPath);
+
+        if (error == NULL)
+        {
+            sprintf(reply, "OK %d\n", elevation);
+            sendAll(socket, reply, strlen(reply));
+        }
+    }
+    else if (valid && strcmp(words[0], "WINDOW") == 0 && count == 5)
+    {
+        answerWindow(targetServer, socket, 1, arguments[0], arguments[1], arguments[2], arguments[3]);
+    }
+    else if (valid && strcmp(words[0], "OVERVIEW") == 0 && count == 6)
+    {
+        answerWindow(targetServer, socket, arguments[0], arguments[1], arguments[2], arguments[3], arguments[4]);
+    }
+    else if (valid && strcmp(words[0], "STATS") == 0 && count == 1)
+    {
+        long hits;
+        long misses;
+        int resident;
+        getCacheCounts(targetServer->cache, &hits, &misses, &resident);
+
+        sprintf(reply, "OK %ld %ld %d\n", hits, misses, resident);
+        sendAll(socket, reply, strlen(reply));
+    }
+    else if (valid && strcmp(words[0], "SHUTDOWN") == 0 && count == 1)
+    {
+        sendAll(socket, "OK\n", 3);
+        stopServer(targetServer);
+        return 1;
+    }
+    else
+    {
+        error = checkRequest(0);
+    }
+
+    // Failed requests are answered with the error, and the connection stays open.
+    if (error != NULL)
+    {
+        sendError(error, socket);
+        error = NULL;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Accepts connections and answers their requests until the server shuts down.
+ * Run by parallelForThreads() once for each worker, so that the parallel calls
+ * made in answering a request run on that worker alone.
+ */
+static void runWorker(int index, void *serverPointer)
+{
+    server *targetServer = (server *) serverPointer;
+    connection client;
+    char line[MAX_REQUEST_LINE];
+
+    while (!isStopping(targetServer))
+    {
+        client.socket = accept(targetServer->listener, NULL, NULL);
+        client.used = 0;
+
+        if (client.socket < 0)
+            continue;
+
+        while (readRequest(targetServer, &client, line))
+        {
+            if (answerRequest(targetServer, client.socket, line))
+                break;
+        }
+
+        close(client.socket);
+    }
+}
+
+
+/*
+ * Answers requests on worker threads until a client sends SHUTDOWN. Any number
+ * of clients can be connected at once, up to one per worker.
+ */
+void runServer(server *targetServer)
+{
+    int workers = getThreadCount() > MIN_SERVE_WORKERS ? getThreadCount() : MIN_SERVE_WORKERS;
+    parallelForThreads(workers, workers, runWorker, targetServer);
+}
+
+
+/*
+ * Closes the listening socket and removes it, and frees the server.
+ */
+void closeServer(server *targetServer)
+{
+    if (targetServer == NULL)
+        return;
+
+    close(targetServer->listener);
+    unlink(targetServer->socketPath);
+    pthread_mutex_destroy(&targetServer->lock);
+    free(targetServer);
+}
+
+
+/*
+ * Connects to a server listening on the socket. Returns the connected socket,
+ * or -1 if there is no server there. Can return an error.
+ */
+int connectServer(char *socketPath)
+{
+    error = NULL;
+
+    struct sockaddr_un address;
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    error = checkSocket(client < 0 || setAddress(&address, socketPath) != 0 ||
+        connect(client, (struct sockaddr *) &address, sizeof(address)) != 0, socketPath);
+
+    if (error != NULL)
+    {
+        if (client >= 0)
+            close(client);
+
+        return -1;
+    }
+
+    return client;
+}
@@ -0,0 +1,9 @@
+#include "gtopoio.h"
+#include "gtopocache.h"
+
+typedef struct server gtopoServer;
+
+gtopoServer* openServer(char *socketPath, gtopoCache *cache, char *inputPath);
+void runServer(gtopoServer *targetServer);
+void closeServer(gtopoServer *targetServer);
+int connectServer(char *socketPath);
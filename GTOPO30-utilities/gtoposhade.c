@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "gtopostencil.h"
+
+#define PI 3.14159265358979323846
+
+
+/*
+ * Settings for shading a DEM. The light source is stored as a unit vector
+ * pointing towards the light, with x pointing east, y north and z up.
+ */
+typedef struct shadeSettings
+{
+    float lightX;
+    float lightY;
+    float lightZ;
+    float gradientScale;
+} shadeSettings;
+
+
+/*
+ * Computes the 8-bit hillshade of a row using Horn's 3x3 gradient, which
+ * rowGradients() computes with the vector kernels. NO_DATA neighbours are
+ * replaced by the centre elevation.
+ */
+static void shadeRow(signed short **rows, int width, void *settingsPointer, unsigned char *output)
+{
+    shadeSettings *settings = (shadeSettings *) settingsPointer;
+    float gradientEast[GRADIENT_CHUNK];
+    float gradientSouth[GRADIENT_CHUNK];
+
+    int first;
+    for (first = 0; first < width; first += GRADIENT_CHUNK)
+    {
+        int columns = width - first < GRADIENT_CHUNK ? width - first : GRADIENT_CHUNK;
+        rowGradients(rows, 1, first, columns, gradientEast, gradientSouth);
+
+        int x;
+        for (x = 0; x < columns; x++)
+        {
+            // Rates of change of elevation towards the east and towards the south.
+            float east = gradientEast[x] * settings->gradientScale;
+            float south = gradientSouth[x] * settings->gradientScale;
+
+            // Cosine of the angle between the surface normal and the light.
+            float shade = (settings->lightZ - east * settings->lightX + south * settings->lightY) /
+                sqrtf(1 + east * east + south * south);
+            shade = shade < 0 ? 0 : shade;
+
+            output[first + x] = (unsigned char) (shade * 255 + 0.5f);
+        }
+    }
+}
+
+
+/*
+ * Streams the DEM at inputPath and writes its analytic hillshade as a binary (P5)
+ * pgm image to outputPath. The azimuth and altitude of the light source are in
+ * degrees, and zFactor exaggerates the relief. NO_DATA elevations are shaded
+ * black. Can return an error.
+ */
+void hillshade(char *inputPath, int width, int height, char *outputPath,
+                double azimuth, double altitude, double zFactor)
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(outputPath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        return;
+
+    // Write the pgm header. The stencil writes the rows after it.
+    fprintf(outputFile, "P5\n%d %d\n255\n", width, height);
+
+    double zenith = (90 - altitude) * PI / 180;
+    double direction = (90 - azimuth) * PI / 180;
+
+    shadeSettings settings;
+    settings.lightX = sin(zenith) * cos(direction);
+    settings.lightY = sin(zenith) * sin(direction);
+    settings.lightZ = cos(zenith);
+    settings.gradientScale = zFactor / (8 * CELL_SIZE);
+
+    gtopoStencil operation;
+    operation.radius = 1;
+    operation.outputSize = 1;
+    operation.kernel = shadeRow;
+    operation.settings = &settings;
+    operation.noDataOutput[0] = 0;
+
+    runStencil(&operation, inputPath, width, height, outputFile, outputPath);
+
+    // Check that the output was closed, as long as nothing went wrong before.
+    int failed = fclose(outputFile) != 0;
+    if (error == NULL)
+        error = checkOutputWritten(failed, outputPath);
+}
@@ -0,0 +1,4 @@
+#include "gtopoio.h"
+
+void hillshade(char *inputPath, int width, int height, char *outputPath,
+                double azimuth, double altitude, double zFactor);
@@ -1,5 +1,19 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include "gtopodata.h"
+#include "gtoposhrink.h"
+#include "gtopopipeline.h"
+#include "gtopothreads.h"
+#include "gtopocpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 static gtopoDEM* initialiseReduced(gtopoDEM *inputDEM, int factor)
 {
@@ -10,46 +24,762 @@ static gtopoDEM* initialiseReduced(gtopoDEM *inputDEM, int factor)
     int reducedWidth = ceil(getWidth(inputDEM) / (double)factor);
     int reducedHeight = ceil(getHeight(inputDEM) / (double)factor);
 
-    // Initialise the image.
-    gtopoDEM *reduced = createDEM(reducedWidth, reducedHeight);
+    // Initialise the image. Every point of it is set by reduce(), so it is not filled first.
+    gtopoDEM *reduced = createUnfilledDEM(NULL, reducedWidth, reducedHeight);
 
     return reduced;
 } 
 
-gtopoDEM* reduce(gtopoDEM *inputDEM, int factor)
+/*
+ * Points of the reduced DEM averaged at once by the separable mean kernels, so
+ * that their column sums fit on the stack.
+ */
+#define MEAN_CHUNK_POINTS 256
+
+
+/*
+ * A kernel that keeps every factor-th point of one row of the input, making
+ * width points of the reduced row.
+ */
+typedef void (*sampleKernel)(signed short *input, int inputWidth, signed short *output, int width, int factor);
+
+/*
+ * A kernel that averages blocks of rows x factor points, from the rows of the
+ * input starting at input[0], making width points of the reduced row.
+ */
+typedef void (*meanKernel)(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor);
+
+
+/*
+ * Removes a --mean flag from anywhere in the arguments, so the program sees only
+ * its own. Returns 1 if one was given and 0 otherwise.
+ */
+int takeMeanFlag(int *argc, char **argv)
 {
-    // Initialise reduced image using the input image and factor.
-    gtopoDEM *reducedDEM = initialiseReduced(inputDEM, factor);
+    int kept = 1;
+    int found = 0;
+    int x;
+
+    for (x = 1; x < *argc; x++)
+    {
+        if (strcmp(argv[x], "--mean") == 0)
+            found = 1;
+        else
+            argv[kept++] = argv[x];
+    }
+
+    argv[kept] = NULL;
+    *argc = kept;
+    return found;
+}
+
+
+/*
+ * Keeps every factor-th point of a row from the reduced column firstColumn up
+ * to width. Every kernel finishes its row with this, and it is the generic
+ * kernel for factors without one of their own.
+ */
+static void sampleColumns(signed short *input, signed short *output, int firstColumn, int width, int factor)
+{
+    int column;
+    for (column = firstColumn; column < width; column++)
+        output[column] = input[(long) column * factor];
+}
+
+
+static void sampleRow(signed short *input, int inputWidth, signed short *output, int width, int factor)
+{
+    sampleColumns(input, output, 0, width, factor);
+}
+
+
+#ifdef __SSE2__
+/*
+ * Returns the even points of the sixteen in low and high, in order.
+ */
+static inline __m128i selectEven(__m128i low, __m128i high)
+{
+    // Sign-extend the even point of each pair over the odd one, then pack the pairs.
+    low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+    high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+    return _mm_packs_epi32(low, high);
+}
+#endif
+
+
+#if defined(__x86_64__)
+/*
+ * Returns the even points of the thirty-two in low and high, in order. The packs
+ * work within each 128-bit lane, so the quarters are then put back in order.
+ */
+__attribute__((target("avx2")))
+static inline __m256i selectEvenAVX2(__m256i low, __m256i high)
+{
+    low = _mm256_srai_epi32(_mm256_slli_epi32(low, 16), 16);
+    high = _mm256_srai_epi32(_mm256_slli_epi32(high, 16), 16);
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+}
+
+
+/*
+ * Keeps every point at a fixed stride of 2, 4 or 8, given as 1, 2 or 3 rounds
+ * of selecting the even points, sixteen points at a time. Returns the reduced
+ * column it stopped at, where the next sixteen would read past the input row.
+ */
+__attribute__((target("avx2")))
+static int sampleEvenAVX2(signed short *input, int inputWidth, signed short *output, int rounds)
+{
+    int factor = 1 << rounds;
+    int column;
+
+    for (column = 0; (column + 16) * factor <= inputWidth; column += 16)
+    {
+        __m256i *points = (__m256i *) (input + column * factor);
+        __m256i vectors[8];
+        int count;
+        int x;
+
+        for (x = 0; x < factor; x++)
+            vectors[x] = _mm256_loadu_si256(points + x);
+
+        for (count = factor; count > 1; count /= 2)
+            for (x = 0; x < count / 2; x++)
+                vectors[x] = selectEvenAVX2(vectors[x * 2], vectors[x * 2 + 1]);
+
+        _mm256_storeu_si256((__m256i *) (output + column), vectors[0]);
+    }
+
+    return column;
+}
+#endif
+
+
+/*
+ * The kernels for factors 2, 4 and 8 make eight points at a time by selecting
+ * the even points once, twice or three times, after making what they can
+ * sixteen at a time with AVX2. Each stops where its next eight points would
+ * read past the end of the input row.
+ */
+static void sampleRowBy2(signed short *input, int inputWidth, signed short *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#if defined(__x86_64__)
+    if (level >= SIMD_AVX2)
+        column = sampleEvenAVX2(input, inputWidth, output, 1);
+#endif
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 8) * 2 <= inputWidth; column += 8)
+    {
+        __m128i *points = (__m128i *) (input + column * 2);
+        _mm_storeu_si128((__m128i *) (output + column),
+            selectEven(_mm_loadu_si128(points), _mm_loadu_si128(points + 1)));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 2);
+}
+
+
+static void sampleRowBy4(signed short *input, int inputWidth, signed short *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#if defined(__x86_64__)
+    if (level >= SIMD_AVX2)
+        column = sampleEvenAVX2(input, inputWidth, output, 2);
+#endif
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 8) * 4 <= inputWidth; column += 8)
+    {
+        __m128i *points = (__m128i *) (input + column * 4);
+        __m128i low = selectEven(_mm_loadu_si128(points), _mm_loadu_si128(points + 1));
+        __m128i high = selectEven(_mm_loadu_si128(points + 2), _mm_loadu_si128(points + 3));
+        _mm_storeu_si128((__m128i *) (output + column), selectEven(low, high));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 4);
+}
 
-    signed short elevation = 0;
+
+static void sampleRowBy8(signed short *input, int inputWidth, signed short *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#if defined(__x86_64__)
+    if (level >= SIMD_AVX2)
+        column = sampleEvenAVX2(input, inputWidth, output, 3);
+#endif
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 8) * 8 <= inputWidth; column += 8)
+    {
+        __m128i *points = (__m128i *) (input + column * 8);
+        __m128i quarters[4];
+        int quarter;
+
+        for (quarter = 0; quarter < 4; quarter++)
+            quarters[quarter] = selectEven(_mm_loadu_si128(points + quarter * 2),
+                _mm_loadu_si128(points + quarter * 2 + 1));
+
+        __m128i low = selectEven(quarters[0], quarters[1]);
+        __m128i high = selectEven(quarters[2], quarters[3]);
+        _mm_storeu_si128((__m128i *) (output + column), selectEven(low, high));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 8);
+}
+
+
+// A fixed stride of 10 points is too sparse to shuffle, so it is copied point by point.
+static void sampleRowBy10(signed short *input, int inputWidth, signed short *output, int width, int factor)
+{
+    sampleColumns(input, output, 0, width, 10);
+}
+
+
+/*
+ * Returns the mean of count valid elevations summing to sum, rounded to the
+ * nearest, or NO_DATA if none are valid. The sum of a wide block can pass 2^31,
+ * and single precision loses whole metres once it passes 2^24, so it is kept in
+ * 64 bits and divided in double precision. The vector kernels divide their small
+ * blocks in single precision, which is exact enough to round the same way.
+ */
+static signed short meanElevation(int64_t sum, int count)
+{
+    return count > 0 ? (signed short) lrint((double) sum / count) : NO_DATA;
+}
+
+
+/*
+ * Averages the valid points of each block of a row from the reduced column
+ * firstColumn up to width. Blocks at the right edge of the input are narrower.
+ * Every kernel finishes its row with this, and it is the generic kernel for
+ * factors without one of their own.
+ */
+static void meanColumns(signed short **input, int rows, int inputWidth, signed short *output,
+                int firstColumn, int width, int factor)
+{
+    int column;
     int row;
+    int point;
+
+    for (column = firstColumn; column < width; column++)
+    {
+        int first = column * factor;
+        int end = first + factor < inputWidth ? first + factor : inputWidth;
+        int64_t sum = 0;
+        int count = 0;
+
+        for (row = 0; row < rows; row++)
+        {
+            for (point = first; point < end; point++)
+            {
+                if (input[row][point] != NO_DATA)
+                {
+                    sum += input[row][point];
+                    count++;
+                }
+            }
+        }
+
+        output[column] = meanElevation(sum, count);
+    }
+}
+
+
+static void meanRow(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    meanColumns(input, rows, inputWidth, output, 0, width, factor);
+}
+
+
+#if defined(__x86_64__)
+/*
+ * Averages 2 x 2 blocks of two rows sixteen at a time, as meanRowBy2() does
+ * eight at a time. Returns the reduced column it stopped at, where the next
+ * sixteen would read past the input rows.
+ */
+__attribute__((target("avx2")))
+static int meanPairsAVX2(signed short **input, int inputWidth, signed short *output)
+{
+    __m256i noData = _mm256_set1_epi16(NO_DATA);
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i noData32 = _mm256_set1_epi32(NO_DATA);
+    __m256i zero = _mm256_setzero_si256();
     int column;
-    int smallerRow = 0;
-    int smallerColumn = 0;
 
-    for (row = 0; row < getHeight(inputDEM); row++)
+    for (column = 0; (column + 16) * 2 <= inputWidth; column += 16)
     {
-        if (smallerRow > getHeight(reducedDEM) - 1)
+        __m256i sums[2] = {zero, zero};
+        __m256i counts[2] = {zero, zero};
+        __m256i means[2];
+        int row;
+        int half;
+
+        for (row = 0; row < 2; row++)
+        {
+            for (half = 0; half < 2; half++)
+            {
+                __m256i points = _mm256_loadu_si256((__m256i *) (input[row] + column * 2) + half);
+                __m256i missing = _mm256_cmpeq_epi16(points, noData);
+
+                sums[half] = _mm256_add_epi32(sums[half], _mm256_madd_epi16(_mm256_andnot_si256(missing, points), ones));
+                counts[half] = _mm256_add_epi32(counts[half], _mm256_madd_epi16(_mm256_andnot_si256(missing, ones), ones));
+            }
+        }
+
+        for (half = 0; half < 2; half++)
         {
-            break;
+            __m256i quotients = _mm256_cvtps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sums[half]),
+                _mm256_cvtepi32_ps(counts[half])));
+            __m256i empty = _mm256_cmpeq_epi32(counts[half], zero);
+            means[half] = _mm256_blendv_epi8(quotients, noData32, empty);
         }
 
-        for (column = 0; column < getWidth(inputDEM); column++)
+        // The packs work within each 128-bit lane, so the quarters are put back in order.
+        _mm256_storeu_si256((__m256i *) (output + column),
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(means[0], means[1]), 0xD8));
+    }
+
+    return column;
+}
+#endif
+
+
+/*
+ * Averages 2 x 2 blocks eight at a time, after averaging what it can sixteen at
+ * a time with AVX2. Each pair of points is summed with a multiply-add, with
+ * NO_DATA masked to zero and counted out, and the sums are divided by the
+ * counts in single precision. The last row of an input with an odd height is
+ * averaged by meanColumns().
+ */
+static void meanRowBy2(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#if defined(__x86_64__)
+    if (rows == 2 && level >= SIMD_AVX2)
+        column = meanPairsAVX2(input, inputWidth, output);
+#endif
+
+#ifdef __SSE2__
+    if (rows == 2 && level >= SIMD_SSE2)
+    {
+        __m128i noData = _mm_set1_epi16(NO_DATA);
+        __m128i ones = _mm_set1_epi16(1);
+        __m128i noData32 = _mm_set1_epi32(NO_DATA);
+        __m128i zero = _mm_setzero_si128();
+
+        for (; (column + 8) * 2 <= inputWidth; column += 8)
         {
-            elevation = getElevation(inputDEM, row, column);
-            
-            if (row % factor == 0 && column % factor == 0)
+            __m128i sums[2] = {zero, zero};
+            __m128i counts[2] = {zero, zero};
+            int row;
+            int half;
+
+            for (row = 0; row < 2; row++)
             {
-                setElevation(reducedDEM, elevation, smallerRow, smallerColumn);
-                smallerColumn++;
+                for (half = 0; half < 2; half++)
+                {
+                    __m128i points = _mm_loadu_si128((__m128i *) (input[row] + column * 2) + half);
+                    __m128i missing = _mm_cmpeq_epi16(points, noData);
 
-                if (smallerColumn > getWidth(reducedDEM) - 1)
-                    smallerRow++;
+                    sums[half] = _mm_add_epi32(sums[half], _mm_madd_epi16(_mm_andnot_si128(missing, points), ones));
+                    counts[half] = _mm_add_epi32(counts[half], _mm_madd_epi16(_mm_andnot_si128(missing, ones), ones));
+                }
+            }
+
+            // Blocks with no valid points divide by zero, and are given NO_DATA instead.
+            __m128i means[2];
+            for (half = 0; half < 2; half++)
+            {
+                __m128i quotients = _mm_cvtps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sums[half]), _mm_cvtepi32_ps(counts[half])));
+                __m128i empty = _mm_cmpeq_epi32(counts[half], zero);
+                means[half] = _mm_or_si128(_mm_and_si128(empty, noData32), _mm_andnot_si128(empty, quotients));
             }
+
+            _mm_storeu_si128((__m128i *) (output + column), _mm_packs_epi32(means[0], means[1]));
+        }
+    }
+#endif
+
+    meanColumns(input, rows, inputWidth, output, column, width, 2);
+}
+
+
+/*
+ * Averages blocks separably, for the factors too wide to average a block in one
+ * vector. The valid points and their count are summed down each input column
+ * for a chunk of the row, eight columns at a time, and each block is then the
+ * sum of factor of these column sums.
+ */
+static void meanRowSeparable(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    int sums[MEAN_CHUNK_POINTS * 10];
+    int counts[MEAN_CHUNK_POINTS * 10];
+    int level = getSimdLevel();
+    int firstColumn;
+
+    for (firstColumn = 0; firstColumn < width; firstColumn += MEAN_CHUNK_POINTS)
+    {
+        int columns = width - firstColumn < MEAN_CHUNK_POINTS ? width - firstColumn : MEAN_CHUNK_POINTS;
+        int first = firstColumn * factor;
+        int end = first + columns * factor < inputWidth ? first + columns * factor : inputWidth;
+        int row;
+        int point;
+
+        for (point = 0; point < end - first; point++)
+        {
+            sums[point] = 0;
+            counts[point] = 0;
+        }
+
+        for (row = 0; row < rows; row++)
+        {
+            signed short *inputRow = input[row] + first;
+            point = 0;
+
+#ifdef __SSE2__
+            __m128i noData = _mm_set1_epi16(NO_DATA);
+            __m128i ones = _mm_set1_epi16(1);
+            __m128i zero = _mm_setzero_si128();
+
+            for (; level >= SIMD_SSE2 && point + 8 <= end - first; point += 8)
+            {
+                __m128i points = _mm_loadu_si128((__m128i *) (inputRow + point));
+                __m128i missing = _mm_cmpeq_epi16(points, noData);
+                __m128i valid = _mm_andnot_si128(missing, points);
+                __m128i present = _mm_andnot_si128(missing, ones);
+                __m128i *columnSums = (__m128i *) (sums + point);
+                __m128i *columnCounts = (__m128i *) (counts + point);
+
+                // Sign-extend the valid points to 32 bits by unpacking each over itself.
+                _mm_storeu_si128(columnSums, _mm_add_epi32(_mm_loadu_si128(columnSums),
+                    _mm_srai_epi32(_mm_unpacklo_epi16(valid, valid), 16)));
+                _mm_storeu_si128(columnSums + 1, _mm_add_epi32(_mm_loadu_si128(columnSums + 1),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(valid, valid), 16)));
+                _mm_storeu_si128(columnCounts, _mm_add_epi32(_mm_loadu_si128(columnCounts),
+                    _mm_unpacklo_epi16(present, zero)));
+                _mm_storeu_si128(columnCounts + 1, _mm_add_epi32(_mm_loadu_si128(columnCounts + 1),
+                    _mm_unpackhi_epi16(present, zero)));
+            }
+#endif
+
+            for (; point < end - first; point++)
+            {
+                if (inputRow[point] != NO_DATA)
+                {
+                    sums[point] += inputRow[point];
+                    counts[point]++;
+                }
+            }
+        }
+
+        int column;
+        for (column = 0; column < columns; column++)
+        {
+            int blockEnd = (column + 1) * factor < end - first ? (column + 1) * factor : end - first;
+            int sum = 0;
+            int count = 0;
+
+            for (point = column * factor; point < blockEnd; point++)
+            {
+                sum += sums[point];
+                count += counts[point];
+            }
+
+            output[firstColumn + column] = meanElevation(sum, count);
         }
+    }
+}
+
+
+/*
+ * The kernels for factors 4, 8 and 10 share the separable kernel, called with a
+ * constant factor so that the compiler can unroll the block sums.
+ */
+static void meanRowBy4(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 4);
+}
+
+
+static void meanRowBy8(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 8);
+}
+
+
+static void meanRowBy10(signed short **input, int rows, int inputWidth, signed short *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 10);
+}
+
+
+/*
+ * Returns the kernel keeping every factor-th point: one of its own for the
+ * common factors, and the generic strided kernel for any other.
+ */
+static sampleKernel chooseSampleKernel(int factor)
+{
+    switch (factor)
+    {
+        case 2:
+            return sampleRowBy2;
+        case 4:
+            return sampleRowBy4;
+        case 8:
+            return sampleRowBy8;
+        case 10:
+            return sampleRowBy10;
+        default:
+            return sampleRow;
+    }
+}
+
+
+/*
+ * Returns the kernel averaging factor x factor blocks, chosen as
+ * chooseSampleKernel() chooses.
+ */
+static meanKernel chooseMeanKernel(int factor)
+{
+    switch (factor)
+    {
+        case 2:
+            return meanRowBy2;
+        case 4:
+            return meanRowBy4;
+        case 8:
+            return meanRowBy8;
+        case 10:
+            return meanRowBy10;
+        default:
+            return meanRow;
+    }
+}
+
+
+/*
+ * The DEM being reduced, the reduced DEM, the factor, and the kernel making
+ * each reduced row: sample keeps the top-left point of each block, and mean,
+ * when it is set, averages the block instead.
+ */
+typedef struct reduction
+{
+    gtopoDEM *inputDEM;
+    gtopoDEM *reducedDEM;
+    int factor;
+    sampleKernel sample;
+    meanKernel mean;
+} reduction;
+
 
-        smallerColumn = 0;
+/*
+ * Makes a band of rows of the reduced DEM with the reduction's kernel. Run by
+ * parallelRows() for each band.
+ */
+static void reduceRows(int firstRow, int rows, void *reductionPointer)
+{
+    reduction *job = (reduction *) reductionPointer;
+    signed short **input = getRaster(job->inputDEM);
+    signed short **reduced = getRaster(job->reducedDEM);
+    int inputWidth = getWidth(job->inputDEM);
+    int inputHeight = getHeight(job->inputDEM);
+    int width = getWidth(job->reducedDEM);
+
+    int row;
+
+    for (row = firstRow; row < firstRow + rows; row++)
+    {
+        int inputRow = row * job->factor;
+
+        if (job->mean != NULL)
+        {
+            // The last block of rows is shorter when the height is not a multiple of the factor.
+            int blockRows = inputHeight - inputRow < job->factor ? inputHeight - inputRow : job->factor;
+            job->mean(input + inputRow, blockRows, inputWidth, reduced[row], width, job->factor);
+        }
+        else
+        {
+            job->sample(input[inputRow], inputWidth, reduced[row], width, job->factor);
+        }
     }
+}
+
+
+/*
+ * Makes the reduced DEM with the reduction, in bands of rows in parallel.
+ * Returns NULL if the reduced DEM could not be allocated.
+ */
+static gtopoDEM* runReduction(gtopoDEM *inputDEM, int factor, int mean)
+{
+    // Initialise reduced image using the input image and factor.
+    gtopoDEM *reducedDEM = initialiseReduced(inputDEM, factor);
+    if (reducedDEM == NULL)
+        return NULL;
+
+    reduction job;
+    job.inputDEM = inputDEM;
+    job.reducedDEM = reducedDEM;
+    job.factor = factor;
+    job.sample = chooseSampleKernel(factor);
+    job.mean = mean ? chooseMeanKernel(factor) : NULL;
+
+    parallelRows(getHeight(reducedDEM), getWidth(reducedDEM), reduceRows, &job);
 
     return reducedDEM;
 }
+
+
+/*
+ * Reduces the DEM by the factor, keeping the point at the top-left of each
+ * factor x factor block. Bands of rows of the reduced DEM are made in parallel.
+ * Returns NULL if the reduced DEM could not be allocated.
+ */
+gtopoDEM* reduce(gtopoDEM *inputDEM, int factor)
+{
+    return runReduction(inputDEM, factor, 0);
+}
+
+
+/*
+ * Reduces the DEM by the factor as reduce() does, but gives each point of the
+ * reduced DEM the mean of the valid elevations of its factor x factor block,
+ * rounded to the nearest, or NO_DATA if the block has none. Blocks at the right
+ * and bottom edges are clipped to the DEM. Returns NULL if the reduced DEM could
+ * not be allocated.
+ */
+gtopoDEM* reduceMean(gtopoDEM *inputDEM, int factor)
+{
+    return runReduction(inputDEM, factor, 1);
+}
+
+
+/*
+ * The output of reduceFile(), whether it could not be written, the reduction
+ * factor, and the kernels making each reduced row, as in a reduction.
+ */
+typedef struct reduceJob
+{
+    int outputFile;
+    int writeFailed;
+    int width;
+    int reducedWidth;
+    int factor;
+    sampleKernel sample;
+    meanKernel mean;
+} reduceJob;
+
+
+/*
+ * Reduces the blocks of rows of a chunk starting on a multiple of the factor, as
+ * reduce() or reduceMean() does, and writes the reduced rows in place in the
+ * output. Chunks being averaged start and end on whole blocks of rows. Returns 1
+ * if the chunk could not be reduced; a row that could not be written sets
+ * writeFailed instead, and the chunks after it are skipped.
+ */
+static int reduceChunk(int firstRow, int rows, signed short *elevations, void *jobPointer)
+{
+    reduceJob *job = (reduceJob *) jobPointer;
+
+    signed short *reduced = (signed short *) malloc(sizeof(signed short) * job->reducedWidth);
+    signed short **blockRows = (signed short **) malloc(sizeof(signed short *) * job->factor);
+    int failed = reduced == NULL || blockRows == NULL;
+    int writeFailed = __atomic_load_n(&job->writeFailed, __ATOMIC_RELAXED);
+    int row;
+    int blockRow;
+
+    // Start from the first row of the chunk on a multiple of the factor.
+    for (row = (job->factor - firstRow % job->factor) % job->factor;
+            row < rows && failed == 0 && writeFailed == 0; row += job->factor)
+    {
+        if (job->mean != NULL)
+        {
+            int count = rows - row < job->factor ? rows - row : job->factor;
+            for (blockRow = 0; blockRow < count; blockRow++)
+                blockRows[blockRow] = elevations + (long) (row + blockRow) * job->width;
+
+            job->mean(blockRows, count, job->width, reduced, job->reducedWidth, job->factor);
+        }
+        else
+        {
+            job->sample(elevations + (long) row * job->width, job->width, reduced, job->reducedWidth, job->factor);
+        }
+
+        long firstPoint = (long) (firstRow + row) / job->factor * job->reducedWidth;
+        writeFailed = writeDEMSpan(job->outputFile, firstPoint, reduced, job->reducedWidth);
+    }
+
+    if (writeFailed)
+        __atomic_store_n(&job->writeFailed, 1, __ATOMIC_RELAXED);
+
+    free(reduced);
+    free(blockRows);
+    return failed;
+}
+
+
+/*
+ * Reduces the raw DEM at inputPath by the factor, as reduce() does, or as
+ * reduceMean() does if mean is 1, and writes it to outputPath without holding
+ * either in memory. The input is streamed through the pipeline in chunks, and
+ * each reduced row is written as soon as it is made. Every row is still read, so
+ * the whole DEM is validated as readDEM() would. The DEM must be one
+ * canStreamDEM() accepts. Can return an error.
+ */
+void reduceFile(char *inputPath, int width, int height, int factor, int mean, char *outputPath)
+{
+    error = NULL;
+
+    FILE *outputFile = NULL;
+    gtopoRowReader *reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    outputFile = fopen(outputPath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    reduceJob job;
+    job.outputFile = fileno(outputFile);
+    job.writeFailed = 0;
+    job.width = width;
+    job.reducedWidth = ceil(width / (double) factor);
+    job.factor = factor;
+    job.sample = chooseSampleKernel(factor);
+    job.mean = mean ? chooseMeanKernel(factor) : NULL;
+
+    // Chunks being averaged are rounded down to whole blocks of rows, but hold at least one.
+    int chunkRows = getChunkRows(width);
+    if (mean)
+        chunkRows = chunkRows > factor ? chunkRows - chunkRows % factor : factor;
+
+    int failed = streamDEMRows(reader, width, 0, height, chunkRows, reduceChunk, &job);
+    error = checkRowData(failed, inputPath);
+    if (error != NULL)
+        goto cleanup;
+
+    job.writeFailed |= fclose(outputFile) != 0;
+    outputFile = NULL;
+    error = checkOutputWritten(job.writeFailed, outputPath);
+    goto cleanup;
+
+    cleanup:
+    if (outputFile != NULL)
+        fclose(outputFile);
+
+    closeDEMRows(reader);
+}
@@ -1,3 +1,6 @@
 #include "gtopoio.h"
 
+int takeMeanFlag(int *argc, char **argv);
 gtopoDEM* reduce(gtopoDEM *inputDEM, int factor);
+gtopoDEM* reduceMean(gtopoDEM *inputDEM, int factor);
+void reduceFile(char *inputPath, int width, int height, int factor, int mean, char *outputPath);
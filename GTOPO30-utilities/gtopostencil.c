@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gtopostencil.h"
+#include "gtopothreads.h"
+#include "gtopocpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Number of rows computed by each task.
+#define ROWS_PER_BAND 64
+
+#define MAX_RADIUS 2
+
+/*
+ * Weights of the gradients, by radius: smoothing across the gradient and
+ * differencing along it. Radius 1 is Horn's 3x3 gradient and radius 2 a smoothed
+ * 5x5 one.
+ */
+static const float smoothing[MAX_RADIUS + 1][2 * MAX_RADIUS + 1] = {{1}, {1, 2, 1}, {1, 4, 6, 4, 1}};
+static const float differencing[MAX_RADIUS + 1][2 * MAX_RADIUS + 1] = {{0}, {-1, 0, 1}, {-1, -2, 0, 2, 1}};
+
+
+/*
+ * Shared state for running a stencil over a DEM in row bands.
+ */
+typedef struct stencilJob
+{
+    gtopoStencil *operation;
+    gtopoRowReader *reader;
+    int outputDescriptor;
+    long headerSize;
+    int width;
+    int height;
+    int *failed;
+    int writeFailed;
+} stencilJob;
+
+
+/*
+ * Reads a row into a buffer with radius extra elevations on either side, which
+ * copy the first and last elevations of the row. Rows beyond the top or bottom of
+ * the DEM are replaced by the nearest row, so the stencil never leaves the buffer.
+ */
+static int readPaddedRow(stencilJob *job, int row, signed short *padded)
+{
+    int radius = job->operation->radius;
+
+    if (row < 0)
+        row = 0;
+    else if (row > job->height - 1)
+        row = job->height - 1;
+
+    int failed = readDEMRow(job->reader, row, padded + radius);
+
+    int x;
+    for (x = 0; x < radius; x++)
+    {
+        padded[x] = padded[radius];
+        padded[radius + job->width + x] = padded[radius + job->width - 1];
+    }
+
+    return failed;
+}
+
+
+/*
+ * Runs the stencil over one band of rows, keeping a ring of 2 * radius + 1 rows in
+ * memory. A band that could not be read is marked in failed, and one that could
+ * not be written sets writeFailed. Run by parallelFor() for each band index.
+ */
+static void runBand(int band, void *jobPointer)
+{
+    stencilJob *job = (stencilJob *) jobPointer;
+    gtopoStencil *operation = job->operation;
+    int radius = operation->radius;
+    int windowRows = 2 * radius + 1;
+    int paddedWidth = job->width + 2 * radius;
+
+    int firstRow = band * ROWS_PER_BAND;
+    int lastRow = firstRow + ROWS_PER_BAND < job->height ? firstRow + ROWS_PER_BAND : job->height;
+
+    signed short *buffer = (signed short *) malloc(sizeof(signed short) * windowRows * paddedWidth);
+    unsigned char *output = (unsigned char *) malloc(operation->outputSize * job->width);
+
+    job->failed[band] = 1;
+    if (buffer == NULL || output == NULL)
+    {
+        free(buffer);
+        free(output);
+        return;
+    }
+
+    // Fill the ring with the rows around the first row of the band.
+    signed short *rows[2 * MAX_RADIUS + 1];
+    int failed = 0;
+    int k;
+    for (k = 0; k < windowRows; k++)
+    {
+        rows[k] = buffer + k * paddedWidth;
+        if (k > 0)
+            failed |= readPaddedRow(job, firstRow - radius + k - 1, rows[k]);
+    }
+
+    int writeFailed = 0;
+    int row;
+    int column;
+    for (row = firstRow; row < lastRow && failed == 0 && writeFailed == 0; row++)
+    {
+        // Roll the ring down by one row, reusing the oldest row for the newest.
+        signed short *oldest = rows[0];
+        for (k = 0; k < windowRows - 1; k++)
+            rows[k] = rows[k + 1];
+
+        rows[windowRows - 1] = oldest;
+        failed |= readPaddedRow(job, row + radius, oldest);
+
+        operation->kernel(rows, job->width, operation->settings, output);
+
+        // Elevation points without data produce no data.
+        signed short *centre = rows[radius] + radius;
+        for (column = 0; column < job->width; column++)
+        {
+            if (centre[column] == NO_DATA)
+                memcpy(output + column * operation->outputSize, operation->noDataOutput, operation->outputSize);
+        }
+
+        size_t rowBytes = (size_t) operation->outputSize * job->width;
+        off_t offset = job->headerSize + (off_t) row * rowBytes;
+        writeFailed = pwrite(job->outputDescriptor, output, rowBytes, offset) != rowBytes;
+    }
+
+    if (writeFailed)
+        __atomic_store_n(&job->writeFailed, 1, __ATOMIC_RELAXED);
+
+    job->failed[band] = failed;
+    free(buffer);
+    free(output);
+}
+
+
+/*
+ * Streams the DEM at inputPath through a neighbourhood operation, writing one
+ * output row per DEM row after the current end of outputFile, which is open at
+ * outputPath (so a header may be written first). Bands of rows are computed in
+ * parallel, each reading only the rows it needs. Rows that could not be read are
+ * reported against the input and rows that could not be written against the
+ * output. The caller still closes the output. Can return an error.
+ */
+void runStencil(gtopoStencil *operation, char *inputPath, int width, int height, FILE *outputFile, char *outputPath)
+{
+    int bands = (height + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    int *failed = NULL;
+
+    gtopoRowReader *reader = openDEMRows(inputPath, width, height);
+    if (error != NULL)
+        goto cleanup;
+
+    failed = (int *) malloc(sizeof(int) * bands);
+    error = checkAllocated(failed);
+    if (error != NULL)
+        goto cleanup;
+
+    // Write any header first, as the rows are written after it.
+    int headerFailed = fflush(outputFile) != 0;
+
+    stencilJob job;
+    job.operation = operation;
+    job.reader = reader;
+    job.outputDescriptor = fileno(outputFile);
+    job.headerSize = ftell(outputFile);
+    job.width = width;
+    job.height = height;
+    job.failed = failed;
+    job.writeFailed = headerFailed;
+
+    if (headerFailed == 0)
+        parallelFor(bands, runBand, &job);
+
+    // Check that every band was read.
+    int band;
+    for (band = 0; band < bands && headerFailed == 0; band++)
+    {
+        error = checkRowData(failed[band], inputPath);
+        if (error != NULL)
+            goto cleanup;
+    }
+
+    // Check that every band was written.
+    error = checkOutputWritten(job.writeFailed, outputPath);
+    goto cleanup;
+
+    cleanup:
+    closeDEMRows(reader);
+    free(failed);
+}
+
+
+/*
+ * Stores an elevation-like value as a big-endian DEM output point, for stencils
+ * that write DEMs.
+ */
+void setDEMOutput(unsigned char *output, int column, signed short value)
+{
+    output[column * 2] = (value >> 8) & 0xFF;
+    output[column * 2 + 1] = value & 0xFF;
+}
+
+
+/*
+ * Computes the gradients of the columns from column up to end - 1 one at a time.
+ * NO_DATA neighbours are replaced by the centre elevation.
+ */
+static void gradientColumns(signed short **rows, int radius, int first, int column, int end, float *east, float *south)
+{
+    const float *across = smoothing[radius];
+    const float *along = differencing[radius];
+
+    for (; column < end; column++)
+    {
+        float e = rows[radius][column + radius];
+        float sumEast = 0;
+        float sumSouth = 0;
+        int k;
+        int j;
+
+        for (k = 0; k <= 2 * radius; k++)
+        {
+            for (j = 0; j <= 2 * radius; j++)
+            {
+                float value = NEIGHBOUR(rows[k][column + j], e);
+                sumEast += across[k] * along[j] * value;
+                sumSouth += along[k] * across[j] * value;
+            }
+        }
+
+        east[column - first] = sumEast;
+        south[column - first] = sumSouth;
+    }
+}
+
+
+#ifdef __SSE2__
+/*
+ * Returns four consecutive elevations as floats, with those that have no data
+ * replaced by the centre elevations.
+ */
+static inline __m128 loadNeighbours(signed short *points, __m128 centre)
+{
+    __m128i values = _mm_loadl_epi64((__m128i *) points);
+    __m128 neighbours = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16));
+    __m128 missing = _mm_cmpeq_ps(neighbours, _mm_set1_ps(NO_DATA));
+    return _mm_or_ps(_mm_and_ps(missing, centre), _mm_andnot_ps(missing, neighbours));
+}
+
+
+/*
+ * Computes the gradients of four columns at a time. Returns the column it
+ * stopped at, where the next four would pass end.
+ */
+static int gradientSSE2(signed short **rows, int radius, int first, int column, int end, float *east, float *south)
+{
+    const float *across = smoothing[radius];
+    const float *along = differencing[radius];
+
+    for (; column + 4 <= end; column += 4)
+    {
+        signed short *centrePoints = rows[radius] + column + radius;
+        __m128i centreValues = _mm_loadl_epi64((__m128i *) centrePoints);
+        __m128 centre = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(centreValues, centreValues), 16));
+        __m128 sumEast = _mm_setzero_ps();
+        __m128 sumSouth = _mm_setzero_ps();
+        int k;
+        int j;
+
+        for (k = 0; k <= 2 * radius; k++)
+        {
+            for (j = 0; j <= 2 * radius; j++)
+            {
+                __m128 value = loadNeighbours(rows[k] + column + j, centre);
+                sumEast = _mm_add_ps(sumEast, _mm_mul_ps(_mm_set1_ps(across[k] * along[j]), value));
+                sumSouth = _mm_add_ps(sumSouth, _mm_mul_ps(_mm_set1_ps(along[k] * across[j]), value));
+            }
+        }
+
+        _mm_storeu_ps(east + column - first, sumEast);
+        _mm_storeu_ps(south + column - first, sumSouth);
+    }
+
+    return column;
+}
+#endif
+
+
+#if defined(__x86_64__)
+/*
+ * Returns eight consecutive elevations as floats, with those that have no data
+ * replaced by the centre elevations.
+ */
+__attribute__((target("avx2")))
+static inline __m256 loadNeighboursAVX2(signed short *points, __m256 centre)
+{
+    __m256 neighbours = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) points)));
+    return _mm256_blendv_ps(neighbours, centre, _mm256_cmp_ps(neighbours, _mm256_set1_ps(NO_DATA), _CMP_EQ_OQ));
+}
+
+
+/*
+ * Computes the gradients of eight columns at a time. Returns the column it
+ * stopped at, where the next eight would pass end.
+ */
+__attribute__((target("avx2")))
+static int gradientAVX2(signed short **rows, int radius, int first, int column, int end, float *east, float *south)
+{
+    const float *across = smoothing[radius];
+    const float *along = differencing[radius];
+
+    for (; column + 8 <= end; column += 8)
+    {
+        signed short *centrePoints = rows[radius] + column + radius;
+        __m256 centre = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) centrePoints)));
+        __m256 sumEast = _mm256_setzero_ps();
+        __m256 sumSouth = _mm256_setzero_ps();
+        int k;
+        int j;
+
+        for (k = 0; k <= 2 * radius; k++)
+        {
+            for (j = 0; j <= 2 * radius; j++)
+            {
+                __m256 value = loadNeighboursAVX2(rows[k] + column + j, centre);
+                sumEast = _mm256_add_ps(sumEast, _mm256_mul_ps(_mm256_set1_ps(across[k] * along[j]), value));
+                sumSouth = _mm256_add_ps(sumSouth, _mm256_mul_ps(_mm256_set1_ps(along[k] * across[j]), value));
+            }
+        }
+
+        _mm256_storeu_ps(east + column - first, sumEast);
+        _mm256_storeu_ps(south + column - first, sumSouth);
+    }
+
+    return column;
+}
+#endif
+
+
+/*
+ * Computes the unscaled gradient of up to GRADIENT_CHUNK columns of the centre
+ * row, from the given column, with the kernel for the instruction set
+ * getSimdLevel() chooses. east[x] and south[x] are the weighted differences of
+ * elevation towards the east and towards the south at column + x. A unit slope
+ * gives 8 per cell with a radius of 1 and 128 with a radius of 2. Every sum is
+ * of small whole numbers, so each kernel gives exactly the same result.
+ */
+void rowGradients(signed short **rows, int radius, int column, int columns, float *east, float *south)
+{
+    int level = getSimdLevel();
+    int end = column + columns;
+    int next = column;
+
+#if defined(__x86_64__)
+    if (level >= SIMD_AVX2)
+        next = gradientAVX2(rows, radius, column, next, end, east, south);
+#endif
+
+#ifdef __SSE2__
+    if (level >= SIMD_SSE2)
+        next = gradientSSE2(rows, radius, column, next, end, east, south);
+#endif
+
+    gradientColumns(rows, radius, column, next, end, east, south);
+}
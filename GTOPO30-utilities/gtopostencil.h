@@ -0,0 +1,32 @@
+#include "gtopoio.h"
+
+/*
+ * Returns the elevation of a neighbour, or the centre elevation in its place if
+ * the neighbour has no data.
+ */
+#define NEIGHBOUR(value, centre) ((value) == NO_DATA ? (centre) : (value))
+
+// Most columns rowGradients() is asked for at once, so callers can keep the results on the stack.
+#define GRADIENT_CHUNK 256
+
+typedef struct stencil gtopoStencil;
+
+/*
+ * A neighbourhood operation run by runStencil(). The kernel computes one output
+ * row from the 2 * radius + 1 rows centred on it: rows[k][radius + column] is the
+ * elevation at the given column of the row k - radius rows away. Output points
+ * are outputSize bytes each. Wherever the centre elevation is NO_DATA, the kernel's
+ * output is replaced by the bytes of noDataOutput.
+ */
+struct stencil
+{
+    int radius;
+    int outputSize;
+    void (*kernel)(signed short **rows, int width, void *settings, unsigned char *output);
+    void *settings;
+    unsigned char noDataOutput[8];
+};
+
+void runStencil(gtopoStencil *operation, char *inputPath, int width, int height, FILE *outputFile, char *outputPath);
+void setDEMOutput(unsigned char *output, int column, signed short value);
+void rowGradients(signed short **rows, int radius, int column, int columns, float *east, float *south);
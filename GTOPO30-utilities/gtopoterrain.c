@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "gtopostencil.h"
+
+#define PI 3.14159265358979323846
+
+/*
+ * Computes the rates of change of elevation towards the east and towards the
+ * south of up to GRADIENT_CHUNK columns of the centre row, from the given column.
+ * A radius of 1 uses Horn's 3x3 gradient and a radius of 2 a smoothed 5x5
+ * gradient, which is less sensitive to noise. NO_DATA neighbours are replaced by
+ * the centre elevation.
+ */
+static void gradients(signed short **rows, int radius, int column, int columns, float *east, float *south)
+{
+    rowGradients(rows, radius, column, columns, east, south);
+
+    // The 3x3 weights difference a unit slope to 8 per cell and the 5x5 ones to 128.
+    int x;
+    for (x = 0; x < columns; x++)
+    {
+        east[x] = east[x] / (radius == 1 ? 8 * CELL_SIZE : 128 * CELL_SIZE);
+        south[x] = south[x] / (radius == 1 ? 8 * CELL_SIZE : 128 * CELL_SIZE);
+    }
+}
+
+
+/*
+ * Computes the slope of a row in whole degrees from horizontal.
+ */
+static void slopeRow(signed short **rows, int width, void *settings, unsigned char *output)
+{
+    int radius = *(int *) settings;
+    float east[GRADIENT_CHUNK];
+    float south[GRADIENT_CHUNK];
+
+    int first;
+    for (first = 0; first < width; first += GRADIENT_CHUNK)
+    {
+        int columns = width - first < GRADIENT_CHUNK ? width - first : GRADIENT_CHUNK;
+        gradients(rows, radius, first, columns, east, south);
+
+        int x;
+        for (x = 0; x < columns; x++)
+        {
+            float degrees = atanf(sqrtf(east[x] * east[x] + south[x] * south[x])) * (180 / PI);
+            setDEMOutput(output, first + x, (signed short) (degrees + 0.5f));
+        }
+    }
+}
+
+
+/*
+ * Computes the aspect of a row: the direction the slope faces, in whole degrees
+ * clockwise from north. Flat ground has no aspect and is given NO_DATA.
+ */
+static void aspectRow(signed short **rows, int width, void *settings, unsigned char *output)
+{
+    int radius = *(int *) settings;
+    float east[GRADIENT_CHUNK];
+    float south[GRADIENT_CHUNK];
+
+    int first;
+    for (first = 0; first < width; first += GRADIENT_CHUNK)
+    {
+        int columns = width - first < GRADIENT_CHUNK ? width - first : GRADIENT_CHUNK;
+        gradients(rows, radius, first, columns, east, south);
+
+        int x;
+        for (x = 0; x < columns; x++)
+        {
+            // The slope faces downhill, against the gradient.
+            int degrees = (int) (atan2f(-east[x], south[x]) * (180 / PI) + 360.5f) % 360;
+            setDEMOutput(output, first + x, east[x] == 0 && south[x] == 0 ? NO_DATA : degrees);
+        }
+    }
+}
+
+
+/*
+ * Streams a DEM through a kernel writing a DEM of the same dimensions.
+ */
+static void writeTerrainDEM(char *inputPath, int width, int height, char *outputPath, int neighbourhood,
+                void (*kernel)(signed short **rows, int width, void *settings, unsigned char *output))
+{
+    error = NULL;
+
+    FILE *outputFile = fopen(outputPath, "wb");
+
+    // Check that the file path exists.
+    error = checkInvalidFileName(outputFile, outputPath);
+    if (error != NULL)
+        return;
+
+    int radius = neighbourhood / 2;
+
+    gtopoStencil operation;
+    operation.radius = radius;
+    operation.outputSize = sizeof(signed short);
+    operation.kernel = kernel;
+    operation.settings = &radius;
+    setDEMOutput(operation.noDataOutput, 0, NO_DATA);
+
+    runStencil(&operation, inputPath, width, height, outputFile, outputPath);
+
+    // Check that the output was closed, as long as nothing went wrong before.
+    int failed = fclose(outputFile) != 0;
+    if (error == NULL)
+        error = checkOutputWritten(failed, outputPath);
+}
+
+
+/*
+ * Writes the slope of the DEM at inputPath, in degrees, as a DEM to outputPath.
+ * The neighbourhood is the width of the gradient stencil, 3 or 5. Can return an
+ * error.
+ */
+void slope(char *inputPath, int width, int height, char *outputPath, int neighbourhood)
+{
+    writeTerrainDEM(inputPath, width, height, outputPath, neighbourhood, slopeRow);
+}
+
+
+/*
+ * Writes the aspect of the DEM at inputPath, in degrees clockwise from north, as a
+ * DEM to outputPath. The neighbourhood is the width of the gradient stencil, 3 or
+ * 5. Can return an error.
+ */
+void aspect(char *inputPath, int width, int height, char *outputPath, int neighbourhood)
+{
+    writeTerrainDEM(inputPath, width, height, outputPath, neighbourhood, aspectRow);
+}
@@ -0,0 +1,4 @@
+#include "gtopoio.h"
+
+void slope(char *inputPath, int width, int height, char *outputPath, int neighbourhood);
+void aspect(char *inputPath, int width, int height, char *outputPath, int neighbourhood);
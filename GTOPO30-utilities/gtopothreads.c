@@ -0,0 +1,422 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Most worker threads that -j or GTOPO_THREADS may ask for.
+#define MAX_THREADS 1024
+
+// Fewest elevation points in a band, so that splitting work never costs more than it saves.
+#define MIN_BAND_POINTS 16384
+
+
+/*
+ * The number of worker threads set by the -j flag, or 0 to take it from the
+ * GTOPO_THREADS environment variable or the number of processors.
+ */
+static int threadCount = 0;
+
+// Set on threads running the tasks of a parallel call, so that calls made by those tasks run inline.
+static _Thread_local int insideWorker = 0;
+
+
+/*
+ * State shared by the worker threads of a parallelFor() call. Workers claim the
+ * next unclaimed index under the lock until every index has been run.
+ */
+typedef struct parallelJob
+{
+    int count;
+    int next;
+    void (*task)(int index, void *arg);
+    void *arg;
+    pthread_mutex_t lock;
+} parallelJob;
+
+
+/*
+ * Rows of a parallelRows() call still to be run by one worker, from next up to
+ * end. The worker takes bands from the front, and idle workers steal from the
+ * back.
+ */
+typedef struct rowQueue
+{
+    int next;
+    int end;
+    pthread_mutex_t lock;
+} rowQueue;
+
+
+/*
+ * State shared by the worker threads of a parallelRows() call.
+ */
+typedef struct rowsJob
+{
+    rowQueue *queues;
+    int threads;
+    int minimumRows;
+    void (*task)(int firstRow, int rows, void *arg);
+    void *arg;
+} rowsJob;
+
+
+/*
+ * Parses a thread count, which must be an integer from 1 to MAX_THREADS. Returns
+ * it, or 0 if it is not valid.
+ */
+static int parseThreadCount(char *value)
+{
+    char *end;
+    long threads = strtol(value, &end, 10);
+
+    if (*value == '\0' || *end != '\0' || threads < 1 || threads > MAX_THREADS)
+        return 0;
+
+    return (int) threads;
+}
+
+
+/*
+ * Removes a -j flag, given as -j threads or -jthreads, from anywhere in the
+ * arguments, and uses that many worker threads from then on. Returns 1 if the
+ * thread count given is not valid and 0 otherwise.
+ */
+int takeThreadFlag(int *argc, char **argv)
+{
+    int kept = 1;
+    int invalid = 0;
+    int x;
+
+    for (x = 1; x < *argc; x++)
+    {
+        if (strncmp(argv[x], "-j", 2) != 0)
+        {
+            argv[kept++] = argv[x];
+            continue;
+        }
+
+        char *value = argv[x][2] != '\0' ? argv[x] + 2 : (x + 1 < *argc ? argv[++x] : "");
+        threadCount = parseThreadCount(value);
+        invalid |= threadCount == 0;
+    }
+
+    argv[kept] = NULL;
+    *argc = kept;
+    return invalid;
+}
+
+
+/*
+ * Returns the number of worker threads the user asked for, given by the -j flag
+ * or else by the GTOPO_THREADS environment variable, or 0 if they asked for none.
+ */
+int getRequestedThreads()
+{
+    if (threadCount > 0)
+        return threadCount;
+
+    char *setting = getenv("GTOPO_THREADS");
+    if (setting != NULL)
+        return parseThreadCount(setting);
+
+    return 0;
+}
+
+
+/*
+ * Returns the number of worker threads to use. This is the number the user asked
+ * for with getRequestedThreads(), or else the number of online processors.
+ */
+int getThreadCount()
+{
+    int requested = getRequestedThreads();
+    if (requested > 0)
+        return requested;
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (processors < 1)
+        return 1;
+
+    return (int) processors;
+}
+
+
+/*
+ * Repeatedly claims and runs the next index of the job until none are left.
+ */
+static void* runWorker(void *jobPointer)
+{
+    parallelJob *job = (parallelJob *) jobPointer;
+    int wasInsideWorker = insideWorker;
+    insideWorker = 1;
+
+    while (1)
+    {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next;
+        job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (index >= job->count)
+            break;
+
+        job->task(index, job->arg);
+    }
+
+    insideWorker = wasInsideWorker;
+    return NULL;
+}
+
+
+/*
+ * Runs task(index, arg) for every index from 0 up to count - 1 across the given
+ * number of worker threads, returning once all of them have finished. Tasks may
+ * run in any order, so each must only write to data that no other index touches.
+ * If threads cannot be started, the remaining work runs on the calling thread,
+ * as does all of it when called from a task of another parallel call, whose
+ * workers already occupy the processors.
+ */
+void parallelForThreads(int count, int threads, void (*task)(int index, void *arg), void *arg)
+{
+    if (insideWorker)
+    {
+        int index;
+        for (index = 0; index < count; index++)
+        {
+            task(index, arg);
+        }
+
+        return;
+    }
+
+    parallelJob job;
+    job.count = count;
+    job.next = 0;
+    job.task = task;
+    job.arg = arg;
+    pthread_mutex_init(&job.lock, NULL);
+
+    if (threads > count)
+        threads = count;
+
+    if (threads < 1)
+        threads = 1;
+
+    pthread_t *workers = (pthread_t *) malloc(sizeof(pthread_t) * threads);
+    int started = 0;
+
+    // The calling thread is the first worker, so only start the others.
+    if (workers != NULL)
+    {
+        while (started < threads - 1 && pthread_create(&workers[started], NULL, runWorker, &job) == 0)
+            started++;
+    }
+
+    runWorker(&job);
+
+    int x;
+    for (x = 0; x < started; x++)
+    {
+        pthread_join(workers[x], NULL);
+    }
+
+    free(workers);
+    pthread_mutex_destroy(&job.lock);
+}
+
+
+/*
+ * Runs task(index, arg) for every index from 0 up to count - 1 across one worker
+ * thread per processor, as parallelForThreads() does.
+ */
+void parallelFor(int count, void (*task)(int index, void *arg), void *arg)
+{
+    parallelForThreads(count, getThreadCount(), task, arg);
+}
+
+
+/*
+ * Takes the next band of rows from a queue: half of what is left, but no fewer
+ * than the job's minimum, so that bands start large and shrink as the rows run
+ * out. Returns the number of rows taken, from *firstRow, or 0 if none are left.
+ */
+static int takeRows(rowsJob *job, rowQueue *queue, int *firstRow)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    int left = queue->end - queue->next;
+    int rows = left / 2 > job->minimumRows ? left / 2 : job->minimumRows;
+    rows = rows < left ? rows : left;
+
+    *firstRow = queue->next;
+    queue->next += rows;
+
+    pthread_mutex_unlock(&queue->lock);
+    return rows;
+}
+
+
+/*
+ * Steals the back half of the rows left to the worker with the most, moving them
+ * to the thief's own queue. Returns 0 if no worker had rows enough to split.
+ */
+static int stealRows(rowsJob *job, int thief)
+{
+    int victim = -1;
+    int most = 0;
+    int x;
+
+    for (x = 0; x < job->threads; x++)
+    {
+        pthread_mutex_lock(&job->queues[x].lock);
+        int left = job->queues[x].end - job->queues[x].next;
+        pthread_mutex_unlock(&job->queues[x].lock);
+
+        if (x != thief && left > most)
+        {
+            victim = x;
+            most = left;
+        }
+    }
+
+    if (victim < 0)
+        return 0;
+
+    rowQueue *queue = &job->queues[victim];
+    pthread_mutex_lock(&queue->lock);
+
+    // The victim may have taken rows since it was chosen, so only steal what is left.
+    int left = queue->end - queue->next;
+    int stolen = left > job->minimumRows ? left / 2 : left;
+    int firstRow = queue->end - stolen;
+    queue->end = firstRow;
+
+    pthread_mutex_unlock(&queue->lock);
+
+    rowQueue *own = &job->queues[thief];
+    pthread_mutex_lock(&own->lock);
+    own->next = firstRow;
+    own->end = firstRow + stolen;
+    pthread_mutex_unlock(&own->lock);
+
+    // Another thief may have emptied the victim first, so look again.
+    return 1;
+}
+
+
+/*
+ * Arguments for one worker of a parallelRows() call.
+ */
+typedef struct rowsWorker
+{
+    rowsJob *job;
+    int index;
+} rowsWorker;
+
+
+/*
+ * Runs bands of the worker's own rows until they run out, then steals rows from
+ * the other workers until there are none left to steal.
+ */
+static void* runRowsWorker(void *workerPointer)
+{
+    rowsWorker *worker = (rowsWorker *) workerPointer;
+    rowsJob *job = worker->job;
+    int wasInsideWorker = insideWorker;
+    insideWorker = 1;
+
+    while (1)
+    {
+        int firstRow;
+        int rows = takeRows(job, &job->queues[worker->index], &firstRow);
+
+        if (rows > 0)
+            job->task(firstRow, rows, job->arg);
+        else if (stealRows(job, worker->index) == 0)
+            break;
+    }
+
+    insideWorker = wasInsideWorker;
+    return NULL;
+}
+
+
+/*
+ * Runs task(firstRow, rows, arg) over bands of rows that together cover every row
+ * from 0 up to height - 1 exactly once, for a raster of rowPoints points a row.
+ * Each worker thread starts with an equal share of the rows and takes bands from
+ * it, half of what it has left at a time. A worker that runs out steals half of
+ * what is left to the busiest, so rows that finish quickly, such as those all
+ * NO_DATA, never leave workers idle while others have work queued. Bands may run
+ * in any order, so each must only write to data that no other row touches. Small
+ * rasters, and calls made from the tasks of another parallel call, run on the
+ * calling thread alone.
+ */
+void parallelRows(int height, int rowPoints, void (*task)(int firstRow, int rows, void *arg), void *arg)
+{
+    rowsJob job;
+    job.minimumRows = MIN_BAND_POINTS / (rowPoints > 0 ? rowPoints : 1);
+    job.minimumRows = job.minimumRows > 1 ? job.minimumRows : 1;
+    job.task = task;
+    job.arg = arg;
+
+    job.threads = getThreadCount();
+    if (job.threads > height / job.minimumRows)
+        job.threads = height / job.minimumRows;
+
+    if (height <= 0)
+        return;
+
+    if (job.threads <= 1 || insideWorker)
+    {
+        task(0, height, arg);
+        return;
+    }
+
+    job.queues = (rowQueue *) malloc(sizeof(rowQueue) * job.threads);
+    pthread_t *threads = (pthread_t *) malloc(sizeof(pthread_t) * job.threads);
+    rowsWorker *workers = (rowsWorker *) malloc(sizeof(rowsWorker) * job.threads);
+
+    if (job.queues == NULL || threads == NULL || workers == NULL)
+    {
+        free(job.queues);
+        free(threads);
+        free(workers);
+        task(0, height, arg);
+        return;
+    }
+
+    int x;
+    for (x = 0; x < job.threads; x++)
+    {
+        job.queues[x].next = (int) ((long) height * x / job.threads);
+        job.queues[x].end = (int) ((long) height * (x + 1) / job.threads);
+        pthread_mutex_init(&job.queues[x].lock, NULL);
+
+        workers[x].job = &job;
+        workers[x].index = x;
+    }
+
+    // The calling thread is the first worker, so only start the others.
+    int started = 1;
+    while (started < job.threads && pthread_create(&threads[started], NULL, runRowsWorker, &workers[started]) == 0)
+        started++;
+
+    // Rows of workers that could not be started are stolen by those that were.
+    runRowsWorker(&workers[0]);
+
+    for (x = 1; x < started; x++)
+    {
+        pthread_join(threads[x], NULL);
+    }
+
+    for (x = 0; x < job.threads; x++)
+    {
+        pthread_mutex_destroy(&job.queues[x].lock);
+    }
+
+    free(job.queues);
+    free(threads);
+    free(workers);
+}
@@ -0,0 +1,6 @@
+int takeThreadFlag(int *argc, char **argv);
+int getRequestedThreads();
+int getThreadCount();
+void parallelForThreads(int count, int threads, void (*task)(int index, void *arg), void *arg);
+void parallelFor(int count, void (*task)(int index, void *arg), void *arg);
+void parallelRows(int height, int rowPoints, void (*task)(int firstRow, int rows, void *arg), void *arg);
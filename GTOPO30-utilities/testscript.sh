@@ -23,12 +23,12 @@ passed=0
 failed=0
 
 # Hide the output of makefile all target
-make all > /dev/null
+make all gtopoBench > /dev/null
 
 echo -n Test 1: Usage message displayed when no arguments are given to gtopoEcho
 exeOut="$(./gtopoEcho)"
-expected="Usage: ./gtopoEcho inputFile width height outputFile"
-if [[ $exeOut =  $expected ]]; then
+expected="Usage: ./gtopoEcho inputFile width height outputFile [writeMode]"
+if [[ $exeOut = "$expected" ]]; then
     printPassed
     passed=$((passed+1))
 else
@@ -187,6 +187,1353 @@ fi
 numberOfTests=$((numberOfTests+1))
 
 
+echo -n Test 11: Usage message displayed when no arguments are given to gtopoPack
+exeOut="$(./gtopoPack)"
+expected="Usage: ./gtopoPack inputFile width height outputFile"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 12: Usage message displayed when no arguments are given to gtopoUnpack
+exeOut="$(./gtopoUnpack)"
+expected="Usage: ./gtopoUnpack inputFile outputFile [row column width height]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 13: gtopoPack and gtopoUnpack reproduce the original DEM file
+./gtopoPack gtopoDEMs/coast.dem 120 90 output.gtpk > /dev/null
+exeOut="$(./gtopoUnpack output.gtpk output.dem)"
+expected="UNPACKED"
+comparison="$(cmp gtopoDEMs/coast.dem output.dem)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $comparison = "" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file was different
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.gtpk output.dem
+
+
+echo -n Test 14: gtopoUnpack rejects a window outside of the DEM
+exeOut="$(./gtopoPack gtopoDEMs/coast.dem 120 90 output.gtpk > /dev/null; ./gtopoUnpack output.gtpk output.dem 80 20 30 40)"
+expected="ERROR: Miscellaneous (Window must have positive dimensions and lie within the DEM)"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f output.gtpk output.dem
+
+
+echo -n Test 15: gtopoEcho writes a bit-packed DEM file that reads back identically
+./gtopoEcho gtopoDEMs/coast.dem 120 90 output.gtbp 1 > /dev/null
+exeOut="$(./gtopoEcho output.gtbp 120 90 output.dem)"
+expected="ECHOED"
+comparison="$(cmp gtopoDEMs/coast.dem output.dem)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $comparison = "" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file was different
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.gtbp output.dem
+
+
+echo -n Test 16: Usage message displayed when no arguments are given to gtopoHillshade
+exeOut="$(./gtopoHillshade)"
+expected="Usage: ./gtopoHillshade inputFile width height outputFile.pgm [azimuth altitude zFactor]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 17: gtopoHillshade writes a binary pgm of the same dimensions as the DEM
+exeOut="$(./gtopoHillshade gtopoDEMs/coast.dem 120 90 output.pgm 315 45 2)"
+expected="SHADED"
+header="$(head -c 14 output.pgm | tr '\n' ' ')"
+size="$(stat -c %s output.pgm)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $header = "P5 120 90 255 " && $size = 10814 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file had the wrong header or size
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.pgm
+
+
+echo -n Test 18: Usage message displayed when no arguments are given to gtopoSlope
+exeOut="$(./gtopoSlope)"
+expected="Usage: ./gtopoSlope inputFile width height outputFile [neighbourhood]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 19: gtopoAspect rejects a neighbourhood other than 3 or 5
+exeOut="$(./gtopoAspect gtopoDEMs/coast.dem 120 90 output.dem 4)"
+expected="ERROR: Miscellaneous (Neighbourhood must be 3 or 5)"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 20: gtopoSlope and gtopoAspect write valid DEMs of the same dimensions
+slopeOut="$(./gtopoSlope gtopoDEMs/coast.dem 120 90 slope.dem 5)"
+aspectOut="$(./gtopoAspect gtopoDEMs/coast.dem 120 90 aspect.dem)"
+exeOut="$slopeOut $aspectOut $(./gtopoEcho slope.dem 120 90 output.dem) $(./gtopoEcho aspect.dem 120 90 output.dem)"
+expected="SLOPED ASPECTED ECHOED ECHOED"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm slope.dem aspect.dem output.dem
+
+
+echo -n Test 21: Usage message displayed when no arguments are given to gtopoInundate
+exeOut="$(./gtopoInundate)"
+expected="Usage: ./gtopoInundate inputFile width height outputFile seaLevel"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 22: gtopoInundate rejects a sea level outside the range of elevations
+exeOut="$(./gtopoInundate gtopoDEMs/coast.dem 120 90 output.txt 9000)"
+expected="ERROR: Miscellaneous (Sea level must be an integer between -407 and 8752)"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 23: gtopoInundate floods the coast from the ocean but not the inland basin
+exeOut="$(./gtopoInundate gtopoDEMs/coast.dem 120 90 output.txt 0)"
+expected="INUNDATED"
+flooded="$(tr -cd '~' < output.txt | wc -c)"
+basin="$(sed -n 61p output.txt | cut -c 91)"
+size="$(stat -c %s output.txt)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $flooded = 243 && $basin = "." && $size = 10889 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file flooded the wrong land
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.txt
+
+
+echo -n Test 24: Usage message displayed when no arguments are given to gtopoRegion
+exeOut="$(./gtopoRegion)"
+expected="Usage: ./gtopoRegion integralFile row column width height"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 25: gtopoRegion reports the mean elevation and land fraction of a region from its summed-area table
+./gtopoIntegral gtopoDEMs/coast.dem 120 90 coast.sat > /dev/null
+exeOut="$(./gtopoRegion coast.sat 0 0 120 90) $(./gtopoRegion coast.sat 85 0 10 5)"
+expected="884.28 0.6965 -9999.00 0.0000"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 26: gtopoRegion rejects a region outside the DEM
+exeOut="$(./gtopoRegion coast.sat 80 0 10 20)"
+expected="ERROR: Miscellaneous (Window must have positive dimensions and lie within the DEM)"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm coast.sat
+
+
+echo -n Test 27: gtopoPrintLand builds a min/max pyramid beside the DEM and prints the same land when reusing it
+exeOut="$(./gtopoPrintLand gtopoDEMs/coast.dem 120 90 output.txt 0 100 1000)"
+built="$(test -f gtopoDEMs/coast.dem.pyr && echo PYRAMID)"
+./gtopoPrintLand gtopoDEMs/coast.dem 120 90 reused.txt 0 100 1000
+comparison="$(cmp output.txt reused.txt)"
+sea="$(tr -cd ' ' < output.txt | wc -c)"
+mountains="$(tr -cd 'A' < output.txt | wc -c)"
+if [[ $exeOut = "" && $built = "PYRAMID" && $comparison = "" ]]; then
+    if [[ $sea = 3642 && $mountains = 3250 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file printed the wrong land
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    echo Pyramid was not built or gave different output
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.txt reused.txt gtopoDEMs/coast.dem.pyr
+
+
+echo -n Test 28: Usage message displayed when no arguments are given to gtopoQuery
+exeOut="$(./gtopoQuery)"
+expected="Usage: ./gtopoQuery inputFile width height outputFile low high"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 29: gtopoQuery lists the elevation points within a range in row order
+exeOut="$(./gtopoQuery gtopoDEMs/coast.dem 120 90 output.txt 1900 8752)"
+expected="QUERIED"
+matches="$(wc -l < output.txt)"
+first="$(head -n 1 output.txt)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $matches = 137 && $first = "30 85 1906" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file listed the wrong elevation points
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.txt gtopoDEMs/coast.dem.pyr
+
+
+echo -n Test 30: Usage message displayed when no arguments are given to gtopoStats
+exeOut="$(./gtopoStats)"
+expected="Usage: ./gtopoStats inputFile width height [histogramFile]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 31: gtopoStats reports the statistics and writes a 1 metre histogram of a DEM
+exeOut="$(./gtopoStats gtopoDEMs/coast.dem 120 90 output.txt | tr '\n' ' ')"
+expected="MIN -50 MAX 2083 MEAN 884.28 STDDEV 565.61 NO_DATA 3278 "
+bins="$(wc -l < output.txt)"
+lowest="$(grep -- '^-50 ' output.txt)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $bins = 9160 && $lowest = "-50 1" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file had the wrong histogram
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.txt
+
+
+echo -n Test 32: Usage message displayed when no arguments are given to gtopoResample
+exeOut="$(./gtopoResample)"
+expected="Usage: ./gtopoResample inputFile width height outputFile outputWidth outputHeight [filter]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 33: gtopoResample rejects an unknown filter
+exeOut="$(./gtopoResample gtopoDEMs/coast.dem 120 90 output.dem 60 45 blur)"
+expected="ERROR: Miscellaneous (Filter must be nearest, bilinear, bicubic or lanczos)"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 34: gtopoResample writes a valid DEM of the requested size and keeps a same size DEM unchanged
+exeOut="$(./gtopoResample gtopoDEMs/coast.dem 120 90 output.dem 60 45 bicubic)"
+expected="RESAMPLED"
+exeEchoOut="$(./gtopoEcho output.dem 60 45 echoed.dem)"
+size="$(wc -c < output.dem)"
+./gtopoResample gtopoDEMs/coast.dem 120 90 output.dem 120 90 lanczos > /dev/null
+exeCompOut="$(./gtopoComp gtopoDEMs/coast.dem 120 90 output.dem)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $exeEchoOut = "ECHOED" && $size = 5400 && $exeCompOut = "IDENTICAL" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file was not resampled correctly
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem echoed.dem
+
+
+echo -n Test 35: Usage message displayed when no arguments are given to gtopoBatch
+exeOut="$(./gtopoBatch)"
+expected="Usage: ./gtopoBatch jobFile"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 36: gtopoBatch reports the line of an invalid job without running any
+printf 'reduce gtopoDEMs/coast.dem 120 90 2 output.dem\ntile gtopoDEMs/coast.dem 120 90 2 output.dem\n' > jobs.txt
+exeOut="$(./gtopoBatch jobs.txt)"
+expected="ERROR: Miscellaneous (<row> and <column> tags were not found in output file name template) on line 2 of jobs.txt"
+if [[ $exeOut = "$expected" && ! -e output.dem ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 37: gtopoBatch writes the same files as running each program on its own
+printf '# Reductions, tiles and land of the coast\nreduce gtopoDEMs/coast.dem 120 90 3 batch_reduced.dem\n\ntile gtopoDEMs/coast.dem 120 90 2 batch_<row>_<column>.dem\nprintland gtopoDEMs/coast.dem 120 90 batch_land.txt 0 500 1500\n' > jobs.txt
+exeOut="$(./gtopoBatch jobs.txt)"
+expected="BATCHED"
+./gtopoReduce gtopoDEMs/coast.dem 120 90 3 reduced.dem > /dev/null
+./gtopoTile gtopoDEMs/coast.dem 120 90 2 tile_\<row\>_\<column\>.dem > /dev/null
+./gtopoPrintLand gtopoDEMs/coast.dem 120 90 land.txt 0 500 1500 > /dev/null
+if [[ $exeOut = $expected ]]; then
+    if cmp -s batch_reduced.dem reduced.dem && cmp -s batch_1_1.dem tile_1_1.dem && cmp -s batch_0_1.dem tile_0_1.dem && cmp -s batch_land.txt land.txt; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Batch output files differed from those of the programs
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm jobs.txt batch_*.dem tile_*.dem reduced.dem batch_land.txt land.txt gtopoDEMs/coast.dem.pyr
+
+
+echo -n Test 38: Usage message displayed when no arguments are given to gtopoBench
+exeOut="$(./gtopoBench)"
+expected="Usage: ./gtopoBench width height [repeats] [scratchDirectory]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 39: gtopoBench prints a timing line for every benchmark and removes its scratch files
+exeOut="$(./gtopoBench 120 90 1 .)"
+header="$(echo "$exeOut" | head -n 1)"
+benchmarks="$(echo "$exeOut" | grep -c ',120,90,')"
+if [[ $header = "benchmark,width,height,seconds,mb_per_second,samples_per_second,peak_rss_kb" && $benchmarks = 7 ]]; then
+    if [[ ! -e gtopoBench.dem && ! -e gtopoBench.txt && ! -e gtopoBench.dem.pyr ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Scratch files were left behind
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "7 benchmarks" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 40: --profile=json prints the phase timings and counters of a program on stderr
+exeOut="$(./gtopoReduce gtopoDEMs/coast.dem 120 90 2 output.dem --profile=json 2> profile.txt)"
+expected="REDUCED"
+profile="$(cat profile.txt)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $profile =~ ^\{\"program\":\"gtopoReduce\",\"seconds\":\{\"args\":[0-9.]+,\"read\":[0-9.]+,\"compute\":[0-9.]+,\"write\":[0-9.]+,\"free\":[0-9.]+,\"total\":[0-9.]+\},\"bytes_read\":[0-9]+,\"bytes_written\":5400,\"allocations\":[0-9]+,\"peak_rss_kb\":[0-9]+\}$ ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        assertionFailed "JSON profile" "\${profile}"
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem profile.txt
+
+
+echo -n Test 41: gtopoTile at a large factor and gtopoAssemble of every tile reproduce the DEM
+exeOut="$(./gtopoTile gtopoDEMs/coast.dem 120 90 10 tile_\<row\>_\<column\>.dem)"
+expected="TILED"
+tuples=""
+for row in {0..9}; do
+    for column in {0..9}; do
+        tuples="$tuples $((row*9)) $((column*12)) tile_${row}_${column}.dem 12 9"
+    done
+done
+./gtopoAssemble assembled.dem 120 90 $tuples > /dev/null
+if [[ $exeOut = $expected ]]; then
+    if cmp -s assembled.dem gtopoDEMs/coast.dem; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Assembled DEM differed from the tiled DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm tile_*.dem assembled.dem
+
+echo -n Test 42: GTOPO_ALLOC_POLICY=spread assembles a DEM larger than a huge page identically
+./gtopoAssemble default.dem 1200 900 0 0 gtopoDEMs/coast.dem 120 90 600 1080 gtopoDEMs/coast.dem 120 90 > /dev/null
+exeOut="$(GTOPO_ALLOC_POLICY=spread ./gtopoAssemble spread.dem 1200 900 0 0 gtopoDEMs/coast.dem 120 90 600 1080 gtopoDEMs/coast.dem 120 90)"
+expected="ASSEMBLED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s default.dem spread.dem; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo DEM assembled with spread rasters differed
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm default.dem spread.dem
+
+echo -n Test 43: gtopoAssemble sets only the points no sub-DEM covers to NO_DATA
+./gtopoAssemble output.dem 130 95 5 10 gtopoDEMs/coast.dem 120 90 > /dev/null
+exeOut="$(./gtopoStats output.dem 130 95 | grep NO_DATA)"
+expected="NO_DATA 4828"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem
+
+echo -n Test 44: gtopoEcho reads auto dimensions from a .HDR file beside a raw DEM
+cp gtopoDEMs/coast.dem header.dem
+printf "BYTEORDER      M\nLAYOUT         BIL\nNROWS          90\nNCOLS          120\nNBANDS         1\nNBITS          16\nBANDROWBYTES   240\nTOTALROWBYTES  240\nBANDGAPBYTES   0\nNODATA         -9999\nULXMAP         -139.99583333333334\nULYMAP         89.99583333333334\nXDIM           0.00833333333333\nYDIM           0.00833333333333\n" > header.HDR
+exeOut="$(./gtopoEcho header.dem auto auto output.dem)"
+expected="ECHOED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s output.dem gtopoDEMs/coast.dem; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo DEM echoed with auto dimensions differed
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem
+
+echo -n Test 45: gtopoEcho reads a little-endian raw DEM whose .HDR file has BYTEORDER I
+dd if=gtopoDEMs/coast.dem of=header.dem conv=swab status=none
+sed -i "s/^BYTEORDER      M/BYTEORDER      I/" header.HDR
+exeOut="$(./gtopoEcho header.dem 120 90 output.dem)"
+expected="ECHOED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s output.dem gtopoDEMs/coast.dem; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Little-endian DEM was not converted
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem
+
+echo -n Test 46: gtopoEcho rejects a raw DEM whose .HDR file gives other dimensions
+cp gtopoDEMs/coast.dem header.dem
+sed -i "s/^BYTEORDER      I/BYTEORDER      M/; s/^NROWS          90/NROWS          91/" header.HDR
+exeOut="$(./gtopoEcho header.dem 120 90 output.dem)"
+expected="ERROR: Bad Dimensions (header.dem)"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm header.dem header.HDR
+
+echo -n Test 47: gtopoComp reads auto dimensions from the header of a bit-packed DEM
+./gtopoEcho gtopoDEMs/coast.dem 120 90 packed.dem 1 > /dev/null
+exeOut="$(./gtopoComp packed.dem auto auto gtopoDEMs/coast.dem)"
+expected="IDENTICAL"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm packed.dem
+
+echo -n Test 48: gtopoEcho rejects auto dimensions for a raw DEM without a .HDR file
+exeOut="$(./gtopoEcho gtopoDEMs/coast.dem auto auto output.dem)"
+expected="ERROR: Miscellaneous (Width and height can only be auto for a DEM with a .HDR file or a bit-packed or packed header)"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 49: gtopoWindow reads a window in degrees from the source tile it lies in
+mkdir -p sources
+cp gtopoDEMs/coast.dem sources/E020N40.DEM
+printf "BYTEORDER      M\nNROWS          90\nNCOLS          120\nULXMAP         20.00416666666667\nULYMAP         39.99583333333333\nXDIM           0.00833333333333\nYDIM           0.00833333333333\n" > sources/E020N40.HDR
+./gtopoPack gtopoDEMs/coast.dem 120 90 packed.gtpk > /dev/null
+./gtopoUnpack packed.gtpk unpacked.dem 30 30 60 30 > /dev/null
+exeOut="$(./gtopoWindow sources output.dem 20.25 39.5 20.75 39.75)"
+expected="WINDOWED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s output.dem unpacked.dem && grep -q "^ULXMAP         20.2541666666667$" output.HDR; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Window differed from the unpacked window or was not georeferenced
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm output.dem output.HDR packed.gtpk unpacked.dem
+
+echo -n Test 50: gtopoWindow opens every source tile that the window overlaps
+exeOut="$(./gtopoWindow sources output.dem 19.5 39.5 20.75 39.75)"
+expected="ERROR: Bad File Name (sources/W020N40.DEM)"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 51: gtopoAssemble places georeferenced tiles from gtopoTile by their coordinates
+./gtopoTile sources/E020N40.DEM auto auto 3 sources/tile_\<row\>_\<column\>.dem > /dev/null
+tuples=""
+for tile in sources/tile_*.dem; do
+    tuples="$tuples auto auto $tile auto auto"
+done
+exeOut="$(./gtopoAssemble output.dem 120 90 $tuples)"
+expected="ASSEMBLED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s output.dem gtopoDEMs/coast.dem && grep -q "^ULYMAP         39.9958333333333$" output.HDR; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo DEM assembled by coordinates differed
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -r sources output.dem output.HDR
+
+echo -n Test 52: gtopoServe answers point, window and overview requests through its block cache
+./gtopoAssemble serve.dem 600 450 0 0 gtopoDEMs/coast.dem 120 90 200 220 gtopoDEMs/coast.dem 120 90 360 480 gtopoDEMs/coast.dem 120 90 > /dev/null
+./gtopoReduce serve.dem 600 450 3 reduced.dem > /dev/null
+./gtopoServe serve.sock serve.dem 600 450 4 > served.txt &
+for attempt in $(seq 50); do
+    ./gtopoRequest serve.sock STATS > /dev/null && break
+    sleep 0.1
+done
+exeOut="$(./gtopoRequest serve.sock "POINT 250 300"; ./gtopoRequest serve.sock "WINDOW 200 220 120 90" window.dem; ./gtopoRequest serve.sock "OVERVIEW 3 0 0 600 450" overview.dem; ./gtopoRequest serve.sock "POINT 449 599")"
+expected="$(printf "OK 1302\nOK 120 90\nOK 200 150\nOK -9999")"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s window.dem gtopoDEMs/coast.dem && cmp -s overview.dem reduced.dem && [[ "$(./gtopoRequest serve.sock STATS)" = "OK 4 8 4" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Served window or overview differed, or the cache was not used
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 53: gtopoServe answers bad requests with an error and keeps serving
+exeOut="$(./gtopoRequest serve.sock "WINDOW 400 0 10 100"; ./gtopoRequest serve.sock "ELEVATION 1 1"; ./gtopoRequest serve.sock "POINT 0 0")"
+expected="$(printf "ERROR: Miscellaneous (Window must have positive dimensions and lie within the DEM)\nERROR: Miscellaneous (%s)\nOK -9999" "Requests must be POINT row column, WINDOW row column width height, OVERVIEW factor row column width height, STATS or SHUTDOWN")"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 54: gtopoServe shuts down on request and removes its socket
+./gtopoRequest serve.sock SHUTDOWN > shutdown.txt
+wait
+exeOut="$(cat shutdown.txt served.txt)"
+expected="$(printf "OK\nSERVED")"
+if [[ $exeOut = $expected && ! -e serve.sock ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f serve.dem reduced.dem window.dem overview.dem served.txt shutdown.txt serve.sock
+
+echo -n Test 55: gtopoSample samples rows and columns at the nearest cell, in the order given
+printf "0 0\n45.2 59.7\n30.4 80.6\n-3 5\n" > points.txt
+exeOut="$(./gtopoSample gtopoDEMs/coast.dem 120 90 cells points.txt samples.txt)"
+expected="SAMPLED"
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(cat samples.txt)" = "$(printf "%s\n" -9999 762 1759 -9999)" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Samples differed from the cells of the DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 56: gtopoSample interpolates bilinearly without letting NO_DATA bleed in
+printf "30.25 80.5\n0.5 25.5\n0.9 25.1\n" > points.txt
+exeOut="$(./gtopoSample gtopoDEMs/coast.dem 120 90 cells points.txt samples.txt bilinear)"
+expected="SAMPLED"
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(cat samples.txt)" = "$(printf "%s\n" 1743 -5 -9999)" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Interpolated samples differed
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+echo -n Test 57: gtopoSample finds points in degrees on the grid of the .HDR file of the DEM
+cp gtopoDEMs/coast.dem header.dem
+printf "NROWS          90\nNCOLS          120\nULXMAP         -139.99583333333334\nULYMAP         89.99583333333334\n" > header.HDR
+printf "89.62083333333334 -139.49583333333334\n\n89.74583333333334 -139.32083333333334\n" > points.txt
+exeOut="$(./gtopoSample header.dem auto auto degrees points.txt samples.txt)"
+expected="SAMPLED"
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(cat samples.txt)" = "$(printf "%s\n" 762 1759)" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Samples in degrees differed from the cells of the DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm header.dem header.HDR samples.txt
+
+echo -n Test 58: gtopoSample reports the line of a malformed point
+printf "1 2\n3 north\n" > points.txt
+exeOut="$(./gtopoSample gtopoDEMs/coast.dem 120 90 cells points.txt samples.txt)"
+expected="ERROR: Miscellaneous (Points must be a row and column, or a latitude and longitude, separated by white space) on line 2 of points.txt"
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm points.txt
+
+echo -n Test 59: gtopoAssemble --incremental patches only the sub-DEM that changed into the output
+cp gtopoDEMs/coast.dem part.dem
+./gtopoAssemble --incremental mosaic.dem 300 250 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 > /dev/null
+./gtopoSlope gtopoDEMs/coast.dem 120 90 part.dem > /dev/null
+exeOut="$(./gtopoAssemble --incremental mosaic.dem 300 250 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 --profile=json 2> profile.txt)"
+./gtopoAssemble full.dem 300 250 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 > /dev/null
+expected="ASSEMBLED"
+if [[ $exeOut = $expected ]]; then
+    # The output is 150000 bytes, but only the 21600 bytes of the changed sub-DEM and the manifest are written.
+    if cmp -s mosaic.dem full.dem && [[ $(cat profile.txt) =~ \"bytes_written\":([0-9]+) ]] && (( BASH_REMATCH[1] < 30000 )); then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Patched output differed from a full assembly, or was written in full
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f mosaic.dem mosaic.dem.manifest full.dem profile.txt
+
+echo -n Test 60: gtopoAssembleReduce --incremental patches the reduced rows a changed sub-DEM touches
+cp gtopoDEMs/coast.dem part.dem
+./gtopoAssembleReduce --incremental mosaic.dem 301 250 3 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 > /dev/null
+./gtopoSlope gtopoDEMs/coast.dem 120 90 part.dem > /dev/null
+exeOut="$(./gtopoAssembleReduce --incremental mosaic.dem 301 250 3 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90)"
+./gtopoAssembleReduce full.dem 301 250 3 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 > /dev/null
+expected="ASSEMBLED"
+if [[ $exeOut = $expected ]] && cmp -s mosaic.dem full.dem; then
+    # An output changed since the manifest was written is assembled again in full.
+    echo extra >> mosaic.dem
+    ./gtopoAssembleReduce --incremental mosaic.dem 301 250 3 0 0 gtopoDEMs/coast.dem 120 90 97 101 part.dem 120 90 150 180 gtopoDEMs/coast.dem 120 90 > /dev/null
+    if cmp -s mosaic.dem full.dem; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Changed output was not assembled again in full
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f mosaic.dem mosaic.dem.manifest full.dem part.dem
+
+echo -n Test 61: gtopoReduce and gtopoTile give the same output streaming a raw DEM as reading a bit-packed one whole
+./gtopoEcho gtopoDEMs/coast.dem 120 90 packed.dem 1 > /dev/null
+./gtopoReduce gtopoDEMs/coast.dem 120 90 7 streamed.dem > /dev/null
+exeOut="$(./gtopoReduce packed.dem 120 90 7 whole.dem)"
+./gtopoTile gtopoDEMs/coast.dem 120 90 4 streamed_\<row\>_\<column\>.dem > /dev/null
+./gtopoTile packed.dem 120 90 4 whole_\<row\>_\<column\>.dem > /dev/null
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    cmp -s streamed.dem whole.dem || identical=0
+    for tile in streamed_*_*.dem; do
+        cmp -s $tile whole_${tile#streamed_} || identical=0
+    done
+    if [[ $identical = 1 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Streamed output differed
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f packed.dem streamed.dem whole.dem streamed_*_*.dem whole_*_*.dem
+
+echo -n Test 62: -j and GTOPO_THREADS change the number of threads but not the output
+./gtopoAssemble single.dem 300 250 0 0 gtopoDEMs/coast.dem 120 90 97 101 gtopoDEMs/coast.dem 120 90 -j 1 > /dev/null
+exeOut="$(GTOPO_THREADS=3 ./gtopoAssemble -j7 parallel.dem 300 250 0 0 gtopoDEMs/coast.dem 120 90 97 101 gtopoDEMs/coast.dem 120 90)"
+expected="ASSEMBLED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s single.dem parallel.dem && [[ "$(./gtopoComp single.dem 300 250 parallel.dem -j 1025)" = "ERROR: Miscellaneous (Thread count given with -j must be an integer from 1 to 1024)" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Threaded assembly differed, or an invalid thread count was accepted
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f single.dem parallel.dem
+
+echo -n Test 63: gtopoReduce --mean averages the valid points of each block, streaming or reading the DEM whole
+printf '\x00\x01\x00\x02\xd8\xf1\xd8\xf1\x00\x04\x00\x06\xd8\xf1\xd8\xf1' > blocks.dem
+printf '\x00\x03\xd8\xf1' > expected.dem
+./gtopoEcho gtopoDEMs/coast.dem 120 90 packed.dem 1 > /dev/null
+exeOut="$(./gtopoReduce --mean blocks.dem 4 2 2 output.dem)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    cmp -s output.dem expected.dem || identical=0
+    for factor in 2 3 4 8 10; do
+        ./gtopoReduce gtopoDEMs/coast.dem 120 90 $factor streamed.dem --mean > /dev/null
+        ./gtopoReduce packed.dem 120 90 $factor whole.dem --mean -j 3 > /dev/null
+        cmp -s streamed.dem whole.dem || identical=0
+    done
+    if [[ $identical = 1 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Averaged output was wrong, or differed between streaming and reading whole
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f blocks.dem expected.dem packed.dem streamed.dem whole.dem output.dem
+
+echo -n Test 64: GTOPO_SIMD=scalar turns off the vector kernels without changing any output
+exeOut="$(GTOPO_SIMD=scalar ./gtopoReduce gtopoDEMs/coast.dem 120 90 2 scalar.dem --mean --profile 2> profile.txt)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    ./gtopoReduce gtopoDEMs/coast.dem 120 90 2 vector.dem --mean > /dev/null
+    cmp -s scalar.dem vector.dem || identical=0
+    GTOPO_SIMD=scalar ./gtopoEcho gtopoDEMs/coast.dem 120 90 scalar.dem > /dev/null
+    cmp -s scalar.dem gtopoDEMs/coast.dem || identical=0
+    GTOPO_SIMD=scalar ./gtopoHillshade gtopoDEMs/coast.dem 120 90 scalar.pgm 300 30 2.5 > /dev/null
+    ./gtopoHillshade gtopoDEMs/coast.dem 120 90 vector.pgm 300 30 2.5 > /dev/null
+    cmp -s scalar.pgm vector.pgm || identical=0
+    GTOPO_SIMD=scalar ./gtopoSlope gtopoDEMs/coast.dem 120 90 scalar.dem 5 > /dev/null
+    ./gtopoSlope gtopoDEMs/coast.dem 120 90 vector.dem 5 > /dev/null
+    cmp -s scalar.dem vector.dem || identical=0
+    GTOPO_SIMD=scalar ./gtopoAspect gtopoDEMs/coast.dem 120 90 scalar.dem 3 > /dev/null
+    ./gtopoAspect gtopoDEMs/coast.dem 120 90 vector.dem 3 > /dev/null
+    cmp -s scalar.dem vector.dem || identical=0
+    if [[ $identical = 1 &&"$(grep -E '^simd +' profile.txt)" =~ scalar$ ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Scalar output differed, or the profile did not report the scalar kernels
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f scalar.dem vector.dem scalar.pgm vector.pgm profile.txt
+
+echo -n Test 65: Programs that stream rows give the same output for a bit-packed DEM as for the raw one
+./gtopoEcho gtopoDEMs/coast.dem 120 90 packed.gtbp 1 > /dev/null
+exeOut="$(./gtopoHillshade packed.gtbp 120 90 packed.pgm)"
+expected="SHADED"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    ./gtopoHillshade gtopoDEMs/coast.dem 120 90 raw.pgm > /dev/null
+    cmp -s packed.pgm raw.pgm || identical=0
+    ./gtopoSlope packed.gtbp 120 90 packed.dem > /dev/null
+    ./gtopoSlope gtopoDEMs/coast.dem 120 90 raw.dem > /dev/null
+    cmp -s packed.dem raw.dem || identical=0
+    ./gtopoIntegral packed.gtbp 120 90 packed.sat > /dev/null
+    ./gtopoIntegral gtopoDEMs/coast.dem 120 90 raw.sat > /dev/null
+    cmp -s packed.sat raw.sat || identical=0
+    [[ "$(./gtopoStats packed.gtbp 120 90)" = "$(./gtopoStats gtopoDEMs/coast.dem 120 90)" ]] || identical=0
+    if [[ $identical = 1 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output for the bit-packed DEM differed from the raw DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f packed.gtbp packed.pgm raw.pgm packed.dem raw.dem packed.sat raw.sat
+
+echo -n Test 66: gtopoPrintLand and gtopoQuery read bit-packed DEMs
+./gtopoEcho gtopoDEMs/coast.dem 120 90 packed.gtbp 1 > /dev/null
+exeOut="$(./gtopoPrintLand packed.gtbp 120 90 packed.txt 0 500 1500; echo $?)"
+expected="0"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    ./gtopoPrintLand gtopoDEMs/coast.dem 120 90 raw.txt 0 500 1500 > /dev/null
+    cmp -s packed.txt raw.txt || identical=0
+    ./gtopoQuery packed.gtbp 120 90 packed.txt 500 1500 > /dev/null || identical=0
+    ./gtopoQuery gtopoDEMs/coast.dem 120 90 raw.txt 500 1500 > /dev/null
+    cmp -s packed.txt raw.txt || identical=0
+    if [[ $identical = 1 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output for the bit-packed DEM differed from the raw DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f packed.gtbp packed.gtbp.pyr packed.txt raw.txt gtopoDEMs/coast.dem.pyr
+
+echo -n Test 67: Programs given auto auto read a packed DEM whole or streamed, as they do a raw one
+./gtopoPack gtopoDEMs/coast.dem 120 90 packed.gtpk > /dev/null
+exeOut="$(./gtopoEcho packed.gtpk auto auto output.dem)"
+expected="ECHOED"
+if [[ $exeOut = $expected ]]; then
+    identical=1
+    cmp -s output.dem gtopoDEMs/coast.dem || identical=0
+    ./gtopoReduce packed.gtpk auto auto 2 packed.dem > /dev/null
+    ./gtopoReduce gtopoDEMs/coast.dem 120 90 2 raw.dem > /dev/null
+    cmp -s packed.dem raw.dem || identical=0
+    ./gtopoSlope packed.gtpk auto auto packed.dem > /dev/null
+    ./gtopoSlope gtopoDEMs/coast.dem 120 90 raw.dem > /dev/null
+    cmp -s packed.dem raw.dem || identical=0
+    if [[ $identical = 1 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output for the packed DEM differed from the raw DEM
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f packed.gtpk output.dem packed.dem raw.dem
+
+echo -n Test 68: gtopoUnpack rejects a packed DEM whose block decodes to an elevation out of range
+# A 2x2 packed DEM with one stored block, whose first elevation decodes to 9000.
+printf "GTPK\x00\x00\x00\x01\x00\x00\x00\x02\x00\x00\x00\x02\x00\x00\x00\x02" > invalid.gtpk
+printf "\x00\x00\x00\x00\x00\x00\x00\x24\x00\x00\x00\x00\x00\x00\x00\x2d" >> invalid.gtpk
+printf "\x00\x46\x00\x00\x00\x50\x00\x00\x00" >> invalid.gtpk
+exeOut="$(./gtopoUnpack invalid.gtpk output.dem)"
+expected="ERROR: Bad Data (invalid.gtpk)"
+if [[ $exeOut = $expected && ! -e output.dem ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f invalid.gtpk output.dem
+
+echo -n Test 69: gtopoIntegral reports a table it could not write, and gtopoRegion a truncated one
+./gtopoIntegral gtopoDEMs/coast.dem 120 90 coast.sat > /dev/null
+head -c 100 coast.sat > truncated.sat
+exeOut="$(./gtopoRegion truncated.sat 0 0 10 10)"
+expected="ERROR: Bad Summed-Area Table (truncated.sat)"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoIntegral gtopoDEMs/coast.dem 120 90 /dev/full)"
+    expected="${expected} ERROR: Output Failed (/dev/full)"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f coast.sat truncated.sat
+
+echo -n Test 70: gtopoPack reports a packed DEM it could not write
+exeOut="$(./gtopoPack gtopoDEMs/coast.dem 120 90 output.gtpk)"
+expected="PACKED"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoPack gtopoDEMs/coast.dem 120 90 /dev/full; echo $?)"
+    expected="${expected} ERROR: Output Failed (/dev/full)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f output.gtpk
+
+echo -n Test 71: gtopoEcho reports a raw or bit-packed DEM it could not write
+exeOut="$(./gtopoEcho gtopoDEMs/coast.dem 120 90 output.gtbp 1)"
+expected="ECHOED"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoEcho gtopoDEMs/coast.dem 120 90 /dev/full 1; echo $?)"
+    exeOut="${exeOut} $(./gtopoEcho gtopoDEMs/coast.dem 120 90 /dev/full 0; echo $?)"
+    expected="${expected} ERROR: Output Failed (/dev/full)
+9 ERROR: Output Failed (/dev/full)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f output.gtbp
+
+echo -n Test 72: gtopoReduce --mean averages blocks whose sum does not fit in 32 bits
+# A 1000 x 1000 DEM of 8752 m reduced by 500 sums 2.19 billion metres a block.
+yes $'\x22\x30' | tr -d '\n' | head -c 2000000 > high.dem
+exeOut="$(./gtopoReduce high.dem 1000 1000 500 output.dem --mean)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(od -An -tx1 output.dem | tr -d ' \n')" = "2230223022302230" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Every block should average 8752 m
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f high.dem output.dem
+
+echo -n Test 73: gtopoQuery reports matches it could not write
+exeOut="$(./gtopoQuery gtopoDEMs/coast.dem 120 90 output.txt 0 8000)"
+expected="QUERIED"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoQuery gtopoDEMs/coast.dem 120 90 /dev/full 0 8000; echo $?)"
+    expected="${expected} ERROR: Output Failed (/dev/full)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f output.txt gtopoDEMs/coast.dem.pyr
+
+echo -n Test 74: gtopoSample reports samples it could not write
+printf "0 0\n45.2 59.7\n" > points.txt
+exeOut="$(./gtopoSample gtopoDEMs/coast.dem 120 90 cells points.txt samples.txt)"
+expected="SAMPLED"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoSample gtopoDEMs/coast.dem 120 90 cells points.txt /dev/full; echo $?)"
+    expected="${expected} ERROR: Output Failed (/dev/full)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f points.txt samples.txt
+
+echo -n Test 75: gtopoStats reports a histogram it could not write
+exeOut="$(./gtopoStats gtopoDEMs/coast.dem 120 90 histogram.txt > /dev/null; echo $?)"
+expected="0"
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="${exeOut} $(./gtopoStats gtopoDEMs/coast.dem 120 90 /dev/full; echo $?)"
+    expected="${expected} ERROR: Output Failed (/dev/full)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f histogram.txt
+
+echo -n Test 76: Tools writing in place report a full output disk against the output, not the input
+exeOut=""
+expected=""
+# /dev/full fails every write as a full disk would.
+if [[ -e /dev/full ]]; then
+    exeOut="$(./gtopoHillshade gtopoDEMs/coast.dem 120 90 /dev/full; echo $?)"
+    exeOut="${exeOut} $(./gtopoSlope gtopoDEMs/coast.dem 120 90 /dev/full; echo $?)"
+    exeOut="${exeOut} $(./gtopoInundate gtopoDEMs/coast.dem 120 90 /dev/full 0; echo $?)"
+    exeOut="${exeOut} $(./gtopoResample gtopoDEMs/coast.dem 120 90 /dev/full 60 45; echo $?)"
+    exeOut="${exeOut} $(./gtopoPrintLand gtopoDEMs/coast.dem 120 90 /dev/full 0 100 1000; echo $?)"
+    exeOut="${exeOut} $(./gtopoReduce gtopoDEMs/coast.dem 120 90 2 /dev/full; echo $?)"
+    for tool in 1 2 3 4 5 6; do
+        expected="${expected:+${expected} }ERROR: Output Failed (/dev/full)
+9"
+    done
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f gtopoDEMs/coast.dem.pyr
+
+echo -n Test 77: gtopoWindow reports a .HDR file it could not write
+mkdir -p sources
+cp gtopoDEMs/coast.dem sources/E020N40.DEM
+printf "BYTEORDER      M\nNROWS          90\nNCOLS          120\nULXMAP         20.00416666666667\nULYMAP         39.99583333333333\nXDIM           0.00833333333333\nYDIM           0.00833333333333\n" > sources/E020N40.HDR
+exeOut="$(./gtopoWindow sources window.dem 20.25 39.5 20.75 39.75; echo $?)"
+expected="WINDOWED
+0"
+# /dev/full fails every write as a full disk would, here through a link in place of the .HDR file.
+if [[ -e /dev/full ]]; then
+    rm -f window.HDR
+    ln -s /dev/full window.HDR
+    exeOut="${exeOut} $(./gtopoWindow sources window.dem 20.25 39.5 20.75 39.75; echo $?)"
+    expected="${expected} ERROR: Output Failed (window.HDR)
+9"
+fi
+if [[ $exeOut = $expected ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -rf sources window.dem window.HDR
+
 # Test Summary
 echo Test Summary:
 echo "Tests Passed: $passed/$numberOfTests"
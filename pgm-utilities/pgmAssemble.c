@@ -4,6 +4,7 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "pgmgroup.h"
+#include "pgmprofile.h"
 
 // Stores the data from the input tuples about the image and its placement.
 typedef struct pgmSubImage
@@ -15,22 +16,20 @@ typedef struct pgmSubImage
 
 
 /*
- * Frees memory allocated to the sub-images.
+ * Frees memory allocated to the sub-images, which were all read into one arena.
  */
-void freeSubImages(pgmSubImage *images, int amount)
+void freeSubImages(pgmSubImage *images, pgmArena *imageArena)
 {
-    int x;
-    for (x = 0; x < amount; x++)
-    {
-        if (images[x].image != NULL)
-            freeImage(images[x].image);
-    }
     free(images);
+    freeArena(imageArena);
 }
 
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
     /*
      * Check argument count is greater than or equal to 4. The program requires 
      * at least 4 arguments to be provided:
@@ -98,9 +97,16 @@ int main(int argc, char **argv)
     int subImageAmount = (argc - 4) / 3;
     pgmSubImage *subImages = (pgmSubImage *) malloc(sizeof(pgmSubImage) * subImageAmount);
 
+    // The sub-images are read into an arena and released together once assembled.
+    pgmArena *subImageArena = createArena();
+
+    error = checkAllocated(subImages);
+    if (error == NULL)
+        error = checkAllocated(subImageArena);
+
     if (error != NULL)
     {
-        freeSubImages(subImages, subImageAmount);
+        freeSubImages(subImages, subImageArena);
         return displayError(error);
     }
 
@@ -116,7 +122,7 @@ int main(int argc, char **argv)
         error = checkInvalidPosition(imageRow, imageHeight, *row);
         if (error != NULL)
         {
-            freeSubImages(subImages, subImageAmount);
+            freeSubImages(subImages, subImageArena);
             return displayError(error);
         }
 
@@ -131,27 +137,33 @@ int main(int argc, char **argv)
         error = checkInvalidPosition(imageColumn, imageWidth, *column);
         if (error != NULL)
         {
-            freeSubImages(subImages, subImageAmount);
+            freeSubImages(subImages, subImageArena);
             return displayError(error);
         }
 
         // Store the sub-image's column starting position if no error occurred.
         subImages[count].startColumn = imageColumn;
 
+        profilePhase(PHASE_READ);
+
         // Open the sub-image to be assembled.
-        subImages[count].image = readImage(argv[argIndex + 2]);
+        subImages[count].image = readArenaImage(subImageArena, argv[argIndex + 2]);
         
         // If the external error pointer is no longer null, a file read error has been detected.
         if (error != NULL)
         {
-            freeSubImages(subImages, subImageAmount);
+            freeSubImages(subImages, subImageArena);
             return displayError(error);
         }
 
+        profilePhase(PHASE_ARGS);
+
         // Add 3 to argIndex to point to the next sub-image to insert.
         argIndex = argIndex + 3;
     }
 
+    profilePhase(PHASE_COMPUTE);
+
     // If no error occurred, assemble the larger image from these sub-images.
     // Find the largest maximum gray value of the sub-images.
     int largestGray = MIN_GRAY_VALUE - 1;
@@ -173,7 +185,7 @@ int main(int argc, char **argv)
     if (error != NULL)
     {
         freeImage(image);
-        freeSubImages(subImages, subImageAmount);
+        freeSubImages(subImages, subImageArena);
         return displayError(error);
     }
 
@@ -186,7 +198,7 @@ int main(int argc, char **argv)
         // If pixels to add were outside of the image, exit.
         if (success == 1)
         {
-            freeSubImages(subImages, subImageAmount);
+            freeSubImages(subImages, subImageArena);
             freeImage(image);
             printf(STR_BAD_LAYOUT);
             return EXIT_BAD_LAYOUT;
@@ -194,19 +206,23 @@ int main(int argc, char **argv)
 
     }
 
+    profilePhase(PHASE_WRITE);
+
     // Write the final image to disk with the path stored in argv[1].
     echoImage(image, argv[1]);
 
     // Check that the file wrote to disk properly.
     if (error != NULL)
     {
-        freeSubImages(subImages, subImageAmount);
+        freeSubImages(subImages, subImageArena);
         freeImage(image);
         return displayError(error);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
-    freeSubImages(subImages, subImageAmount);
+    freeSubImages(subImages, subImageArena);
     freeImage(image);
     printf(STR_ASSEMBLED);
     return EXIT_NO_ERRORS;
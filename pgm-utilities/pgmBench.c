@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Includes pgmio.h. We can use pgm input/output functions and track the external error.
+#include "pgmcompare.h"
+#include "pgmgroup.h"
+#include "pgmshrink.h"
+
+#define DEFAULT_REPEATS 3
+#define BENCH_REDUCE_FACTOR 2
+#define BENCH_TILE_FACTOR 4
+
+
+/*
+ * The images and scratch files shared by the benchmarks. Each benchmark times
+ * one operation on them, doing any setup and tidying outside of the timed section.
+ */
+typedef struct benchState
+{
+    pgmImage *image;
+    pgmImage *binary;
+    pgmImage *ascii;
+    pgmImage ***tiles;
+    char *binaryPath;
+    char *asciiPath;
+} benchState;
+
+
+/*
+ * Returns the time in seconds from a monotonic clock.
+ */
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+
+/*
+ * Resets the peak resident memory of the process to what it holds now, so that
+ * each benchmark reports its own peak rather than the largest one before it.
+ * Linux supports this through clear_refs. Elsewhere the peak is left as it is.
+ */
+static void resetPeakResident()
+{
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+
+/*
+ * Returns the peak resident memory of the process since resetPeakResident() in
+ * kilobytes, or since it started where that cannot be reset.
+ */
+static long peakResidentKB()
+{
+    long peak = -1;
+    char line[256];
+    FILE *file = fopen("/proc/self/status", "r");
+
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "VmHWM: %ld", &peak) == 1)
+            break;
+    }
+
+    if (file != NULL)
+        fclose(file);
+
+    if (peak >= 0)
+        return peak;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+/*
+ * Fills the image with a gradient and noise, so that its P2 form has numbers of
+ * every length. The same size always gives the same image.
+ */
+static void fillImage(pgmImage *image)
+{
+    unsigned int noise = 12345;
+
+    int row;
+    int column;
+
+    for (row = 0; row < getHeight(image); row++)
+    {
+        for (column = 0; column < getWidth(image); column++)
+        {
+            noise = noise * 1103515245 + 12345;
+            setPixel(image, (row + column + (noise >> 16) % 64) % (MAX_GRAY_VALUE + 1), row, column);
+        }
+    }
+}
+
+
+/*
+ * Frees the factor x factor tiles made by tile(), along with the tile arrays.
+ */
+static void freeTiles(pgmImage ***tiles, int factor)
+{
+    int row;
+    int column;
+
+    for (row = 0; row < factor; row++)
+    {
+        for (column = 0; column < factor; column++)
+        {
+            freeImage(tiles[row][column]);
+        }
+        free(tiles[row]);
+    }
+    free(tiles);
+}
+
+
+static double benchEcho(benchState *state)
+{
+    double start = now();
+    echoImage(state->image, state->binaryPath);
+    return now() - start;
+}
+
+
+static double benchConvertAscii(benchState *state)
+{
+    double start = now();
+    convert(state->image, state->asciiPath, ASCII);
+    return now() - start;
+}
+
+
+static double benchReadBinary(benchState *state)
+{
+    freeImage(state->binary);
+
+    double start = now();
+    state->binary = readImage(state->binaryPath);
+    return now() - start;
+}
+
+
+static double benchReadAscii(benchState *state)
+{
+    freeImage(state->ascii);
+
+    double start = now();
+    state->ascii = readImage(state->asciiPath);
+    return now() - start;
+}
+
+
+static double benchConvertBinary(benchState *state)
+{
+    double start = now();
+    convert(state->ascii, state->binaryPath, RAW);
+    return now() - start;
+}
+
+
+static double benchReduce(benchState *state)
+{
+    double start = now();
+    pgmImage *reduced = reduce(state->binary, BENCH_REDUCE_FACTOR);
+    double seconds = now() - start;
+
+    freeImage(reduced);
+    return seconds;
+}
+
+
+static double benchTile(benchState *state)
+{
+    if (state->tiles != NULL)
+        freeTiles(state->tiles, BENCH_TILE_FACTOR);
+
+    double start = now();
+    state->tiles = tile(state->binary, BENCH_TILE_FACTOR, NULL);
+    return now() - start;
+}
+
+
+static double benchAssemble(benchState *state)
+{
+    pgmImage *assembled = createEmptyImage(getWidth(state->image), getHeight(state->image), MAX_GRAY_VALUE, RAW);
+    error = checkImageAllocated(assembled);
+    if (error != NULL)
+        return 0;
+
+    int row;
+    int column;
+    int startRow = 0;
+
+    double start = now();
+    for (row = 0; row < BENCH_TILE_FACTOR; row++)
+    {
+        int startColumn = 0;
+        for (column = 0; column < BENCH_TILE_FACTOR; column++)
+        {
+            addImage(assembled, state->tiles[row][column], startRow, startColumn);
+            startColumn += getWidth(state->tiles[row][column]);
+        }
+        startRow += getHeight(state->tiles[row][0]);
+    }
+    double seconds = now() - start;
+
+    freeImage(assembled);
+    return seconds;
+}
+
+
+// Keeps the result of compare, which the release build would otherwise optimise away.
+static volatile int compared;
+
+
+static double benchCompare(benchState *state)
+{
+    double start = now();
+    compared = compare(state->binary, state->ascii);
+    return now() - start;
+}
+
+
+/*
+ * Runs a benchmark the given number of times and prints a line for its fastest
+ * run. MB/s counts the bytes of pixel data processed, 1 for each pixel. Returns
+ * 1 if the benchmark failed, leaving the error set.
+ */
+static int runBench(char *name, double (*bench)(benchState *state), benchState *state, int repeats)
+{
+    double fastest = 0;
+
+    resetPeakResident();
+
+    int repeat;
+    for (repeat = 0; repeat < repeats; repeat++)
+    {
+        error = NULL;
+        double seconds = bench(state);
+
+        if (error != NULL)
+            return 1;
+
+        if (repeat == 0 || seconds < fastest)
+            fastest = seconds;
+    }
+
+    // Avoid dividing by zero for images too small to time.
+    if (fastest <= 0)
+        fastest = 1e-9;
+
+    double pixels = (double) getWidth(state->image) * getHeight(state->image);
+    printf("%s,%d,%d,%.6f,%.2f,%.0f,%ld\n", name, getWidth(state->image), getHeight(state->image), fastest,
+        pixels / fastest / 1e6, pixels / fastest, peakResidentKB());
+    fflush(stdout);
+    return 0;
+}
+
+
+/*
+ * Returns the path of a scratch file in the directory, which the caller frees.
+ */
+static char* scratchPath(char *directory, char *name)
+{
+    char *path = (char *) malloc(strlen(directory) + strlen(name) + 2);
+
+    if (path != NULL)
+        sprintf(path, "%s/%s", directory, name);
+
+    return path;
+}
+
+
+int main(int argc, char **argv)
+{
+    /*
+     * Check argument count is between 3 and 5. The program requires these
+     * arguments to be provided:
+     *
+     * argv[0] = Program name
+     * argv[1] = Width of the synthetic image
+     * argv[2] = Height of the synthetic image
+     * argv[3] = Number of times to run each benchmark, keeping the fastest (optional)
+     * argv[4] = Directory for the scratch files (optional, the current directory by default)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s width height [repeats] [scratchDirectory]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc < 3 || argc > 5)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    // Convert the width and height CLI arguments to integers and check them.
+    char *end;
+    int width = strtol(argv[1], &end, 10);
+    error = checkInvalidDimensionSize(width, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    int height = strtol(argv[2], &end, 10);
+    error = checkInvalidDimensionSize(height, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    // The repeat count is checked like a factor: an integer greater than 0.
+    int repeats = DEFAULT_REPEATS;
+    if (argc > 3)
+    {
+        repeats = strtol(argv[3], &end, 10);
+        error = checkInvalidFactor(repeats, *end);
+        if (error != NULL)
+            return displayError(error);
+    }
+
+    char *directory = argc > 4 ? argv[4] : ".";
+
+    benchState state;
+    memset(&state, 0, sizeof(benchState));
+    state.binaryPath = scratchPath(directory, "pgmBench.pgm");
+    state.asciiPath = scratchPath(directory, "pgmBenchAscii.pgm");
+    state.image = createEmptyImage(width, height, MAX_GRAY_VALUE, RAW);
+
+    error = checkImageAllocated(state.image);
+    if (error == NULL && (state.binaryPath == NULL || state.asciiPath == NULL))
+        error = checkImageAllocated(NULL);
+
+    if (error != NULL)
+        goto cleanup;
+
+    fillImage(state.image);
+
+    // Each benchmark uses the results of those before it, so stop at the first failure.
+    printf("benchmark,width,height,seconds,mb_per_second,samples_per_second,peak_rss_kb\n");
+
+    if (runBench("echoImage", benchEcho, &state, repeats) ||
+        runBench("convertP2", benchConvertAscii, &state, repeats) ||
+        runBench("readImageP5", benchReadBinary, &state, repeats) ||
+        runBench("readImageP2", benchReadAscii, &state, repeats) ||
+        runBench("convertP5", benchConvertBinary, &state, repeats) ||
+        runBench("reduce", benchReduce, &state, repeats) ||
+        runBench("tile", benchTile, &state, repeats) ||
+        runBench("addImage", benchAssemble, &state, repeats) ||
+        runBench("compare", benchCompare, &state, repeats))
+        goto cleanup;
+
+    goto cleanup;
+
+    cleanup:
+    if (state.binaryPath != NULL)
+        unlink(state.binaryPath);
+    if (state.asciiPath != NULL)
+        unlink(state.asciiPath);
+
+    if (state.tiles != NULL)
+        freeTiles(state.tiles, BENCH_TILE_FACTOR);
+
+    freeImage(state.image);
+    freeImage(state.binary);
+    freeImage(state.ascii);
+    free(state.binaryPath);
+    free(state.asciiPath);
+
+    if (error != NULL)
+        return displayError(error);
+
+    return EXIT_NO_ERRORS;
+}
@@ -2,9 +2,13 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "pgmcompare.h"
+#include "pgmprofile.h"
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
     /*
      * Check argument count is exactly equal to 3. The program requires only 3
      * arguments to be provided:
@@ -24,6 +28,8 @@ int main(int argc, char **argv)
         return EXIT_BAD_ARGS_COUNT;
     }
 
+    profilePhase(PHASE_READ);
+
     // Read image file 1 and store returned pointer to the image structure. 
     pgmImage *inputImageOne = readImage(argv[1]);
 
@@ -51,6 +57,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_COMPUTE);
+
     // Compare the two images and determine logical equivalence.
     int result = compare(inputImageOne, inputImageTwo);
 
@@ -64,6 +72,8 @@ int main(int argc, char **argv)
         printf(STR_DIFFERENT);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Free memory allocated to the images and exit.
     freeImage(inputImageOne);
     freeImage(inputImageTwo);    
@@ -1,10 +1,14 @@
 #include <stdio.h>
 #include "pgmio.h"
+#include "pgmprofile.h"
 
 // https://gabriellesc.github.io/teaching/resources/GDB-cheat-sheet.pdf
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
     /*
      * Check argument count is exactly equal to 3. The program requires only 3
      * arguments to be provided:
@@ -24,6 +28,8 @@ int main(int argc, char **argv)
         return EXIT_BAD_ARGS_COUNT;
     }
 
+    profilePhase(PHASE_READ);
+
     // Read image file and store returned pointer to the image structure. 
     pgmImage *inputImage = readImage(argv[1]);
 
@@ -36,6 +42,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_WRITE);
+
     // Write the data referenced by the image pointer to a new file with same formatting.
     echoImage(inputImage, argv[2]);
 
@@ -46,6 +54,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeImage(inputImage);
     printf(STR_ECHOED);
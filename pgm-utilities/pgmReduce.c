@@ -3,9 +3,22 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "pgmshrink.h"
+#include "pgmthreads.h"
+#include "pgmprofile.h"
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    // Remove any --mean flag, which averages each block instead of keeping its top-left pixel.
+    int mean = takeMeanFlag(&argc, argv);
+
     /*
      * Check argument count is exactly equal to 3. The program requires only 3
      * arguments to be provided:
@@ -36,6 +49,8 @@ int main(int argc, char **argv)
     if (error != NULL)
         return displayError(error);
 
+    profilePhase(PHASE_READ);
+
     // Read image file and store returned pointer to the image structure. 
     pgmImage *inputImage = readImage(argv[1]);
 
@@ -48,8 +63,12 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_COMPUTE);
+
     // If checks pass, reduce the image.
-    pgmImage *reducedImage = reduce(inputImage, factor);
+    pgmImage *reducedImage = mean ? reduceMean(inputImage, factor) : reduce(inputImage, factor);
+
+    profilePhase(PHASE_WRITE);
 
     // Write the data referenced by the reduced image pointer to a new file with same formatting.
     echoImage(reducedImage, argv[3]);
@@ -62,6 +81,8 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeImage(inputImage);
     freeImage(reducedImage);
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// Includes pgmio.h. We can use pgm input/output functions and track the external error.
+#include "pgmfilter.h"
+#include "pgmthreads.h"
+#include "pgmprofile.h"
+
+int main(int argc, char **argv)
+{
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
+    // Remove any -j flag, which sets the number of worker threads.
+    error = checkThreadCount(takeThreadFlag(&argc, argv));
+    if (error != NULL)
+        return displayError(error);
+
+    /*
+     * Check argument count is equal to 5 or 6. The program requires 5 arguments
+     * to be provided, with the filter optional:
+     * 
+     * argv[0] = Program name
+     * argv[1] = Input file path
+     * argv[2] = Width of the output image
+     * argv[3] = Height of the output image
+     * argv[4] = Output file path
+     * 
+     * argv[5] = Filter: nearest, bilinear, bicubic or lanczos (optional, default bilinear)
+     */
+    if (argc == 1)
+    {
+        printf("Usage: %s inputImage.pgm width height outputImage.pgm [filter]\n", argv[0]);
+        return EXIT_NO_ERRORS;
+    }
+    else if (argc != 5 && argc != 6)
+    {
+        printf(STR_BAD_ARGS_COUNT);
+        return EXIT_BAD_ARGS_COUNT;
+    }
+
+    /* 
+     * Convert the dimension CLI arguments to integers. Check that they are valid.
+     * Have to be integers between 1 and 65535 inclusive.
+     */
+    char *end;
+    int width = strtol(argv[2], &end, 10);
+    error = checkInvalidDimensionSize(width, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    int height = strtol(argv[3], &end, 10);
+    error = checkInvalidDimensionSize(height, *end);
+    if (error != NULL)
+        return displayError(error);
+
+    // Look up the optional filter.
+    int filter = argc == 6 ? parseFilter(argv[5]) : BILINEAR;
+    error = checkInvalidFilter(filter);
+    if (error != NULL)
+        return displayError(error);
+
+    profilePhase(PHASE_READ);
+
+    // Read image file and store returned pointer to the image structure. 
+    pgmImage *inputImage = readImage(argv[1]);
+
+    // If the external error pointer is no longer null, a file read error has been detected.
+    if (error != NULL)
+    {
+        if (inputImage != NULL)
+            freeImage(inputImage);
+            
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_COMPUTE);
+
+    // If checks pass, resample the image.
+    pgmImage *resampledImage = resample(inputImage, width, height, filter);
+
+    error = checkImageAllocated(resampledImage);
+    if (error != NULL)
+    {
+        freeImage(inputImage);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_WRITE);
+
+    // Write the data referenced by the resampled image pointer to a new file with same formatting.
+    echoImage(resampledImage, argv[4]);
+
+    // If the external error pointer is no longer null, a file write error has been detected.
+    if (error != NULL)
+    {
+        freeImage(inputImage);
+        freeImage(resampledImage);
+        return displayError(error);
+    }
+
+    profilePhase(PHASE_FREE);
+
+    // Display success string and exit the program.
+    freeImage(inputImage);
+    freeImage(resampledImage);
+    printf(STR_RESAMPLED);
+    return EXIT_NO_ERRORS;
+}
@@ -7,19 +7,7 @@
 
 // Includes pgmio.h. We can use pgm input/output functions and track the external error.
 #include "pgmgroup.h"
-
-void freeTiles(pgmImage ***tiles, int factor)
-{
-    int row;
-    int column;
-
-    for (row = 0; row < factor; row++)
-    {
-        free(tiles[row]);
-    }
-    free(tiles);
-}
-
+#include "pgmprofile.h"
 
 char* buildPath(char *format, int rowNumber, int columnNumber)
 {
@@ -92,6 +80,9 @@ char* buildPath(char *format, int rowNumber, int columnNumber)
 
 int main(int argc, char **argv)
 {
+    // Remove any --profile flag and start timing the argument parsing.
+    startProfile(&argc, argv);
+
     /*
      * Check argument count is exactly equal to 3. The program requires only 3
      * arguments to be provided:
@@ -129,6 +120,8 @@ int main(int argc, char **argv)
    if (error != NULL)
         return displayError(error);
 
+    profilePhase(PHASE_READ);
+
     // Read image file and store returned pointer to the image structure if checks pass.
     pgmImage *inputImage = readImage(argv[1]);
 
@@ -141,8 +134,24 @@ int main(int argc, char **argv)
         return displayError(error);
     }
 
-    // If checks pass, tile the image.
-    pgmImage*** tiledImage = tile(inputImage, factor);
+    profilePhase(PHASE_COMPUTE);
+
+    /*
+     * If checks pass, tile the image. The tiles are allocated from an arena so
+     * that they can all be released at once, however large the factor.
+     */
+    pgmArena *tileArena = createArena();
+
+    error = checkAllocated(tileArena);
+    if (error != NULL)
+    {
+        freeImage(inputImage);
+        return displayError(error);
+    }
+
+    pgmImage*** tiledImage = tile(inputImage, factor, tileArena);
+
+    profilePhase(PHASE_WRITE);
 
     int row;
     int column;
@@ -158,8 +167,9 @@ int main(int argc, char **argv)
             // Check if an error occurred when writing the image.
             if (error != NULL)
             {
+                free(path);
                 freeImage(inputImage);
-                freeTiles(tiledImage, factor);
+                freeArena(tileArena);
                 return displayError(error);
             }
 
@@ -168,9 +178,11 @@ int main(int argc, char **argv)
         }
     }
 
+    profilePhase(PHASE_FREE);
+
     // Display success string and exit the program.
     freeImage(inputImage);
-    freeTiles(tiledImage, factor);
+    freeArena(tileArena);
     printf(STR_TILED);
     return EXIT_NO_ERRORS;
 }
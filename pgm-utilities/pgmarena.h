@@ -0,0 +1,7 @@
+#include <stddef.h>
+
+typedef struct arena pgmArena;
+
+pgmArena* createArena();
+void* arenaAllocate(pgmArena *arena, size_t size);
+void freeArena(pgmArena *arena);
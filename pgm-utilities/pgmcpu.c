@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pgmcpu.h"
+
+// Environment variable naming the instruction set kernels should use, such as scalar for none.
+#define SIMD_VARIABLE "PGM_SIMD"
+
+
+/*
+ * The instruction set kernels use, or -1 until getSimdLevel() first chooses it.
+ * Every thread that races to choose it chooses the same one.
+ */
+static int simdLevel = -1;
+
+// Names of the instruction sets, indexed by level.
+static char *simdNames[] = {"scalar", "sse2", "avx2", "avx512", "neon"};
+
+
+/*
+ * Returns the best instruction set this processor has that kernels are written
+ * for. AVX-512 kernels need its byte and word instructions (AVX-512BW). The
+ * checks also make sure the operating system saves the wider registers.
+ */
+static int detectSimdLevel()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw"))
+        return SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+
+    // Every x86-64 processor has SSE2.
+    return SIMD_SSE2;
+#elif defined(__aarch64__)
+    // Every AArch64 processor has NEON.
+    return SIMD_NEON;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+
+/*
+ * Returns the instruction set that kernels should use: the best this processor
+ * has, unless the PGM_SIMD environment variable names a lower one, or scalar
+ * to use none. Naming one the processor does not have has no effect. Chosen on
+ * the first call, and the same for the rest of the run.
+ */
+int getSimdLevel()
+{
+    int level = __atomic_load_n(&simdLevel, __ATOMIC_RELAXED);
+    if (level >= 0)
+        return level;
+
+    level = detectSimdLevel();
+    char *requested = getenv(SIMD_VARIABLE);
+
+    int x;
+    for (x = SIMD_SCALAR; requested != NULL && x <= SIMD_NEON; x++)
+    {
+        // NEON and the x86 instruction sets are never both present, so neither is lower than the other.
+        int lower = x == SIMD_SCALAR || (x < level && level != SIMD_NEON);
+
+        if (strcmp(requested, simdNames[x]) == 0 && lower)
+            level = x;
+    }
+
+    __atomic_store_n(&simdLevel, level, __ATOMIC_RELAXED);
+    return level;
+}
+
+
+/*
+ * Returns the name of an instruction set level, as PGM_SIMD takes it.
+ */
+char* getSimdName(int level)
+{
+    return level >= SIMD_SCALAR && level <= SIMD_NEON ? simdNames[level] : "unknown";
+}
@@ -1,5 +1,8 @@
 #include <stdlib.h>
+#include <string.h>
 #include "pgmlimits.h"
+#include "pgmdata.h"
+#include "pgmprofile.h"
 
 // Enable this #define directive for testing memory allocation failure.
 // #define malloc(...) NULL
@@ -7,78 +10,73 @@
 
 // http://netpbm.sourceforge.net/doc/pgm.html 
 
+typedef struct comment comment;
+typedef struct image image;
+
+
+void freeImage(image *image);
+
+
 /*
- * Stores data related to comments. Properties of a comment include:
- * 
- * What line number they appear on, with indexing beginning at 0. 
- * Whether it exists on this line or not (1 for exists, 0 otherwise).
- * It's related string/buffer, with maximum length of MAX_COMMENT_LINE_LENGTH.
- * 
- * Other information: 
- * 
- * Comments may appear on seperate lines or at the end of lines.
- * Comments only appear in the header section of a pgm file, that is the lines
- * or seperate lines up until the image raster data.
- * Comments are prefixed with '#'
+ * Allocates zeroed memory from an arena, or from the heap when there is no arena.
  */
-typedef struct comment
+static void* allocate(pgmArena *arena, size_t size)
 {
-    int lineNumber;
-    int exists;
-    char *commentString;
-} comment;
+    if (arena == NULL)
+    {
+        countAllocation();
+        return calloc(1, size);
+    }
+
+    void *memory = arenaAllocate(arena, size);
+
+    if (memory != NULL)
+        memset(memory, 0, size);
+
+    return memory;
+}
 
 
 /*
- * Stores all required data related to a pgm image that is to be handled by a
- * program. Properties of a pgm image include:
- * 
- * Raw: If the magic number is P5, the image raster data is stored in raw byte
- * format, whereas a magic number of P2 indicates the image raster data is stored
- * in ASCII character encoding. 0 indicates this data is encoded with ASCII and
- * 1 indicates it is stored in raw bytes.
- * 
- * Magic number: A sequence of two characters appearing at the top of a pgm file.
- * This will be stored internally as a sequence of two bytes to avoid issues with
- * endianness.
- * 
- * Width and height: Appear below the magic number and specifies the width and
- * height of the image in pixels. These may be split into two lines. 
- * 
- * Maximum Gray value: Appears below the width and height. It is greater than 0,
- * and less than 65536. If this value is less than or equal to 255, we need one
- * byte to store each pixel in the raster. Values higher than this are not
- * permitted.
- * 
- * Raster: Each pixel in the raster represents a gray value greater than 0 and less than 
- * the specified maximum gray value, which itself must be less than 255.
- * Every pixel uses the one byte.
- * 
- * Comments: Comments may appear in plainext pgm files (P2). They are implemented
- * using the defined "comment" data type. An arbitrary amount of comments are to
- * be stored.
+ * Allocates memory for storing comment lines, with every comment string in one
+ * block, and sets initial NULL/empty values. Returns 1 if memory allocation
+ * failed and 0 otherwise.
  */
-typedef struct image
+static int initComments(image *image)
 {
-    int format;
-    int width; 
-    int height;
-    int maxGrayValue;
-    unsigned short magicNumber;
-    unsigned char **raster;
-    comment *comments;
-} image;
+    image->comments = (comment *) allocate(image->arena, sizeof(comment) * MAX_COMMENTS);
+
+    if (image->comments == NULL)
+        return 1;
+
+    char *strings = (char *) allocate(image->arena, MAX_COMMENTS * MAX_COMMENT_LINE_LENGTH);
+
+    if (strings == NULL)
+        return 1;
+
+    int x;
+    for (x = 0; x < MAX_COMMENTS; x++)
+    {
+        image->comments[x].commentString = strings + x * MAX_COMMENT_LINE_LENGTH;
+        image->comments[x].exists = 0;
+        image->comments[x].lineNumber = 0;
+    }
+
+    return 0;
+}
 
 
 /*
  * Dynamically allocates memory to an image structure and returns a pointer to
  * the allocated memory so that its fields can be initialised and allocated
- * memory as required.
+ * memory as required. If an arena is given, the image and its raster are
+ * allocated from it and are released with the arena rather than by freeImage().
+ * Returns NULL if memory allocation fails.
  */
-image* createImage()
+image* createArenaImage(pgmArena *arena)
 {
     // Allocate memory to a new image and set initial NULL/empty values. 
-    image *newImage = (image *) malloc(sizeof(image));
+    image *newImage = (image *) allocate(arena, sizeof(image));
 
     // Check for failed memory allocation and return NULL if this occurred.
     if (newImage == NULL)
@@ -90,35 +88,34 @@ image* createImage()
     newImage->maxGrayValue = DEFAULT_VALUE;
     newImage->magicNumber = 0;
     newImage->raster = NULL;
+    newImage->comments = NULL;
+    newImage->arena = arena;
     
-    // Allocate memory for storing comment lines and set initial NULL/empty values.
-    newImage->comments = (comment *) malloc(sizeof(comment) * MAX_COMMENTS);
-
     // Check for failed memory allocation and return NULL if this occurred.
-    if (newImage->comments == NULL)
-        return NULL;
-
-    int x;
-    for (x = 0; x < MAX_COMMENTS; x++)
+    if (initComments(newImage) != 0)
     {
-        newImage->comments[x].commentString = (char *) calloc(MAX_COMMENT_LINE_LENGTH, sizeof(char));
-
-        // Check for failed memory allocation and return NULL if this occurred.
-        if (newImage->comments[x].commentString == NULL)
-            return NULL;
-
-        newImage->comments[x].exists = 0;
-        newImage->comments[x].lineNumber = 0;
+        freeImage(newImage);
+        return NULL;
     }
 
     return newImage;
 }
 
 
+/*
+ * Dynamically allocates memory to an image structure from the heap. Returns NULL
+ * if memory allocation fails.
+ */
+image* createImage()
+{
+    return createArenaImage(NULL);
+}
+
+
 /*
  * Dynamically allocates enough memory to the image raster to store each pixel and
- * initialises their values to 0. If memory allocation fails, the raster is set to
- * NULL.
+ * initialises their values to 0. The pixels are held in one block with the row
+ * pointers into it. If memory allocation fails, the raster is set to NULL.
  */
 void initImageRaster(image *image)
 {       
@@ -126,36 +123,40 @@ void initImageRaster(image *image)
      * and their total is the height of the image. Each of these arrays have
      * length equal to the width of the image.
      */
+    unsigned char **raster = (unsigned char **) allocate(image->arena, sizeof(unsigned char *) * image->height);
+    unsigned char *pixels = (unsigned char *) allocate(image->arena, (size_t) image->width * image->height);
 
-    image->raster = (unsigned char **) malloc(sizeof(unsigned char *) * image->height);
+    if (raster == NULL || pixels == NULL)
+    {
+        if (image->arena == NULL)
+        {
+            free(raster);
+            free(pixels);
+        }
 
-    if (image->raster == NULL)
+        image->raster = NULL;
         return;
+    }
 
-    // Allocate memory to each pixel in the raster and set them to an initial value of 0.
+    // Point each row of the raster into the block of pixels.
     int row;
-    int column;
-
     for (row = 0; row < image->height; row++)
     {
-        image->raster[row] = (unsigned char *) calloc(image->width, sizeof(unsigned char));
-
-        if (image->raster[row] == NULL)
-        {
-            image->raster = NULL;
-            return;
-        }
+        raster[row] = pixels + (size_t) row * image->width;
     }
+
+    image->raster = raster;
 }
 
 
 /*
- *  Creates an empty image with the parameters given.
+ * Creates an empty image with the parameters given, allocated from the arena or
+ * from the heap if the arena is NULL. Returns NULL if memory allocation fails.
  */
-image* createEmptyImage(int imageWidth, int imageHeight, int maxGray, int rawOrAscii)
+image* createArenaEmptyImage(pgmArena *arena, int imageWidth, int imageHeight, int maxGray, int rawOrAscii)
 {
     // Allocate memory to a new image and set the values.
-    image *newImage = (image *) malloc(sizeof(image));
+    image *newImage = createArenaImage(arena);
 
     //Check for failed memory allocation.
     if (newImage == NULL)
@@ -168,15 +169,9 @@ image* createEmptyImage(int imageWidth, int imageHeight, int maxGray, int rawOrA
     initImageRaster(newImage);
 
     if (newImage->raster == NULL)
-        return NULL;
-
-    int row;
-    for (row = 0; row < newImage->height; row++)
     {
-        if (newImage->raster[row] == NULL)
-        {
-            return NULL;
-        }
+        freeImage(newImage);
+        return NULL;
     }
 
     if (rawOrAscii == ASCII)
@@ -188,25 +183,16 @@ image* createEmptyImage(int imageWidth, int imageHeight, int maxGray, int rawOrA
         newImage->magicNumber = MAGIC_NUMBER_RAW_PGM;
     }
 
-    // Allocate memory for storing comment lines and set initial NULL/empty values.
-    newImage->comments = (comment *) malloc(sizeof(comment) * MAX_COMMENTS);
-
-    if (newImage->comments == NULL)
-        return NULL;
-
-    int x;
-    for (x = 0; x < MAX_COMMENTS; x++)
-    {
-        newImage->comments[x].commentString = (char *) calloc(MAX_COMMENT_LINE_LENGTH, sizeof(char));
-
-        if (newImage->comments[x].commentString == NULL)
-            return NULL;
+    return newImage;
+}
 
-        newImage->comments[x].exists = 0;
-        newImage->comments[x].lineNumber = 0;
-    }
 
-    return newImage;
+/*
+ *  Creates an empty image with the parameters given.
+ */
+image* createEmptyImage(int imageWidth, int imageHeight, int maxGray, int rawOrAscii)
+{
+    return createArenaEmptyImage(NULL, imageWidth, imageHeight, maxGray, rawOrAscii);
 }
 
 
@@ -284,6 +270,11 @@ unsigned char** getRaster(image *image)
 }
 
 
+// Always define the out-of-line accessors, which pgmdata.h may have replaced.
+#undef getPixel
+#undef setPixel
+
+
 /*
  * Returns the value of the pixel in the raster given a pointer to the image and
  * the row and column this pixel should come from.
@@ -361,29 +352,25 @@ void setPixel(image *image, unsigned char value, int row, int column)
 
 /*
  * Frees all dynamically allocated data related to an image given its pointer
- * which includes the raster and comments.
+ * which includes the raster and comments. Images allocated from an arena are
+ * left to be released with the arena.
  */
 void freeImage(image *image)
 {
-    // Only free if the image is initialised.
-    if (image != NULL)
+    // Only free if the image is initialised and does not belong to an arena.
+    if (image != NULL && image->arena == NULL)
     {
         // Free memory allocated to comments.
-        int x;
-
-        for (x = 0; x < MAX_COMMENTS; x++)
+        if (image->comments != NULL)
         {
-            free(image->comments[x].commentString);
+            free(image->comments[0].commentString);
+            free(image->comments);
         }
-        free(image->comments);
 
         // Free memory allocated to the image raster if it was allocated.
         if (image->raster != NULL)
         {
-            for (x = 0; x < image->height; x++)
-            {
-                free(image->raster[x]);
-            }
+            free(image->raster[0]);
             free(image->raster);
         }
 
@@ -1,8 +1,81 @@
+#ifndef PGMDATA_H
+#define PGMDATA_H
+
+#include "pgmarena.h"
+
+/*
+ * Stores data related to comments. Properties of a comment include:
+ *
+ * What line number they appear on, with indexing beginning at 0.
+ * Whether it exists on this line or not (1 for exists, 0 otherwise).
+ * It's related string/buffer, with maximum length of MAX_COMMENT_LINE_LENGTH.
+ *
+ * Other information:
+ *
+ * Comments may appear on seperate lines or at the end of lines.
+ * Comments only appear in the header section of a pgm file, that is the lines
+ * or seperate lines up until the image raster data.
+ * Comments are prefixed with '#'
+ */
+struct comment
+{
+    int lineNumber;
+    int exists;
+    char *commentString;
+};
+
+
+/*
+ * Stores all required data related to a pgm image that is to be handled by a
+ * program. Properties of a pgm image include:
+ *
+ * Raw: If the magic number is P5, the image raster data is stored in raw byte
+ * format, whereas a magic number of P2 indicates the image raster data is stored
+ * in ASCII character encoding. 0 indicates this data is encoded with ASCII and
+ * 1 indicates it is stored in raw bytes.
+ *
+ * Magic number: A sequence of two characters appearing at the top of a pgm file.
+ * This will be stored internally as a sequence of two bytes to avoid issues with
+ * endianness.
+ *
+ * Width and height: Appear below the magic number and specifies the width and
+ * height of the image in pixels. These may be split into two lines.
+ *
+ * Maximum Gray value: Appears below the width and height. It is greater than 0,
+ * and less than 65536. If this value is less than or equal to 255, we need one
+ * byte to store each pixel in the raster. Values higher than this are not
+ * permitted.
+ *
+ * Raster: Each pixel in the raster represents a gray value greater than 0 and less than
+ * the specified maximum gray value, which itself must be less than 255.
+ * Every pixel uses the one byte.
+ *
+ * Comments: Comments may appear in plainext pgm files (P2). They are implemented
+ * using the defined "comment" data type. An arbitrary amount of comments are to
+ * be stored.
+ *
+ * Programs should use the functions below rather than the fields, which are only
+ * here so that the accessors can be inlined.
+ */
+struct image
+{
+    int format;
+    int width;
+    int height;
+    int maxGrayValue;
+    unsigned short magicNumber;
+    unsigned char **raster;
+    struct comment *comments;
+    pgmArena *arena;
+};
+
 typedef struct comment pgmComment;
 typedef struct image pgmImage;
 
 pgmImage* createImage();
+pgmImage* createArenaImage(pgmArena *arena);
 pgmImage* createEmptyImage(int imageWidth, int imageHeight, int maxGray, int rawOrAscii);
+pgmImage* createArenaEmptyImage(pgmArena *arena, int imageWidth, int imageHeight, int maxGray, int rawOrAscii);
 int determineFormat(pgmImage *image);
 char* getComment(pgmImage *image, int lineNo);
 int getCommentExists(pgmImage *image, int lineNo);
@@ -19,3 +92,27 @@ void setDimensions(pgmImage *image, int width, int height);
 void setMaxGrayValue(pgmImage *image, int maxGray);
 void setPixel(pgmImage *image, unsigned char value, int row, int column);
 void freeImage(pgmImage *image);
+
+/*
+ * The release and pgo builds define INLINE_ACCESSORS, replacing the per-pixel
+ * accessors with these so that they cost no call in the loops that use them.
+ * pgmdata.c still defines the functions above for objects built without it.
+ */
+#ifdef INLINE_ACCESSORS
+
+static inline unsigned char inlineGetPixel(pgmImage *image, int row, int column)
+{
+    return image->raster[row][column];
+}
+
+static inline void inlineSetPixel(pgmImage *image, unsigned char value, int row, int column)
+{
+    image->raster[row][column] = value;
+}
+
+#define getPixel inlineGetPixel
+#define setPixel inlineSetPixel
+
+#endif
+
+#endif
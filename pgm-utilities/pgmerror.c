@@ -19,10 +19,15 @@ typedef struct pgmErr
 
 
 /*
- *
+ * Allocates an error with the given exit code and a message built from the
+ * prefix and, in brackets, the string. Errors are only allocated once a check
+ * has failed, so the checks made on every sample of a raster cost nothing when
+ * they pass.
  */
-static void createError(pgmErr *err, int code, char *prefix , char *string)
+static pgmErr* createError(int code, char *prefix , char *string)
 {
+    pgmErr *err = (pgmErr *) malloc(sizeof(pgmErr));
+
     // Allocate enough memory to the error string and build it.
     err->errorMsg = (char *) calloc(strlen(prefix) + strlen(string) + 10, sizeof(char));
     err->errorCode = code;
@@ -38,6 +43,7 @@ static void createError(pgmErr *err, int code, char *prefix , char *string)
         strcat(err->errorMsg, ")");
         
     strcat(err->errorMsg, "\n");
+    return err;
 }
 
 
@@ -46,16 +52,12 @@ static void createError(pgmErr *err, int code, char *prefix , char *string)
  */
 pgmErr* checkInvalidFileName(FILE *file, char *path)
 {
-    pgmErr *invalidFileName = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (file == NULL)
     {
         // We will free the error when we display it.
-        createError(invalidFileName, EXIT_BAD_FILE_NAME, STR_BAD_FILE_NAME, path);
-        return invalidFileName;
+        return createError(EXIT_BAD_FILE_NAME, STR_BAD_FILE_NAME, path);
     }
 
-    free(invalidFileName);
     return NULL;
 }
 
@@ -65,15 +67,11 @@ pgmErr* checkInvalidFileName(FILE *file, char *path)
  */
 pgmErr* checkInvalidFactor(int factor, char lastChar)
 {
-    pgmErr *invalidFactor = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (factor <= 0 || lastChar != '\0')
     {
-        createError(invalidFactor, EXIT_MISC, STR_MISC, STR_BAD_FACTOR);
-        return invalidFactor;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_FACTOR);
     }
 
-    free(invalidFactor);
     return NULL;
 }
 
@@ -83,15 +81,11 @@ pgmErr* checkInvalidFactor(int factor, char lastChar)
  */
 pgmErr* checkInvalidDimensionSize(int dimension, char lastChar)
 {
-    pgmErr *invalidDimension = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (dimension < MIN_IMAGE_DIMENSION || dimension > MAX_IMAGE_DIMENSION || lastChar != '\0')
     {
-        createError(invalidDimension, EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
-        return invalidDimension;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_DIMENSION);
     }
 
-    free(invalidDimension);
     return NULL;
 }
 
@@ -101,15 +95,11 @@ pgmErr* checkInvalidDimensionSize(int dimension, char lastChar)
  */
 pgmErr* checkInvalidPosition(int axisPosition, int axisEnd, char lastChar)
 {
-    pgmErr *invalidPosition = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (axisPosition < MIN_IMAGE_DIMENSION - 1 || axisPosition > axisEnd - 1 || lastChar != '\0')
     {
-        createError(invalidPosition, EXIT_MISC, STR_MISC, STR_BAD_ROW);
-        return invalidPosition;
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_ROW);
     }
 
-    free(invalidPosition);
     return NULL;
 }
 
@@ -120,28 +110,22 @@ pgmErr* checkInvalidPosition(int axisPosition, int axisEnd, char lastChar)
  */
 pgmErr* checkTagsPresent(char *template, char *rowTag, char *colTag)
 {
-    pgmErr *tagMissing = (pgmErr *) malloc(sizeof(pgmErr));
-
     char *rowTagAddress = strstr(template, rowTag);
     char *columnTagAddress = strstr(template, colTag);
 
     if (rowTagAddress == NULL && columnTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_TAGS);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_TAGS);
     }
     else if (rowTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_ROW_TAG);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_ROW_TAG);
     }
     else if (columnTagAddress == NULL)
     {
-        createError(tagMissing, EXIT_MISC, STR_MISC, STR_NO_COL_TAG);
-        return tagMissing;
+        return createError(EXIT_MISC, STR_MISC, STR_NO_COL_TAG);
     }
 
-    free(tagMissing);
     return NULL;
 }
 
@@ -151,16 +135,12 @@ pgmErr* checkTagsPresent(char *template, char *rowTag, char *colTag)
  */
 pgmErr* checkEOF(FILE *file, char *path)
 {
-    pgmErr *eofDetected = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (feof(file))
     {
         // We will free the error when we display it.
-        createError(eofDetected, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return eofDetected;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
     
-    free(eofDetected);
     return NULL;
 }
 
@@ -170,16 +150,12 @@ pgmErr* checkEOF(FILE *file, char *path)
  */
 pgmErr* checkBinaryEOF(int scanned, char *path)
 {
-    pgmErr *eofDetected = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (scanned == 0)
     {
         // We will free the error when we display it.
-        createError(eofDetected, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return eofDetected;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
     
-    free(eofDetected);
     return NULL;
 }
 
@@ -189,8 +165,6 @@ pgmErr* checkBinaryEOF(int scanned, char *path)
  */
 pgmErr* checkComment(char *comment, char *path)
 {
-    pgmErr *badCommentLine = (pgmErr *) malloc(sizeof(pgmErr));
-
     // Get last character. If not a new line, this is an invalid comment.
     // A valid comment of length n: comment[n] == '\0', comment[n - 1] == '\n'
     char lastChar = comment[strlen(comment) - 1];
@@ -198,11 +172,9 @@ pgmErr* checkComment(char *comment, char *path)
     if (comment == NULL || lastChar != '\n')
     {
         // We will free the error when we display it.
-        createError(badCommentLine, EXIT_BAD_COMMENT_LINE, STR_BAD_COMMENT_LINE, path);
-        return badCommentLine;
+        return createError(EXIT_BAD_COMMENT_LINE, STR_BAD_COMMENT_LINE, path);
     }
     
-    free(badCommentLine);
     return NULL;
 }
 
@@ -212,17 +184,12 @@ pgmErr* checkComment(char *comment, char *path)
  */
 pgmErr* checkCommentLimit(char *comment)
 {
-    pgmErr *commentLimitExceeded = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (comment == NULL)
     {
         // We will free the error when we display it.
-        createError(commentLimitExceeded, EXIT_MISC, STR_COMMENT_LIMIT, "");
-        return commentLimitExceeded;
+        return createError(EXIT_MISC, STR_COMMENT_LIMIT, "");
     }
 
-    // Error not triggered. Free it.
-    free(commentLimitExceeded);
     return NULL;
 }
 
@@ -232,17 +199,12 @@ pgmErr* checkCommentLimit(char *comment)
  */
 pgmErr* checkInvalidMagicNo(unsigned short *magicNo, char *path)
 {
-    pgmErr *invalidMagicNo = (pgmErr *) malloc(sizeof(pgmErr));
-    
     if ((*magicNo != MAGIC_NUMBER_ASCII_PGM) && (*magicNo != MAGIC_NUMBER_RAW_PGM))
     {
         // We will free the error when we display it.
-        createError(invalidMagicNo, EXIT_BAD_MAGIC_NUMBER, STR_BAD_MAGIC_NUMBER, path);
-        return invalidMagicNo;
+        return createError(EXIT_BAD_MAGIC_NUMBER, STR_BAD_MAGIC_NUMBER, path);
     }
 
-    // Error not triggered. Free it.
-    free(invalidMagicNo);
     return NULL;
 }
 
@@ -252,8 +214,6 @@ pgmErr* checkInvalidMagicNo(unsigned short *magicNo, char *path)
  */
 pgmErr* checkInvalidDimensions(int width, int height, int scanned, char *path)
 {
-    pgmErr *invalidDimensions = (pgmErr *) malloc(sizeof(pgmErr));
-
     /* 
      * We expect fscanf to have scanned 2 integers, one for width and height.
      * We also expect the values for width and height fall within their valid range.
@@ -265,12 +225,9 @@ pgmErr* checkInvalidDimensions(int width, int height, int scanned, char *path)
         height > MAX_IMAGE_DIMENSION)
     {
         // We will free the error when we display it.
-        createError(invalidDimensions, EXIT_BAD_DIMENSIONS, STR_BAD_DIMENSIONS, path);
-        return invalidDimensions;
+        return createError(EXIT_BAD_DIMENSIONS, STR_BAD_DIMENSIONS, path);
     }
 
-    // Error not triggered. Free it.
-    free(invalidDimensions);
     return NULL;
 }
 
@@ -280,8 +237,6 @@ pgmErr* checkInvalidDimensions(int width, int height, int scanned, char *path)
  */
 pgmErr* checkInvalidMaxGrayValue(int maxGray, int scanned, char *path)
 {
-    pgmErr *invalidMaxGrayValue = (pgmErr *) malloc(sizeof(pgmErr));
-
     /* 
      * We expect fscanf to have scanned 1 unsigned integer for maximum gray value.
      * We also expect the value for maximum gray value to fall within its valid range.
@@ -289,12 +244,9 @@ pgmErr* checkInvalidMaxGrayValue(int maxGray, int scanned, char *path)
     if (scanned != 1 || maxGray < MIN_GRAY_VALUE || maxGray > MAX_GRAY_VALUE)
     {
         // We will free the error when we display it.
-        createError(invalidMaxGrayValue, EXIT_BAD_MAX_GRAY_VALUE, STR_BAD_MAX_GRAY_VALUE, path);
-        return invalidMaxGrayValue;
+        return createError(EXIT_BAD_MAX_GRAY_VALUE, STR_BAD_MAX_GRAY_VALUE, path);
     }
 
-    // Error not triggered. Free it.
-    free(invalidMaxGrayValue);
     return NULL;
 }
 
@@ -304,17 +256,27 @@ pgmErr* checkInvalidMaxGrayValue(int maxGray, int scanned, char *path)
  */
 pgmErr* checkImageAllocated(pgmImage *image)
 {
-    pgmErr *imageNotAllocated = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (image == NULL)
     {
         // We will free the error when we display it.
-        createError(imageNotAllocated, EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
-        return imageNotAllocated;
+        return createError(EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
     }
     
-    // Error not triggered. Free it.
-    free(imageNotAllocated);
+    return NULL;
+}
+
+
+/*
+ * Checks whether a working allocation, such as an arena, was allocated.
+ */
+pgmErr* checkAllocated(void *pointer)
+{
+    if (pointer == NULL)
+    {
+        // We will free the error when we display it.
+        return createError(EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
+    }
+
     return NULL;
 }
 
@@ -324,13 +286,10 @@ pgmErr* checkImageAllocated(pgmImage *image)
  */
 pgmErr* checkRasterAllocated(unsigned char **raster, int width, int height)
 {
-    pgmErr *rasterNotAllocated = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (raster == NULL)
     {
         // We will free the error when we display it.
-        createError(rasterNotAllocated, EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
-        return rasterNotAllocated;
+        return createError(EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
     }
 
     int row;
@@ -338,13 +297,10 @@ pgmErr* checkRasterAllocated(unsigned char **raster, int width, int height)
     {
         if (raster[row] == NULL)
         {
-            createError(rasterNotAllocated, EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
-            return rasterNotAllocated;
+            return createError(EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, "");
         }
     }
     
-    // Error not triggered. Free it.
-    free(rasterNotAllocated);
     return NULL;
 }
 
@@ -354,8 +310,6 @@ pgmErr* checkRasterAllocated(unsigned char **raster, int width, int height)
  */
 pgmErr* checkRequiredData(pgmImage *image, char *path)
 {
-    pgmErr *rasterNotAllocated = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (getWidth(image) < MIN_IMAGE_DIMENSION ||
         getWidth(image) > MAX_IMAGE_DIMENSION ||
         getHeight(image) < MIN_IMAGE_DIMENSION ||
@@ -364,12 +318,9 @@ pgmErr* checkRequiredData(pgmImage *image, char *path)
         getMaxGrayValue(image) > MAX_GRAY_VALUE)
     {
         // We will free the error when we display it.
-        createError(rasterNotAllocated, EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
-        return rasterNotAllocated;
+        return createError(EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
     }
 
-    // Error not triggered. Free it.
-    free(rasterNotAllocated);
     return NULL;
 }
 
@@ -379,17 +330,12 @@ pgmErr* checkRequiredData(pgmImage *image, char *path)
  */
 pgmErr* checkPixel(unsigned char pixel, int maxGray, int scanned, char *path)
 {
-    pgmErr *badPixel = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (scanned != 1 || pixel > maxGray || pixel < MIN_PIXEL_VALUE || pixel > MAX_GRAY_VALUE)
     {
         // We will free this error when we display it.
-        createError(badPixel, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return badPixel;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
 
-    // Error not triggered. Free it.
-    free(badPixel);
     return NULL;
 }
 
@@ -399,17 +345,12 @@ pgmErr* checkPixel(unsigned char pixel, int maxGray, int scanned, char *path)
  */
 pgmErr* checkPixelCount(int count, int expected, char *path)
 {
-    pgmErr *missingPixels = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (count != expected)
     {
         // We will free this error when we display it.
-        createError(missingPixels, EXIT_BAD_DATA, STR_BAD_DATA, path);
-        return missingPixels;
+        return createError(EXIT_BAD_DATA, STR_BAD_DATA, path);
     }
 
-    // Error not triggered. Free it.
-    free(missingPixels);
     return NULL;
 }
 
@@ -419,17 +360,12 @@ pgmErr* checkPixelCount(int count, int expected, char *path)
  */
 pgmErr* checkInvalidWriteMode(int mode)
 {
-    pgmErr *invalidWriteMode = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (mode < 0 || mode > 1)
     {
         // We will free this error when we display it.
-        createError(invalidWriteMode, EXIT_MISC, STR_BAD_WRITE_MODE, "");
-        return invalidWriteMode;
+        return createError(EXIT_MISC, STR_BAD_WRITE_MODE, "");
     }
 
-    // Error not triggered. Free it.
-    free(invalidWriteMode);
     return NULL;
 }
 
@@ -439,21 +375,17 @@ pgmErr* checkInvalidWriteMode(int mode)
  */
 pgmErr* checkImageCanBeWritten(pgmImage *image, char *path)
 {
-    pgmErr *writeFailed = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (image == NULL)
     {
         // We will free this error when we display it.
-        createError(writeFailed, EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
-        return writeFailed;
+        return createError(EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
     }
 
     // If the image is allocated but not its raster, create an error.
     if (getRaster(image) == NULL)
     {
         // We will free this error when we display it.
-        createError(writeFailed, EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, path);
-        return writeFailed;
+        return createError(EXIT_IMAGE_MALLOC_FAILED, STR_IMAGE_MALLOC_FAILED, path);
     }
 
     // Check that the formatting, image dimensions, and maximum gray value are valid.
@@ -467,29 +399,51 @@ pgmErr* checkImageCanBeWritten(pgmImage *image, char *path)
         getMaxGrayValue(image) > MAX_GRAY_VALUE)
     {
         // We will free this error when we display it.
-        createError(writeFailed, EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
-        return writeFailed;
+        return createError(EXIT_OUTPUT_FAILED, STR_OUTPUT_FAILED, path);
     }
 
-    // Error not triggered. Free it.
-    free(writeFailed);
     return NULL;
 }
 
 
 pgmErr* checkFileFormat(pgmImage *image, int convertFrom, char *path)
 {
-    pgmErr *badFileToConvert = (pgmErr *) malloc(sizeof(pgmErr));
-
     if (determineFormat(image) != convertFrom)
     {
         // We will free this error when we display it.
-        createError(badFileToConvert, EXIT_BAD_MAGIC_NUMBER, STR_BAD_MAGIC_NUMBER, path);
-        return badFileToConvert;
+        return createError(EXIT_BAD_MAGIC_NUMBER, STR_BAD_MAGIC_NUMBER, path);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether a resampling filter was recognised.
+ */
+pgmErr* checkInvalidFilter(int filter)
+{
+    if (filter < 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_FILTER);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Checks whether the thread count given with the -j flag was valid.
+ */
+pgmErr* checkThreadCount(int invalid)
+{
+    if (invalid != 0)
+    {
+        // We will free this error when we display it.
+        return createError(EXIT_MISC, STR_MISC, STR_BAD_THREADS);
     }
 
-    // Error not triggered. Free it.
-    free(badFileToConvert);
     return NULL;
 }
 
@@ -18,8 +18,11 @@ pgmError* checkInvalidMagicNo(unsigned short *magicNo, char *path);
 pgmError* checkInvalidDimensions(int width, int height, int scanned, char *path);
 pgmError* checkInvalidMaxGrayValue(int maxGray, int scanned, char *path);
 pgmError* checkImageAllocated(pgmImage *image);
+pgmError* checkAllocated(void *pointer);
 pgmError* checkRasterAllocated(unsigned char **raster, int width, int height);
 pgmError* checkRequiredData(pgmImage *image, char *path);
 pgmError* checkPixel(unsigned char pixel, int maxGray, int scanned, char *path);
 pgmError* checkPixelCount(int count, int expected, char *path);
+pgmError* checkInvalidFilter(int filter);
+pgmError* checkThreadCount(int invalid);
 int displayError(pgmError *err);
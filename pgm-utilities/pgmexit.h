@@ -6,6 +6,7 @@
 #define STR_REDUCED "REDUCED\n"
 #define STR_TILED "TILED\n"
 #define STR_ASSEMBLED "ASSEMBLED\n"
+#define STR_RESAMPLED "RESAMPLED\n"
 
 #define EXIT_BAD_ARGS_COUNT 1
 #define STR_BAD_ARGS_COUNT "ERROR: Bad Argument Count\n"
@@ -42,6 +43,8 @@
 #define STR_BAD_WRITE_MODE "Invalid write mode. Must either be 0 or 1"
 #define STR_COMMENT_LIMIT "Comment limit was reached"
 #define STR_BAD_FACTOR "Factor was not an integer greater than 0"
+#define STR_BAD_FILTER "Filter must be nearest, bilinear, bicubic or lanczos"
+#define STR_BAD_THREADS "Thread count given with -j must be an integer from 1 to 1024"
 #define STR_NO_TAGS "<row> and <column> tags were not found in output file name template"
 #define STR_NO_ROW_TAG "<row> tag was not found in output file name template"
 #define STR_NO_COL_TAG "<column> tag was not found in output file name template"
@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pgmfilter.h"
+#include "pgmthreads.h"
+
+#define PI 3.14159265358979323846
+
+// Number of output rows computed by each task.
+#define ROWS_PER_BAND 64
+
+
+/*
+ * Precomputed weights for resampling along one axis. Output point i takes a
+ * weighted sum of count[i] input points starting at first[i], with weights
+ * weights[i * taps] onwards. Rows of weights are padded with zeros up to taps.
+ */
+typedef struct weightTable
+{
+    int taps;
+    int *first;
+    int *count;
+    float *weights;
+} weightTable;
+
+
+/*
+ * Shared state for resampling an image in bands of output rows.
+ */
+typedef struct resampleJob
+{
+    unsigned char **input;
+    unsigned char **output;
+    int maxGray;
+    int outputWidth;
+    int outputHeight;
+    weightTable *columns;
+    weightTable *rows;
+    int *failed;
+} resampleJob;
+
+
+/*
+ * Returns the filter named on the command line, or -1 if there is no such filter.
+ */
+int parseFilter(char *name)
+{
+    if (strcmp(name, "nearest") == 0)
+        return NEAREST;
+    else if (strcmp(name, "bilinear") == 0)
+        return BILINEAR;
+    else if (strcmp(name, "bicubic") == 0)
+        return BICUBIC;
+    else if (strcmp(name, "lanczos") == 0)
+        return LANCZOS;
+
+    return -1;
+}
+
+
+/*
+ * Returns how far either side of its centre a filter reaches, in input points.
+ */
+static double filterSupport(int filter)
+{
+    if (filter == BILINEAR)
+        return 1;
+    else if (filter == BICUBIC)
+        return 2;
+    else
+        return 3;
+}
+
+
+/*
+ * Evaluates a filter at a distance from its centre, in input points.
+ */
+static double filterWeight(int filter, double x)
+{
+    x = fabs(x);
+
+    if (filter == BILINEAR)
+        return x < 1 ? 1 - x : 0;
+
+    // Keys' cubic convolution with a = -0.5.
+    if (filter == BICUBIC)
+    {
+        if (x < 1)
+            return (1.5 * x - 2.5) * x * x + 1;
+        else if (x < 2)
+            return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+
+        return 0;
+    }
+
+    // Three-lobed Lanczos.
+    if (x == 0)
+        return 1;
+    else if (x >= 3)
+        return 0;
+
+    return 3 * sin(PI * x) * sin(PI * x / 3) / (PI * PI * x * x);
+}
+
+
+/*
+ * Frees a weight table.
+ */
+static void freeWeights(weightTable *table)
+{
+    if (table != NULL)
+    {
+        free(table->first);
+        free(table->count);
+        free(table->weights);
+        free(table);
+    }
+}
+
+
+/*
+ * Computes the weights for resampling inputSize points to outputSize points with
+ * a filter. Points are treated as cells, so output point i is centred on input
+ * coordinate (i + 0.5) * inputSize / outputSize. When shrinking, the filter is
+ * stretched to cover every input point it replaces. Weights falling outside the
+ * input are dropped and the rest renormalised. Returns NULL if memory could not
+ * be allocated.
+ */
+static weightTable* createWeights(int inputSize, int outputSize, int filter)
+{
+    double scale = (double) inputSize / outputSize;
+    double stretch = scale > 1 ? scale : 1;
+    double support = filter == NEAREST ? 0 : filterSupport(filter) * stretch;
+
+    weightTable *table = (weightTable *) calloc(1, sizeof(weightTable));
+    if (table == NULL)
+        return NULL;
+
+    table->taps = filter == NEAREST ? 1 : (int) ceil(2 * support) + 1;
+    table->first = (int *) malloc(sizeof(int) * outputSize);
+    table->count = (int *) malloc(sizeof(int) * outputSize);
+    table->weights = (float *) calloc((size_t) outputSize * table->taps, sizeof(float));
+
+    if (table->first == NULL || table->count == NULL || table->weights == NULL)
+    {
+        freeWeights(table);
+        return NULL;
+    }
+
+    int i;
+    int j;
+    for (i = 0; i < outputSize; i++)
+    {
+        double centre = (i + 0.5) * scale;
+        float *weights = table->weights + (size_t) i * table->taps;
+
+        if (filter == NEAREST)
+        {
+            int nearest = (int) centre;
+            table->first[i] = nearest < inputSize ? nearest : inputSize - 1;
+            table->count[i] = 1;
+            weights[0] = 1;
+            continue;
+        }
+
+        int low = (int) ceil(centre - support - 0.5);
+        int high = (int) floor(centre + support - 0.5);
+        low = low > 0 ? low : 0;
+        high = high < inputSize - 1 ? high : inputSize - 1;
+
+        double total = 0;
+        for (j = low; j <= high && j - low < table->taps; j++)
+        {
+            weights[j - low] = filterWeight(filter, (j + 0.5 - centre) / stretch);
+            total += weights[j - low];
+        }
+
+        table->first[i] = low;
+        table->count[i] = j - low;
+
+        for (j = 0; j < table->count[i] && total != 0; j++)
+            weights[j] /= total;
+    }
+
+    return table;
+}
+
+
+/*
+ * Resamples one band of output rows. The input rows under the band are resampled
+ * horizontally into a buffer first, then combined vertically. The vertical loops
+ * run along contiguous rows so that they can be vectorized. Run by parallelFor()
+ * for each band index.
+ */
+static void resampleBand(int band, void *jobPointer)
+{
+    resampleJob *job = (resampleJob *) jobPointer;
+    weightTable *columns = job->columns;
+    weightTable *rows = job->rows;
+    int outputWidth = job->outputWidth;
+
+    int firstRow = band * ROWS_PER_BAND;
+    int lastRow = firstRow + ROWS_PER_BAND < job->outputHeight ? firstRow + ROWS_PER_BAND : job->outputHeight;
+
+    // The input rows under the band. Each output row's first input row is no lower than the last's.
+    int firstInput = rows->first[firstRow];
+    int lastInput = firstInput;
+
+    int row;
+    for (row = firstRow; row < lastRow; row++)
+    {
+        int end = rows->first[row] + rows->count[row];
+        lastInput = end > lastInput ? end : lastInput;
+    }
+
+    int inputRows = lastInput - firstInput;
+    float *values = (float *) malloc(sizeof(float) * inputRows * outputWidth);
+    float *value = (float *) malloc(sizeof(float) * outputWidth);
+
+    job->failed[band] = 1;
+    if (values == NULL || value == NULL)
+    {
+        free(values);
+        free(value);
+        return;
+    }
+
+    int x;
+    int tap;
+    for (row = 0; row < inputRows; row++)
+    {
+        unsigned char *pixels = job->input[firstInput + row];
+        float *horizontal = values + row * outputWidth;
+
+        for (x = 0; x < outputWidth; x++)
+        {
+            unsigned char *input = pixels + columns->first[x];
+            float *weights = columns->weights + x * columns->taps;
+            float sum = 0;
+
+            for (tap = 0; tap < columns->count[x]; tap++)
+                sum += weights[tap] * input[tap];
+
+            horizontal[x] = sum;
+        }
+    }
+
+    for (row = firstRow; row < lastRow; row++)
+    {
+        memset(value, 0, sizeof(float) * outputWidth);
+
+        for (tap = 0; tap < rows->count[row]; tap++)
+        {
+            float rowWeight = rows->weights[row * rows->taps + tap];
+            float *horizontal = values + (rows->first[row] + tap - firstInput) * outputWidth;
+
+            for (x = 0; x < outputWidth; x++)
+                value[x] += rowWeight * horizontal[x];
+        }
+
+        // Sharpening filters can overshoot the range of gray values.
+        for (x = 0; x < outputWidth; x++)
+        {
+            float pixel = roundf(value[x]);
+            pixel = pixel < MIN_PIXEL_VALUE ? MIN_PIXEL_VALUE : pixel;
+            pixel = pixel > job->maxGray ? job->maxGray : pixel;
+            job->output[row][x] = (unsigned char) pixel;
+        }
+    }
+
+    job->failed[band] = 0;
+    free(values);
+    free(value);
+}
+
+
+/*
+ * Resamples an image to outputWidth by outputHeight pixels with the given filter,
+ * returning a new image with the same max gray value and format. The filters are
+ * separable, so rows are resampled first and columns second, each with a table of
+ * weights computed once. Bands of output rows are resampled in parallel. Returns
+ * NULL if memory could not be allocated.
+ */
+pgmImage* resample(pgmImage *inputImage, int outputWidth, int outputHeight, int filter)
+{
+    int bands = (outputHeight + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+
+    pgmImage *resampledImage = createEmptyImage(outputWidth, outputHeight, getMaxGrayValue(inputImage), determineFormat(inputImage));
+
+    resampleJob job;
+    job.input = getRaster(inputImage);
+    job.maxGray = getMaxGrayValue(inputImage);
+    job.outputWidth = outputWidth;
+    job.outputHeight = outputHeight;
+    job.columns = createWeights(getWidth(inputImage), outputWidth, filter);
+    job.rows = createWeights(getHeight(inputImage), outputHeight, filter);
+    job.failed = (int *) malloc(sizeof(int) * bands);
+
+    int failed = resampledImage == NULL || job.columns == NULL || job.rows == NULL || job.failed == NULL;
+
+    if (failed == 0)
+    {
+        job.output = getRaster(resampledImage);
+        parallelFor(bands, resampleBand, &job);
+
+        int band;
+        for (band = 0; band < bands; band++)
+            failed |= job.failed[band];
+    }
+
+    if (failed && resampledImage != NULL)
+    {
+        freeImage(resampledImage);
+        resampledImage = NULL;
+    }
+
+    freeWeights(job.columns);
+    freeWeights(job.rows);
+    free(job.failed);
+    return resampledImage;
+}
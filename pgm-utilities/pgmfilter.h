@@ -0,0 +1,9 @@
+#include "pgmio.h"
+
+#define NEAREST 0
+#define BILINEAR 1
+#define BICUBIC 2
+#define LANCZOS 3
+
+int parseFilter(char *name);
+pgmImage* resample(pgmImage *inputImage, int outputWidth, int outputHeight, int filter);
@@ -10,7 +10,19 @@ typedef struct point
 } point;
 
 
-static pgmImage*** createTiles(pgmImage *image, int factor)
+/*
+ * Allocates memory from an arena, or from the heap when there is no arena.
+ */
+static void* allocate(pgmArena *arena, size_t size)
+{
+    if (arena != NULL)
+        return arenaAllocate(arena, size);
+
+    return malloc(size);
+}
+
+
+static pgmImage*** createTiles(pgmImage *image, int factor, pgmArena *arena)
 {
     // Calculate the width of right-most tiles.
     int tileRightWidth = (getWidth(image) / factor) + (getWidth(image) % factor);
@@ -26,11 +38,11 @@ static pgmImage*** createTiles(pgmImage *image, int factor)
     int row;
     int column;
 
-    pgmImage ***tiles = (pgmImage ***) malloc(sizeof(pgmImage **) * factor);
+    pgmImage ***tiles = (pgmImage ***) allocate(arena, sizeof(pgmImage **) * factor);
 
     for (row = 0; row < factor; row++)
     {
-        tiles[row] = (pgmImage **) malloc(sizeof(pgmImage *) * factor);
+        tiles[row] = (pgmImage **) allocate(arena, sizeof(pgmImage *) * factor);
     }
     
     // Initialise the tiles and set their dimensions.
@@ -40,22 +52,22 @@ static pgmImage*** createTiles(pgmImage *image, int factor)
         {
             if (row < factor - 1 && column < factor - 1)
             {
-                tiles[row][column] = createEmptyImage(tileWidth, tileHeight,
+                tiles[row][column] = createArenaEmptyImage(arena, tileWidth, tileHeight,
                     getMaxGrayValue(image), determineFormat(image));
             }
             else if (row < factor - 1 && column == factor - 1)
             {
-                tiles[row][column] = createEmptyImage(tileRightWidth, tileHeight, 
+                tiles[row][column] = createArenaEmptyImage(arena, tileRightWidth, tileHeight, 
                     getMaxGrayValue(image), determineFormat(image));
             }
             else if (row == factor - 1 && column < factor - 1)
             {
-                tiles[row][column] = createEmptyImage(tileWidth, tileBottomHeight,
+                tiles[row][column] = createArenaEmptyImage(arena, tileWidth, tileBottomHeight,
                     getMaxGrayValue(image), determineFormat(image));   
             }
             else if (row == factor - 1 && column == factor - 1)
             {
-                tiles[row][column] = createEmptyImage(tileRightWidth, tileBottomHeight,
+                tiles[row][column] = createArenaEmptyImage(arena, tileRightWidth, tileBottomHeight,
                     getMaxGrayValue(image), determineFormat(image));
             }
         }
@@ -99,13 +111,18 @@ static point** calculateReadPoints(pgmImage *image, pgmImage ***tiles, int facto
 }
 
 
-pgmImage*** tile(pgmImage *image, int factor)
+/*
+ * Splits the image into factor x factor tiles. If an arena is given, the tiles
+ * and their arrays are allocated from it and are released with the arena, which
+ * saves allocating and freeing each tile at large factors.
+ */
+pgmImage*** tile(pgmImage *image, int factor, pgmArena *arena)
 {
     /* 
      * We need to split the input image into (factor * factor) smaller images. We
      * need an array of (factor * factor) image structs.
      */
-    pgmImage ***imageTiles = createTiles(image, factor);
+    pgmImage ***imageTiles = createTiles(image, factor, arena);
 
     // Calculate the coordinates where each tile begins (top-left corner).
     point **readPoints = calculateReadPoints(image, imageTiles, factor);
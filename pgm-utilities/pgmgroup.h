@@ -1,4 +1,4 @@
 #include "pgmio.h"
 
-pgmImage*** tile(pgmImage *image, int factor);
+pgmImage*** tile(pgmImage *image, int factor, pgmArena *arena);
 int addImage(pgmImage *parent, pgmImage *child, int startRow, int startColumn);
@@ -3,6 +3,13 @@
 #include "pgmdata.h"
 #include "pgmlimits.h"
 #include "pgmerror.h"
+#include "pgmcpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 // Used to signal file errors to the programs that include this module.
 pgmError *error = NULL;
@@ -276,13 +283,131 @@ static void readAsciiData(pgmImage *image, FILE *file, char *path, int *line)
 
 
 /*
- * Reads the image raster, interpreting it as raw byte data. Can return an error.
+ * Returns the index of the first of count pixels from first onwards that is
+ * above the maximum gray value, or count if there is none. This is the scalar
+ * kernel, and the vector kernels finish with it.
+ */
+static int findPixelAboveFrom(unsigned char *pixels, int first, int count, int maxGray)
+{
+    int x = first;
+    while (x < count && pixels[x] <= maxGray)
+        x++;
+
+    return x;
+}
+
+
+/*
+ * The vector kernels compare a block of pixels at a time with the maximum gray
+ * value, and stop at the first block holding a pixel above it so that the
+ * scalar kernel can find which.
+ */
+#if defined(__x86_64__)
+static int findPixelAboveSSE2(unsigned char *pixels, int count, int maxGray)
+{
+    __m128i limit = _mm_set1_epi8((char) maxGray);
+    int x;
+
+    // A pixel is above the limit when the larger of the two is not the limit.
+    for (x = 0; x + 16 <= count; x += 16)
+    {
+        __m128i block = _mm_loadu_si128((__m128i *) (pixels + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(block, limit), limit)) != 0xFFFF)
+            break;
+    }
+
+    return findPixelAboveFrom(pixels, x, count, maxGray);
+}
+
+
+__attribute__((target("avx2")))
+static int findPixelAboveAVX2(unsigned char *pixels, int count, int maxGray)
+{
+    __m256i limit = _mm256_set1_epi8((char) maxGray);
+    int x;
+
+    for (x = 0; x + 32 <= count; x += 32)
+    {
+        __m256i block = _mm256_loadu_si256((__m256i *) (pixels + x));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(block, limit), limit)) != -1)
+            break;
+    }
+
+    return findPixelAboveFrom(pixels, x, count, maxGray);
+}
+
+
+__attribute__((target("avx512bw")))
+static int findPixelAboveAVX512(unsigned char *pixels, int count, int maxGray)
+{
+    __m512i limit = _mm512_set1_epi8((char) maxGray);
+    int x;
+
+    for (x = 0; x + 64 <= count; x += 64)
+    {
+        if (_mm512_cmpgt_epu8_mask(_mm512_loadu_si512(pixels + x), limit) != 0)
+            break;
+    }
+
+    return findPixelAboveFrom(pixels, x, count, maxGray);
+}
+#elif defined(__aarch64__)
+static int findPixelAboveNEON(unsigned char *pixels, int count, int maxGray)
+{
+    int x;
+
+    for (x = 0; x + 16 <= count; x += 16)
+    {
+        if (vmaxvq_u8(vld1q_u8(pixels + x)) > maxGray)
+            break;
+    }
+
+    return findPixelAboveFrom(pixels, x, count, maxGray);
+}
+#endif
+
+
+/*
+ * Returns the index of the first of count pixels that is above the maximum gray
+ * value, or count if there is none, with the kernel for the instruction set
+ * getSimdLevel() chooses.
+ */
+static int findPixelAbove(unsigned char *pixels, int count, int maxGray)
+{
+    // No pixel can be above the largest maximum gray value.
+    if (maxGray >= MAX_GRAY_VALUE)
+        return count;
+
+    switch (getSimdLevel())
+    {
+#if defined(__x86_64__)
+        case SIMD_AVX512:
+            return findPixelAboveAVX512(pixels, count, maxGray);
+        case SIMD_AVX2:
+            return findPixelAboveAVX2(pixels, count, maxGray);
+        case SIMD_SSE2:
+            return findPixelAboveSSE2(pixels, count, maxGray);
+#elif defined(__aarch64__)
+        case SIMD_NEON:
+            return findPixelAboveNEON(pixels, count, maxGray);
+#endif
+        default:
+            return findPixelAboveFrom(pixels, 0, count, maxGray);
+    }
+}
+
+
+/*
+ * Reads the image raster, interpreting it as raw byte data. Each row is read
+ * straight into the image in one call and then checked with the vector kernel.
+ * Can return an error.
  */
 static void readRawData(pgmImage *image, FILE *file, char *path)
 {
+    int width = getWidth(image);
+    int maxGray = getMaxGrayValue(image);
+    unsigned char **raster = getRaster(image);
     int row;
-    int column;
-    int scanCount = 0;
     int pixelsRead = 0;
     unsigned char pixel = 0;
 
@@ -292,24 +417,22 @@ static void readRawData(pgmImage *image, FILE *file, char *path)
     // Start reading the binary raster data.
     for (row = 0; row < getHeight(image); row++)
     {   
-        for (column = 0; column < getWidth(image); column++)
-        {
-            scanCount = fread(&pixel, 1, 1, file);
+        int scanCount = fread(raster[row], 1, width, file);
 
-            // Check that the requested number of bytes was read.
-            error = checkBinaryEOF(scanCount, path);
-            if (error != NULL)
-                return;
+        // Check that the pixels we read are within valid range, before checking that none were missing.
+        int invalid = findPixelAbove(raster[row], scanCount, maxGray);
+        if (invalid < scanCount)
+        {
+            error = checkPixel(raster[row][invalid], maxGray, 1, path);
+            return;
+        }
 
-            // Check that the pixel we read is within valid range.
-            error = checkPixel(pixel, getMaxGrayValue(image), scanCount, path);
-            if (error != NULL)
-                return;
+        // Check that the requested number of bytes was read.
+        error = checkBinaryEOF(scanCount == width, path);
+        if (error != NULL)
+            return;
 
-            // Set the value if check passes.
-            setPixel(image, pixel, row, column);
-            pixelsRead++;
-        }
+        pixelsRead += scanCount;
     }
 
     // Check whether the file contains more data than expected.
@@ -367,14 +490,16 @@ static void readRaster(pgmImage *image, FILE *file, char *filePath, int *line)
 
 
 /*
- * Opens the file in read binary mode, and reads the image data. Data in the
+ * Opens the file in read binary mode, and reads the image data into an image
+ * allocated from the arena, or from the heap if the arena is NULL. Data in the
  * header should be encoded in plaintext ASCII. The magic number is used to 
  * determine whether we need to interpret the raster data as bytes or ASCII.
  * Returns NULL if read failed.
  */
-pgmImage* readImage(char *filePath)
+pgmImage* readArenaImage(pgmArena *arena, char *filePath)
 {
     error = NULL;
+    pgmImage *newImage = NULL;
 
     // Record line number so that we can track comment positions before raster data.
     int line;
@@ -393,7 +518,7 @@ pgmImage* readImage(char *filePath)
         goto cleanup;
 
     // Initialise the image.
-    pgmImage *newImage = createImage();
+    newImage = createArenaImage(arena);
 
     // Check that the image was allocated memory correctly.
     error = checkImageAllocated(newImage);
@@ -448,12 +573,25 @@ pgmImage* readImage(char *filePath)
         fclose(inputFile);
     
     if (error != NULL)
+    {
+        freeImage(newImage);
         return NULL;
+    }
     
     return newImage;
 }
 
 
+/*
+ * Opens the file in read binary mode, and reads the image data into an image
+ * allocated from the heap. Returns NULL if read failed.
+ */
+pgmImage* readImage(char *filePath)
+{
+    return readArenaImage(NULL, filePath);
+}
+
+
 /*
  * Writes consecutive comment lines that appeared in the read image.
  */
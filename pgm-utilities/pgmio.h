@@ -6,5 +6,6 @@
 extern pgmError *error;
 
 pgmImage* readImage(char *filePath);
+pgmImage* readArenaImage(pgmArena *arena, char *filePath);
 void echoImage(pgmImage *image, char *filePath);
 void convert(pgmImage *image, char *filePath, int binaryOrAscii);
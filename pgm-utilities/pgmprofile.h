@@ -0,0 +1,9 @@
+#define PHASE_ARGS 0
+#define PHASE_READ 1
+#define PHASE_COMPUTE 2
+#define PHASE_WRITE 3
+#define PHASE_FREE 4
+
+void startProfile(int *argc, char **argv);
+void profilePhase(int phase);
+void countAllocation();
@@ -1,5 +1,13 @@
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include "pgmdata.h"
+#include "pgmthreads.h"
+#include "pgmcpu.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 static pgmImage* initialiseReduced(pgmImage *image, int factor)
 {
@@ -16,40 +24,456 @@ static pgmImage* initialiseReduced(pgmImage *image, int factor)
     return reduced;
 } 
 
-pgmImage* reduce(pgmImage *inputImage, int factor)
+/*
+ * Pixels of the reduced image averaged at once by the separable mean kernels, so
+ * that their column sums fit on the stack.
+ */
+#define MEAN_CHUNK_PIXELS 256
+
+
+/*
+ * A kernel that keeps every factor-th pixel of one row of the input, making
+ * width pixels of the reduced row.
+ */
+typedef void (*sampleKernel)(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor);
+
+/*
+ * A kernel that averages blocks of rows x factor pixels, from the rows of the
+ * input starting at input[0], making width pixels of the reduced row.
+ */
+typedef void (*meanKernel)(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor);
+
+
+/*
+ * Removes a --mean flag from anywhere in the arguments, so the program sees only
+ * its own. Returns 1 if one was given and 0 otherwise.
+ */
+int takeMeanFlag(int *argc, char **argv)
 {
-    // Initialise reduced image using the input image and factor.
-    pgmImage *reducedImage = initialiseReduced(inputImage, factor);
+    int kept = 1;
+    int found = 0;
+    int x;
 
-    unsigned char pixel = 0;
-    int row;
+    for (x = 1; x < *argc; x++)
+    {
+        if (strcmp(argv[x], "--mean") == 0)
+            found = 1;
+        else
+            argv[kept++] = argv[x];
+    }
+
+    argv[kept] = NULL;
+    *argc = kept;
+    return found;
+}
+
+
+/*
+ * Keeps every factor-th pixel of a row from the reduced column firstColumn up
+ * to width. Every kernel finishes its row with this, and it is the generic
+ * kernel for factors without one of their own.
+ */
+static void sampleColumns(unsigned char *input, unsigned char *output, int firstColumn, int width, int factor)
+{
     int column;
-    int smallerRow = 0;
-    int smallerColumn = 0;
+    for (column = firstColumn; column < width; column++)
+        output[column] = input[(long) column * factor];
+}
 
-    for (row = 0; row < getHeight(inputImage); row++)
+
+static void sampleRow(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor)
+{
+    sampleColumns(input, output, 0, width, factor);
+}
+
+
+#ifdef __SSE2__
+/*
+ * Returns the even pixels of the thirty-two in low and high, in order.
+ */
+static inline __m128i selectEven(__m128i low, __m128i high)
+{
+    // Clear the odd pixel of each pair, then pack the pairs.
+    __m128i evens = _mm_set1_epi16(0x00FF);
+    return _mm_packus_epi16(_mm_and_si128(low, evens), _mm_and_si128(high, evens));
+}
+#endif
+
+
+/*
+ * The kernels for factors 2, 4 and 8 make sixteen pixels at a time by selecting
+ * the even pixels once, twice or three times. Each stops where its next sixteen
+ * pixels would read past the end of the input row.
+ */
+static void sampleRowBy2(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 16) * 2 <= inputWidth; column += 16)
     {
-        if (smallerRow > getHeight(reducedImage) - 1)
+        __m128i *pixels = (__m128i *) (input + column * 2);
+        _mm_storeu_si128((__m128i *) (output + column),
+            selectEven(_mm_loadu_si128(pixels), _mm_loadu_si128(pixels + 1)));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 2);
+}
+
+
+static void sampleRowBy4(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 16) * 4 <= inputWidth; column += 16)
+    {
+        __m128i *pixels = (__m128i *) (input + column * 4);
+        __m128i low = selectEven(_mm_loadu_si128(pixels), _mm_loadu_si128(pixels + 1));
+        __m128i high = selectEven(_mm_loadu_si128(pixels + 2), _mm_loadu_si128(pixels + 3));
+        _mm_storeu_si128((__m128i *) (output + column), selectEven(low, high));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 4);
+}
+
+
+static void sampleRowBy8(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor)
+{
+    int level = getSimdLevel();
+    int column = 0;
+
+#ifdef __SSE2__
+    for (; level >= SIMD_SSE2 && (column + 16) * 8 <= inputWidth; column += 16)
+    {
+        __m128i *pixels = (__m128i *) (input + column * 8);
+        __m128i quarters[4];
+        int quarter;
+
+        for (quarter = 0; quarter < 4; quarter++)
+            quarters[quarter] = selectEven(_mm_loadu_si128(pixels + quarter * 2),
+                _mm_loadu_si128(pixels + quarter * 2 + 1));
+
+        __m128i low = selectEven(quarters[0], quarters[1]);
+        __m128i high = selectEven(quarters[2], quarters[3]);
+        _mm_storeu_si128((__m128i *) (output + column), selectEven(low, high));
+    }
+#endif
+
+    sampleColumns(input, output, column, width, 8);
+}
+
+
+// A fixed stride of 10 pixels is too sparse to shuffle, so it is copied pixel by pixel.
+static void sampleRowBy10(unsigned char *input, int inputWidth, unsigned char *output, int width, int factor)
+{
+    sampleColumns(input, output, 0, width, 10);
+}
+
+
+/*
+ * Averages each block of a row from the reduced column firstColumn up to width,
+ * rounding halves up. Blocks at the right edge of the input are narrower. Every
+ * kernel finishes its row with this, and it is the generic kernel for factors
+ * without one of their own.
+ */
+static void meanColumns(unsigned char **input, int rows, int inputWidth, unsigned char *output,
+                int firstColumn, int width, int factor)
+{
+    int column;
+    int row;
+    int pixel;
+
+    for (column = firstColumn; column < width; column++)
+    {
+        int first = column * factor;
+        int end = first + factor < inputWidth ? first + factor : inputWidth;
+        int count = rows * (end - first);
+
+        // Wide blocks of bright pixels pass 2^31, so the sum is kept in 64 bits.
+        int64_t sum = 0;
+
+        for (row = 0; row < rows; row++)
+            for (pixel = first; pixel < end; pixel++)
+                sum += input[row][pixel];
+
+        output[column] = (sum + count / 2) / count;
+    }
+}
+
+
+static void meanRow(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    meanColumns(input, rows, inputWidth, output, 0, width, factor);
+}
+
+
+/*
+ * Averages 2 x 2 blocks sixteen at a time. The even and odd pixels of each row
+ * are widened to 16 bits and added, and the sums rounded and divided by four
+ * with a shift. The last row of an input with an odd height is averaged by
+ * meanColumns().
+ */
+static void meanRowBy2(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    int column = 0;
+
+#ifdef __SSE2__
+    if (rows == 2 && getSimdLevel() >= SIMD_SSE2)
+    {
+        __m128i evens = _mm_set1_epi16(0x00FF);
+        __m128i two = _mm_set1_epi16(2);
+
+        for (; (column + 16) * 2 <= inputWidth; column += 16)
         {
-            break;
+            __m128i sums[2] = {two, two};
+            int row;
+            int half;
+
+            for (row = 0; row < 2; row++)
+            {
+                for (half = 0; half < 2; half++)
+                {
+                    __m128i pixels = _mm_loadu_si128((__m128i *) (input[row] + column * 2) + half);
+                    sums[half] = _mm_add_epi16(sums[half],
+                        _mm_add_epi16(_mm_and_si128(pixels, evens), _mm_srli_epi16(pixels, 8)));
+                }
+            }
+
+            _mm_storeu_si128((__m128i *) (output + column),
+                _mm_packus_epi16(_mm_srli_epi16(sums[0], 2), _mm_srli_epi16(sums[1], 2)));
         }
+    }
+#endif
+
+    meanColumns(input, rows, inputWidth, output, column, width, 2);
+}
+
+
+/*
+ * Averages blocks separably, for the factors too wide to average a block in one
+ * vector. Each input column is summed down the block for a chunk of the row,
+ * sixteen columns at a time, and each block is then the sum of factor of these
+ * column sums.
+ */
+static void meanRowSeparable(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    unsigned short sums[MEAN_CHUNK_PIXELS * 10];
+    int level = getSimdLevel();
+    int firstColumn;
+
+    for (firstColumn = 0; firstColumn < width; firstColumn += MEAN_CHUNK_PIXELS)
+    {
+        int columns = width - firstColumn < MEAN_CHUNK_PIXELS ? width - firstColumn : MEAN_CHUNK_PIXELS;
+        int first = firstColumn * factor;
+        int end = first + columns * factor < inputWidth ? first + columns * factor : inputWidth;
+        int row;
+        int pixel;
+
+        for (pixel = 0; pixel < end - first; pixel++)
+            sums[pixel] = 0;
 
-        for (column = 0; column < getWidth(inputImage); column++)
+        for (row = 0; row < rows; row++)
         {
-            pixel = getPixel(inputImage, row, column);
-            
-            if (row % factor == 0 && column % factor == 0)
+            unsigned char *inputRow = input[row] + first;
+            pixel = 0;
+
+#ifdef __SSE2__
+            __m128i zero = _mm_setzero_si128();
+
+            for (; level >= SIMD_SSE2 && pixel + 16 <= end - first; pixel += 16)
             {
-                setPixel(reducedImage, pixel, smallerRow, smallerColumn);
-                smallerColumn++;
+                __m128i pixels = _mm_loadu_si128((__m128i *) (inputRow + pixel));
+                __m128i *columnSums = (__m128i *) (sums + pixel);
 
-                if (smallerColumn > getWidth(reducedImage) - 1)
-                    smallerRow++;
+                // Widen the pixels to 16 bits by unpacking them with zeros.
+                _mm_storeu_si128(columnSums, _mm_add_epi16(_mm_loadu_si128(columnSums),
+                    _mm_unpacklo_epi8(pixels, zero)));
+                _mm_storeu_si128(columnSums + 1, _mm_add_epi16(_mm_loadu_si128(columnSums + 1),
+                    _mm_unpackhi_epi8(pixels, zero)));
             }
+#endif
+
+            for (; pixel < end - first; pixel++)
+                sums[pixel] += inputRow[pixel];
         }
 
-        smallerColumn = 0;
+        int column;
+        for (column = 0; column < columns; column++)
+        {
+            int blockEnd = (column + 1) * factor < end - first ? (column + 1) * factor : end - first;
+            int count = rows * (blockEnd - column * factor);
+            int sum = 0;
+
+            for (pixel = column * factor; pixel < blockEnd; pixel++)
+                sum += sums[pixel];
+
+            output[firstColumn + column] = (sum + count / 2) / count;
+        }
     }
+}
+
+
+/*
+ * The kernels for factors 4, 8 and 10 share the separable kernel, called with a
+ * constant factor so that the compiler can unroll the block sums.
+ */
+static void meanRowBy4(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 4);
+}
+
+
+static void meanRowBy8(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 8);
+}
+
+
+static void meanRowBy10(unsigned char **input, int rows, int inputWidth, unsigned char *output, int width, int factor)
+{
+    meanRowSeparable(input, rows, inputWidth, output, width, 10);
+}
+
+
+/*
+ * Returns the kernel keeping every factor-th pixel: one of its own for the
+ * common factors, and the generic strided kernel for any other.
+ */
+static sampleKernel chooseSampleKernel(int factor)
+{
+    switch (factor)
+    {
+        case 2:
+            return sampleRowBy2;
+        case 4:
+            return sampleRowBy4;
+        case 8:
+            return sampleRowBy8;
+        case 10:
+            return sampleRowBy10;
+        default:
+            return sampleRow;
+    }
+}
+
+
+/*
+ * Returns the kernel averaging factor x factor blocks, chosen as
+ * chooseSampleKernel() chooses.
+ */
+static meanKernel chooseMeanKernel(int factor)
+{
+    switch (factor)
+    {
+        case 2:
+            return meanRowBy2;
+        case 4:
+            return meanRowBy4;
+        case 8:
+            return meanRowBy8;
+        case 10:
+            return meanRowBy10;
+        default:
+            return meanRow;
+    }
+}
+
+
+/*
+ * The image being reduced, the reduced image, the factor, and the kernel making
+ * each reduced row: sample keeps the top-left pixel of each block, and mean,
+ * when it is set, averages the block instead.
+ */
+typedef struct reduction
+{
+    pgmImage *inputImage;
+    pgmImage *reducedImage;
+    int factor;
+    sampleKernel sample;
+    meanKernel mean;
+} reduction;
+
+
+/*
+ * Makes a band of rows of the reduced image with the reduction's kernel. Run by
+ * parallelRows() for each band.
+ */
+static void reduceRows(int firstRow, int rows, void *reductionPointer)
+{
+    reduction *job = (reduction *) reductionPointer;
+    unsigned char **input = getRaster(job->inputImage);
+    unsigned char **reduced = getRaster(job->reducedImage);
+    int inputWidth = getWidth(job->inputImage);
+    int inputHeight = getHeight(job->inputImage);
+    int width = getWidth(job->reducedImage);
+
+    int row;
+
+    for (row = firstRow; row < firstRow + rows; row++)
+    {
+        int inputRow = row * job->factor;
+
+        if (job->mean != NULL)
+        {
+            // The last block of rows is shorter when the height is not a multiple of the factor.
+            int blockRows = inputHeight - inputRow < job->factor ? inputHeight - inputRow : job->factor;
+            job->mean(input + inputRow, blockRows, inputWidth, reduced[row], width, job->factor);
+        }
+        else
+        {
+            job->sample(input[inputRow], inputWidth, reduced[row], width, job->factor);
+        }
+    }
+}
+
+
+/*
+ * Makes the reduced image with the reduction, in bands of rows in parallel.
+ * Returns NULL if the reduced image could not be allocated.
+ */
+static pgmImage* runReduction(pgmImage *inputImage, int factor, int mean)
+{
+    // Initialise reduced image using the input image and factor.
+    pgmImage *reducedImage = initialiseReduced(inputImage, factor);
+    if (reducedImage == NULL)
+        return NULL;
+
+    reduction job;
+    job.inputImage = inputImage;
+    job.reducedImage = reducedImage;
+    job.factor = factor;
+    job.sample = chooseSampleKernel(factor);
+    job.mean = mean ? chooseMeanKernel(factor) : NULL;
+
+    parallelRows(getHeight(reducedImage), getWidth(reducedImage), reduceRows, &job);
 
     return reducedImage;
 }
+
+
+/*
+ * Reduces the image by the factor, keeping the pixel at the top-left of each
+ * factor x factor block. Bands of rows of the reduced image are made in parallel.
+ * Returns NULL if the reduced image could not be allocated.
+ */
+pgmImage* reduce(pgmImage *inputImage, int factor)
+{
+    return runReduction(inputImage, factor, 0);
+}
+
+
+/*
+ * Reduces the image by the factor as reduce() does, but gives each pixel of the
+ * reduced image the mean of its factor x factor block, rounding halves up.
+ * Blocks at the right and bottom edges are clipped to the image. Returns NULL if
+ * the reduced image could not be allocated.
+ */
+pgmImage* reduceMean(pgmImage *inputImage, int factor)
+{
+    return runReduction(inputImage, factor, 1);
+}
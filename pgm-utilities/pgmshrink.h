@@ -1,3 +1,5 @@
 #include "pgmio.h"
 
+int takeMeanFlag(int *argc, char **argv);
 pgmImage* reduce(pgmImage *inputImage, int factor);
+pgmImage* reduceMean(pgmImage *inputImage, int factor);
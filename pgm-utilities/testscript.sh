@@ -23,7 +23,7 @@ passed=0
 failed=0
 
 # Hide the output of makefile all target
-make all > /dev/null
+make all pgmBench > /dev/null
 
 echo -n Test 1: Usage message displayed when no arguments are given to pgmEcho
 exeOut="$(./pgmEcho)"
@@ -785,6 +785,250 @@ fi
 numberOfTests=$((numberOfTests+1))
 
 
+echo -n Test 53: Usage message displayed when no arguments are given to pgmResample
+exeOut="$(./pgmResample)"
+expected="Usage: ./pgmResample inputImage.pgm width height outputImage.pgm [filter]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 54: pgmResample rejects an unknown filter
+exeOut="$(./pgmResample pgmImages/baboon.pgm 100 100 output.pgm blur)"
+expected="ERROR: Miscellaneous (Filter must be nearest, bilinear, bicubic or lanczos)"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 55: pgmResample leaves an image unchanged when resampling to its own size
+exeOut="$(./pgmResample pgmImages/baboon.pgm 512 512 output.pgm lanczos)"
+expected="RESAMPLED"
+exeCompOut="$(./pgmComp pgmImages/baboon.pgm output.pgm)"
+expectedComp="IDENTICAL"
+if [[ $exeOut = $expected ]]; then
+    if [[ $exeCompOut = $expectedComp ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        assertionFailed "\${exeCompOut}" "\${expectedComp}"
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 56: pgmResample writes an image of the requested size
+exeOut="$(./pgmResample pgmImages/baboon.pgm 300 200 output.pgm bicubic)"
+expected="RESAMPLED"
+header="$(head -n 2 output.pgm | tr '\n' ' ')"
+if [[ $exeOut = $expected ]]; then
+    if [[ $header = "P5 300 200 " ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Output file had the wrong dimensions
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 57: Usage message displayed when no arguments are given to pgmBench
+exeOut="$(./pgmBench)"
+expected="Usage: ./pgmBench width height [repeats] [scratchDirectory]"
+if [[ $exeOut = "$expected" ]]; then
+    printPassed
+    passed=$((passed+1))
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 58: pgmBench prints a timing line for every benchmark and removes its scratch files
+exeOut="$(./pgmBench 120 90 1 .)"
+header="$(echo "$exeOut" | head -n 1)"
+benchmarks="$(echo "$exeOut" | grep -c ',120,90,')"
+if [[ $header = "benchmark,width,height,seconds,mb_per_second,samples_per_second,peak_rss_kb" && $benchmarks = 9 ]]; then
+    if [[ ! -e pgmBench.pgm && ! -e pgmBenchAscii.pgm ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Scratch files were left behind
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "9 benchmarks" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+
+
+echo -n Test 59: --profile prints the time of each phase and the counters of a program on stderr
+exeOut="$(./pgmEcho --profile pgmImages/baboon.pgm output.pgm 2> profile.txt)"
+expected="ECHOED"
+phases="$(grep -cE '^(args|read|compute|write|free|total) +[0-9.]+ s$' profile.txt)"
+counters="$(grep -cE '^(bytes read|bytes written|allocations|peak RSS) +[0-9]+( KB)?$' profile.txt)"
+if [[ $exeOut = $expected ]]; then
+    if [[ $(head -n 1 profile.txt) = "PROFILE pgmEcho" && $phases = 6 && $counters = 4 ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        assertionFailed "text profile" "$(cat profile.txt)"
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm profile.txt
+
+
+echo -n Test 60: pgmTile at a large factor and pgmAssemble of every tile reproduce the image
+exeOut="$(./pgmTile pgmImages/baboon.pgm 16 tile_\<row\>_\<column\>.pgm)"
+expected="TILED"
+tuples=""
+for row in {0..15}; do
+    for column in {0..15}; do
+        tuples="$tuples $((row*32)) $((column*32)) tile_${row}_${column}.pgm"
+    done
+done
+./pgmAssemble assembled.pgm 512 512 $tuples > /dev/null
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(./pgmComp assembled.pgm pgmImages/baboon.pgm)" = "IDENTICAL" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Assembled image differed from the tiled image
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm tile_*.pgm assembled.pgm
+
+echo -n Test 61: pgmReduce gives the same image on any number of threads set with -j or PGM_THREADS
+./pgmReduce pgmImages/baboon.pgm 3 single.pgm -j 1 > /dev/null
+exeOut="$(PGM_THREADS=3 ./pgmReduce -j5 pgmImages/baboon.pgm 3 parallel.pgm)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    if cmp -s single.pgm parallel.pgm && [[ "$(./pgmReduce pgmImages/baboon.pgm 3 parallel.pgm -j 0)" = "ERROR: Miscellaneous (Thread count given with -j must be an integer from 1 to 1024)" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Threaded reduction differed, or an invalid thread count was accepted
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f single.pgm parallel.pgm
+
+echo -n Test 62: pgmReduce --mean averages each block of pixels, rounding halves up
+{ echo P2; echo 64 4; echo 255; for value in 10 13 10 13; do printf "$value %.0s" $(seq 64); echo; done; } > blocks.pgm
+{ echo P2; echo 32 2; echo 255; printf "12 %.0s" $(seq 64); echo; } > halves.pgm
+{ echo P2; echo 16 1; echo 255; printf "12 %.0s" $(seq 16); echo; } > quarters.pgm
+exeOut="$(./pgmReduce --mean blocks.pgm 2 output.pgm)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    ./pgmReduce blocks.pgm 4 reduced.pgm --mean > /dev/null
+    if [[ "$(./pgmComp output.pgm halves.pgm)" = "IDENTICAL" && "$(./pgmComp reduced.pgm quarters.pgm)" = "IDENTICAL" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Averaged image was wrong
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f blocks.pgm halves.pgm quarters.pgm output.pgm reduced.pgm
+
+echo -n Test 63: PGM_SIMD=scalar turns off the vector kernels without changing any output
+exeOut="$(PGM_SIMD=scalar ./pgmReduce pgmImages/baboon.pgm 2 scalar.pgm --mean --profile 2> profile.txt)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    ./pgmReduce pgmImages/baboon.pgm 2 vector.pgm --mean > /dev/null
+    if cmp -s scalar.pgm vector.pgm && [[ "$(grep -E '^simd +' profile.txt)" =~ scalar$ ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo Scalar output differed, or the profile did not report the scalar kernels
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f scalar.pgm vector.pgm profile.txt
+
+echo -n Test 64: pgmReduce --mean averages blocks whose sum does not fit in 32 bits
+# A 2910 x 2910 image of gray 254 reduced by 2910 sums 2.15 billion.
+(printf 'P5\n2910 2910\n255\n'; head -c $((2910*2910)) /dev/zero | tr '\0' '\376') > bright.pgm
+exeOut="$(./pgmReduce bright.pgm 2910 reduced.pgm --mean)"
+expected="REDUCED"
+if [[ $exeOut = $expected ]]; then
+    if [[ "$(tail -c 1 reduced.pgm | od -An -tu1 | tr -d ' ')" = "254" ]]; then
+        printPassed
+        passed=$((passed+1))
+    else
+        printFailed
+        failed=$((failed+1))
+        echo The block should average 254
+    fi
+else
+    printFailed
+    failed=$((failed+1))
+    assertionFailed "\${expected}" "\${exeOut}"
+fi
+numberOfTests=$((numberOfTests+1))
+rm -f bright.pgm reduced.pgm
+
 # Test Summary
 echo Test Summary:
 echo "Tests Passed: $passed/$numberOfTests"